@@ -29,6 +29,8 @@ b2BroadPhase::b2BroadPhase()
 	m_moveCapacity = 16;
 	m_moveCount = 0;
 	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+
+	m_adaptive = false;
 }
 
 b2BroadPhase::~b2BroadPhase()
@@ -45,22 +47,56 @@ int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 	return proxyId;
 }
 
+int32 b2BroadPhase::CreateStaticProxy(const b2AABB& aabb, void* userData)
+{
+	if (m_grid.Accepts(aabb) == false)
+	{
+		return CreateProxy(aabb, userData);
+	}
+
+	int32 proxyId = m_grid.CreateProxy(aabb, userData) | e_gridProxy;
+	++m_proxyCount;
+	BufferMove(proxyId);
+	return proxyId;
+}
+
 void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
 	--m_proxyCount;
-	m_tree.DestroyProxy(proxyId);
+	if (IsGridProxy(proxyId))
+	{
+		m_grid.DestroyProxy(proxyId & ~e_gridProxy);
+	}
+	else
+	{
+		m_tree.DestroyProxy(proxyId);
+	}
 }
 
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
-	bool buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	bool buffer;
+	if (IsGridProxy(proxyId))
+	{
+		buffer = m_grid.MoveProxy(proxyId & ~e_gridProxy, aabb, displacement);
+	}
+	else
+	{
+		buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	}
+
 	if (buffer)
 	{
 		BufferMove(proxyId);
 	}
 }
 
+void b2BroadPhase::SetStaticGrid(const b2Vec2& lower, float32 cellSize, int32 width, int32 height)
+{
+	m_grid.Set(lower, cellSize, width, height);
+}
+
 void b2BroadPhase::TouchProxy(int32 proxyId)
 {
 	BufferMove(proxyId);
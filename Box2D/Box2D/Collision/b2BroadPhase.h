@@ -22,6 +22,7 @@
 #include <Box2D/Common/b2Settings.h>
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Collision/b2StaticGrid.h>
 #include <algorithm>
 
 struct b2Pair
@@ -30,6 +31,8 @@ struct b2Pair
 	int32 proxyIdB;
 };
 
+template <typename T> struct b2GridCallback;
+
 /// The broad-phase is used for computing pairs and performing volume queries and ray casts.
 /// This broad-phase does not persist pairs. Instead, this reports potentially new pairs.
 /// It is up to the client to consume the new pairs and to track subsequent overlap.
@@ -39,7 +42,8 @@ public:
 
 	enum
 	{
-		e_nullProxy = -1
+		e_nullProxy = -1,
+		e_gridProxy = 0x40000000
 	};
 
 	b2BroadPhase();
@@ -49,6 +53,11 @@ public:
 	/// UpdatePairs is called.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
 
+	/// Create a proxy that will never move on its own, e.g. for a fixture of
+	/// a static body. The proxy goes into the static grid if it fits there,
+	/// otherwise into the tree.
+	int32 CreateStaticProxy(const b2AABB& aabb, void* userData);
+
 	/// Destroy a proxy. It is up to the client to remove any pairs.
 	void DestroyProxy(int32 proxyId);
 
@@ -99,6 +108,26 @@ public:
 	/// Get the quality metric of the embedded tree.
 	float32 GetTreeQuality() const;
 
+	/// Enable/disable rebuilding the embedded tree when its quality drops.
+	void SetAdaptive(bool flag) { m_adaptive = flag; }
+	bool GetAdaptive() const { return m_adaptive; }
+
+	/// Lay out a grid for static proxies, e.g. over the tiles of a level.
+	/// Static proxies created afterwards that are no larger than a cell are
+	/// kept in the grid instead of the tree. There must be no proxies in a
+	/// previous grid.
+	void SetStaticGrid(const b2Vec2& lower, float32 cellSize, int32 width, int32 height);
+
+	/// Get the number of proxies in the static grid.
+	int32 GetStaticGridProxyCount() const { return m_grid.GetProxyCount(); }
+
+	/// Collect the proxies created from now on and insert them in one go.
+	/// Do not query the broad-phase before calling EndBulkInsert.
+	void BeginBulkInsert();
+
+	/// Insert the proxies created since BeginBulkInsert.
+	void EndBulkInsert();
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
@@ -107,13 +136,17 @@ public:
 private:
 
 	friend class b2DynamicTree;
+	friend struct b2GridCallback<b2BroadPhase>;
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
 
 	bool QueryCallback(int32 proxyId);
 
+	static bool IsGridProxy(int32 proxyId) { return (proxyId & e_gridProxy) != 0; }
+
 	b2DynamicTree m_tree;
+	b2StaticGrid m_grid;
 
 	int32 m_proxyCount;
 
@@ -126,6 +159,8 @@ private:
 	int32 m_pairCount;
 
 	int32 m_queryProxyId;
+
+	bool m_adaptive;
 };
 
 /// This is used to sort pairs.
@@ -144,20 +179,64 @@ inline bool b2PairLessThan(const b2Pair& pair1, const b2Pair& pair2)
 	return false;
 }
 
+/// Translates the proxy ids reported by the static grid to broad-phase ids.
+template <typename T>
+struct b2GridCallback
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		return callback->QueryCallback(proxyId | b2BroadPhase::e_gridProxy);
+	}
+
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		return callback->RayCastCallback(input, proxyId | b2BroadPhase::e_gridProxy);
+	}
+
+	T* callback;
+};
+
+/// Remembers how far the tree clipped a ray, so the grid is cast against the
+/// same segment.
+template <typename T>
+struct b2RayCastClipper
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		float32 value = callback->RayCastCallback(input, proxyId);
+		if (0.0f <= value && value < maxFraction)
+		{
+			maxFraction = value;
+		}
+		return value;
+	}
+
+	T* callback;
+	float32 maxFraction;
+};
+
 inline void* b2BroadPhase::GetUserData(int32 proxyId) const
 {
+	if (IsGridProxy(proxyId))
+	{
+		return m_grid.GetUserData(proxyId & ~e_gridProxy);
+	}
 	return m_tree.GetUserData(proxyId);
 }
 
 inline bool b2BroadPhase::TestOverlap(int32 proxyIdA, int32 proxyIdB) const
 {
-	const b2AABB& aabbA = m_tree.GetFatAABB(proxyIdA);
-	const b2AABB& aabbB = m_tree.GetFatAABB(proxyIdB);
+	const b2AABB& aabbA = GetFatAABB(proxyIdA);
+	const b2AABB& aabbB = GetFatAABB(proxyIdB);
 	return b2TestOverlap(aabbA, aabbB);
 }
 
 inline const b2AABB& b2BroadPhase::GetFatAABB(int32 proxyId) const
 {
+	if (IsGridProxy(proxyId))
+	{
+		return m_grid.GetFatAABB(proxyId & ~e_gridProxy);
+	}
 	return m_tree.GetFatAABB(proxyId);
 }
 
@@ -181,12 +260,33 @@ inline float32 b2BroadPhase::GetTreeQuality() const
 	return m_tree.GetAreaRatio();
 }
 
+inline void b2BroadPhase::BeginBulkInsert()
+{
+	m_tree.BeginBulkInsert();
+}
+
+inline void b2BroadPhase::EndBulkInsert()
+{
+	m_tree.EndBulkInsert();
+}
+
 template <typename T>
 void b2BroadPhase::UpdatePairs(T* callback)
 {
+	// Pending proxies must be in the tree before it is queried.
+	m_tree.FlushBulkInsert();
+
+	if (m_adaptive)
+	{
+		m_tree.Optimize();
+	}
+
 	// Reset pair buffer
 	m_pairCount = 0;
 
+	b2GridCallback<b2BroadPhase> gridCallback;
+	gridCallback.callback = this;
+
 	// Perform tree queries for all moving proxies.
 	for (int32 i = 0; i < m_moveCount; ++i)
 	{
@@ -198,10 +298,16 @@ void b2BroadPhase::UpdatePairs(T* callback)
 
 		// We have to query the tree with the fat AABB so that
 		// we don't fail to create a pair that may touch later.
-		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
+		const b2AABB& fatAABB = GetFatAABB(m_queryProxyId);
 
 		// Query tree, create pairs and add them pair buffer.
 		m_tree.Query(this, fatAABB);
+
+		// Static proxies never form pairs among themselves.
+		if (IsGridProxy(m_queryProxyId) == false)
+		{
+			m_grid.Query(&gridCallback, fatAABB);
+		}
 	}
 
 	// Reset move buffer
@@ -215,8 +321,8 @@ void b2BroadPhase::UpdatePairs(T* callback)
 	while (i < m_pairCount)
 	{
 		b2Pair* primaryPair = m_pairBuffer + i;
-		void* userDataA = m_tree.GetUserData(primaryPair->proxyIdA);
-		void* userDataB = m_tree.GetUserData(primaryPair->proxyIdB);
+		void* userDataA = GetUserData(primaryPair->proxyIdA);
+		void* userDataB = GetUserData(primaryPair->proxyIdB);
 
 		callback->AddPair(userDataA, userDataB);
 		++i;
@@ -241,17 +347,38 @@ template <typename T>
 inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb) const
 {
 	m_tree.Query(callback, aabb);
+
+	b2GridCallback<T> gridCallback;
+	gridCallback.callback = callback;
+	m_grid.Query(&gridCallback, aabb);
 }
 
 template <typename T>
 inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input) const
 {
-	m_tree.RayCast(callback, input);
+	b2RayCastClipper<T> clipper;
+	clipper.callback = callback;
+	clipper.maxFraction = input.maxFraction;
+	m_tree.RayCast(&clipper, input);
+
+	if (clipper.maxFraction == 0.0f)
+	{
+		// The client has terminated the ray cast.
+		return;
+	}
+
+	b2RayCastInput gridInput = input;
+	gridInput.maxFraction = clipper.maxFraction;
+
+	b2GridCallback<T> gridCallback;
+	gridCallback.callback = callback;
+	m_grid.RayCast(&gridCallback, gridInput);
 }
 
 inline void b2BroadPhase::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	m_tree.ShiftOrigin(newOrigin);
+	m_grid.ShiftOrigin(newOrigin);
 }
 
 #endif
@@ -18,6 +18,22 @@
 
 #include <Box2D/Collision/b2DynamicTree.h>
 #include <string.h>
+#include <algorithm>
+
+// Number of bins used by the surface area heuristic.
+static const int32 b2_treeBinCount = 16;
+
+// Trees with fewer leaves are never rebuilt.
+static const int32 b2_treeMinRebuildLeafCount = 32;
+
+// The area ratio may grow by this factor before sub-trees are refit.
+static const float32 b2_treeAreaRatioTolerance = 1.25f;
+
+// The area ratio may grow by this factor before the whole tree is rebuilt.
+static const float32 b2_treeAreaRatioRebuildTolerance = 2.0f;
+
+// A refit rebuilds sub-trees with up to this many leaves.
+static const int32 b2_treeRefitLeafCount = 128;
 
 b2DynamicTree::b2DynamicTree()
 {
@@ -41,12 +57,21 @@ b2DynamicTree::b2DynamicTree()
 	m_path = 0;
 
 	m_insertionCount = 0;
+
+	m_changeCount = 0;
+	m_referenceAreaRatio = 0.0f;
+
+	m_bulkInsert = false;
+	m_bulkCapacity = 16;
+	m_bulkCount = 0;
+	m_bulkLeaves = (int32*)b2Alloc(m_bulkCapacity * sizeof(int32));
 }
 
 b2DynamicTree::~b2DynamicTree()
 {
 	// This frees the entire tree in one shot.
 	b2Free(m_nodes);
+	b2Free(m_bulkLeaves);
 }
 
 // Allocate a node from the pool. Grow the pool if necessary.
@@ -113,6 +138,24 @@ int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
 	m_nodes[proxyId].userData = userData;
 	m_nodes[proxyId].height = 0;
 
+	++m_changeCount;
+
+	if (m_bulkInsert)
+	{
+		if (m_bulkCount == m_bulkCapacity)
+		{
+			int32* oldLeaves = m_bulkLeaves;
+			m_bulkCapacity *= 2;
+			m_bulkLeaves = (int32*)b2Alloc(m_bulkCapacity * sizeof(int32));
+			memcpy(m_bulkLeaves, oldLeaves, m_bulkCount * sizeof(int32));
+			b2Free(oldLeaves);
+		}
+
+		m_bulkLeaves[m_bulkCount] = proxyId;
+		++m_bulkCount;
+		return proxyId;
+	}
+
 	InsertLeaf(proxyId);
 
 	return proxyId;
@@ -123,6 +166,11 @@ void b2DynamicTree::DestroyProxy(int32 proxyId)
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
 	b2Assert(m_nodes[proxyId].IsLeaf());
 
+	// The proxy may still be pending.
+	FlushBulkInsert();
+
+	++m_changeCount;
+
 	RemoveLeaf(proxyId);
 	FreeNode(proxyId);
 }
@@ -138,6 +186,12 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 		return false;
 	}
 
+	// The proxy may still be pending.
+	FlushBulkInsert();
+
+	// Moving proxies degrade the tree just like new ones.
+	++m_changeCount;
+
 	RemoveLeaf(proxyId);
 
 	// Extend AABB.
@@ -263,7 +317,7 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 	m_nodes[newParent].parent = oldParent;
 	m_nodes[newParent].userData = NULL;
 	m_nodes[newParent].aabb.Combine(leafAABB, m_nodes[sibling].aabb);
-	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].height = 1 + b2Max(m_nodes[sibling].height, m_nodes[leaf].height);
 
 	if (oldParent != b2_nullNode)
 	{
@@ -767,6 +821,496 @@ void b2DynamicTree::RebuildBottomUp()
 	Validate();
 }
 
+// Split a set of leaves in two using a binned surface area heuristic.
+// The leaves are reordered so that the first part comes first.
+// Returns the size of the first part.
+int32 b2DynamicTree::PartitionLeaves(int32* leaves, int32 count) const
+{
+	b2Assert(count > 1);
+
+	// Split along the axis with the largest spread of the leaf centers.
+	b2Vec2 lower = m_nodes[leaves[0]].aabb.GetCenter();
+	b2Vec2 upper = lower;
+	for (int32 i = 1; i < count; ++i)
+	{
+		b2Vec2 c = m_nodes[leaves[i]].aabb.GetCenter();
+		lower = b2Min(lower, c);
+		upper = b2Max(upper, c);
+	}
+
+	b2Vec2 extent = upper - lower;
+	int32 axis = extent.x > extent.y ? 0 : 1;
+	float32 width = extent(axis);
+	if (width <= b2_epsilon)
+	{
+		// All centers coincide. Any split is as good as any other.
+		return count / 2;
+	}
+
+	struct b2TreeBin
+	{
+		b2AABB aabb;
+		int32 count;
+	};
+
+	b2TreeBin bins[b2_treeBinCount];
+	for (int32 i = 0; i < b2_treeBinCount; ++i)
+	{
+		bins[i].count = 0;
+	}
+
+	float32 scale = float32(b2_treeBinCount) / width;
+	for (int32 i = 0; i < count; ++i)
+	{
+		const b2AABB& aabb = m_nodes[leaves[i]].aabb;
+		int32 bin = int32(scale * (aabb.GetCenter()(axis) - lower(axis)));
+		bin = b2Clamp(bin, 0, b2_treeBinCount - 1);
+		if (bins[bin].count == 0)
+		{
+			bins[bin].aabb = aabb;
+		}
+		else
+		{
+			bins[bin].aabb.Combine(aabb);
+		}
+		++bins[bin].count;
+	}
+
+	// Sweep from the right to get the cost of every right part.
+	float32 rightCosts[b2_treeBinCount];
+	// Overwritten by the first non-empty bin; initialized to keep the
+	// compiler from warning about a use before assignment.
+	b2AABB rightAABB = m_nodes[leaves[0]].aabb;
+	int32 rightCount = 0;
+	for (int32 i = b2_treeBinCount - 1; i > 0; --i)
+	{
+		if (bins[i].count > 0)
+		{
+			if (rightCount == 0)
+			{
+				rightAABB = bins[i].aabb;
+			}
+			else
+			{
+				rightAABB.Combine(bins[i].aabb);
+			}
+			rightCount += bins[i].count;
+		}
+		rightCosts[i] = rightCount > 0 ? rightAABB.GetPerimeter() * rightCount : 0.0f;
+	}
+
+	// Sweep from the left and pick the cheapest split. The first and the
+	// last bin are never empty, so every split yields two parts.
+	float32 minCost = b2_maxFloat;
+	int32 splitBin = 0;
+	b2AABB leftAABB = m_nodes[leaves[0]].aabb;
+	int32 leftCount = 0;
+	for (int32 i = 0; i < b2_treeBinCount - 1; ++i)
+	{
+		if (bins[i].count > 0)
+		{
+			if (leftCount == 0)
+			{
+				leftAABB = bins[i].aabb;
+			}
+			else
+			{
+				leftAABB.Combine(bins[i].aabb);
+			}
+			leftCount += bins[i].count;
+		}
+
+		if (leftCount == 0 || leftCount == count)
+		{
+			continue;
+		}
+
+		float32 cost = leftAABB.GetPerimeter() * leftCount + rightCosts[i + 1];
+		if (cost < minCost)
+		{
+			minCost = cost;
+			splitBin = i;
+		}
+	}
+
+	// Move the leaves of the left part to the front.
+	int32 split = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 bin = int32(scale * (m_nodes[leaves[i]].aabb.GetCenter()(axis) - lower(axis)));
+		bin = b2Clamp(bin, 0, b2_treeBinCount - 1);
+		if (bin <= splitBin)
+		{
+			b2Swap(leaves[i], leaves[split]);
+			++split;
+		}
+	}
+
+	b2Assert(0 < split && split < count);
+	return split;
+}
+
+// Build a sub-tree over a set of leaves and return its root.
+int32 b2DynamicTree::BuildTopDown(int32* leaves, int32 count)
+{
+	b2Assert(count > 0);
+
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	struct b2BuildRange
+	{
+		int32 begin;
+		int32 count;
+		int32 node;
+	};
+
+	// Internal nodes are created before their children, so walking
+	// them backwards visits the children first.
+	int32* internals = (int32*)b2Alloc((count - 1) * sizeof(int32));
+	int32 internalCount = 0;
+
+	int32 root = AllocateNode();
+	internals[internalCount++] = root;
+
+	b2GrowableStack<b2BuildRange, 64> stack;
+	b2BuildRange range = { 0, count, root };
+	stack.Push(range);
+
+	while (stack.GetCount() > 0)
+	{
+		range = stack.Pop();
+
+		int32* rangeLeaves = leaves + range.begin;
+		int32 split = PartitionLeaves(rangeLeaves, range.count);
+
+		int32 begins[2] = { range.begin, range.begin + split };
+		int32 counts[2] = { split, range.count - split };
+		int32 children[2];
+		for (int32 i = 0; i < 2; ++i)
+		{
+			if (counts[i] == 1)
+			{
+				children[i] = leaves[begins[i]];
+			}
+			else
+			{
+				children[i] = AllocateNode();
+				internals[internalCount++] = children[i];
+				b2BuildRange childRange = { begins[i], counts[i], children[i] };
+				stack.Push(childRange);
+			}
+			m_nodes[children[i]].parent = range.node;
+		}
+
+		m_nodes[range.node].child1 = children[0];
+		m_nodes[range.node].child2 = children[1];
+	}
+
+	b2Assert(internalCount == count - 1);
+
+	for (int32 i = internalCount - 1; i >= 0; --i)
+	{
+		b2TreeNode* node = m_nodes + internals[i];
+		const b2TreeNode* child1 = m_nodes + node->child1;
+		const b2TreeNode* child2 = m_nodes + node->child2;
+		node->aabb.Combine(child1->aabb, child2->aabb);
+		node->height = 1 + b2Max(child1->height, child2->height);
+	}
+
+	b2Free(internals);
+
+	return root;
+}
+
+void b2DynamicTree::RebuildTopDown()
+{
+	FlushBulkInsert();
+
+	int32* nodes = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 count = 0;
+
+	// Build array of leaves. Free the rest.
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height < 0)
+		{
+			// free node in pool
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			m_nodes[i].parent = b2_nullNode;
+			nodes[count] = i;
+			++count;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	if (count > 0)
+	{
+		m_root = BuildTopDown(nodes, count);
+		m_nodes[m_root].parent = b2_nullNode;
+	}
+	else
+	{
+		m_root = b2_nullNode;
+	}
+
+	b2Free(nodes);
+
+	m_changeCount = 0;
+	m_referenceAreaRatio = GetAreaRatio();
+}
+
+// Rebuild a sub-tree in place and update the bounds of its ancestors.
+void b2DynamicTree::RebuildSubtree(int32 index)
+{
+	b2Assert(0 <= index && index < m_nodeCapacity);
+
+	if (m_nodes[index].IsLeaf())
+	{
+		return;
+	}
+
+	int32 parent = m_nodes[index].parent;
+
+	// Collect the leaves and free the internal nodes.
+	int32* leaves = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 count = 0;
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(index);
+	while (stack.GetCount() > 0)
+	{
+		int32 nodeId = stack.Pop();
+		if (m_nodes[nodeId].IsLeaf())
+		{
+			leaves[count] = nodeId;
+			++count;
+		}
+		else
+		{
+			stack.Push(m_nodes[nodeId].child1);
+			stack.Push(m_nodes[nodeId].child2);
+			FreeNode(nodeId);
+		}
+	}
+
+	int32 subtree = BuildTopDown(leaves, count);
+	b2Free(leaves);
+
+	m_nodes[subtree].parent = parent;
+	if (parent == b2_nullNode)
+	{
+		m_root = subtree;
+		return;
+	}
+
+	if (m_nodes[parent].child1 == index)
+	{
+		m_nodes[parent].child1 = subtree;
+	}
+	else
+	{
+		m_nodes[parent].child2 = subtree;
+	}
+
+	// The freed root may have been reused inside the new sub-tree,
+	// so the ancestors are walked from the parent.
+	while (parent != b2_nullNode)
+	{
+		b2TreeNode* node = m_nodes + parent;
+		node->aabb.Combine(m_nodes[node->child1].aabb, m_nodes[node->child2].aabb);
+		node->height = 1 + b2Max(m_nodes[node->child1].height, m_nodes[node->child2].height);
+		parent = node->parent;
+	}
+}
+
+// Rebuild the sub-trees of up to b2_treeRefitLeafCount leaves whose area
+// ratio is worst, until the leaf budget is used up. The upper levels of
+// the tree are kept.
+void b2DynamicTree::Refit(int32 leafBudget)
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	// Visit the nodes top-down, so that walking the order backwards
+	// visits the children before their parents.
+	int32* order = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 orderCount = 0;
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+	while (stack.GetCount() > 0)
+	{
+		int32 nodeId = stack.Pop();
+		order[orderCount] = nodeId;
+		++orderCount;
+		if (m_nodes[nodeId].IsLeaf() == false)
+		{
+			stack.Push(m_nodes[nodeId].child1);
+			stack.Push(m_nodes[nodeId].child2);
+		}
+	}
+
+	// Leaf count and total perimeter of every sub-tree.
+	int32* leafCounts = (int32*)b2Alloc(m_nodeCapacity * sizeof(int32));
+	float32* areas = (float32*)b2Alloc(m_nodeCapacity * sizeof(float32));
+	for (int32 i = orderCount - 1; i >= 0; --i)
+	{
+		int32 nodeId = order[i];
+		const b2TreeNode* node = m_nodes + nodeId;
+		if (node->IsLeaf())
+		{
+			leafCounts[nodeId] = 1;
+			areas[nodeId] = node->aabb.GetPerimeter();
+		}
+		else
+		{
+			leafCounts[nodeId] = leafCounts[node->child1] + leafCounts[node->child2];
+			areas[nodeId] = areas[node->child1] + areas[node->child2] + node->aabb.GetPerimeter();
+		}
+	}
+
+	// The candidates are the largest sub-trees within the size limit.
+	// They are disjoint, so rebuilding one leaves the others intact.
+	struct b2RefitCandidate
+	{
+		float32 areaRatio;
+		int32 node;
+
+		bool operator<(const b2RefitCandidate& other) const
+		{
+			return areaRatio > other.areaRatio;
+		}
+	};
+
+	b2RefitCandidate* candidates = (b2RefitCandidate*)b2Alloc(orderCount * sizeof(b2RefitCandidate));
+	int32 candidateCount = 0;
+	for (int32 i = 0; i < orderCount; ++i)
+	{
+		int32 nodeId = order[i];
+		const b2TreeNode* node = m_nodes + nodeId;
+		if (node->height < 2 || leafCounts[nodeId] > b2_treeRefitLeafCount)
+		{
+			continue;
+		}
+
+		if (node->parent != b2_nullNode && leafCounts[node->parent] <= b2_treeRefitLeafCount)
+		{
+			continue;
+		}
+
+		candidates[candidateCount].areaRatio = areas[nodeId] / node->aabb.GetPerimeter();
+		candidates[candidateCount].node = nodeId;
+		++candidateCount;
+	}
+
+	std::sort(candidates, candidates + candidateCount);
+
+	for (int32 i = 0; i < candidateCount && leafBudget > 0; ++i)
+	{
+		leafBudget -= leafCounts[candidates[i].node];
+		RebuildSubtree(candidates[i].node);
+	}
+
+	b2Free(candidates);
+	b2Free(areas);
+	b2Free(leafCounts);
+	b2Free(order);
+
+	Validate();
+}
+
+bool b2DynamicTree::Optimize()
+{
+	b2Assert(m_bulkCount == 0);
+
+	int32 leafCount = (m_nodeCount + 1) / 2;
+	if (leafCount < b2_treeMinRebuildLeafCount || 4 * m_changeCount < leafCount)
+	{
+		return false;
+	}
+
+	m_changeCount = 0;
+
+	// A balanced tree over n leaves has a height of about log2(n).
+	int32 balancedHeight = 0;
+	while ((1 << balancedHeight) < leafCount)
+	{
+		++balancedHeight;
+	}
+
+	if (GetHeight() > 2 * balancedHeight)
+	{
+		RebuildTopDown();
+		return true;
+	}
+
+	float32 areaRatio = GetAreaRatio();
+	if (m_referenceAreaRatio == 0.0f)
+	{
+		// First check of a tree that was never rebuilt: its current
+		// quality is what later checks compare with.
+		m_referenceAreaRatio = areaRatio;
+		return false;
+	}
+
+	if (areaRatio > b2_treeAreaRatioRebuildTolerance * m_referenceAreaRatio)
+	{
+		RebuildTopDown();
+		return true;
+	}
+
+	if (areaRatio > b2_treeAreaRatioTolerance * m_referenceAreaRatio)
+	{
+		// Mild degradation is mostly local, so only the worst sub-trees
+		// are rebuilt.
+		Refit(leafCount / 4);
+		return true;
+	}
+
+	// The tree may have improved on its own.
+	m_referenceAreaRatio = b2Min(m_referenceAreaRatio, areaRatio);
+	return false;
+}
+
+void b2DynamicTree::BeginBulkInsert()
+{
+	b2Assert(m_bulkInsert == false);
+	m_bulkInsert = true;
+}
+
+void b2DynamicTree::EndBulkInsert()
+{
+	b2Assert(m_bulkInsert);
+	FlushBulkInsert();
+	m_bulkInsert = false;
+}
+
+void b2DynamicTree::FlushBulkInsert()
+{
+	if (m_bulkCount == 0)
+	{
+		return;
+	}
+
+	int32 count = m_bulkCount;
+	m_bulkCount = 0;
+
+	// Insert the pending proxies as one sub-tree. InsertLeaf also
+	// works for internal nodes.
+	int32 subtree = BuildTopDown(m_bulkLeaves, count);
+	InsertLeaf(subtree);
+}
+
 void b2DynamicTree::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	// Build array of leaves. Free the rest.
@@ -118,6 +118,32 @@ public:
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
+	/// Rebuild the tree top-down using a binned surface area heuristic.
+	/// This is O(n log n) and keeps all proxy ids.
+	void RebuildTopDown();
+
+	/// Check the tree quality against the area ratio of the last rebuild,
+	/// or of the first check. A mildly degraded tree gets its worst
+	/// sub-trees rebuilt (refit), a badly degraded or too high tree is
+	/// rebuilt as a whole. The check itself is skipped until enough
+	/// proxies were inserted, moved or removed.
+	/// @return true if the tree was refit or rebuilt.
+	bool Optimize();
+
+	/// Defer the insertion of new proxies. The proxies created until
+	/// EndBulkInsert are built into a sub-tree of their own, which is then
+	/// inserted as a whole. The tree must not be queried in between.
+	void BeginBulkInsert();
+
+	/// Insert the proxies created since BeginBulkInsert.
+	void EndBulkInsert();
+
+	/// Insert pending proxies but stay in bulk insert mode.
+	void FlushBulkInsert();
+
+	/// Are new proxies currently deferred?
+	bool IsBulkInserting() const { return m_bulkInsert; }
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
@@ -133,6 +159,11 @@ private:
 
 	int32 Balance(int32 index);
 
+	int32 BuildTopDown(int32* leaves, int32 count);
+	int32 PartitionLeaves(int32* leaves, int32 count) const;
+	void RebuildSubtree(int32 index);
+	void Refit(int32 leafBudget);
+
 	int32 ComputeHeight() const;
 	int32 ComputeHeight(int32 nodeId) const;
 
@@ -151,6 +182,17 @@ private:
 	uint32 m_path;
 
 	int32 m_insertionCount;
+
+	/// Proxies inserted, moved or removed since the last quality check.
+	int32 m_changeCount;
+
+	/// Area ratio right after the last rebuild.
+	float32 m_referenceAreaRatio;
+
+	bool m_bulkInsert;
+	int32* m_bulkLeaves;
+	int32 m_bulkCount;
+	int32 m_bulkCapacity;
 };
 
 inline void* b2DynamicTree::GetUserData(int32 proxyId) const
@@ -168,6 +210,8 @@ inline const b2AABB& b2DynamicTree::GetFatAABB(int32 proxyId) const
 template <typename T>
 inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 {
+	b2Assert(m_bulkCount == 0);
+
 	b2GrowableStack<int32, 256> stack;
 	stack.Push(m_root);
 
@@ -203,6 +247,8 @@ inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 template <typename T>
 inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) const
 {
+	b2Assert(m_bulkCount == 0);
+
 	b2Vec2 p1 = input.p1;
 	b2Vec2 p2 = input.p2;
 	b2Vec2 r = p2 - p1;
@@ -0,0 +1,251 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*
+* Altered source version: this file is not part of the original Box2D
+* distribution. It was added to the copy of Box2D bundled with Impact.
+*/
+
+#include <Box2D/Collision/b2StaticGrid.h>
+#include <string.h>
+
+b2StaticGrid::b2StaticGrid()
+{
+	m_proxyCapacity = 16;
+	m_proxyCount = 0;
+	m_proxies = (b2GridProxy*)b2Alloc(m_proxyCapacity * sizeof(b2GridProxy));
+
+	// Build a linked list for the free list.
+	for (int32 i = 0; i < m_proxyCapacity - 1; ++i)
+	{
+		m_proxies[i].next = i + 1;
+		m_proxies[i].cell = -1;
+	}
+	m_proxies[m_proxyCapacity-1].next = b2_nullGridProxy;
+	m_proxies[m_proxyCapacity-1].cell = -1;
+	m_freeList = 0;
+
+	m_cells = NULL;
+	m_lower.SetZero();
+	m_cellSize = 1.0f;
+	m_invCellSize = 1.0f;
+	m_width = 0;
+	m_height = 0;
+	m_maxExtent.SetZero();
+}
+
+b2StaticGrid::~b2StaticGrid()
+{
+	b2Free(m_proxies);
+	if (m_cells)
+	{
+		b2Free(m_cells);
+	}
+}
+
+void b2StaticGrid::Set(const b2Vec2& lower, float32 cellSize, int32 width, int32 height)
+{
+	b2Assert(m_proxyCount == 0);
+	b2Assert(cellSize > 0.0f);
+	b2Assert(width > 0 && height > 0);
+
+	Reset();
+
+	m_lower = lower;
+	m_cellSize = cellSize;
+	m_invCellSize = 1.0f / cellSize;
+	m_width = width;
+	m_height = height;
+	m_maxExtent.SetZero();
+
+	int32 cellCount = width * height;
+	m_cells = (int32*)b2Alloc(cellCount * sizeof(int32));
+	for (int32 i = 0; i < cellCount; ++i)
+	{
+		m_cells[i] = b2_nullGridProxy;
+	}
+}
+
+void b2StaticGrid::Reset()
+{
+	b2Assert(m_proxyCount == 0);
+
+	if (m_cells)
+	{
+		b2Free(m_cells);
+		m_cells = NULL;
+	}
+
+	m_width = 0;
+	m_height = 0;
+}
+
+bool b2StaticGrid::Accepts(const b2AABB& aabb) const
+{
+	if (m_cells == NULL)
+	{
+		return false;
+	}
+
+	// The full size counts, not the half-extents.
+	b2Vec2 size = aabb.upperBound - aabb.lowerBound;
+	return size.x <= m_cellSize && size.y <= m_cellSize;
+}
+
+// Allocate a proxy from the pool. Grow the pool if necessary.
+int32 b2StaticGrid::AllocateProxy()
+{
+	if (m_freeList == b2_nullGridProxy)
+	{
+		b2Assert(m_proxyCount == m_proxyCapacity);
+
+		// The free list is empty. Rebuild a bigger pool.
+		b2GridProxy* oldProxies = m_proxies;
+		m_proxyCapacity *= 2;
+		m_proxies = (b2GridProxy*)b2Alloc(m_proxyCapacity * sizeof(b2GridProxy));
+		memcpy(m_proxies, oldProxies, m_proxyCount * sizeof(b2GridProxy));
+		b2Free(oldProxies);
+
+		for (int32 i = m_proxyCount; i < m_proxyCapacity - 1; ++i)
+		{
+			m_proxies[i].next = i + 1;
+			m_proxies[i].cell = -1;
+		}
+		m_proxies[m_proxyCapacity-1].next = b2_nullGridProxy;
+		m_proxies[m_proxyCapacity-1].cell = -1;
+		m_freeList = m_proxyCount;
+	}
+
+	int32 proxyId = m_freeList;
+	m_freeList = m_proxies[proxyId].next;
+	m_proxies[proxyId].prev = b2_nullGridProxy;
+	m_proxies[proxyId].next = b2_nullGridProxy;
+	m_proxies[proxyId].userData = NULL;
+	++m_proxyCount;
+	return proxyId;
+}
+
+// Return a proxy to the pool.
+void b2StaticGrid::FreeProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2Assert(0 < m_proxyCount);
+	m_proxies[proxyId].next = m_freeList;
+	m_proxies[proxyId].cell = -1;
+	m_freeList = proxyId;
+	--m_proxyCount;
+}
+
+int32 b2StaticGrid::ComputeCell(const b2AABB& aabb) const
+{
+	b2Vec2 center = m_invCellSize * (aabb.GetCenter() - m_lower);
+	int32 x = b2Clamp(int32(floorf(center.x)), 0, m_width - 1);
+	int32 y = b2Clamp(int32(floorf(center.y)), 0, m_height - 1);
+	return y * m_width + x;
+}
+
+void b2StaticGrid::Link(int32 proxyId)
+{
+	b2GridProxy* proxy = m_proxies + proxyId;
+	proxy->cell = ComputeCell(proxy->aabb);
+	proxy->prev = b2_nullGridProxy;
+	proxy->next = m_cells[proxy->cell];
+	if (proxy->next != b2_nullGridProxy)
+	{
+		m_proxies[proxy->next].prev = proxyId;
+	}
+	m_cells[proxy->cell] = proxyId;
+
+	m_maxExtent = b2Max(m_maxExtent, proxy->aabb.GetExtents());
+}
+
+void b2StaticGrid::Unlink(int32 proxyId)
+{
+	b2GridProxy* proxy = m_proxies + proxyId;
+	if (proxy->prev != b2_nullGridProxy)
+	{
+		m_proxies[proxy->prev].next = proxy->next;
+	}
+	else
+	{
+		b2Assert(m_cells[proxy->cell] == proxyId);
+		m_cells[proxy->cell] = proxy->next;
+	}
+
+	if (proxy->next != b2_nullGridProxy)
+	{
+		m_proxies[proxy->next].prev = proxy->prev;
+	}
+}
+
+int32 b2StaticGrid::CreateProxy(const b2AABB& aabb, void* userData)
+{
+	b2Assert(m_cells != NULL);
+
+	int32 proxyId = AllocateProxy();
+
+	// Fatten the aabb.
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	m_proxies[proxyId].aabb.lowerBound = aabb.lowerBound - r;
+	m_proxies[proxyId].aabb.upperBound = aabb.upperBound + r;
+	m_proxies[proxyId].userData = userData;
+
+	Link(proxyId);
+
+	return proxyId;
+}
+
+void b2StaticGrid::DestroyProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2Assert(m_proxies[proxyId].cell >= 0);
+
+	Unlink(proxyId);
+	FreeProxy(proxyId);
+}
+
+bool b2StaticGrid::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	B2_NOT_USED(displacement);
+
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2Assert(m_proxies[proxyId].cell >= 0);
+
+	if (m_proxies[proxyId].aabb.Contains(aabb))
+	{
+		return false;
+	}
+
+	Unlink(proxyId);
+
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	m_proxies[proxyId].aabb.lowerBound = aabb.lowerBound - r;
+	m_proxies[proxyId].aabb.upperBound = aabb.upperBound + r;
+
+	Link(proxyId);
+	return true;
+}
+
+void b2StaticGrid::ShiftOrigin(const b2Vec2& newOrigin)
+{
+	m_lower -= newOrigin;
+
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		m_proxies[i].aabb.lowerBound -= newOrigin;
+		m_proxies[i].aabb.upperBound -= newOrigin;
+	}
+}
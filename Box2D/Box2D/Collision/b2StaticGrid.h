@@ -0,0 +1,277 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*
+* Altered source version: this file is not part of the original Box2D
+* distribution. It was added to the copy of Box2D bundled with Impact.
+*/
+
+#ifndef B2_STATIC_GRID_H
+#define B2_STATIC_GRID_H
+
+#include <Box2D/Collision/b2Collision.h>
+
+#define b2_nullGridProxy (-1)
+
+/// A proxy in the static grid. The client does not interact with this directly.
+struct b2GridProxy
+{
+	/// Enlarged AABB
+	b2AABB aabb;
+
+	void* userData;
+
+	/// Cell holding the proxy, -1 for a free proxy.
+	int32 cell;
+
+	/// Neighbours in the cell list. A free proxy uses next for the free list.
+	int32 prev;
+	int32 next;
+};
+
+/// A loose uniform grid for proxies that do not move, such as the tiles of a
+/// level. Every proxy is stored in the cell holding the center of its AABB, so
+/// it is only accepted if it is no larger than a cell. Queries with small AABBs
+/// then visit a constant number of cells. Proxies outside the grid are stored in
+/// the nearest border cell, which keeps queries correct but slower.
+///
+/// Proxies are pooled and relocatable, so we use proxy indices rather than pointers.
+class b2StaticGrid
+{
+public:
+	b2StaticGrid();
+	~b2StaticGrid();
+
+	/// Lay out the grid. There must be no proxies in the grid.
+	/// @param lower the lower corner of the grid
+	/// @param cellSize the edge length of a cell
+	/// @param width the number of cells in x direction
+	/// @param height the number of cells in y direction
+	void Set(const b2Vec2& lower, float32 cellSize, int32 width, int32 height);
+
+	/// Remove the grid. There must be no proxies in the grid.
+	void Reset();
+
+	/// Is the grid laid out?
+	bool IsEnabled() const { return m_cells != NULL; }
+
+	/// Can a proxy with this AABB be stored in the grid?
+	bool Accepts(const b2AABB& aabb) const;
+
+	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
+
+	/// Destroy a proxy. This asserts if the id is invalid.
+	void DestroyProxy(int32 proxyId);
+
+	/// Move a proxy. Static proxies move rarely, e.g. when placed after creation.
+	/// @return true if the fat AABB of the proxy changed.
+	bool MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
+
+	/// Get proxy user data.
+	void* GetUserData(int32 proxyId) const;
+
+	/// Get the fat AABB for a proxy.
+	const b2AABB& GetFatAABB(int32 proxyId) const;
+
+	/// Get the number of proxies.
+	int32 GetProxyCount() const { return m_proxyCount; }
+
+	/// Query an AABB for overlapping proxies. The callback class
+	/// is called for each proxy that overlaps the supplied AABB.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb) const;
+
+	/// Ray-cast against the proxies in the grid. Unlike the dynamic tree the
+	/// proxies are not visited front to back, but the segment is still clipped
+	/// to the fraction returned by the callback.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input) const;
+
+	/// Shift the world origin. Useful for large worlds.
+	/// The shift formula is: position -= newOrigin
+	/// @param newOrigin the new origin with respect to the old origin
+	void ShiftOrigin(const b2Vec2& newOrigin);
+
+private:
+
+	int32 AllocateProxy();
+	void FreeProxy(int32 proxyId);
+
+	void Link(int32 proxyId);
+	void Unlink(int32 proxyId);
+
+	int32 ComputeCell(const b2AABB& aabb) const;
+	void ComputeCellRange(const b2AABB& aabb, int32* lowerX, int32* lowerY, int32* upperX, int32* upperY) const;
+
+	b2GridProxy* m_proxies;
+	int32 m_proxyCount;
+	int32 m_proxyCapacity;
+	int32 m_freeList;
+
+	/// The first proxy of every cell.
+	int32* m_cells;
+
+	b2Vec2 m_lower;
+	float32 m_cellSize;
+	float32 m_invCellSize;
+	int32 m_width;
+	int32 m_height;
+
+	/// The largest half extent of all proxies ever stored. Queries are
+	/// enlarged by this to find proxies stored in neighbouring cells.
+	b2Vec2 m_maxExtent;
+};
+
+inline void* b2StaticGrid::GetUserData(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].userData;
+}
+
+inline const b2AABB& b2StaticGrid::GetFatAABB(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].aabb;
+}
+
+inline void b2StaticGrid::ComputeCellRange(const b2AABB& aabb, int32* lowerX, int32* lowerY, int32* upperX, int32* upperY) const
+{
+	b2Vec2 lower = m_invCellSize * (aabb.lowerBound - m_maxExtent - m_lower);
+	b2Vec2 upper = m_invCellSize * (aabb.upperBound + m_maxExtent - m_lower);
+	*lowerX = b2Clamp(int32(floorf(lower.x)), 0, m_width - 1);
+	*lowerY = b2Clamp(int32(floorf(lower.y)), 0, m_height - 1);
+	*upperX = b2Clamp(int32(floorf(upper.x)), 0, m_width - 1);
+	*upperY = b2Clamp(int32(floorf(upper.y)), 0, m_height - 1);
+}
+
+template <typename T>
+inline void b2StaticGrid::Query(T* callback, const b2AABB& aabb) const
+{
+	if (m_proxyCount == 0)
+	{
+		return;
+	}
+
+	int32 lowerX, lowerY, upperX, upperY;
+	ComputeCellRange(aabb, &lowerX, &lowerY, &upperX, &upperY);
+
+	for (int32 y = lowerY; y <= upperY; ++y)
+	{
+		const int32* row = m_cells + y * m_width;
+		for (int32 x = lowerX; x <= upperX; ++x)
+		{
+			int32 proxyId = row[x];
+			while (proxyId != b2_nullGridProxy)
+			{
+				const b2GridProxy* proxy = m_proxies + proxyId;
+				int32 next = proxy->next;
+				if (b2TestOverlap(proxy->aabb, aabb))
+				{
+					bool proceed = callback->QueryCallback(proxyId);
+					if (proceed == false)
+					{
+						return;
+					}
+				}
+				proxyId = next;
+			}
+		}
+	}
+}
+
+template <typename T>
+inline void b2StaticGrid::RayCast(T* callback, const b2RayCastInput& input) const
+{
+	if (m_proxyCount == 0)
+	{
+		return;
+	}
+
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2Cross(1.0f, r);
+	b2Vec2 abs_v = b2Abs(v);
+
+	float32 maxFraction = input.maxFraction;
+
+	// Build a bounding box for the segment.
+	b2AABB segmentAABB;
+	{
+		b2Vec2 t = p1 + maxFraction * (p2 - p1);
+		segmentAABB.lowerBound = b2Min(p1, t);
+		segmentAABB.upperBound = b2Max(p1, t);
+	}
+
+	int32 lowerX, lowerY, upperX, upperY;
+	ComputeCellRange(segmentAABB, &lowerX, &lowerY, &upperX, &upperY);
+
+	for (int32 y = lowerY; y <= upperY; ++y)
+	{
+		const int32* row = m_cells + y * m_width;
+		for (int32 x = lowerX; x <= upperX; ++x)
+		{
+			int32 proxyId = row[x];
+			while (proxyId != b2_nullGridProxy)
+			{
+				const b2GridProxy* proxy = m_proxies + proxyId;
+				int32 next = proxy->next;
+
+				if (b2TestOverlap(proxy->aabb, segmentAABB))
+				{
+					// Separating axis for segment (Gino, p80).
+					// |dot(v, p1 - c)| > dot(|v|, h)
+					b2Vec2 c = proxy->aabb.GetCenter();
+					b2Vec2 h = proxy->aabb.GetExtents();
+					float32 separation = b2Abs(b2Dot(v, p1 - c)) - b2Dot(abs_v, h);
+					if (separation <= 0.0f)
+					{
+						b2RayCastInput subInput;
+						subInput.p1 = input.p1;
+						subInput.p2 = input.p2;
+						subInput.maxFraction = maxFraction;
+
+						float32 value = callback->RayCastCallback(subInput, proxyId);
+
+						if (value == 0.0f)
+						{
+							// The client has terminated the ray cast.
+							return;
+						}
+
+						if (value > 0.0f && value < maxFraction)
+						{
+							// Update segment bounding box.
+							maxFraction = value;
+							b2Vec2 t = p1 + maxFraction * (p2 - p1);
+							segmentAABB.lowerBound = b2Min(p1, t);
+							segmentAABB.upperBound = b2Max(p1, t);
+						}
+					}
+				}
+
+				proxyId = next;
+			}
+		}
+	}
+}
+
+#endif
@@ -17,11 +17,13 @@
 */
 
 #include <Box2D/Common/b2BlockAllocator.h>
+#include <algorithm>
 #include <limits.h>
 #include <string.h>
 #include <stddef.h>
 
-int32 b2BlockAllocator::s_blockSizes[b2_blockSizes] = 
+// Generic size classes. These cover arbitrary requests up to b2_maxBlockSize.
+static const int32 b2_genericBlockSizes[] =
 {
 	16,		// 0
 	32,		// 1
@@ -38,8 +40,9 @@ int32 b2BlockAllocator::s_blockSizes[b2_blockSizes] =
 	512,	// 12
 	640,	// 13
 };
-uint8 b2BlockAllocator::s_blockSizeLookup[b2_maxBlockSize + 1];
-bool b2BlockAllocator::s_blockSizeLookupInitialized;
+
+// Blocks are linked through their first bytes, so keep them pointer aligned.
+static const int32 b2_blockAlignment = 8;
 
 struct b2Chunk
 {
@@ -52,7 +55,32 @@ struct b2Block
 	b2Block* next;
 };
 
-b2BlockAllocator::b2BlockAllocator()
+// Merge the generic and the object size classes into one sorted table.
+static int32 b2BuildBlockSizes(int32* sizes, const int32* objectSizes, int32 objectCount)
+{
+	const int32 genericCount = sizeof(b2_genericBlockSizes) / sizeof(b2_genericBlockSizes[0]);
+	b2Assert(genericCount + objectCount <= b2_blockSizes);
+
+	int32 count = 0;
+	for (int32 i = 0; i < genericCount; ++i)
+	{
+		sizes[count++] = b2_genericBlockSizes[i];
+	}
+
+	for (int32 i = 0; i < objectCount; ++i)
+	{
+		int32 size = (objectSizes[i] + b2_blockAlignment - 1) & ~(b2_blockAlignment - 1);
+		if (size <= b2_maxBlockSize)
+		{
+			sizes[count++] = size;
+		}
+	}
+
+	std::sort(sizes, sizes + count);
+	return int32(std::unique(sizes, sizes + count) - sizes);
+}
+
+b2BlockAllocator::b2BlockAllocator(const int32* objectSizes, int32 objectSizeCount)
 {
 	b2Assert(b2_blockSizes < UCHAR_MAX);
 
@@ -62,25 +90,28 @@ b2BlockAllocator::b2BlockAllocator()
 	
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+	memset(m_classChunkCounts, 0, sizeof(m_classChunkCounts));
+	memset(m_classUsedCounts, 0, sizeof(m_classUsedCounts));
+
+	// The tables belong to the allocator, so allocators may be built on
+	// several threads at the same time.
+	m_blockSizeCount = b2BuildBlockSizes(m_blockSizes, objectSizes, objectSizeCount);
+	b2Assert(m_blockSizes[m_blockSizeCount - 1] == b2_maxBlockSize);
 
-	if (s_blockSizeLookupInitialized == false)
+	m_blockSizeLookup[0] = 0;
+	int32 j = 0;
+	for (int32 i = 1; i <= b2_maxBlockSize; ++i)
 	{
-		int32 j = 0;
-		for (int32 i = 1; i <= b2_maxBlockSize; ++i)
+		b2Assert(j < m_blockSizeCount);
+		if (i <= m_blockSizes[j])
 		{
-			b2Assert(j < b2_blockSizes);
-			if (i <= s_blockSizes[j])
-			{
-				s_blockSizeLookup[i] = (uint8)j;
-			}
-			else
-			{
-				++j;
-				s_blockSizeLookup[i] = (uint8)j;
-			}
+			m_blockSizeLookup[i] = (uint8)j;
+		}
+		else
+		{
+			++j;
+			m_blockSizeLookup[i] = (uint8)j;
 		}
-
-		s_blockSizeLookupInitialized = true;
 	}
 }
 
@@ -106,8 +137,10 @@ void* b2BlockAllocator::Allocate(int32 size)
 		return b2Alloc(size);
 	}
 
-	int32 index = s_blockSizeLookup[size];
-	b2Assert(0 <= index && index < b2_blockSizes);
+	int32 index = m_blockSizeLookup[size];
+	b2Assert(0 <= index && index < m_blockSizeCount);
+
+	++m_classUsedCounts[index];
 
 	if (m_freeLists[index])
 	{
@@ -132,7 +165,7 @@ void* b2BlockAllocator::Allocate(int32 size)
 #if defined(_DEBUG)
 		memset(chunk->blocks, 0xcd, b2_chunkSize);
 #endif
-		int32 blockSize = s_blockSizes[index];
+		int32 blockSize = m_blockSizes[index];
 		chunk->blockSize = blockSize;
 		int32 blockCount = b2_chunkSize / blockSize;
 		b2Assert(blockCount * blockSize <= b2_chunkSize);
@@ -147,6 +180,7 @@ void* b2BlockAllocator::Allocate(int32 size)
 
 		m_freeLists[index] = chunk->blocks->next;
 		++m_chunkCount;
+		++m_classChunkCounts[index];
 
 		return chunk->blocks;
 	}
@@ -167,12 +201,15 @@ void b2BlockAllocator::Free(void* p, int32 size)
 		return;
 	}
 
-	int32 index = s_blockSizeLookup[size];
-	b2Assert(0 <= index && index < b2_blockSizes);
+	int32 index = m_blockSizeLookup[size];
+	b2Assert(0 <= index && index < m_blockSizeCount);
+	b2Assert(m_classUsedCounts[index] > 0);
+
+	--m_classUsedCounts[index];
 
 #ifdef _DEBUG
 	// Verify the memory address and size is valid.
-	int32 blockSize = s_blockSizes[index];
+	int32 blockSize = m_blockSizes[index];
 	bool found = false;
 	for (int32 i = 0; i < m_chunkCount; ++i)
 	{
@@ -212,4 +249,129 @@ void b2BlockAllocator::Clear()
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+	memset(m_classChunkCounts, 0, sizeof(m_classChunkCounts));
+	memset(m_classUsedCounts, 0, sizeof(m_classUsedCounts));
+}
+
+static bool b2ChunkLessThan(const b2Chunk& chunk1, const b2Chunk& chunk2)
+{
+	return chunk1.blocks < chunk2.blocks;
+}
+
+// Find the chunk holding a block. The chunks must be sorted by address.
+static int32 b2FindChunk(const b2Chunk* chunks, int32 count, const void* p)
+{
+	int32 low = 0;
+	int32 high = count - 1;
+	while (low <= high)
+	{
+		int32 mid = (low + high) >> 1;
+		const int8* blocks = (const int8*)chunks[mid].blocks;
+		if ((const int8*)p < blocks)
+		{
+			high = mid - 1;
+		}
+		else if ((const int8*)p >= blocks + b2_chunkSize)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			return mid;
+		}
+	}
+
+	b2Assert(false);
+	return -1;
+}
+
+int32 b2BlockAllocator::Trim()
+{
+	if (m_chunkCount == 0)
+	{
+		return 0;
+	}
+
+	std::sort(m_chunks, m_chunks + m_chunkCount, b2ChunkLessThan);
+
+	// Count the free blocks of every chunk.
+	int32* freeCounts = (int32*)b2Alloc(m_chunkCount * sizeof(int32));
+	memset(freeCounts, 0, m_chunkCount * sizeof(int32));
+
+	for (int32 index = 0; index < m_blockSizeCount; ++index)
+	{
+		for (b2Block* block = m_freeLists[index]; block; block = block->next)
+		{
+			++freeCounts[b2FindChunk(m_chunks, m_chunkCount, block)];
+		}
+	}
+
+	// Unlink the blocks of chunks that are entirely free. Their free count
+	// is negated to mark them for release.
+	int32 releaseCount = 0;
+	for (int32 i = 0; i < m_chunkCount; ++i)
+	{
+		if (freeCounts[i] == b2_chunkSize / m_chunks[i].blockSize)
+		{
+			freeCounts[i] = -1;
+			++releaseCount;
+		}
+	}
+
+	if (releaseCount > 0)
+	{
+		for (int32 index = 0; index < m_blockSizeCount; ++index)
+		{
+			b2Block** link = m_freeLists + index;
+			while (*link)
+			{
+				if (freeCounts[b2FindChunk(m_chunks, m_chunkCount, *link)] < 0)
+				{
+					*link = (*link)->next;
+				}
+				else
+				{
+					link = &(*link)->next;
+				}
+			}
+		}
+
+		int32 count = 0;
+		for (int32 i = 0; i < m_chunkCount; ++i)
+		{
+			if (freeCounts[i] < 0)
+			{
+				--m_classChunkCounts[m_blockSizeLookup[m_chunks[i].blockSize]];
+				b2Free(m_chunks[i].blocks);
+			}
+			else
+			{
+				m_chunks[count++] = m_chunks[i];
+			}
+		}
+
+		memset(m_chunks + count, 0, (m_chunkCount - count) * sizeof(b2Chunk));
+		m_chunkCount = count;
+	}
+
+	b2Free(freeCounts);
+
+	return releaseCount;
+}
+
+int32 b2BlockAllocator::GetClassCount() const
+{
+	return m_blockSizeCount;
+}
+
+b2BlockClassStats b2BlockAllocator::GetClassStats(int32 index) const
+{
+	b2Assert(0 <= index && index < m_blockSizeCount);
+
+	b2BlockClassStats stats;
+	stats.blockSize = m_blockSizes[index];
+	stats.chunkCount = m_classChunkCounts[index];
+	stats.blockCount = stats.chunkCount * (b2_chunkSize / stats.blockSize);
+	stats.usedCount = m_classUsedCounts[index];
+	return stats;
 }
@@ -23,19 +23,31 @@
 
 const int32 b2_chunkSize = 16 * 1024;
 const int32 b2_maxBlockSize = 640;
-const int32 b2_blockSizes = 14;
+const int32 b2_blockSizes = 32;
 const int32 b2_chunkArrayIncrement = 128;
 
 struct b2Block;
 struct b2Chunk;
 
+/// Occupancy of a single size class of the block allocator.
+struct b2BlockClassStats
+{
+	int32 blockSize;	///< size of a block in bytes
+	int32 chunkCount;	///< number of chunks owned by this size class
+	int32 blockCount;	///< number of blocks available in these chunks
+	int32 usedCount;	///< number of blocks currently handed out
+};
+
 /// This is a small object allocator used for allocating small
 /// objects that persist for more than one time step.
 /// See: http://www.codeproject.com/useritems/Small_Block_Allocator.asp
 class b2BlockAllocator
 {
 public:
-	b2BlockAllocator();
+	/// @param objectSizes sizes of the objects that get a size class of their own,
+	/// so they don't waste the slack of the next generic class. May be NULL.
+	/// @param objectSizeCount the number of entries in objectSizes
+	b2BlockAllocator(const int32* objectSizes = NULL, int32 objectSizeCount = 0);
 	~b2BlockAllocator();
 
 	/// Allocate memory. This will use b2Alloc if the size is larger than b2_maxBlockSize.
@@ -46,6 +58,24 @@ public:
 
 	void Clear();
 
+	/// Release all chunks whose blocks are all free back to the system. This
+	/// walks every free list, so call it between levels rather than per step.
+	/// @return the number of chunks released.
+	int32 Trim();
+
+	/// Get the number of size classes.
+	int32 GetClassCount() const;
+
+	/// Get the occupancy of a size class.
+	/// @param index the size class, 0 <= index < GetClassCount()
+	b2BlockClassStats GetClassStats(int32 index) const;
+
+	/// Get the number of chunks currently allocated.
+	int32 GetChunkCount() const { return m_chunkCount; }
+
+	/// Get the number of bytes currently held in chunks.
+	int32 GetReservedBytes() const { return m_chunkCount * b2_chunkSize; }
+
 private:
 
 	b2Chunk* m_chunks;
@@ -53,10 +83,12 @@ private:
 	int32 m_chunkSpace;
 
 	b2Block* m_freeLists[b2_blockSizes];
+	int32 m_classChunkCounts[b2_blockSizes];
+	int32 m_classUsedCounts[b2_blockSizes];
 
-	static int32 s_blockSizes[b2_blockSizes];
-	static uint8 s_blockSizeLookup[b2_maxBlockSize + 1];
-	static bool s_blockSizeLookupInitialized;
+	int32 m_blockSizes[b2_blockSizes];
+	int32 m_blockSizeCount;
+	uint8 m_blockSizeLookup[b2_maxBlockSize + 1];
 };
 
 #endif
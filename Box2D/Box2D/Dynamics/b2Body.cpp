@@ -123,6 +123,8 @@ void b2Body::SetType(b2BodyType type)
 		return;
 	}
 
+	bool wasStatic = m_type == b2_staticBody;
+
 	m_type = type;
 
 	ResetMassData();
@@ -151,8 +153,20 @@ void b2Body::SetType(b2BodyType type)
 	}
 	m_contactList = NULL;
 
-	// Touch the proxies so that new contacts will be created (when appropriate)
+	// Static proxies may live in the static grid of the broad-phase, so
+	// re-create the proxies if the body becomes or stops being static.
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+	if (wasStatic != (m_type == b2_staticBody) && (m_flags & e_activeFlag))
+	{
+		for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+		{
+			f->DestroyProxies(broadPhase);
+			f->CreateProxies(broadPhase, m_xf);
+		}
+		return;
+	}
+
+	// Touch the proxies so that new contacts will be created (when appropriate)
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 	{
 		int32 proxyCount = f->m_proxyCount;
@@ -126,11 +126,20 @@ void b2Fixture::CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf)
 	// Create proxies in the broad-phase.
 	m_proxyCount = m_shape->GetChildCount();
 
+	bool isStatic = m_body->GetType() == b2_staticBody;
+
 	for (int32 i = 0; i < m_proxyCount; ++i)
 	{
 		b2FixtureProxy* proxy = m_proxies + i;
 		m_shape->ComputeAABB(&proxy->aabb, xf, i);
-		proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy);
+		if (isStatic)
+		{
+			proxy->proxyId = broadPhase->CreateStaticProxy(proxy->aabb, proxy);
+		}
+		else
+		{
+			proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy);
+		}
 		proxy->fixture = this;
 		proxy->childIndex = i;
 	}
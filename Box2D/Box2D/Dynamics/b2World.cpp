@@ -21,6 +21,10 @@
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2Island.h>
 #include <Box2D/Dynamics/Joints/b2PulleyJoint.h>
+#include <Box2D/Dynamics/Joints/b2MouseJoint.h>
+#include <Box2D/Dynamics/Joints/b2PrismaticJoint.h>
+#include <Box2D/Dynamics/Joints/b2RevoluteJoint.h>
+#include <Box2D/Dynamics/Contacts/b2PolygonContact.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 #include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
 #include <Box2D/Collision/b2Collision.h>
@@ -34,7 +38,25 @@
 #include <Box2D/Common/b2Timer.h>
 #include <new>
 
+// The objects that dominate the block allocator in practice get a size class
+// of their own. All contact types share the layout of b2Contact.
+static const int32 b2_worldObjectSizes[] =
+{
+	sizeof(b2Body),
+	sizeof(b2Fixture),
+	sizeof(b2FixtureProxy),
+	sizeof(b2PolygonContact),
+	sizeof(b2CircleShape),
+	sizeof(b2EdgeShape),
+	sizeof(b2ChainShape),
+	sizeof(b2PolygonShape),
+	sizeof(b2MouseJoint),
+	sizeof(b2PrismaticJoint),
+	sizeof(b2RevoluteJoint),
+};
+
 b2World::b2World(const b2Vec2& gravity)
+	: m_blockAllocator(b2_worldObjectSizes, sizeof(b2_worldObjectSizes) / sizeof(b2_worldObjectSizes[0]))
 {
 	m_destructionListener = NULL;
 	g_debugDraw = NULL;
@@ -1279,6 +1301,17 @@ void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 	m_contactManager.m_broadPhase.ShiftOrigin(newOrigin);
 }
 
+int32 b2World::TrimMemory()
+{
+	b2Assert((m_flags & e_locked) == 0);
+	if ((m_flags & e_locked) == e_locked)
+	{
+		return 0;
+	}
+
+	return m_blockAllocator.Trim() * b2_chunkSize;
+}
+
 void b2World::Dump()
 {
 	if ((m_flags & e_locked) == e_locked)
@@ -179,6 +179,29 @@ public:
 	/// The minimum is 1.
 	float32 GetTreeQuality() const;
 
+	/// Lay out a uniform grid for static fixtures, e.g. over the tiles of a
+	/// level. Static fixtures created afterwards that are no larger than a
+	/// cell are kept in the grid instead of the dynamic tree, so queries
+	/// against them take constant time. Destroy all static bodies created
+	/// since the last call first.
+	/// @param lower the lower corner of the grid
+	/// @param cellSize the edge length of a cell
+	/// @param width the number of cells in x direction
+	/// @param height the number of cells in y direction
+	void SetStaticGrid(const b2Vec2& lower, float32 cellSize, int32 width, int32 height);
+
+	/// Enable/disable rebuilding the dynamic tree when its quality drops.
+	void SetAdaptiveBroadPhase(bool flag);
+	bool GetAdaptiveBroadPhase() const;
+
+	/// Insert the proxies of all fixtures created from now on into the
+	/// broad-phase in one batch. Use this when creating many bodies at once.
+	/// Do not query or step the world before calling EndBulkInsert.
+	void BeginBulkInsert();
+
+	/// Insert the proxies of the fixtures created since BeginBulkInsert.
+	void EndBulkInsert();
+
 	/// Change the global gravity vector.
 	void SetGravity(const b2Vec2& gravity);
 	
@@ -205,6 +228,15 @@ public:
 	/// Get the current profile.
 	const b2Profile& GetProfile() const;
 
+	/// Get the small object allocator, e.g. to inspect its occupancy.
+	const b2BlockAllocator& GetBlockAllocator() const;
+
+	/// Release the memory of destroyed bodies, fixtures, contacts and joints
+	/// back to the system. Call this after destroying many objects at once.
+	/// @warning this should be called outside of a time step.
+	/// @return the number of bytes released.
+	int32 TrimMemory();
+
 	/// Dump the world into the log file.
 	/// @warning this should be called outside of a time step.
 	void Dump();
@@ -351,4 +383,34 @@ inline const b2Profile& b2World::GetProfile() const
 	return m_profile;
 }
 
+inline void b2World::SetStaticGrid(const b2Vec2& lower, float32 cellSize, int32 width, int32 height)
+{
+	m_contactManager.m_broadPhase.SetStaticGrid(lower, cellSize, width, height);
+}
+
+inline void b2World::SetAdaptiveBroadPhase(bool flag)
+{
+	m_contactManager.m_broadPhase.SetAdaptive(flag);
+}
+
+inline bool b2World::GetAdaptiveBroadPhase() const
+{
+	return m_contactManager.m_broadPhase.GetAdaptive();
+}
+
+inline void b2World::BeginBulkInsert()
+{
+	m_contactManager.m_broadPhase.BeginBulkInsert();
+}
+
+inline void b2World::EndBulkInsert()
+{
+	m_contactManager.m_broadPhase.EndBulkInsert();
+}
+
+inline const b2BlockAllocator& b2World::GetBlockAllocator() const
+{
+	return m_blockAllocator;
+}
+
 #endif
@@ -0,0 +1,202 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "stdafx.h"
+
+namespace Impact {
+
+  const float32 ActivationManager::DefaultActivationMargin = 3.f;
+  const float32 ActivationManager::DefaultDeactivationMargin = 6.f;
+  const float32 ActivationManager::DefaultDeactivationInterval = .5f;
+  const float32 ActivationManager::DefaultActivatorSpeed = .5f;
+
+
+  ActivationManager::ActivationManager(void)
+    : mWidth(0)
+    , mHeight(0)
+    , mInactiveCount(0)
+    , mSecondsSinceDeactivation(0.f)
+  {
+    // ...
+  }
+
+
+  void ActivationManager::setup(int width, int height)
+  {
+    clear();
+    mWidth = width;
+    mHeight = height;
+    mGrid.resize(width * height, nullptr);
+  }
+
+
+  void ActivationManager::clear(void)
+  {
+    mGrid.clear();
+    mActive.clear();
+    mActivatorAABBs.clear();
+    mWidth = 0;
+    mHeight = 0;
+    mInactiveCount = 0;
+    mSecondsSinceDeactivation = 0.f;
+  }
+
+
+  int ActivationManager::cellOf(const b2Vec2 &pos) const
+  {
+    const int x = int(std::floor(pos.x));
+    const int y = int(std::floor(pos.y));
+    if (x < 0 || y < 0 || x >= mWidth || y >= mHeight)
+      return -1;
+    return x + y * mWidth;
+  }
+
+
+  void ActivationManager::add(Block *block)
+  {
+    b2Body *body = block->body();
+    const int cell = cellOf(body->GetPosition());
+    if (cell < 0 || mGrid[cell] != nullptr) {
+      // blocks outside the map or sharing a cell are simulated all the time
+      body->SetActive(true);
+      mActive.push_back(block);
+      return;
+    }
+    body->SetActive(false);
+    mGrid[cell] = block;
+    ++mInactiveCount;
+  }
+
+
+  void ActivationManager::remove(Block *block)
+  {
+    std::vector<Block*>::iterator b = std::find(mActive.begin(), mActive.end(), block);
+    if (b != mActive.end()) {
+      *b = mActive.back();
+      mActive.pop_back();
+      return;
+    }
+    const int cell = cellOf(block->position());
+    if (cell >= 0 && mGrid[cell] == block) {
+      mGrid[cell] = nullptr;
+      --mInactiveCount;
+    }
+  }
+
+
+  void ActivationManager::addActivatorAABB(const b2Body *body, float32 elapsedSeconds)
+  {
+    if (body == nullptr || !body->IsActive())
+      return;
+    b2AABB aabb;
+    aabb.lowerBound = body->GetPosition();
+    aabb.upperBound = body->GetPosition();
+    for (const b2Fixture *f = body->GetFixtureList(); f != nullptr; f = f->GetNext()) {
+      for (int32 i = 0; i < f->GetShape()->GetChildCount(); ++i)
+        aabb.Combine(f->GetAABB(i));
+    }
+    // reach out as far as the body will travel during the next step
+    const b2Vec2 &d = elapsedSeconds * body->GetLinearVelocity();
+    const b2Vec2 reach(std::abs(d.x), std::abs(d.y));
+    aabb.lowerBound -= reach;
+    aabb.upperBound += reach;
+    mActivatorAABBs.push_back(aabb);
+  }
+
+
+  void ActivationManager::activate(const b2AABB &aabb)
+  {
+    const int x0 = std::max(0, int(std::floor(aabb.lowerBound.x - DefaultActivationMargin)));
+    const int y0 = std::max(0, int(std::floor(aabb.lowerBound.y - DefaultActivationMargin)));
+    const int x1 = std::min(mWidth - 1, int(std::floor(aabb.upperBound.x + DefaultActivationMargin)));
+    const int y1 = std::min(mHeight - 1, int(std::floor(aabb.upperBound.y + DefaultActivationMargin)));
+    for (int y = y0; y <= y1; ++y) {
+      Block **row = mGrid.data() + y * mWidth;
+      for (int x = x0; x <= x1; ++x) {
+        Block *block = row[x];
+        if (block != nullptr) {
+          row[x] = nullptr;
+          --mInactiveCount;
+          block->body()->SetActive(true);
+          mActive.push_back(block);
+        }
+      }
+    }
+  }
+
+
+  void ActivationManager::deactivate(void)
+  {
+    for (std::vector<Block*>::size_type i = 0; i < mActive.size(); ) {
+      Block *block = mActive[i];
+      b2Body *body = block->body();
+      bool keep = !block->isAlive() || body->IsAwake() || body->GetGravityScale() > 0.f;
+      const int cell = cellOf(body->GetPosition());
+      keep = keep || cell < 0 || mGrid[cell] != nullptr;
+      if (!keep) {
+        const b2Vec2 &p = body->GetPosition();
+        for (std::vector<b2AABB>::const_iterator a = mActivatorAABBs.cbegin(); a != mActivatorAABBs.cend() && !keep; ++a) {
+          keep = p.x > a->lowerBound.x - DefaultDeactivationMargin && p.x < a->upperBound.x + DefaultDeactivationMargin
+            && p.y > a->lowerBound.y - DefaultDeactivationMargin && p.y < a->upperBound.y + DefaultDeactivationMargin;
+        }
+      }
+      if (keep) {
+        ++i;
+      }
+      else {
+        body->SetActive(false);
+        mGrid[cell] = block;
+        ++mInactiveCount;
+        mActive[i] = mActive.back();
+        mActive.pop_back();
+      }
+    }
+  }
+
+
+  void ActivationManager::update(const BodyList &activators, float32 elapsedSeconds)
+  {
+    if (mGrid.empty())
+      return;
+
+    mActivatorAABBs.clear();
+    for (BodyList::const_iterator b = activators.cbegin(); b != activators.cend(); ++b)
+      addActivatorAABB((*b)->body(), elapsedSeconds);
+    // falling blocks and blocks pushed around wake up their neighbours before they touch them
+    for (std::vector<Block*>::const_iterator b = mActive.cbegin(); b != mActive.cend(); ++b) {
+      const b2Body *body = (*b)->body();
+      if (body->IsAwake() && (body->GetGravityScale() > 0.f || body->GetLinearVelocity().LengthSquared() > DefaultActivatorSpeed * DefaultActivatorSpeed))
+        addActivatorAABB(body, elapsedSeconds);
+    }
+
+    if (mInactiveCount > 0) {
+      for (std::vector<b2AABB>::const_iterator a = mActivatorAABBs.cbegin(); a != mActivatorAABBs.cend(); ++a)
+        activate(*a);
+    }
+
+    mSecondsSinceDeactivation += elapsedSeconds;
+    if (mSecondsSinceDeactivation > DefaultDeactivationInterval) {
+      mSecondsSinceDeactivation = 0.f;
+      deactivate();
+    }
+  }
+
+}
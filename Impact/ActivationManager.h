@@ -0,0 +1,84 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef __ACTIVATIONMANAGER_H_
+#define __ACTIVATIONMANAGER_H_
+
+#include <Box2D/Box2D.h>
+#include <vector>
+
+#include "Body.h"
+
+namespace Impact {
+
+  class Block;
+
+  /// keeps blocks far away from balls, the racket and falling blocks out of the simulation
+  class ActivationManager {
+  public:
+    ActivationManager(void);
+
+    /// lay out the activation grid with one cell per tile; the grid must be empty
+    void setup(int width, int height);
+    /// forget all blocks; the blocks' bodies are left untouched
+    void clear(void);
+
+    /// register a block whose body was created inactive
+    void add(Block *block);
+    /// unregister a killed block
+    void remove(Block *block);
+
+    /// wake the blocks near the activators and the falling blocks;
+    /// sleeping, untouched blocks far away from them are deactivated from time to time
+    void update(const BodyList &activators, float32 elapsedSeconds);
+
+    inline int activeCount(void) const
+    {
+      return int(mActive.size());
+    }
+    inline int inactiveCount(void) const
+    {
+      return mInactiveCount;
+    }
+
+    static const float32 DefaultActivationMargin;
+    static const float32 DefaultDeactivationMargin;
+    static const float32 DefaultDeactivationInterval;
+    static const float32 DefaultActivatorSpeed;
+
+  private:
+    int mWidth;
+    int mHeight;
+    std::vector<Block*> mGrid;
+    std::vector<Block*> mActive;
+    std::vector<b2AABB> mActivatorAABBs;
+    int mInactiveCount;
+    float32 mSecondsSinceDeactivation;
+
+    int cellOf(const b2Vec2 &pos) const;
+    void addActivatorAABB(const b2Body *body, float32 elapsedSeconds);
+    void activate(const b2AABB &aabb);
+    void deactivate(void);
+  };
+
+}
+
+#endif // __ACTIVATIONMANAGER_H_
@@ -0,0 +1,91 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __APPENDONLYLIST_H_
+#define __APPENDONLYLIST_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace Impact {
+
+  /// a list one thread appends to while other threads read it without locking;
+  /// elements are stored in chunks which never move, and an element may be read
+  /// as soon as it is counted by size()
+  template <typename T>
+  class AppendOnlyList {
+  public:
+    static const std::size_t ChunkSize = 256;
+    static const std::size_t MaxChunks = 1024;
+
+    AppendOnlyList(void)
+      : mSize(0)
+    {
+      for (std::size_t c = 0; c < MaxChunks; ++c)
+        mChunks[c] = nullptr;
+    }
+
+    ~AppendOnlyList()
+    {
+      for (std::size_t c = 0; c < MaxChunks; ++c)
+        delete [] mChunks[c];
+    }
+
+    /// append an element; must only be called by a single writer
+    /// @return false if the list is full
+    bool push_back(const T &value)
+    {
+      const std::size_t n = mSize.load(std::memory_order_relaxed);
+      const std::size_t c = n / ChunkSize;
+      if (c >= MaxChunks)
+        return false;
+      if (mChunks[c] == nullptr)
+        mChunks[c] = new T[ChunkSize];
+      mChunks[c][n % ChunkSize] = value;
+      // publishes the element and its chunk to the readers
+      mSize.store(n + 1, std::memory_order_release);
+      return true;
+    }
+
+    inline std::size_t size(void) const
+    {
+      return mSize.load(std::memory_order_acquire);
+    }
+
+    inline bool empty(void) const
+    {
+      return size() == 0;
+    }
+
+    inline const T &operator[](std::size_t i) const
+    {
+      return mChunks[i / ChunkSize][i % ChunkSize];
+    }
+
+  private:
+    AppendOnlyList(const AppendOnlyList &);
+    AppendOnlyList &operator=(const AppendOnlyList &);
+    T *mChunks[MaxChunks];
+    std::atomic<std::size_t> mSize;
+  };
+
+}
+
+#endif // __APPENDONLYLIST_H_
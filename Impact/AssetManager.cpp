@@ -0,0 +1,229 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "stdafx.h"
+#include "AssetManager.h"
+
+namespace Impact {
+
+  AssetManager::AssetManager(void)
+    : mScheduled(0)
+    , mDone(0)
+    , mQuit(false)
+  { /* ... */ }
+
+
+  AssetManager::~AssetManager()
+  {
+    shutdown();
+  }
+
+
+  void AssetManager::load(const std::string &name, const Step &decode, const Step &upload)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    // the workers are only started when needed, so that headless games spawn none
+    if (mWorkers.empty()) {
+      const unsigned int n = std::max(2U, std::min(8U, std::thread::hardware_concurrency()));
+      for (unsigned int i = 0; i < n; ++i)
+        mWorkers.push_back(std::thread(&AssetManager::work, this));
+    }
+    Job job;
+    job.name = name;
+    job.decode = decode;
+    job.upload = upload;
+    mPending.push_back(job);
+    ++mScheduled;
+    mWorkAvailable.notify_one();
+  }
+
+
+  void AssetManager::loadTexture(sf::Texture &texture, const std::string &filename, const std::function<void(void)> &loaded)
+  {
+    std::shared_ptr<sf::Image> image(new sf::Image);
+    load(filename,
+      [image, filename](void) {
+        return image->loadFromFile(filename);
+      },
+      [image, &texture, loaded](void) {
+        if (!texture.loadFromImage(*image))
+          return false;
+        if (loaded)
+          loaded();
+        return true;
+      });
+  }
+
+
+  void AssetManager::loadShader(sf::Shader &shader, const std::string &filename, sf::Shader::Type type, const std::function<void(void)> &loaded)
+  {
+    std::shared_ptr<std::string> source(new std::string);
+    load(filename,
+      [source, filename](void) {
+        std::ifstream in(filename, std::ios::binary);
+        if (!in.is_open())
+          return false;
+        source->assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return true;
+      },
+      [source, &shader, type, loaded](void) {
+        if (!shader.loadFromMemory(*source, type))
+          return false;
+        if (loaded)
+          loaded();
+        return true;
+      });
+  }
+
+
+  // the sound is decoded right away, so that it's cached when it's played first
+  void AssetManager::loadSound(SoundBank &bank, SoundBank::Sound &sound, const std::string &filename)
+  {
+    sound = bank.add(filename);
+    const SoundBank::Sound s = sound;
+    load(filename, [&bank, s](void) {
+      return bank.load(s) && bank.decode(s);
+    });
+  }
+
+
+  void AssetManager::decodeSound(SoundBank &bank, const SoundBank::Sound &sound)
+  {
+    if (!bank.startDecoding(sound))
+      return;
+    const SoundBank::Sound s = sound;
+    load(sound->filename, [&bank, s](void) {
+      return bank.decode(s);
+    });
+  }
+
+
+  void AssetManager::openMusic(sf::Music &music, const std::string &filename)
+  {
+    load(filename, [&music, filename](void) {
+      return music.openFromFile(filename);
+    });
+  }
+
+
+  void AssetManager::work(void)
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;) {
+      mWorkAvailable.wait(lock, [this]{ return mQuit || !mPending.empty(); });
+      if (mQuit)
+        return;
+      Job job = mPending.front();
+      mPending.pop_front();
+      lock.unlock();
+      const bool ok = job.decode();
+      if (!ok)
+        std::cerr << job.name << " failed to load." << std::endl;
+      lock.lock();
+      if (mQuit)
+        return;
+      if (ok && job.upload) {
+        mDecoded.push_back(job);
+        mJobDone.notify_all();
+      }
+      else
+        jobDone();
+    }
+  }
+
+
+  void AssetManager::jobDone(void)
+  {
+    if (++mDone == mScheduled) {
+      mScheduled = 0;
+      mDone = 0;
+    }
+    mJobDone.notify_all();
+  }
+
+
+  bool AssetManager::uploadNext(std::unique_lock<std::mutex> &lock)
+  {
+    if (mDecoded.empty())
+      return false;
+    Job job = mDecoded.front();
+    mDecoded.pop_front();
+    lock.unlock();
+    if (!job.upload())
+      std::cerr << job.name << " failed to load." << std::endl;
+    lock.lock();
+    jobDone();
+    return true;
+  }
+
+
+  bool AssetManager::processUploads(const sf::Time &budget)
+  {
+    sf::Clock clock;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (clock.getElapsedTime() < budget && uploadNext(lock))
+      /**/;
+    return mScheduled == 0;
+  }
+
+
+  void AssetManager::finish(void)
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mScheduled != 0) {
+      mJobDone.wait(lock, [this]{ return mScheduled == 0 || !mDecoded.empty(); });
+      while (uploadNext(lock))
+        /**/;
+    }
+  }
+
+
+  void AssetManager::shutdown(void)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mQuit = true;
+      mPending.clear();
+      mDecoded.clear();
+      mScheduled = 0;
+      mDone = 0;
+      mWorkAvailable.notify_all();
+    }
+    for (std::vector<std::thread>::iterator worker = mWorkers.begin(); worker != mWorkers.end(); ++worker)
+      worker->join();
+    mWorkers.clear();
+    mQuit = false;
+  }
+
+
+  float AssetManager::progress(void) const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mScheduled == 0 ? 1.f : float(mDone) / float(mScheduled);
+  }
+
+
+  bool AssetManager::isIdle(void) const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mScheduled == 0;
+  }
+
+}
@@ -0,0 +1,99 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __ASSETMANAGER_H_
+#define __ASSETMANAGER_H_
+
+#include <SFML/Audio.hpp>
+#include <SFML/Graphics.hpp>
+#include <SFML/System.hpp>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "SoundBank.h"
+
+namespace Impact {
+
+  /* Loads assets on a pool of worker threads. Loading is split into a
+   * decode step, which runs on a worker (reading and decompressing files,
+   * decoding sounds and images), and an optional upload step, which needs
+   * the OpenGL context and is therefore run later in batches on the thread
+   * calling processUploads() (creating textures, compiling shaders).
+   * The upload step is skipped if decoding failed. Objects passed by
+   * reference must outlive the manager's jobs, see shutdown().
+   */
+  class AssetManager {
+  public:
+    typedef std::function<bool(void)> Step;
+
+    AssetManager(void);
+    ~AssetManager();
+
+    void load(const std::string &name, const Step &decode, const Step &upload = Step());
+    void loadTexture(sf::Texture &texture, const std::string &filename, const std::function<void(void)> &loaded = std::function<void(void)>());
+    void loadShader(sf::Shader &shader, const std::string &filename, sf::Shader::Type type, const std::function<void(void)> &loaded = std::function<void(void)>());
+    void loadSound(SoundBank &bank, SoundBank::Sound &sound, const std::string &filename);
+    /// decodes a sound dropped from the bank's cache again
+    void decodeSound(SoundBank &bank, const SoundBank::Sound &sound);
+    void openMusic(sf::Music &music, const std::string &filename);
+
+    /// runs uploads of decoded assets until the time budget is used up;
+    /// true once everything scheduled so far is loaded
+    bool processUploads(const sf::Time &budget);
+    /// blocks until everything scheduled so far is loaded
+    void finish(void);
+    /// drops jobs not started yet and waits for the workers to quit
+    void shutdown(void);
+
+    /// loaded fraction of the assets scheduled since the manager was last idle
+    float progress(void) const;
+    bool isIdle(void) const;
+
+  private:
+    struct Job {
+      std::string name;
+      Step decode;
+      Step upload;
+    };
+
+    std::vector<std::thread> mWorkers;
+    std::deque<Job> mPending;
+    std::deque<Job> mDecoded;
+    mutable std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mJobDone;
+    int mScheduled;
+    int mDone;
+    bool mQuit;
+
+    void work(void);
+    void jobDone(void);
+    bool uploadNext(std::unique_lock<std::mutex> &lock);
+  };
+
+}
+
+#endif // __ASSETMANAGER_H_
@@ -0,0 +1,316 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "stdafx.h"
+#include "AudioMixer.h"
+
+namespace Impact {
+
+  /// hands out the chunks sf::Music decodes for playback, without playing them
+  class MusicStream : public sf::Music {
+  public:
+    /// @return false once the end of the track is reached; the last samples may come with it
+    bool next(const sf::Int16 *&samples, std::size_t &sampleCount)
+    {
+      Chunk chunk;
+      chunk.samples = nullptr;
+      chunk.sampleCount = 0;
+      const bool more = onGetData(chunk);
+      samples = chunk.samples;
+      sampleCount = chunk.sampleCount;
+      return more;
+    }
+    void rewind(void)
+    {
+      onSeek(sf::Time::Zero);
+    }
+  };
+
+
+  AudioMixer::AudioMixer(unsigned int sampleRate)
+    : mSampleRate(sampleRate)
+    , mFramesMixed(0)
+  {
+    // ...
+  }
+
+
+  int64_t AudioMixer::frameAt(const sf::Time &when) const
+  {
+    return when.asMicroseconds() * int64_t(mSampleRate) / 1000000;
+  }
+
+
+  void AudioMixer::post(const Event &e)
+  {
+    std::lock_guard<std::mutex> lock(mEventMutex);
+    mEvents.push_back(e);
+  }
+
+
+  void AudioMixer::playSound(const std::shared_ptr<const sf::SoundBuffer> &buffer, float volume, const sf::Time &when)
+  {
+    Event e(PlaySoundEvent, frameAt(when));
+    e.buffer = buffer;
+    e.volume = volume;
+    post(e);
+  }
+
+
+  void AudioMixer::playMusic(const std::string &filename, bool loop, float volume, const sf::Time &when)
+  {
+    Event e(PlayMusicEvent, frameAt(when));
+    e.filename = filename;
+    e.volume = volume;
+    e.loop = loop;
+    post(e);
+  }
+
+
+  void AudioMixer::pauseMusic(const sf::Time &when)
+  {
+    post(Event(PauseMusicEvent, frameAt(when)));
+  }
+
+
+  void AudioMixer::resumeMusic(const sf::Time &when)
+  {
+    post(Event(ResumeMusicEvent, frameAt(when)));
+  }
+
+
+  void AudioMixer::stopMusic(const sf::Time &when)
+  {
+    post(Event(StopMusicEvent, frameAt(when)));
+  }
+
+
+  void AudioMixer::setMusicVolume(float volume, const sf::Time &when)
+  {
+    Event e(MusicVolumeEvent, frameAt(when));
+    e.volume = volume;
+    post(e);
+  }
+
+
+  void AudioMixer::mix(float *out, unsigned int frameCount)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mEventMutex);
+      mDueEvents.insert(mDueEvents.end(), mEvents.begin(), mEvents.end());
+      mEvents.clear();
+    }
+    std::stable_sort(mDueEvents.begin(), mDueEvents.end());
+
+    std::fill(out, out + frameCount * ChannelCount, 0.f);
+    const int64_t end = mFramesMixed + frameCount;
+    std::vector<Event>::iterator e = mDueEvents.begin();
+    while (mFramesMixed < end) {
+      // split the block at the next event; events that are already late start right away
+      int64_t stop = end;
+      if (e != mDueEvents.end() && e->frame < end)
+        stop = std::max(mFramesMixed, e->frame);
+      const unsigned int n = static_cast<unsigned int>(stop - mFramesMixed);
+      render(out, n);
+      out += n * ChannelCount;
+      mFramesMixed = stop;
+      while (e != mDueEvents.end() && e->frame <= mFramesMixed)
+        apply(*e++);
+    }
+    mDueEvents.erase(mDueEvents.begin(), e);
+  }
+
+
+  void AudioMixer::apply(const Event &e)
+  {
+    switch (e.type) {
+    case PlaySoundEvent:
+    {
+      // a new sound replaces the oldest one
+      unsigned int soundCount = 0;
+      std::vector<Voice>::iterator oldest = mVoices.end();
+      for (std::vector<Voice>::iterator v = mVoices.begin(); v != mVoices.end(); ++v) {
+        if (!v->music) {
+          if (oldest == mVoices.end())
+            oldest = v;
+          ++soundCount;
+        }
+      }
+      if (soundCount >= MaxSoundVoices)
+        mVoices.erase(oldest);
+      if (e.buffer->getSampleCount() == 0)
+        break;
+      Voice v;
+      v.buffer = e.buffer;
+      v.streamEnded = true;
+      v.position = 0.0;
+      v.step = double(e.buffer->getSampleRate()) / mSampleRate;
+      v.gain = 1e-2f * e.volume;
+      v.loop = e.loop;
+      v.music = false;
+      v.paused = false;
+      mVoices.push_back(v);
+      break;
+    }
+    case PlayMusicEvent:
+    {
+      apply(Event(StopMusicEvent, e.frame));
+      std::shared_ptr<MusicStream> stream(new MusicStream);
+      if (!stream->openFromFile(e.filename)) {
+        std::cerr << "AudioMixer: " << e.filename << " failed to load." << std::endl;
+        break;
+      }
+      Voice v;
+      v.stream = stream;
+      v.streamEnded = false;
+      v.position = 0.0;
+      v.step = double(stream->getSampleRate()) / mSampleRate;
+      v.gain = 1e-2f * e.volume;
+      v.loop = e.loop;
+      v.music = true;
+      v.paused = false;
+      mVoices.push_back(v);
+      break;
+    }
+    case PauseMusicEvent:
+    case ResumeMusicEvent:
+      for (std::vector<Voice>::iterator v = mVoices.begin(); v != mVoices.end(); ++v)
+        if (v->music)
+          v->paused = e.type == PauseMusicEvent;
+      break;
+    case StopMusicEvent:
+    {
+      std::vector<Voice>::iterator v = mVoices.begin();
+      while (v != mVoices.end())
+        v = v->music ? mVoices.erase(v) : v + 1;
+      break;
+    }
+    case MusicVolumeEvent:
+      for (std::vector<Voice>::iterator v = mVoices.begin(); v != mVoices.end(); ++v)
+        if (v->music)
+          v->gain = 1e-2f * e.volume;
+      break;
+    }
+  }
+
+
+  void AudioMixer::render(float *out, unsigned int frameCount)
+  {
+    static const float Scale = 1.f / 32768.f;
+    std::vector<Voice>::iterator v = mVoices.begin();
+    while (v != mVoices.end()) {
+      if (v->paused) {
+        ++v;
+        continue;
+      }
+      if (v->stream) {
+        v = renderStream(*v, out, frameCount) ? mVoices.erase(v) : v + 1;
+        continue;
+      }
+      const sf::Int16 *samples = v->buffer->getSamples();
+      const unsigned int channels = v->buffer->getChannelCount();
+      const size_t sourceFrames = size_t(v->buffer->getSampleCount() / channels);
+      const float gain = v->gain * Scale;
+      bool finished = false;
+      float *dst = out;
+      for (unsigned int i = 0; i < frameCount; ++i) {
+        size_t idx = size_t(v->position);
+        if (idx >= sourceFrames) {
+          if (!v->loop) {
+            finished = true;
+            break;
+          }
+          v->position -= double(sourceFrames);
+          idx = size_t(v->position);
+        }
+        // linear interpolation between neighbouring source frames
+        size_t next = idx + 1;
+        if (next >= sourceFrames)
+          next = v->loop ? 0 : idx;
+        const float t = float(v->position - double(idx));
+        const sf::Int16 *a = samples + idx * channels;
+        const sf::Int16 *b = samples + next * channels;
+        const float left = a[0] + t * (b[0] - a[0]);
+        const float right = channels > 1 ? a[1] + t * (b[1] - a[1]) : left;
+        *dst++ += gain * left;
+        *dst++ += gain * right;
+        v->position += v->step;
+      }
+      v = finished ? mVoices.erase(v) : v + 1;
+    }
+  }
+
+
+  // @return true when the track has ended
+  bool AudioMixer::renderStream(Voice &v, float *out, unsigned int frameCount)
+  {
+    static const float Scale = 1.f / 32768.f;
+    const unsigned int channels = v.stream->getChannelCount();
+    const float gain = v.gain * Scale;
+    float *dst = out;
+    for (unsigned int i = 0; i < frameCount; ++i) {
+      size_t idx = size_t(v.position);
+      // the interpolation needs the frame after the current one, too
+      while (idx + 1 >= v.window.size() / channels && !v.streamEnded) {
+        refill(v);
+        idx = size_t(v.position);
+      }
+      const size_t windowFrames = v.window.size() / channels;
+      if (idx >= windowFrames)
+        return true;
+      const size_t next = std::min(idx + 1, windowFrames - 1);
+      const float t = float(v.position - double(idx));
+      const sf::Int16 *a = v.window.data() + idx * channels;
+      const sf::Int16 *b = v.window.data() + next * channels;
+      const float left = a[0] + t * (b[0] - a[0]);
+      const float right = channels > 1 ? a[1] + t * (b[1] - a[1]) : left;
+      *dst++ += gain * left;
+      *dst++ += gain * right;
+      v.position += v.step;
+    }
+    return false;
+  }
+
+
+  // drops the frames played already and appends the next decoded chunk
+  void AudioMixer::refill(Voice &v)
+  {
+    const unsigned int channels = v.stream->getChannelCount();
+    const size_t played = std::min(size_t(v.position), v.window.size() / channels);
+    v.window.erase(v.window.begin(), v.window.begin() + played * channels);
+    v.position -= double(played);
+
+    const sf::Int16 *samples = nullptr;
+    std::size_t sampleCount = 0;
+    bool more = v.stream->next(samples, sampleCount);
+    if (sampleCount > 0)
+      v.window.insert(v.window.end(), samples, samples + sampleCount);
+    if (!more) {
+      if (v.loop && (sampleCount > 0 || !v.window.empty())) {
+        v.stream->rewind();
+      }
+      else {
+        v.streamEnded = true;
+      }
+    }
+  }
+
+}
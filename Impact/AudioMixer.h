@@ -0,0 +1,141 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef __AUDIOMIXER_H_
+#define __AUDIOMIXER_H_
+
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <SFML/System/Time.hpp>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Impact {
+
+  class MusicStream;
+
+  /* Mixes the game's sound effects and music in software, so that the recorder
+   * does not depend on capturing the sound card's output. The game thread
+   * schedules sounds at the recorder's clock time, the encoder thread pulls
+   * the mixed samples. Because each event is rendered at the sample position
+   * of its time stamp, the audio stays in sync with the video frames no matter
+   * how fast the encoder runs.
+   * Music is opened and decoded chunk by chunk on the thread calling mix(), so
+   * neither the game thread waits for a track to be decoded nor is the whole
+   * track held in memory.
+   */
+  class AudioMixer {
+  public:
+    AudioMixer(unsigned int sampleRate = DefaultSampleRate);
+
+    /// the following are called by the game thread
+    void playSound(const std::shared_ptr<const sf::SoundBuffer> &buffer, float volume, const sf::Time &when);
+    void playMusic(const std::string &filename, bool loop, float volume, const sf::Time &when);
+    void pauseMusic(const sf::Time &when);
+    void resumeMusic(const sf::Time &when);
+    void stopMusic(const sf::Time &when);
+    void setMusicVolume(float volume, const sf::Time &when);
+
+    /// render the next frames as interleaved stereo samples in [-1, 1]; called by the encoder thread
+    void mix(float *out, unsigned int frameCount);
+
+    inline unsigned int sampleRate(void) const
+    {
+      return mSampleRate;
+    }
+    inline int64_t framesMixed(void) const
+    {
+      return mFramesMixed;
+    }
+
+    static const unsigned int ChannelCount = 2;
+    static const unsigned int DefaultSampleRate = 44100;
+    static const unsigned int MaxSoundVoices = 16;
+
+  private:
+    typedef std::shared_ptr<const sf::SoundBuffer> SoundBufferPtr;
+
+    typedef enum _EventType {
+      PlaySoundEvent,
+      PlayMusicEvent,
+      PauseMusicEvent,
+      ResumeMusicEvent,
+      StopMusicEvent,
+      MusicVolumeEvent
+    } EventType;
+
+    struct Event {
+      Event(EventType t, int64_t f)
+        : type(t)
+        , frame(f)
+        , volume(0.f)
+        , loop(false)
+      { /* ... */ }
+      inline bool operator<(const Event &other) const
+      {
+        return frame < other.frame;
+      }
+      EventType type;
+      int64_t frame;
+      SoundBufferPtr buffer;
+      std::string filename;
+      float volume;
+      bool loop;
+    };
+
+    struct Voice {
+      SoundBufferPtr buffer;
+      /// music is streamed; its decoded samples are appended to the window,
+      /// which starts at the frame the position is counted from
+      std::shared_ptr<MusicStream> stream;
+      std::vector<sf::Int16> window;
+      bool streamEnded;
+      double position;
+      double step;
+      float gain;
+      bool loop;
+      bool music;
+      bool paused;
+    };
+
+    int64_t frameAt(const sf::Time &when) const;
+    void post(const Event &e);
+    void apply(const Event &e);
+    void render(float *out, unsigned int frameCount);
+    bool renderStream(Voice &v, float *out, unsigned int frameCount);
+    void refill(Voice &v);
+
+    unsigned int mSampleRate;
+    int64_t mFramesMixed;
+
+    std::mutex mEventMutex;
+    std::vector<Event> mEvents;
+
+    /// the following are only touched by the encoder thread
+    std::vector<Event> mDueEvents;
+    std::vector<Voice> mVoices;
+  };
+
+}
+
+#endif // __AUDIOMIXER_H_
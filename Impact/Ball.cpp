@@ -29,31 +29,33 @@ namespace Impact {
   const float32 Ball::DefaultRestitution = .5f; //MOD Ballelastizitt
   const float32 Ball::DefaultLinearDamping = .5f; //MOD Geschwindigkeitsdmpfung
   const float32 Ball::DefaultAngularDamping = .21f; //MOD Rotationsgeschwindigkeitsdmpfung
+  const float32 Ball::MaxEncodedSpeed = 64.f;
 
   Ball::Ball(Game *game, const TileParam &tileParam)
     : Body(Body::BodyType::Ball, game, tileParam)
   {
     mName = Name;
+    mZIndex = PlayerLayer;
     setEnergy(1);
-    const sf::Texture &texture = mGame->level()->texture(mName);
-    sf::Image img;
-    img.create(texture.getSize().x + 2 * TextureMargin, texture.getSize().y + 2 * TextureMargin, sf::Color(0, 0, 0, 0));
-    img.copy(texture.copyToImage(), TextureMargin, TextureMargin, sf::IntRect(0, 0, 0, 0), true);
-    mTexture.loadFromImage(img);
-    setSmooth(mTileParam.smooth);
-
-    setHalfTextureSize(texture);
-
-    const float32 halfW = .5f * mTexture.getSize().x;
-    const float32 halfH = .5f * mTexture.getSize().y;
-
-    mSprite.setTexture(mTexture);
-    mSprite.setOrigin(halfW, halfH);
-
-    if (gLocalSettings().useShaders()) {
-      mShader.loadFromFile(ShadersDir + "/motionblur.vs", ShadersDir + "/motionblur.fs");
-      mShader.setParameter("uBlur", 2.f);
-      mShader.setParameter("uResolution", float(mTexture.getSize().x), float(mTexture.getSize().y));
+    const sf::Vector2u &size = mGame->level()->textureSize(mName);
+    setHalfTextureSize(size);
+
+    // headless games never draw, so they need no textures of their own
+    if (!mGame->isHeadless()) {
+      // all balls share one texture and shader, so that they can be drawn in one go
+      sf::Texture &paddedTexture = mGame->tileTexture(mGame->level()->bodyIndexByTextureName(mName));
+      if (paddedTexture.getSize().x == 0) {
+        const sf::Texture &texture = mGame->level()->texture(mName);
+        sf::Image img;
+        img.create(texture.getSize().x + 2 * TextureMargin, texture.getSize().y + 2 * TextureMargin, sf::Color(0, 0, 0, 0));
+        img.copy(texture.copyToImage(), TextureMargin, TextureMargin, sf::IntRect(0, 0, 0, 0), true);
+        paddedTexture.loadFromImage(img);
+        paddedTexture.setSmooth(mTileParam.smooth);
+        if (mGame->useShaders())
+          mGame->ballShader().setParameter("uResolution", float(paddedTexture.getSize().x), float(paddedTexture.getSize().y));
+      }
+      mSprite.setTexture(paddedTexture);
+      mSprite.setOrigin(.5f * paddedTexture.getSize().x, .5f * paddedTexture.getSize().y);
     }
 
     b2BodyDef bd;
@@ -75,7 +77,7 @@ namespace Impact {
     case BodyShapeType::CircleShape:
     {
       b2CircleShape circle;
-      circle.m_radius = .5f * texture.getSize().x * Game::InvScale;
+      circle.m_radius = .5f * size.x * Game::InvScale;
       fd.shape = &circle;
       mBody->CreateFixture(&fd);
       break;
@@ -83,7 +85,7 @@ namespace Impact {
     case BodyShapeType::PolygonShape:
     {
       b2PolygonShape square;
-      const float edge = .5f * Game::InvScale * texture.getSize().x;
+      const float edge = .5f * Game::InvScale * size.x;
       square.SetAsBox(edge, edge);
       fd.shape = &square;
       mBody->CreateFixture(&fd);
@@ -96,24 +98,44 @@ namespace Impact {
   }
 
 
+  // the shared shader gets velocity and angle of each ball in its vertex color;
+  // the angle takes two channels, so that slowly spinning balls turn smoothly
+  static sf::Color motionColor(const b2Vec2 &v, float32 angle)
+  {
+    const float32 vx = b2Clamp(v.x / Ball::MaxEncodedSpeed, -1.f, 1.f);
+    const float32 vy = b2Clamp(v.y / Ball::MaxEncodedSpeed, -1.f, 1.f);
+    float32 turns = std::fmod(angle / (2 * b2_pi), 1.f);
+    if (turns < 0.f)
+      turns += 1.f;
+    const uint32_t a = uint32_t(turns * 65535.f);
+    return sf::Color(sf::Uint8(127.5f + 127.5f * vx), sf::Uint8(127.5f + 127.5f * vy), sf::Uint8(a >> 8), sf::Uint8(a & 0xffU));
+  }
+
+
   void Ball::onUpdate(float elapsedSeconds)
   {
     UNUSED(elapsedSeconds);
-    if (gLocalSettings().useShaders()) {
-      mShader.setParameter("uV", mBody->GetLinearVelocity().x, mBody->GetLinearVelocity().y);
-      mShader.setParameter("uRot", mBody->GetAngle());
+    if (mGame->useShaders()) {
+      mSprite.setColor(motionColor(mBody->GetLinearVelocity(), mBody->GetAngle()));
     }
     else {
+      mSprite.setColor(sf::Color::White);
       mSprite.setRotation(rad2deg(mBody->GetAngle()));
     }
     mSprite.setPosition(Game::Scale * mBody->GetPosition().x, Game::Scale * mBody->GetPosition().y);
   }
 
 
+  void Ball::enqueue(RenderQueue &queue) const
+  {
+    queue.add(mSprite, mZIndex, mGame->useShaders() ? &mGame->ballShader() : nullptr);
+  }
+
+
   void Ball::onDraw(sf::RenderTarget &target, sf::RenderStates states) const
   {
-    if (gLocalSettings().useShaders()) {
-      states.shader = &mShader;
+    if (mGame->useShaders()) {
+      states.shader = &mGame->ballShader();
     }
     target.draw(mSprite, states);
   }
@@ -35,6 +35,7 @@ namespace Impact {
     // Body implementation
     virtual void onUpdate(float elapsedSeconds);
     virtual void onDraw(sf::RenderTarget &target, sf::RenderStates states) const;
+    virtual void enqueue(RenderQueue &queue) const;
     virtual BodyType type(void) const { return Body::BodyType::Ball; }
 
     virtual void setPosition(const b2Vec2 &);
@@ -46,6 +47,9 @@ namespace Impact {
     static const float32 DefaultAngularDamping;
     static const std::string Name;
 
+    /// fastest speed the motion blur shader can tell apart, see motionblur.vs
+    static const float32 MaxEncodedSpeed;
+
   private:
     static const int TextureMargin = 24;
 
@@ -33,6 +33,7 @@ namespace Impact {
     : Body(Body::BodyType::Block, game, tileParam)
     , mGravityScale(2.f)
     , mMinimumHitImpulse(0)
+    , mHit(false)
   {
     mName = Name;
     mMinimumHitImpulse = mTileParam.minimumHitImpulse;
@@ -40,28 +41,35 @@ namespace Impact {
     setEnergy(mTileParam.minimumKillImpulse);
     setGravityScale(mTileParam.gravityScale);
 
-    const sf::Texture &texture = mGame->level()->tileParam(index).texture;
-    sf::Image img;
-    img.create(texture.getSize().x + 2 * TextureMargin, texture.getSize().y + 2 * TextureMargin, sf::Color(0, 0, 0, 0));
-    img.copy(texture.copyToImage(), TextureMargin, TextureMargin, sf::IntRect(0, 0, 0, 0), true);
-    mTexture.loadFromImage(img);
-    setSmooth(mTileParam.smooth);
-
-    setHalfTextureSize(texture);
-    
-    mSprite.setTexture(mTexture);
-    mSprite.setOrigin(.5f * mTexture.getSize().x, .5f * mTexture.getSize().y);
+    const sf::Vector2u &size = mGame->level()->tileSize(index);
+    setHalfTextureSize(size);
+
+    // all blocks of a kind share one texture, so that they can be drawn in one go
+    sf::Texture &paddedTexture = mGame->tileTexture(index);
+    // headless games never draw, so they need no textures of their own
+    if (!mGame->isHeadless()) {
+      if (paddedTexture.getSize().x == 0) {
+        const sf::Texture &texture = mGame->level()->tileParam(index).texture;
+        sf::Image img;
+        img.create(texture.getSize().x + 2 * TextureMargin, texture.getSize().y + 2 * TextureMargin, sf::Color(0, 0, 0, 0));
+        img.copy(texture.copyToImage(), TextureMargin, TextureMargin, sf::IntRect(0, 0, 0, 0), true);
+        paddedTexture.loadFromImage(img);
+        paddedTexture.setSmooth(mTileParam.smooth);
+      }
+      mSprite.setTexture(paddedTexture);
+      mSprite.setOrigin(.5f * paddedTexture.getSize().x, .5f * paddedTexture.getSize().y);
+    }
 
-    if (gLocalSettings().useShaders()) {
+    if (mGame->useShaders()) {
       mShader.loadFromFile(ShadersDir + "/fallingblock.fs", sf::Shader::Fragment);
       mShader.setParameter("uAge", 0.f);
       mShader.setParameter("uBlur", 0.f);
       mShader.setParameter("uColor", sf::Color(255, 255, 255, 255));
-      mShader.setParameter("uResolution", float(mTexture.getSize().x), float(mTexture.getSize().y));
+      mShader.setParameter("uResolution", float(paddedTexture.getSize().x), float(paddedTexture.getSize().y));
     }
 
-    const unsigned int W = texture.getSize().x;
-    const unsigned int H = texture.getSize().y;
+    const unsigned int W = size.x;
+    const unsigned int H = size.y;
 
     b2BodyDef bd;
     bd.type = b2_dynamicBody;
@@ -71,6 +79,7 @@ namespace Impact {
     bd.gravityScale = .0f;
     bd.allowSleep = true;
     bd.awake = false;
+    bd.active = false; // woken up by the ActivationManager
     bd.fixedRotation = false;
     bd.bullet = false;
     bd.userData = this;
@@ -125,27 +134,36 @@ namespace Impact {
     UNUSED(elapsedSeconds);
     mSprite.setPosition(Game::Scale * mBody->GetPosition().x, Game::Scale * mBody->GetPosition().y);
     mSprite.setRotation(rad2deg(mBody->GetAngle()));
-    if (gLocalSettings().useShaders())
+    if (mGame->useShaders())
       mShader.setParameter("uAge", age().asSeconds());
   }
 
 
   void Block::onDraw(sf::RenderTarget &target, sf::RenderStates states) const
   {
-    if (gLocalSettings().useShaders())
+    if (mGame->useShaders())
       states.shader = &mShader;
     target.draw(mSprite, states);
   }
 
 
+  void Block::enqueue(RenderQueue &queue) const
+  {
+    // the blur shader leaves a block untouched until it has been hit,
+    // so untouched blocks are drawn without it and can be batched
+    queue.add(mSprite, mZIndex, mGame->useShaders() && mHit ? &mShader : nullptr);
+  }
+
+
   bool Block::hit(float impulse)
   {
     const int v = int(impulse);
     bool destroyed = Body::hit(v);
     if (!destroyed && v > mMinimumHitImpulse) {
+      mHit = true;
       mBody->SetLinearDamping(0.f);
       mBody->SetGravityScale(mGravityScale);
-      if (gLocalSettings().useShaders()) {
+      if (mGame->useShaders()) {
         mShader.setParameter("uColor", sf::Color(sf::Color(255, 255, 255, 230)));
         mShader.setParameter("uBlur", 2.28f);
       }
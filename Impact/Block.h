@@ -34,6 +34,7 @@ namespace Impact {
     // Body implementation
     virtual void onUpdate(float elapsedSeconds);
     virtual void onDraw(sf::RenderTarget &target, sf::RenderStates states) const;
+    virtual void enqueue(RenderQueue &queue) const;
     virtual BodyType type(void) const { return Body::BodyType::Block; }
 
     virtual bool hit(float impulse);
@@ -54,6 +55,7 @@ namespace Impact {
   private:
     float32 mGravityScale;
     int mMinimumHitImpulse;
+    bool mHit;
   };
 
 }
@@ -28,13 +28,12 @@ namespace Impact {
   Body::Body(BodyType type, Game *game, const TileParam &tileParam)
     : mAlive(true)
     , mVisible(true)
-    , mZIndex(0)
+    , mZIndex(TileLayer)
     , mBody(nullptr)
     , mSetHalfTextureSizeCalled(false)
     , mTileParam(tileParam)
   {
     setGame(game);
-    mSpawned.restart();
   }
 
 
@@ -47,8 +46,10 @@ namespace Impact {
   void Body::setGame(Game *game)
   {
     mGame = game;
-    if (mGame != nullptr)
+    if (mGame != nullptr) {
       doOnKilled(boost::bind(&Game::onBodyKilled, mGame, this));
+      mSpawned.setClock(&mGame->simulationClock());
+    }
   }
 
 
@@ -70,6 +71,12 @@ namespace Impact {
   }
 
 
+  void Body::enqueue(RenderQueue &queue) const
+  {
+    queue.add(*this, mZIndex);
+  }
+
+
   void Body::setSmooth(bool smooth)
   {
     mTexture.setSmooth(smooth);
@@ -137,9 +144,9 @@ namespace Impact {
   }
 
 
-  void Body::setHalfTextureSize(const sf::Texture &texture)
+  void Body::setHalfTextureSize(const sf::Vector2u &size)
   {
-    mHalfTextureSize = .5f * b2Vec2(Game::InvScale * texture.getSize().x, Game::InvScale * texture.getSize().y);
+    mHalfTextureSize = .5f * b2Vec2(Game::InvScale * size.x, Game::InvScale * size.y);
     mSetHalfTextureSizeCalled = true;
   }
 
@@ -29,6 +29,8 @@
 #include "Destructible.h"
 #include "util.h"
 #include "TileParam.h"
+#include "SimulationClock.h"
+#include "RenderQueue.h"
 
 #include <cstdint>
 #include <vector>
@@ -82,6 +84,9 @@ namespace Impact {
 
     void update(float elapsedSeconds);
     void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+    /// hand what is to be drawn to the render queue; bodies drawing a
+    /// single sprite queue it, so that it can be culled and batched
+    virtual void enqueue(RenderQueue &queue) const;
 
     virtual void setRestitution(float32);
     virtual void setFriction(float32);
@@ -118,7 +123,8 @@ namespace Impact {
 
     inline const sf::Texture &texture(void) const
     {
-      return mTexture;
+      // tiles draw textures shared with all tiles of their kind
+      return mSprite.getTexture() != nullptr ? *mSprite.getTexture() : mTexture;
     }
 
     virtual void remove(void);
@@ -162,7 +168,11 @@ namespace Impact {
     b2Vec2 mHalfTextureSize;
 
     int mZIndex;
-    sf::Clock mSpawned; // milliseconds
+    static const int TileLayer = 0;
+    static const int PlayerLayer = 1;
+    static const int ParticleLayer = 2;
+    static const int TextLayer = 3;
+    SimulationTimer mSpawned;
     sf::Time mMaxAge;
     Game *mGame;
 
@@ -173,7 +183,7 @@ namespace Impact {
 
     TileParam mTileParam;
 
-    void setHalfTextureSize(const sf::Texture &texture);
+    void setHalfTextureSize(const sf::Vector2u &size);
 
   private:
     bool mAlive;
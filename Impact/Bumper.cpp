@@ -26,17 +26,26 @@ namespace Impact {
 
   Bumper::Bumper(int index, Game *game, const TileParam &tileParam)
     : Body(Body::BodyType::Bumper, game, tileParam)
+    , mActivationTimer(&game->simulationClock())
     , mActivated(false)
   {
     mName = Name;
     setScore(mTileParam.score);
 
-    mTexture = mGame->level()->tileParam(index).texture;
-    setSmooth(mTileParam.smooth);
-    mSprite.setTexture(mTexture);
-    mSprite.setOrigin(.5f * mTexture.getSize().x, .5f * mTexture.getSize().y);
+    // headless games never draw, so they need no textures of their own
+    if (!mGame->isHeadless()) {
+      // all bumpers of a kind share one texture, so that they can be drawn in one go
+      sf::Texture &texture = mGame->tileTexture(index);
+      if (texture.getSize().x == 0) {
+        texture = mGame->level()->tileParam(index).texture;
+        texture.setSmooth(mTileParam.smooth);
+      }
+      mSprite.setTexture(texture);
+      mSprite.setOrigin(.5f * texture.getSize().x, .5f * texture.getSize().y);
+    }
 
-    setHalfTextureSize(mTexture);
+    const sf::Vector2u &size = mGame->level()->tileSize(index);
+    setHalfTextureSize(size);
 
     b2BodyDef bd;
     bd.type = b2_staticBody;
@@ -44,7 +53,7 @@ namespace Impact {
     mBody = game->world()->CreateBody(&bd);
 
     b2CircleShape circle;
-    circle.m_radius = .5f * mTexture.getSize().x * Game::InvScale;
+    circle.m_radius = .5f * size.x * Game::InvScale;
 
     b2FixtureDef fd;
     fd.shape = &circle;
@@ -70,6 +79,12 @@ namespace Impact {
   }
 
 
+  void Bumper::enqueue(RenderQueue &queue) const
+  {
+    queue.add(mSprite, mZIndex);
+  }
+
+
   void Bumper::onDraw(sf::RenderTarget &target, sf::RenderStates states) const
   {
     target.draw(mSprite, states);
@@ -34,6 +34,7 @@ namespace Impact {
     // Body implementation
     virtual void onUpdate(float elapsedSeconds);
     virtual void onDraw(sf::RenderTarget &target, sf::RenderStates states) const;
+    virtual void enqueue(RenderQueue &queue) const;
     virtual BodyType type(void) const { return Body::BodyType::Bumper; }
 
     static const std::string Name;
@@ -44,7 +45,7 @@ namespace Impact {
     void activate(void);
 
   private:
-    sf::Clock mActivationTimer;
+    SimulationTimer mActivationTimer;
     bool mActivated;
 
   };
@@ -37,27 +37,31 @@ namespace Impact {
     : Body(Body::BodyType::Particle, def.game)
     , mParticles(def.count)
     , mShader(nullptr)
+    , mVertices(sf::Quads)
   {
     mName = std::string("Explosion");
+    mZIndex = ParticleLayer;
     setLifetime(def.maxLifetime);
     mTexture = def.texture;
 
-    if (gLocalSettings().useShaders() && gLocalSettings().useShadersForExplosions()) {
+    if (mGame->useShaders() && gLocalSettings().useShadersForExplosions()) {
       mShader = ShaderPool::getNext();
       mShader->setParameter("uTexture", sf::Shader::CurrentTexture);
       mShader->setParameter("uMaxAge", def.maxLifetime.asSeconds());
     }
 
-    static boost::random::uniform_int_distribution<sf::Int32> randomLifetime(def.minLifetime.asMilliseconds(), def.maxLifetime.asMilliseconds());
-    static boost::random::uniform_real_distribution<float32> randomSpeed(def.minSpeed, def.maxSpeed);
-    static boost::random::uniform_real_distribution<float32> randomOffset(-1.f, +1.f);
+    boost::random::uniform_int_distribution<sf::Int32> randomLifetime(def.minLifetime.asMilliseconds(), def.maxLifetime.asMilliseconds());
+    boost::random::uniform_real_distribution<float32> randomSpeed(def.minSpeed, def.maxSpeed);
+    boost::random::uniform_real_distribution<float32> randomOffset(-1.f, +1.f);
+    std::mt19937 &rng = mGame->simulationClock().rng();
 
     b2World *world = mGame->world();
+    world->BeginBulkInsert();
     const int N = mParticles.size();
     for (int i = 0; i < N; ++i) {
       SimpleParticle &p = mParticles[i];
       p.dead = false;
-      p.lifeTime = sf::milliseconds(randomLifetime(gRNG()));
+      p.lifeTime = sf::milliseconds(randomLifetime(rng));
       p.sprite.setTexture(mTexture);
       mTexture.setRepeated(false);
       mTexture.setSmooth(true);
@@ -65,7 +69,10 @@ namespace Impact {
 
       b2BodyDef bd;
       bd.type = b2_dynamicBody;
-      bd.position = def.pos + Game::InvScale * b2Vec2(randomOffset(gRNG()), randomOffset(gRNG()));
+      // one draw per statement: the evaluation order of arguments is unspecified
+      const float32 offsetX = randomOffset(rng);
+      const float32 offsetY = randomOffset(rng);
+      bd.position = def.pos + Game::InvScale * b2Vec2(offsetX, offsetY);
 #ifdef EXPLOSION_PARTICLES_CANNOT_ROTATE
       bd.fixedRotation = true;
 #else
@@ -76,7 +83,10 @@ namespace Impact {
       bd.userData = this;
       bd.gravityScale = def.gravityScale;
       bd.linearDamping = def.linearDamping;
-      bd.linearVelocity = randomSpeed(gRNG()) * b2Vec2(randomOffset(gRNG()), randomOffset(gRNG()));
+      const float32 speed = randomSpeed(rng);
+      const float32 directionX = randomOffset(rng);
+      const float32 directionY = randomOffset(rng);
+      bd.linearVelocity = speed * b2Vec2(directionX, directionY);
       p.body = world->CreateBody(&bd);
 
       b2CircleShape circleShape;
@@ -93,6 +103,7 @@ namespace Impact {
       fd.shape = &circleShape;
       p.body->CreateFixture(&fd);
     }
+    world->EndBulkInsert();
   }
 
 
@@ -142,9 +153,13 @@ namespace Impact {
       mShader->setParameter("uAge", age().asSeconds());
       states.shader = mShader;
     }
+    // all particles share texture and shader, so they go out in a single draw call
+    mVertices.clear();
     for (std::vector<SimpleParticle>::const_iterator p = mParticles.cbegin(); p != mParticles.cend(); ++p)
       if (!p->dead)
-        target.draw(p->sprite, states);
+        RenderQueue::appendQuad(mVertices, p->sprite);
+    states.texture = &mTexture;
+    target.draw(mVertices, states);
   }
 
 }
@@ -93,6 +93,7 @@ namespace Impact {
     std::vector<SimpleParticle> mParticles;
 
     sf::Shader *mShader;
+    mutable sf::VertexArray mVertices;
 
     static std::vector<sf::Shader*> sShaders;
     static std::vector<sf::Shader*>::size_type sCurrentShaderIndex;
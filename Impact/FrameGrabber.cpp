@@ -0,0 +1,139 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "stdafx.h"
+#include "FrameGrabber.h"
+
+namespace Impact {
+
+  VideoFramePool::~VideoFramePool()
+  {
+    for (std::vector<VideoFrame*>::iterator f = mFree.begin(); f != mFree.end(); ++f)
+      delete *f;
+  }
+
+
+  VideoFramePtr VideoFramePool::acquire(unsigned int width, unsigned int height)
+  {
+    VideoFrame *frame = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (!mFree.empty()) {
+        frame = mFree.back();
+        mFree.pop_back();
+      }
+    }
+    if (frame == nullptr)
+      frame = new VideoFrame;
+    frame->width = width;
+    frame->height = height;
+    frame->pixels.resize(4 * width * height);
+    // the frame keeps the pool alive until it has been returned
+    std::shared_ptr<VideoFramePool> pool = shared_from_this();
+    return VideoFramePtr(frame, [pool](VideoFrame *f) { pool->recycle(f); });
+  }
+
+
+  void VideoFramePool::recycle(VideoFrame *frame)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFree.push_back(frame);
+  }
+
+
+  FrameGrabber::FrameGrabber(void)
+    : mIndex(0)
+    , mPending(0)
+    , mWidth(0)
+    , mHeight(0)
+    , mPool(std::make_shared<VideoFramePool>())
+  {
+    std::fill(mPBO, mPBO + RingSize, 0);
+  }
+
+
+  FrameGrabber::~FrameGrabber()
+  {
+    destroy();
+  }
+
+
+  bool FrameGrabber::create(unsigned int width, unsigned int height)
+  {
+    destroy();
+    if (!GLEW_VERSION_2_1) {
+      std::cerr << "Pixel buffer objects are not available." << std::endl;
+      return false;
+    }
+    mWidth = width;
+    mHeight = height;
+    glGenBuffers(RingSize, mPBO);
+    for (int i = 0; i < RingSize; ++i) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, mPBO[i]);
+      glBufferData(GL_PIXEL_PACK_BUFFER, 4 * width * height, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return glGetError() == GL_NO_ERROR;
+  }
+
+
+  void FrameGrabber::destroy(void)
+  {
+    if (mPBO[0] != 0) {
+      glDeleteBuffers(RingSize, mPBO);
+      std::fill(mPBO, mPBO + RingSize, 0);
+    }
+    mIndex = 0;
+    mPending = 0;
+  }
+
+
+  VideoFramePtr FrameGrabber::grab(const sf::Time &timestamp)
+  {
+    VideoFramePtr frame;
+    if (mPBO[0] == 0)
+      return frame;
+
+    // glReadPixels() returns immediately because the pixels go into a buffer object
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, mPBO[mIndex]);
+    glReadPixels(0, 0, mWidth, mHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    mTimestamps[mIndex] = timestamp;
+    mIndex = (mIndex + 1) % RingSize;
+
+    if (mPending == RingSize - 1) {
+      // the oldest buffer has been filled long ago, so mapping it doesn't stall
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, mPBO[mIndex]);
+      const sf::Uint8 *pixels = reinterpret_cast<const sf::Uint8*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+      if (pixels != nullptr) {
+        frame = mPool->acquire(mWidth, mHeight);
+        frame->timestamp = mTimestamps[mIndex];
+        std::memcpy(frame->pixels.data(), pixels, frame->pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      }
+    }
+    else {
+      ++mPending;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return frame;
+  }
+
+}
@@ -0,0 +1,100 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef __FRAMEGRABBER_H_
+#define __FRAMEGRABBER_H_
+
+#include <GL/glew.h>
+#include <SFML/Config.hpp>
+#include <SFML/System/Time.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Impact {
+
+  /// RGBA pixels as delivered by glReadPixels(), i.e. the bottom row comes first
+  struct VideoFrame {
+    VideoFrame(void)
+      : width(0)
+      , height(0)
+    { /* ... */ }
+    inline int stride(void) const
+    {
+      return 4 * int(width);
+    }
+    inline const sf::Uint8 *topRow(void) const
+    {
+      return pixels.data() + (height - 1) * stride();
+    }
+    unsigned int width;
+    unsigned int height;
+    sf::Time timestamp;
+    std::vector<sf::Uint8> pixels;
+  };
+
+  /// frames are handed out reference-counted and go back to their pool when the last reference is dropped
+  typedef std::shared_ptr<VideoFrame> VideoFramePtr;
+
+
+  class VideoFramePool : public std::enable_shared_from_this<VideoFramePool> {
+  public:
+    ~VideoFramePool();
+    VideoFramePtr acquire(unsigned int width, unsigned int height);
+
+  private:
+    void recycle(VideoFrame *frame);
+
+    std::mutex mMutex;
+    std::vector<VideoFrame*> mFree;
+  };
+
+
+  /// reads back the frame buffer asynchronously through a ring of pixel buffer objects
+  class FrameGrabber {
+  public:
+    FrameGrabber(void);
+    ~FrameGrabber();
+
+    /// must be called with the window's GL context active
+    bool create(unsigned int width, unsigned int height);
+    void destroy(void);
+
+    /// queue the read-back of the current frame buffer and return the frame
+    /// queued RingSize-1 calls ago, or an empty pointer while the ring fills up
+    VideoFramePtr grab(const sf::Time &timestamp);
+
+    static const int RingSize = 3;
+
+  private:
+    GLuint mPBO[RingSize];
+    sf::Time mTimestamps[RingSize];
+    int mIndex;
+    int mPending;
+    unsigned int mWidth;
+    unsigned int mHeight;
+    std::shared_ptr<VideoFramePool> mPool;
+  };
+
+}
+
+#endif // __FRAMEGRABBER_H_
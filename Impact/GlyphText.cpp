@@ -0,0 +1,156 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "stdafx.h"
+#include "GlyphText.h"
+
+namespace Impact {
+
+  GlyphText::GlyphText(void)
+    : mFont(nullptr)
+    , mCharacterSize(30U)
+    , mColor(sf::Color::White)
+    , mGlyphs(128)
+    , mVertices(sf::Quads)
+  {
+    clear();
+  }
+
+
+  void GlyphText::setFont(const sf::Font &font, unsigned int characterSize)
+  {
+    mFont = &font;
+    mCharacterSize = characterSize;
+    mGlyphs.assign(128, Glyph());
+    static const char *const Prepared = "0123456789- ";
+    for (const char *c = Prepared; *c != '\0'; ++c)
+      glyph(*c);
+    clear();
+  }
+
+
+  void GlyphText::setColor(const sf::Color &color)
+  {
+    mColor = color;
+    for (unsigned int i = 0; i < mVertices.getVertexCount(); ++i)
+      mVertices[i].color = color;
+  }
+
+
+  void GlyphText::clear(void)
+  {
+    mVertices.clear();
+    // like sf::Text, the first baseline is one character size below the top
+    mPen = sf::Vector2f(0.f, float(mCharacterSize));
+  }
+
+
+  const GlyphText::Glyph &GlyphText::glyph(char c)
+  {
+    Glyph &g = mGlyphs[c & 0x7f];
+    if (!g.valid && mFont != nullptr) {
+      const sf::Glyph &fontGlyph = mFont->getGlyph(sf::Uint32(c & 0x7f), mCharacterSize, false);
+      g.advance = float(fontGlyph.advance);
+      g.bounds = sf::FloatRect(fontGlyph.bounds);
+      g.textureRect = sf::FloatRect(fontGlyph.textureRect);
+      g.valid = true;
+    }
+    return g;
+  }
+
+
+  void GlyphText::appendChar(char c)
+  {
+    if (mFont == nullptr)
+      return;
+    if (c == '\n') {
+      mPen.x = 0.f;
+      mPen.y += float(mFont->getLineSpacing(mCharacterSize));
+      return;
+    }
+    const Glyph &g = glyph(c);
+    const float left = mPen.x + g.bounds.left;
+    const float top = mPen.y + g.bounds.top;
+    const float right = left + g.bounds.width;
+    const float bottom = top + g.bounds.height;
+    const float u0 = g.textureRect.left;
+    const float v0 = g.textureRect.top;
+    const float u1 = u0 + g.textureRect.width;
+    const float v1 = v0 + g.textureRect.height;
+    mVertices.append(sf::Vertex(sf::Vector2f(left, top), mColor, sf::Vector2f(u0, v0)));
+    mVertices.append(sf::Vertex(sf::Vector2f(right, top), mColor, sf::Vector2f(u1, v0)));
+    mVertices.append(sf::Vertex(sf::Vector2f(right, bottom), mColor, sf::Vector2f(u1, v1)));
+    mVertices.append(sf::Vertex(sf::Vector2f(left, bottom), mColor, sf::Vector2f(u0, v1)));
+    mPen.x += g.advance;
+  }
+
+
+  void GlyphText::append(const char *str)
+  {
+    while (*str != '\0')
+      appendChar(*str++);
+  }
+
+
+  void GlyphText::append(const std::string &str)
+  {
+    append(str.c_str());
+  }
+
+
+  void GlyphText::append(int64_t number)
+  {
+    // digits are produced backwards into a buffer large enough for any 64 bit number
+    char digits[21];
+    int n = 0;
+    uint64_t magnitude = number < 0 ? uint64_t(0) - uint64_t(number) : uint64_t(number);
+    do {
+      digits[n++] = char('0' + magnitude % 10);
+      magnitude /= 10;
+    } while (magnitude != 0);
+    if (number < 0)
+      appendChar('-');
+    while (n > 0)
+      appendChar(digits[--n]);
+  }
+
+
+  sf::FloatRect GlyphText::getLocalBounds(void) const
+  {
+    return mVertices.getBounds();
+  }
+
+
+  sf::FloatRect GlyphText::getGlobalBounds(void) const
+  {
+    return getTransform().transformRect(getLocalBounds());
+  }
+
+
+  void GlyphText::draw(sf::RenderTarget &target, sf::RenderStates states) const
+  {
+    if (mFont == nullptr || mVertices.getVertexCount() == 0)
+      return;
+    states.transform *= getTransform();
+    states.texture = &mFont->getTexture(mCharacterSize);
+    target.draw(mVertices, states);
+  }
+
+}
@@ -0,0 +1,71 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GLYPHTEXT_H_
+#define __GLYPHTEXT_H_
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Impact {
+
+  /// an ASCII text laid out from glyph quads, which are looked up once per character
+  /// and then reused; the glyphs of numbers are prepared when the font is set, so
+  /// numbers can be shown without formatting strings
+  class GlyphText : public sf::Drawable, public sf::Transformable {
+  public:
+    GlyphText(void);
+    void setFont(const sf::Font &font, unsigned int characterSize);
+    void setColor(const sf::Color &color);
+    /// remove all characters
+    void clear(void);
+    void append(const char *str);
+    void append(const std::string &str);
+    void append(int64_t number);
+    sf::FloatRect getLocalBounds(void) const;
+    sf::FloatRect getGlobalBounds(void) const;
+
+  private:
+    struct Glyph {
+      Glyph(void)
+        : valid(false)
+        , advance(0.f)
+      { /* ... */ }
+      bool valid;
+      float advance;
+      sf::FloatRect bounds;
+      sf::FloatRect textureRect;
+    };
+    const sf::Font *mFont;
+    unsigned int mCharacterSize;
+    sf::Color mColor;
+    std::vector<Glyph> mGlyphs;
+    sf::VertexArray mVertices;
+    sf::Vector2f mPen;
+    const Glyph &glyph(char c);
+    void appendChar(char c);
+    virtual void draw(sf::RenderTarget &target, sf::RenderStates states) const;
+  };
+
+}
+
+#endif // __GLYPHTEXT_H_
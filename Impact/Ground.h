@@ -34,6 +34,7 @@ namespace Impact {
     // Body implementation
     virtual void onUpdate(float) { /* ... */ }
     virtual void onDraw(sf::RenderTarget &, sf::RenderStates) const  { /* ... */ }
+    virtual void enqueue(RenderQueue &) const { /* nothing to draw */ }
     virtual BodyType type(void) const { return Body::BodyType::Ground; }
 
     static const std::string Name;
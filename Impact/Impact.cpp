@@ -112,6 +112,9 @@ namespace Impact {
   const sf::Time Game::DefaultAberrationEffectDuration = sf::milliseconds(250);
   const sf::Time Game::DefaultEarthquakeDuration = sf::milliseconds(10 * 1000);
   const sf::Time Game::DefaultOverlayDuration = sf::milliseconds(300);
+  const sf::Time Game::DefaultTimeStep = sf::microseconds(8333); // 120 Hz
+  const sf::Time Game::DefaultReplayTail = sf::milliseconds(2000);
+  const float Game::DefaultCameraSpeed = 4.f;
 
 #ifndef NDEBUG
   const char* Game::StateNames[State::LastState] = {
@@ -131,7 +134,7 @@ namespace Impact {
   };
 #endif
 
-  Game::Game(void)
+  Game::Game(Mode mode)
     : mWorld(nullptr)
     , mDisplayCount(0)
     , mBallHasBeenLost(false)
@@ -139,6 +142,7 @@ namespace Impact {
     , mGround(nullptr)
     , mContactPointCount(0)
     , mLevelScore(0)
+    , mTotalScore(0)
     , mNewHighscore(false)
     , mLives(DefaultLives)
     , mMouseButtonDown(false)
@@ -148,6 +152,11 @@ namespace Impact {
     , mPlaymode(Playmode::Campaign)
     , mKeyMapping(Action::LastAction)
     , mBlockCount(0)
+    , mStatsDirty(true)
+    , mScrolling(false)
+    , mChunksHorizontally(0)
+    , mChunksVertically(0)
+    , mStreamingStamp(0)
     , mFadeEffectsActive(0)
     , mFadeEffectsDarken(false)
     , mFadeEffectDuration(DefaultFadeEffectDuration)
@@ -162,8 +171,7 @@ namespace Impact {
     , mOverlayDuration(DefaultOverlayDuration)
     , mLastKillingsIndex(0)
     , mMusic(Music::LastMusic)
-    , mSoundFX(MaxSoundFX)
-    , mSoundIndex(0)
+    , mMusicFilenames(Music::LastMusic)
     , mFPSArray(32, 0)
     , mFPS(0)
     , mFPSIndex(0)
@@ -173,9 +181,13 @@ namespace Impact {
     , mGLVersionMinor(0)
     , mGLSLVersionMajor(0)
     , mGLSLVersionMinor(0)
-    , mShadersAvailable(sf::Shader::isAvailable())
+    , mShadersAvailable(mode == Interactive && sf::Shader::isAvailable())
+    , mHeadless(mode == Headless)
+    , mThumbnails(mAssets, gLocalSettings().levelCacheDir())
     , mQuitEnumeration(false)
     , mHighscoreReached(false)
+    , mOfflineRendering(false)
+    , mRenderTarget(&mWindow)
 #ifndef NO_RECORDER
     , mRec(nullptr)
     , mRecorderEnabled(false)
@@ -183,6 +195,23 @@ namespace Impact {
   {
     bool ok;
 
+    mOverlayClock.setClock(&mSimClock);
+    mEarthquakeClock.setClock(&mSimClock);
+    mAberrationClock.setClock(&mSimClock);
+    mFadeEffectTimer.setClock(&mSimClock);
+    mScaleGravityClock.setClock(&mSimClock);
+    mScaleBallDensityClock.setClock(&mSimClock);
+    mLevelTimer.setClock(&mSimClock);
+    mPenaltyClock.setClock(&mSimClock);
+
+    // a headless game only simulates, so it neither opens a window
+    // nor loads anything that is just needed for presentation
+    if (mHeadless) {
+      mLevel.setMusicEnabled(false);
+      createWorld();
+      return;
+    }
+
     glewInit();
     glGetIntegerv(GL_MAJOR_VERSION, &mGLVersionMajor);
     glGetIntegerv(GL_MINOR_VERSION, &mGLVersionMinor);
@@ -225,12 +254,21 @@ namespace Impact {
     mWindow.setVerticalSyncEnabled(false);
     resize();
 
+    // sounds, music, images and shaders are decoded in the background while
+    // onInitialization() shows the progress, see finishInitialization()
     initSounds();
 
-    sf::Image icon;
-    icon.loadFromFile(ImagesDir + "/app-icon.png");
-    mWindow.setIcon(icon.getSize().x, icon.getSize().y, icon.getPixelsPtr());
-
+    std::shared_ptr<sf::Image> icon(new sf::Image);
+    mAssets.load(ImagesDir + "/app-icon.png",
+      [icon](void) {
+        return icon->loadFromFile(ImagesDir + "/app-icon.png");
+      },
+      [this, icon](void) {
+        mWindow.setIcon(icon->getSize().x, icon->getSize().y, icon->getPixelsPtr());
+        return true;
+      });
+
+    // the fonts are needed right away to lay out the texts and draw the progress
     ok = mFixedFont.loadFromFile(FontsDir + "/04b_03.ttf"); //MOD Font
     if (!ok)
       std::cerr << FontsDir + "/04b_03.ttf failed to load." << std::endl;
@@ -239,10 +277,11 @@ namespace Impact {
     if (!ok)
       std::cerr << FontsDir + "/Dimitri.ttf failed to load." << std::endl;
 
-    mParticleTexture.loadFromFile(ImagesDir + "/round-soft-particle.png"); //MOD Explosionspartikel
+    mAssets.loadTexture(mParticleTexture, ImagesDir + "/round-soft-particle.png"); //MOD Explosionspartikel
 
-    mScrollbarTexture.loadFromFile(ImagesDir + "/white-pixel.png");
-    mScrollbarSprite.setTexture(mScrollbarTexture);
+    mAssets.loadTexture(mScrollbarTexture, ImagesDir + "/white-pixel.png", [this](void) {
+      mScrollbarSprite.setTexture(mScrollbarTexture);
+    });
 
     mNewHighscoreMsg.setString(tr("New Highscore"));
     mNewHighscoreMsg.setFont(mFixedFont);
@@ -272,11 +311,9 @@ namespace Impact {
     mStatMsg.setCharacterSize(8U);
     mStatMsg.setColor(sf::Color(255U, 255U, 63U));
 
-    mScoreMsg.setFont(mFixedFont);
-    mScoreMsg.setCharacterSize(16U);
+    mScoreMsg.setFont(mFixedFont, 16U);
 
-    mCurrentScoreMsg.setFont(mFixedFont);
-    mCurrentScoreMsg.setCharacterSize(16U);
+    mCurrentScoreMsg.setFont(mFixedFont, 16U);
 
     mHighscoreMsg.setFont(mFixedFont);
     mHighscoreMsg.setCharacterSize(16U);
@@ -294,18 +331,19 @@ namespace Impact {
     mLevelAuthorText.setFont(mFixedFont);
     mLevelAuthorText.setCharacterSize(8U);
 
-    mFPSText.setFont(mFixedFont);
-    mFPSText.setCharacterSize(8U);
+    mFPSText.setFont(mFixedFont, 8U);
 
-    mBackgroundTexture.loadFromFile(ImagesDir + "/welcome-background.jpg");
-    mBackgroundSprite.setTexture(mBackgroundTexture);
-    mBackgroundSprite.setPosition(0.f, 0.f);
-    mBackgroundSprite.setScale(float(mDefaultView.getSize().x) / float(mBackgroundTexture.getSize().x), float(mDefaultView.getSize().y) / float(mBackgroundTexture.getSize().y));
+    mAssets.loadTexture(mBackgroundTexture, ImagesDir + "/welcome-background.jpg", [this](void) {
+      mBackgroundSprite.setTexture(mBackgroundTexture);
+      mBackgroundSprite.setPosition(0.f, 0.f);
+      mBackgroundSprite.setScale(float(mDefaultView.getSize().x) / float(mBackgroundTexture.getSize().x), float(mDefaultView.getSize().y) / float(mBackgroundTexture.getSize().y));
+    });
 
-    mLogoTexture.loadFromFile(ImagesDir + "/ct_logo.png");
-    mLogoSprite.setTexture(mLogoTexture);
-    mLogoSprite.setOrigin(float(mLogoTexture.getSize().x), float(mLogoTexture.getSize().y));
-    mLogoSprite.setPosition(mDefaultView.getSize().x - 8.f, mDefaultView.getSize().y - 8.f);
+    mAssets.loadTexture(mLogoTexture, ImagesDir + "/ct_logo.png", [this](void) {
+      mLogoSprite.setTexture(mLogoTexture);
+      mLogoSprite.setOrigin(float(mLogoTexture.getSize().x), float(mLogoTexture.getSize().y));
+      mLogoSprite.setPosition(mDefaultView.getSize().x - 8.f, mDefaultView.getSize().y - 8.f);
+    });
 
     mTitleText = sf::Text("Impac't", mTitleFont, 120U);
     mTitleText.setPosition(.5f * (mDefaultView.getSize().x - mTitleText.getLocalBounds().width), .11f * (mDefaultView.getSize().y - mTitleText.getLocalBounds().height));
@@ -361,30 +399,21 @@ namespace Impact {
     mLevelsRenderTexture.create(600, 170);
     mLevelsRenderView = mLevelsRenderTexture.getDefaultView();
 
+    mStatsTexture.create(DefaultStatsWidth, DefaultStatsHeight);
+    mStatsSprite.setTexture(mStatsTexture.getTexture());
+
     mKeyMapping[PauseAction] = sf::Keyboard::Escape; //MOD Tasten
     mKeyMapping[RecoverBallAction] = sf::Keyboard::N; //MOD Tasten
 
     initShaderDependants();
 
-    restart();
-
     mRecorderClock.restart();
 
 #ifndef NO_RECORDER
-#if defined(WIN32)
-    HRESULT hr = S_OK;
-    hr = CoInitialize(NULL);
-    if (FAILED(hr)) {
-      std::cerr << "CoInitialize failed: hr = "
-        << std::showbase << std::internal << std::setfill('0') << std::setw(8) << std::hex
-        << hr << std::endl;
-
-    }
-    else {
-      if (mRecorderEnabled)
-        mRec = new Recorder(this);
+    if (mRecorderEnabled) {
+      mRec = new Recorder(this);
+      mFrameGrabber.create(mWindow.getSize().x, mWindow.getSize().y);
     }
-#endif
 #endif
 
     enumerateAllLevels();
@@ -393,120 +422,84 @@ namespace Impact {
 
   Game::~Game(void)
   {
+    // the loaders still running refer to the assets, which are about to be destroyed
+    mAssets.shutdown();
+    if (mNextLevelFuture.valid())
+      mNextLevelFuture.wait();
     mQuitEnumeration = true;
+    // the enumerator appends to the list of level names, which is about to be destroyed
+    if (mEnumerateFuture.valid())
+      mEnumerateFuture.wait();
+    mReplayWriter.close();
 
-#if defined(WIN32)
-    CoUninitialize(); 
-#endif
 #ifndef NO_RECORDER
     if (mRec != nullptr) {
       mRec->stop();
       delete mRec;
     }
 #endif
-    gLocalSettings().save();
+    if (!mHeadless)
+      gLocalSettings().flush();
     clearWorld();
+    safeDelete(mWorld);
   }
 
 
-  void Game::initSounds(void)
+  bool Game::useShaders(void) const
   {
-    bool ok;
+    return !mHeadless && gLocalSettings().useShaders();
+  }
+
 
+  void Game::initSounds(void)
+  {
     setSoundFXVolume(gLocalSettings().soundFXVolume());
     setMusicVolume(gLocalSettings().musicVolume());
 
     sf::Listener::setPosition(DefaultCenter.x, DefaultCenter.y, 0.f);
 
-    ok = mMusic[Music::WelcomeMusic].openFromFile(gLocalSettings().musicDir() + "/hag5.ogg");
-    if (!ok)
-      std::cerr << gLocalSettings().musicDir() + "/hag1.ogg failed to load." << std::endl;
-
-    mMusic[Music::LevelMusic1].openFromFile(gLocalSettings().musicDir() + "/hag2.ogg");
-    if (!ok)
-      std::cerr << gLocalSettings().musicDir() + "/hag2.ogg failed to load." << std::endl;
-
-    mMusic[Music::LevelMusic2].openFromFile(gLocalSettings().musicDir() + "/hag3.ogg");
-    if (!ok)
-      std::cerr << gLocalSettings().musicDir() + "/hag3.ogg failed to load." << std::endl;
+    static const char *MusicFiles[Music::LastMusic] = { "hag5.ogg", "hag2.ogg", "hag3.ogg", "hag4.ogg", "hag5.ogg", "hag1.ogg" };
+    for (int i = 0; i < Music::LastMusic; ++i) {
+      // the recorder's mixer decodes the music files by itself
+      mMusicFilenames[i] = gLocalSettings().musicDir() + "/" + MusicFiles[i];
+      mAssets.openMusic(mMusic[i], mMusicFilenames[i]);
+    }
 
-    mMusic[Music::LevelMusic3].openFromFile(gLocalSettings().musicDir() + "/hag4.ogg");
-    if (!ok)
-      std::cerr << gLocalSettings().musicDir() + "/hag4.ogg failed to load." << std::endl;
+    mSounds.setBudget(std::size_t(gLocalSettings().soundFXCacheSize()) * 1024);
+    mSoundFX.start();
 
-    mMusic[Music::LevelMusic4].openFromFile(gLocalSettings().musicDir() + "/hag5.ogg");
-    if (!ok)
-      std::cerr << gLocalSettings().musicDir() + "/hag5.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mStartupSound, gLocalSettings().soundFXDir() + "/startup.ogg");
 
-    mMusic[Music::LevelMusic5].openFromFile(gLocalSettings().musicDir() + "/hag1.ogg");
-    if (!ok)
-      std::cerr << gLocalSettings().musicDir() + "/hag1.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mNewBallSound, gLocalSettings().soundFXDir() + "/new-ball.ogg"); //MOD Sound
 
-    for (std::vector<sf::Sound>::iterator sound = mSoundFX.begin(); sound != mSoundFX.end(); ++sound)
-      sound->setMinDistance(float(DefaultTilesHorizontally * DefaultTilesVertically));
+    mAssets.loadSound(mSounds, mNewLifeSound, gLocalSettings().soundFXDir() + "/new-life.ogg"); //MOD Sound
 
-    ok = mStartupSound.loadFromFile(gLocalSettings().soundFXDir() + "/startup.ogg");
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/startup.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mBallOutSound, gLocalSettings().soundFXDir() + "/ball-out.ogg"); //MOD Sound
 
-    ok = mNewBallSound.loadFromFile(gLocalSettings().soundFXDir() + "/new-ball.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/new-ball.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mBlockHitSound, gLocalSettings().soundFXDir() + "/block-hit.ogg"); //MOD Sound
 
-    ok = mNewLifeSound.loadFromFile(gLocalSettings().soundFXDir() + "/new-life.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/new-ball.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mPenaltySound, gLocalSettings().soundFXDir() + "/penalty.ogg"); //MOD Sound
 
-    ok = mBallOutSound.loadFromFile(gLocalSettings().soundFXDir() + "/ball-out.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/ball-out.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mRacketHitSound, gLocalSettings().soundFXDir() + "/racket-hit.ogg"); //MOD Sound
 
-    ok = mBlockHitSound.loadFromFile(gLocalSettings().soundFXDir() + "/block-hit.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/block-hit.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mRacketHitBlockSound, gLocalSettings().soundFXDir() + "/racket-hit-block.ogg"); //MOD Sound
 
-    ok = mPenaltySound.loadFromFile(gLocalSettings().soundFXDir() + "/penalty.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/penalty.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mExplosionSound, gLocalSettings().soundFXDir() + "/explosion.ogg"); //MOD Sound
 
-    ok = mRacketHitSound.loadFromFile(gLocalSettings().soundFXDir() + "/racket-hit.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/racket-hit.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mLevelCompleteSound, gLocalSettings().soundFXDir() + "/level-complete.ogg"); //MOD Sound
 
-    ok = mRacketHitBlockSound.loadFromFile(gLocalSettings().soundFXDir() + "/racket-hit-block.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/racket-hit-block.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mKillingSpreeSound, gLocalSettings().soundFXDir() + "/killing-spree.ogg"); //MOD Sound
 
-    ok = mExplosionSound.loadFromFile(gLocalSettings().soundFXDir() + "/explosion.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/explosion.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mMultiballSound, gLocalSettings().soundFXDir() + "/multiball.ogg"); //MOD Sound
 
-    ok = mLevelCompleteSound.loadFromFile(gLocalSettings().soundFXDir() + "/level-complete.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/level-complete.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mHighscoreSound, gLocalSettings().soundFXDir() + "/highscore.ogg"); //MOD Sound
 
-    ok = mKillingSpreeSound.loadFromFile(gLocalSettings().soundFXDir() + "/killing-spree.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/killing-spree.ogg failed to load." << std::endl;
-
-    ok = mMultiballSound.loadFromFile(gLocalSettings().soundFXDir() + "/multiball.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/multiball-spree.ogg failed to load." << std::endl;
-
-    ok = mHighscoreSound.loadFromFile(gLocalSettings().soundFXDir() + "/highscore.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/highscore.ogg failed to load." << std::endl;
-
-    ok = mBumperSound.loadFromFile(gLocalSettings().soundFXDir() + "/bumper.ogg"); //MOD Sound
-    if (!ok)
-      std::cerr << gLocalSettings().soundFXDir() + "/bumper.ogg failed to load." << std::endl;
+    mAssets.loadSound(mSounds, mBumperSound, gLocalSettings().soundFXDir() + "/bumper.ogg"); //MOD Sound
   }
 
 
   void Game::initShaderDependants(void)
   {
-    bool ok = false;
-
     const float menuTop = std::floor(mDefaultView.getCenter().y - 45.5f);
 
     mProgramInfoMsg.setString("Impac't v" + std::string(IMPACT_VERSION) + " (" + __TIMESTAMP__ + ")"
@@ -548,7 +541,7 @@ namespace Impact {
     mWarningText.setPosition(8.f, 4.f);
 
     if (gLocalSettings().useShaders()) {
-      const sf::Vector2f &windowSize = sf::Vector2f(float(mWindow.getSize().x), float(mWindow.getSize().y));
+      const sf::Vector2f windowSize(float(mWindow.getSize().x), float(mWindow.getSize().y));
       mRenderTexture0.create(DefaultPlaygroundWidth, DefaultPlaygroundHeight);
       mRenderTexture1.create(DefaultPlaygroundWidth, DefaultPlaygroundHeight);
       sf::RenderTexture titleRenderTexture;
@@ -557,34 +550,31 @@ namespace Impact {
       mTitleTexture = titleRenderTexture.getTexture();
       mTitleTexture.setSmooth(true);
       mTitleSprite.setTexture(mTitleTexture);
-      ok = mAberrationShader.loadFromFile(ShadersDir + "/aberration.fs", sf::Shader::Fragment);
-      if (!ok)
-        std::cerr << ShadersDir + "/aberration.fs" << " failed to load/compile." << std::endl;
-      mAberrationShader.setParameter("uCenter", sf::Vector2f(.5f, .5f));
-      ok = mMixShader.loadFromFile(ShadersDir + "/mix.fs", sf::Shader::Fragment);
-      if (!ok)
-        std::cerr << ShadersDir + "/mix.fs" << " failed to load/compile." << std::endl;
-      ok = mVBlurShader.loadFromFile(ShadersDir + "/vblur.fs", sf::Shader::Fragment);
-      if (!ok)
-        std::cerr << ShadersDir + "/vblur.fs" << " failed to load/compile." << std::endl;
-      mVBlurShader.setParameter("uBlur", 4.f);
-      mVBlurShader.setParameter("uResolution", windowSize);
-      ok = mHBlurShader.loadFromFile(ShadersDir + "/hblur.fs", sf::Shader::Fragment);
-      if (!ok)
-        std::cerr << ShadersDir + "/hblur.fs" << " failed to load/compile." << std::endl;
-      mHBlurShader.setParameter("uBlur", 4.f);
-      mHBlurShader.setParameter("uResolution", windowSize);
-      ok = mTitleShader.loadFromFile(ShadersDir + "/title.fs", sf::Shader::Fragment);
-      if (!ok)
-        std::cerr << ShadersDir + "/title.fs" << " failed to load/compile." << std::endl;
-      mTitleShader.setParameter("uResolution", windowSize);
-      ok = mEarthquakeShader.loadFromFile(ShadersDir + "/earthquake.fs", sf::Shader::Fragment);
-      if (!ok)
-        std::cerr << ShadersDir + "/earthquake.fs" << " failed to load/compile." << std::endl;
-      ok = mOverlayShader.loadFromFile(ShadersDir + "/overlay.fs", sf::Shader::Fragment);
-      if (!ok)
-        std::cerr << ShadersDir + "/overlay.fs" << " failed to load/compile." << std::endl;
-      mOverlayShader.setParameter("uResolution", windowSize);
+      // the sources are read by the asset manager, the shaders are compiled on this thread
+      mAssets.loadShader(mAberrationShader, ShadersDir + "/aberration.fs", sf::Shader::Fragment, [this](void) {
+        mAberrationShader.setParameter("uCenter", sf::Vector2f(.5f, .5f));
+      });
+      mAssets.loadShader(mMixShader, ShadersDir + "/mix.fs", sf::Shader::Fragment);
+      // has a vertex shader, too, which the asset manager cannot load
+      if (mBallShader.loadFromFile(ShadersDir + "/motionblur.vs", ShadersDir + "/motionblur.fs"))
+        mBallShader.setParameter("uBlur", 2.f);
+      else
+        std::cerr << ShadersDir + "/motionblur.vs" << " failed to load/compile." << std::endl;
+      mAssets.loadShader(mVBlurShader, ShadersDir + "/vblur.fs", sf::Shader::Fragment, [this, windowSize](void) {
+        mVBlurShader.setParameter("uBlur", 4.f);
+        mVBlurShader.setParameter("uResolution", windowSize);
+      });
+      mAssets.loadShader(mHBlurShader, ShadersDir + "/hblur.fs", sf::Shader::Fragment, [this, windowSize](void) {
+        mHBlurShader.setParameter("uBlur", 4.f);
+        mHBlurShader.setParameter("uResolution", windowSize);
+      });
+      mAssets.loadShader(mTitleShader, ShadersDir + "/title.fs", sf::Shader::Fragment, [this, windowSize](void) {
+        mTitleShader.setParameter("uResolution", windowSize);
+      });
+      mAssets.loadShader(mEarthquakeShader, ShadersDir + "/earthquake.fs", sf::Shader::Fragment);
+      mAssets.loadShader(mOverlayShader, ShadersDir + "/overlay.fs", sf::Shader::Fragment, [this, windowSize](void) {
+        mOverlayShader.setParameter("uResolution", windowSize);
+      });
 
       ////MOD Schlüsselloch
       //ok = mKeyholeShader.loadFromFile(ShadersDir + "/keyhole.fs", sf::Shader::Fragment);
@@ -594,12 +584,10 @@ namespace Impact {
       //mKeyholeShader.setParameter("uSharpness", 2.0f); //MOD Sharpness
       //mKeyholeShader.setParameter("uAspect", mDefaultView.getSize().y / mDefaultView.getSize().x);
       //mKeyholeShader.setParameter("uCenter", sf::Vector2f(.5f, .5f));
-
-      ok = mVignetteShader.loadFromFile(ShadersDir + "/vignette.fs", sf::Shader::Fragment);
-      if (!ok)
-        std::cerr << ShadersDir + "/vignette.fs" << " failed to load/compile." << std::endl;
-      mVignetteShader.setParameter("uStretch", 1.0f);
-      mVignetteShader.setParameter("uHSV", mHSVShift);
+      mAssets.loadShader(mVignetteShader, ShadersDir + "/vignette.fs", sf::Shader::Fragment, [this](void) {
+        mVignetteShader.setParameter("uStretch", 1.0f);
+        mVignetteShader.setParameter("uHSV", mHSVShift);
+      });
     }
 
     mMenuParticlesPerExplosionText = sf::Text(tr("Particles per explosion"), mFixedFont, 16U);
@@ -676,6 +664,7 @@ namespace Impact {
     mStatsViewRectangle[2].color = sf::Color::Black;
     mStatsViewRectangle[3].position = sf::Vector2f(mStatsView.getSize().x, 0.f);
     mStatsViewRectangle[3].color = mStatsColor;
+    mStatsDirty = true;
   }
 
 
@@ -699,6 +688,10 @@ namespace Impact {
 
   void Game::resumeAllMusic(void)
   {
+#ifndef NO_RECORDER
+    if (recordingMixer() != nullptr)
+      recordingMixer()->resumeMusic(recordingTime());
+#endif
     for (std::vector<sf::Music>::iterator m = mMusic.begin(); m != mMusic.end(); ++m) {
       if (m->getStatus() == sf::Music::Paused)
         m->play();
@@ -710,6 +703,10 @@ namespace Impact {
 
   void Game::pauseAllMusic(void)
   {
+#ifndef NO_RECORDER
+    if (recordingMixer() != nullptr)
+      recordingMixer()->pauseMusic(recordingTime());
+#endif
     for (std::vector<sf::Music>::iterator m = mMusic.begin(); m != mMusic.end(); ++m) {
       if (m->getStatus() == sf::Music::Playing)
       m->pause();
@@ -721,6 +718,10 @@ namespace Impact {
 
   void Game::stopAllMusic(void)
   {
+#ifndef NO_RECORDER
+    if (recordingMixer() != nullptr)
+      recordingMixer()->stopMusic(recordingTime());
+#endif
     for (std::vector<sf::Music>::iterator m = mMusic.begin(); m != mMusic.end(); ++m)
       m->stop();
     if (mLevel.music() != nullptr)
@@ -731,13 +732,7 @@ namespace Impact {
   void Game::restart(void)
   {
     clearWorld();
-
-    safeRenew(mWorld, new b2World(b2Vec2(0.f, DefaultGravity)));
-    mWorld->SetAllowSleeping(true);
-    mWorld->SetWarmStarting(true);
-    mWorld->SetContinuousPhysics(false);
-    mWorld->SetContactListener(this);
-    mWorld->SetSubStepping(true);
+    createWorld();
 
     mExtraLifeIndex = 0;
     mLives = DefaultLives;
@@ -759,9 +754,76 @@ namespace Impact {
   }
 
 
+  void Game::finishInitialization(void)
+  {
+    if (mState != State::Initialization)
+      return;
+    mAssets.finish();
+    restart();
+  }
+
+
+  void Game::onInitialization(void)
+  {
+    sf::Event event;
+    while (mWindow.pollEvent(event)) {
+      if (event.type == sf::Event::Closed) {
+        mWindow.close();
+        return;
+      }
+    }
+
+    // uploading the decoded assets needs the GL context, so a few are done per frame
+    if (mAssets.processUploads(sf::milliseconds(10))) {
+      finishInitialization();
+      return;
+    }
+
+    mRenderTarget->setView(mDefaultView);
+    mRenderTarget->clear(sf::Color(31, 31, 47));
+    mRenderTarget->draw(mTitleText);
+
+    const sf::Vector2f barSize(.5f * mDefaultView.getSize().x, 4.f);
+    const sf::Vector2f barPos(.5f * (mDefaultView.getSize().x - barSize.x), 1.4f * mDefaultView.getCenter().y);
+    sf::RectangleShape bar(barSize);
+    bar.setPosition(barPos);
+    bar.setFillColor(sf::Color(255, 255, 255, 63));
+    mRenderTarget->draw(bar);
+    bar.setSize(sf::Vector2f(mAssets.progress() * barSize.x, barSize.y));
+    bar.setFillColor(sf::Color::White);
+    mRenderTarget->draw(bar);
+  }
+
+
+  void Game::createWorld(void)
+  {
+    safeRenew(mWorld, new b2World(b2Vec2(0.f, DefaultGravity)));
+    mWorld->SetAllowSleeping(true);
+    mWorld->SetWarmStarting(true);
+    mWorld->SetContinuousPhysics(false);
+    mWorld->SetContactListener(this);
+    mWorld->SetSubStepping(true);
+    mWorld->SetAdaptiveBroadPhase(true);
+  }
+
+
   void Game::clearWorld(void)
   {
     mBalls.clear();
+    mActivationManager.clear();
+    mScrolling = false;
+    mChunks.clear();
+    mLoadedChunks.clear();
+    mTiles.clear();
+    mStreamedTiles.clear();
+    mFallingBlocks.clear();
+    // bodies remove themselves from the world, which must still exist then
+    for (BodyList::iterator b = mBodies.begin(); b != mBodies.end(); ++b)
+      delete *b;
+    mBodies.clear();
+    mTileTextures.clear();
+    mRacket = nullptr;
+    mGround = nullptr;
     if (mWorld != nullptr) {
       b2Body *node = mWorld->GetBodyList();
       while (node) {
@@ -769,8 +831,14 @@ namespace Impact {
         node = node->GetNext();
         mWorld->DestroyBody(body);
       }
+      const int32 releasedBytes = mWorld->TrimMemory();
+#ifndef NDEBUG
+      std::cout << "released " << releasedBytes << " bytes of physics memory, "
+        << mWorld->GetBlockAllocator().GetReservedBytes() << " bytes still reserved" << std::endl;
+#else
+      UNUSED(releasedBytes);
+#endif
     }
-    mBodies.clear();
   }
 
 
@@ -781,6 +849,7 @@ namespace Impact {
     mPlaygroundView.reset(sf::FloatRect(0.f, 0.f, float(DefaultPlaygroundWidth), float(DefaultPlaygroundHeight)));
     mPlaygroundView.setCenter(.5f * sf::Vector2f(float(DefaultPlaygroundWidth), float(DefaultPlaygroundHeight)));
     mPlaygroundView.setViewport(sf::FloatRect(0.f, 0.f, 1.f, float(DefaultPlaygroundHeight) / float(DefaultWindowHeight)));
+    mCameraView = mPlaygroundView;
     mStatsView.reset(sf::FloatRect(0.f, float(DefaultPlaygroundHeight), float(DefaultStatsWidth), float(DefaultStatsHeight)));
     mStatsView.setCenter(sf::Vector2f(.5f * DefaultStatsWidth, .5f * DefaultStatsHeight));
     mStatsView.setViewport(sf::FloatRect(0.f, float(DefaultWindowHeight - DefaultStatsHeight) / float(DefaultWindowHeight), 1.f, float(DefaultStatsHeight) / float(DefaultWindowHeight)));
@@ -817,26 +886,22 @@ namespace Impact {
   void Game::loop(void)
   {
 #ifdef CT_VERSION_INTERNAL
-    if (!mLevelZipFilename.empty())
+    if (!mLevelZipFilename.empty()) {
+      finishInitialization();
       loadLevelFromZip(mLevelZipFilename);
+    }
 #endif
 
     mRecorderWallClock.restart();
 
     while (mWindow.isOpen()) {
-      mElapsed = mClock.restart();
-
-#ifndef NO_RECORDER
-      if (mRecorderEnabled) {
-        if (mRecorderClock.getElapsedTime() > sf::milliseconds(1000 * mRec->timeBase().num / mRec->timeBase().den)) {
-          mRecorderClock.restart();
-          if (mRec != nullptr)
-            mRec->setFrame(mWindow.capture(), mRecorderWallClock.getElapsedTime());
-        }
-      }
-#endif
+      mElapsed = mOfflineRendering ? mOfflineFrameTime : mClock.restart();
 
       switch (mState) {
+      case State::Initialization:
+        onInitialization();
+        break;
+
       case State::Playing:
         onPlaying();
         break;
@@ -885,8 +950,41 @@ namespace Impact {
         break;
       }
 
+#ifndef NO_RECORDER
+      if (mRecorderEnabled && mRec != nullptr) {
+        if (mOfflineRendering || mRecorderClock.getElapsedTime() > sf::milliseconds(1000 * mRec->timeBase().num / mRec->timeBase().den)) {
+          mRecorderClock.restart();
+          // glReadPixels() reads from the frame buffer of the active context
+          if (mOfflineRendering)
+            mOfflineRenderTexture.setActive();
+          // the pixels arrive a few grabs later without stalling the GPU
+          const VideoFramePtr &frame = mFrameGrabber.grab(recordingTime());
+          if (frame)
+            mRec->pushFrame(frame);
+        }
+      }
+      if (mOfflineRendering) {
+        // show what goes into the video
+        mOfflineRenderTexture.display();
+        sf::Sprite preview(mOfflineRenderTexture.getTexture());
+        preview.setScale(float(mWindow.getSize().x) / mOfflineRenderTexture.getSize().x, float(mWindow.getSize().y) / mOfflineRenderTexture.getSize().y);
+        mWindow.setView(mWindow.getDefaultView());
+        mWindow.draw(preview);
+      }
+#endif
+
       mWindow.display();
 
+      if (mOfflineRendering) {
+        mSimulatedTime += mElapsed;
+        if (!mReplayReader.isOpen() && mSimulatedTime > mReplayEndTime + DefaultReplayTail) {
+#ifndef NO_RECORDER
+          mRec->stop();
+#endif
+          mWindow.close();
+        }
+      }
+
 #ifdef CT_VERSION_INTERNAL
       if (!mLevelZipFilename.empty()) {
         if (mDisplayCount++ > 10) {
@@ -929,7 +1027,7 @@ namespace Impact {
 
   inline void Game::clearWindow(void)
   {
-    mWindow.clear(mLevel.backgroundColor());
+    mRenderTarget->clear(mLevel.backgroundColor());
   }
 
 
@@ -941,6 +1039,103 @@ namespace Impact {
   }
 
 
+  sf::Time Game::recordingTime(void) const
+  {
+    return mOfflineRendering ? mSimulatedTime : mRecorderWallClock.getElapsedTime();
+  }
+
+
+  void Game::startReplayCapture(void)
+  {
+    const std::string &dir = gLocalSettings().replaysDir();
+#if defined(WIN32)
+    CreateDirectory(dir.c_str(), NULL);
+#elif defined(LINUX_AMD64)
+    mkdir(dir.c_str(), 0775);
+#endif
+    char timestamp[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+    const std::string &filename = dir + "/" + mLevel.base62name() + "-" + timestamp + ".impr";
+    if (!mReplayWriter.open(filename, mSession))
+      std::cerr << "Cannot write replay to " << filename << std::endl;
+  }
+
+
+  void Game::stopReplay(void)
+  {
+    mReplayReader.close();
+    mReplayEndTime = recordingTime();
+  }
+
+
+  bool Game::playReplay(const std::string &filename)
+  {
+    finishInitialization();
+    if (!mReplayReader.open(filename)) {
+      std::cerr << "Cannot read replay " << filename << std::endl;
+      return false;
+    }
+    const ReplayHeader &header = mReplayReader.header();
+    if (header.stepMicroseconds != uint32_t(DefaultTimeStep.asMicroseconds())) {
+      std::cerr << "Replay " << filename << " uses a time step of " << header.stepMicroseconds << " us, expected " << DefaultTimeStep.asMicroseconds() << " us." << std::endl;
+      mReplayReader.close();
+      return false;
+    }
+    mLevel.set(header.levelNum, false);
+    mLevel.loadZip(header.levelZip);
+    if (!mLevel.isAvailable() || mLevel.hash() != header.levelHash) {
+      std::cerr << "Replay " << filename << " needs level " << header.levelZip << " with hash " << header.levelHash << std::endl;
+      mReplayReader.close();
+      return false;
+    }
+    mPlaymode = SingleLevel;
+    gotoCurrentLevel();
+    return true;
+  }
+
+
+  bool Game::renderReplay(const std::string &replayFilename, const std::string &videoFilename, unsigned int width, unsigned int height)
+  {
+#ifndef NO_RECORDER
+    // the startup sound must not end up in the video
+    finishInitialization();
+    // the video gets its own frame buffer, so the window keeps its size
+    if (!mOfflineRenderTexture.create(width, height)) {
+      std::cerr << "Cannot create a " << width << "x" << height << " render texture." << std::endl;
+      return false;
+    }
+    mOfflineRenderTexture.setSmooth(true);
+    mRenderTarget = &mOfflineRenderTexture;
+    mWindow.setFramerateLimit(0);
+    mWindow.setVerticalSyncEnabled(false);
+    if (mRec != nullptr) {
+      mRec->stop();
+      delete mRec;
+    }
+    mOfflineRenderTexture.setActive();
+    mFrameGrabber.destroy();
+    mFrameGrabber.create(width, height);
+    mRec = new Recorder(this, videoFilename, int(width), int(height));
+    // every simulated frame must end up in the video
+    mRec->setBackPressurePolicy(Recorder::Block);
+    mRecorderEnabled = true;
+    mOfflineRendering = true;
+    mOfflineFrameTime = sf::microseconds(sf::Int64(1000000) * mRec->timeBase().num / mRec->timeBase().den);
+    mSimulatedTime = sf::Time::Zero;
+    // the recorder must be running before the level music starts
+    return playReplay(replayFilename);
+#else
+    UNUSED(replayFilename);
+    UNUSED(videoFilename);
+    UNUSED(width);
+    UNUSED(height);
+    std::cerr << "Cannot render replays: this build has no recorder." << std::endl;
+    return false;
+#endif
+  }
+
+
   void Game::openLevelZip(void)
   {
     playSound(mRacketHitSound);
@@ -995,12 +1190,15 @@ namespace Impact {
 
   void Game::gotoWelcomeScreen(void) 
   {
+    mReplayWriter.close();
+    if (mReplayReader.isOpen())
+      stopReplay();
     clearWorld();
     stopAllMusic();
     playSound(mStartupSound);
     mStartMsg.setString(tr("Click to start"));
     setState(State::WelcomeScreen);
-    mWindow.setView(mDefaultView);
+    mRenderTarget->setView(mDefaultView);
     if (gLocalSettings().useShaders()) {
       mTitleShader.setParameter("uMaxT", 1.f);
     }
@@ -1058,11 +1256,11 @@ namespace Impact {
         }
       }
     }
-    mWindow.clear(sf::Color(31, 31, 47));
-    mWindow.draw(mBackgroundSprite);
+    mRenderTarget->clear(sf::Color(31, 31, 47));
+    mRenderTarget->draw(mBackgroundSprite);
 
     update();
-    drawWorld(mWindow.getDefaultView());
+    drawWorld(mDefaultView);
 
     const sf::Int32 t = mWallClock.getElapsedTime().asMilliseconds();
 
@@ -1070,17 +1268,17 @@ namespace Impact {
       sf::RenderStates states;
       states.shader = &mTitleShader;
       mTitleShader.setParameter("uT", 1e-3f * t);
-      mWindow.draw(mTitleSprite, states);
+      mRenderTarget->draw(mTitleSprite, states);
     }
     else {
-      mWindow.draw(mTitleText);
+      mRenderTarget->draw(mTitleText);
     }
 
     if (!mWarningText.getString().isEmpty())
-      mWindow.draw(mWarningText);
+      mRenderTarget->draw(mWarningText);
 
     if (mWelcomeLevel == 0) {
-      ExplosionDef pd(this, b2Vec2(.5f * DefaultTilesHorizontally, .4f * DefaultTilesVertically));
+      ExplosionDef pd(this, menuExplosionCenter());
       pd.ballCollisionEnabled = false;
       pd.count = gLocalSettings().particlesPerExplosion();
       pd.texture = mParticleTexture;
@@ -1090,19 +1288,19 @@ namespace Impact {
 
     if (t > 350) {
       mMenuSingleLevel.setColor(sf::Color(255, 255, 255, mMenuSingleLevel.getGlobalBounds().contains(mousePos) ? 255 : 192));
-      mWindow.draw(mMenuSingleLevel);
+      mRenderTarget->draw(mMenuSingleLevel);
       mMenuCampaignText.setColor(sf::Color(255, 255, 255, mMenuCampaignText.getGlobalBounds().contains(mousePos) ? 255 : 192));
-      mWindow.draw(mMenuCampaignText);
+      mRenderTarget->draw(mMenuCampaignText);
       mMenuLoadLevelText.setColor(sf::Color(255, 255, 255, mMenuLoadLevelText.getGlobalBounds().contains(mousePos) ? 255 : 192));
-      mWindow.draw(mMenuLoadLevelText);
+      mRenderTarget->draw(mMenuLoadLevelText);
       mMenuAchievementsText.setColor(sf::Color(255, 255, 255, mMenuAchievementsText.getGlobalBounds().contains(mousePos) ? 16 : 16));
-      mWindow.draw(mMenuAchievementsText);
+      mRenderTarget->draw(mMenuAchievementsText);
       mMenuOptionsText.setColor(sf::Color(255, 255, 255, mMenuOptionsText.getGlobalBounds().contains(mousePos) ? 255 : 192));
-      mWindow.draw(mMenuOptionsText);
+      mRenderTarget->draw(mMenuOptionsText);
       mMenuCreditsText.setColor(sf::Color(255, 255, 255, mMenuCreditsText.getGlobalBounds().contains(mousePos) ? 255 : 192));
-      mWindow.draw(mMenuCreditsText);
+      mRenderTarget->draw(mMenuCreditsText);
       mMenuExitText.setColor(sf::Color(255, 255, 255, mMenuExitText.getGlobalBounds().contains(mousePos) ? 255 : 192));
-      mWindow.draw(mMenuExitText);
+      mRenderTarget->draw(mMenuExitText);
 
       if (mWelcomeLevel == 1) {
         playSound(mExplosionSound, Game::InvScale * b2Vec2(mStartMsg.getPosition().x, mStartMsg.getPosition().y));
@@ -1114,7 +1312,7 @@ namespace Impact {
       }
     }
     if (t > 550) {
-      mWindow.draw(mLogoSprite);
+      mRenderTarget->draw(mLogoSprite);
       if (mWelcomeLevel == 2) {
         playSound(mExplosionSound, Game::InvScale * b2Vec2(mLogoSprite.getPosition().x, mLogoSprite.getPosition().y));
         mWelcomeLevel = 3;
@@ -1125,7 +1323,7 @@ namespace Impact {
       }
     }
     if (t > 670) {
-      mWindow.draw(mProgramInfoMsg);
+      mRenderTarget->draw(mProgramInfoMsg);
       if (mWelcomeLevel == 3) {
         playSound(mExplosionSound, Game::InvScale * b2Vec2(mProgramInfoMsg.getPosition().x, mProgramInfoMsg.getPosition().y));
         mWelcomeLevel = 4;
@@ -1149,6 +1347,10 @@ namespace Impact {
   void Game::gotoLevelCompleted(void)
   {
     mTotalScore = deductPenalty(mLevelScore);
+    if (mHeadless) {
+      setState(State::LevelCompleted);
+      return;
+    }
     checkHighscore();
     playSound(mLevelCompleteSound);
     mStartMsg.setString(tr("Click to continue"));
@@ -1175,19 +1377,19 @@ namespace Impact {
       }
     }
 
-    mWindow.setView(mPlaygroundView);
+    mRenderTarget->setView(mPlaygroundView);
     mLevelCompletedMsg.setPosition(mPlaygroundView.getCenter().x - .5f * mLevelCompletedMsg.getLocalBounds().width, 20.f);
-    mWindow.draw(mLevelCompletedMsg);
+    mRenderTarget->draw(mLevelCompletedMsg);
     
     mYourScoreMsg.setPosition(mPlaygroundView.getCenter().x - .5f * mYourScoreMsg.getLocalBounds().width, mPlaygroundView.getCenter().y);
-    mWindow.draw(mYourScoreMsg);
+    mRenderTarget->draw(mYourScoreMsg);
 
     if (mNewHighscore)
       displayHighscoreMessage();
 
     mTotalScoreMsg.setString(std::to_string(mTotalScore));
     mTotalScoreMsg.setPosition(mPlaygroundView.getCenter().x - .5f * mTotalScoreMsg.getLocalBounds().width, mPlaygroundView.getCenter().y - mTotalScoreMsg.getLocalBounds().height + 64);
-    mWindow.draw(mTotalScoreMsg);
+    mRenderTarget->draw(mTotalScoreMsg);
 
     drawStartMessage();
   }
@@ -1220,20 +1422,20 @@ namespace Impact {
       }
     }
 
-    mWindow.setView(mPlaygroundView);
+    mRenderTarget->setView(mPlaygroundView);
 
     mPlayerWonMsg.setPosition(mPlaygroundView.getCenter().x - .5f * mPlayerWonMsg.getLocalBounds().width, 20.f);
-    mWindow.draw(mPlayerWonMsg);
+    mRenderTarget->draw(mPlayerWonMsg);
 
     mYourScoreMsg.setPosition(mPlaygroundView.getCenter().x - .5f * mYourScoreMsg.getLocalBounds().width, mPlaygroundView.getCenter().y);
-    mWindow.draw(mYourScoreMsg);
+    mRenderTarget->draw(mYourScoreMsg);
 
     if (mNewHighscore)
       displayHighscoreMessage();
 
     mTotalScoreMsg.setString(std::to_string(mTotalScore));
     mTotalScoreMsg.setPosition(mPlaygroundView.getCenter().x - .5f * mTotalScoreMsg.getLocalBounds().width, mPlaygroundView.getCenter().y - mTotalScoreMsg.getLocalBounds().height + 64);
-    mWindow.draw(mTotalScoreMsg);
+    mRenderTarget->draw(mTotalScoreMsg);
 
     drawStartMessage();
   }
@@ -1242,6 +1444,10 @@ namespace Impact {
   void Game::gotoGameOver(void)
   {
     mTotalScore = deductPenalty(mLevelScore);
+    if (mHeadless) {
+      setState(State::GameOver);
+      return;
+    }
     checkHighscore();
     mStartMsg.setString(tr("Click to continue"));
     setState(State::GameOver);
@@ -1267,16 +1473,16 @@ namespace Impact {
       }
     }
 
-    mWindow.setView(mPlaygroundView);
+    mRenderTarget->setView(mPlaygroundView);
     mGameOverMsg.setPosition(mPlaygroundView.getCenter().x - .5f * mGameOverMsg.getLocalBounds().width, 20.f);
-    mWindow.draw(mGameOverMsg);
+    mRenderTarget->draw(mGameOverMsg);
 
     mYourScoreMsg.setPosition(mPlaygroundView.getCenter().x - .5f * mYourScoreMsg.getLocalBounds().width, mPlaygroundView.getCenter().y);
-    mWindow.draw(mYourScoreMsg);
+    mRenderTarget->draw(mYourScoreMsg);
 
     mTotalScoreMsg.setString(std::to_string(mTotalScore));
     mTotalScoreMsg.setPosition(mPlaygroundView.getCenter().x - .5f * mTotalScoreMsg.getLocalBounds().width, mPlaygroundView.getCenter().y - mTotalScoreMsg.getLocalBounds().height + 64);
-    mWindow.draw(mTotalScoreMsg);
+    mRenderTarget->draw(mTotalScoreMsg);
 
     drawStartMessage();
   }
@@ -1293,22 +1499,22 @@ namespace Impact {
   {
     drawPlayground();
 
-    mWindow.setView(mPlaygroundView);
+    mRenderTarget->setView(mPlaygroundView);
     sf::Text pausingText(tr(">>> Pausing <<<"), mFixedFont, 64U);
     pausingText.setPosition(mPlaygroundView.getCenter().x - .5f * pausingText.getLocalBounds().width, -20 + mPlaygroundView.getCenter().y - pausingText.getLocalBounds().height);
-    mWindow.draw(pausingText);
+    mRenderTarget->draw(pausingText);
 
     const sf::Vector2f &mousePos = getCursorPosition();
 
     sf::Text resumeText(tr("Resume playing"), mFixedFont, 32U);
     resumeText.setPosition(mPlaygroundView.getCenter().x - .5f * resumeText.getLocalBounds().width, 32 + mPlaygroundView.getCenter().y);
     resumeText.setColor(sf::Color(255, 255, 255, resumeText.getGlobalBounds().contains(mousePos) ? 255 : 192));
-    mWindow.draw(resumeText);
+    mRenderTarget->draw(resumeText);
 
     sf::Text mainMenuText(tr("Go to main menu"), mFixedFont, 32U);
     mainMenuText.setPosition(mPlaygroundView.getCenter().x - .5f * mainMenuText.getLocalBounds().width, 64 + mPlaygroundView.getCenter().y);
     mainMenuText.setColor(sf::Color(255, 255, 255, mainMenuText.getGlobalBounds().contains(mousePos) ? 255 : 192));
-    mWindow.draw(mainMenuText);
+    mRenderTarget->draw(mainMenuText);
 
     sf::Event event;
     while (mWindow.pollEvent(event)) {
@@ -1335,21 +1541,36 @@ namespace Impact {
   {
     stopAllMusic();
     clearWorld();
-    mBallHasBeenLost = false;
     mWindow.setMouseCursorVisible(false);
     if (gLocalSettings().useShaders()) {
       mMixShader.setParameter("uColorMix", sf::Color(255, 255, 255, 255));
     }
-    mScaleGravityEnabled = false;
-    mScaleBallDensityEnabled = false;
     if (mLevel.isAvailable()) {
       if (mPlaymode == Campaign)
         gLocalSettings().setLastCampaignLevel(mLevel.num());
       static boost::random::uniform_int_distribution<int> randomMusic(LevelMusic1, LevelMusic5);
-      buildLevel();
+      mReplayWriter.close();
+      if (mReplayReader.isOpen()) {
+        mSession = mReplayReader.header();
+      }
+      else {
+        mSession.levelHash = mLevel.hash();
+        mSession.levelZip = mLevel.zipFilename();
+        mSession.levelNum = mLevel.num();
+        mSession.seed = gRNG()();
+        mSession.stepMicroseconds = uint32_t(DefaultTimeStep.asMicroseconds());
+        mSession.velocityIterations = gLocalSettings().velocityIterations();
+        mSession.positionIterations = gLocalSettings().positionIterations();
+        mSession.particlesPerExplosion = gLocalSettings().particlesPerExplosion();
+        if (gLocalSettings().recordReplays())
+          startReplayCapture();
+      }
+      startSimulation();
+      if (mPlaymode == Campaign && !mReplayReader.isOpen())
+        prefetchNextLevel();
       mHighscoreMsg.setString("highscore: " + std::to_string(gLocalSettings().highscore(mLevel.num())));
       mHighscoreMsg.setPosition(mStatsView.getSize().x - mHighscoreMsg.getLocalBounds().width - 4, 36);
-      mHighscoreReached = false;
+      mStatsDirty = true;
       stopBlurEffect();
       mFadeEffectsActive = 0;
       mEarthquakeDuration = sf::Time::Zero;
@@ -1360,15 +1581,15 @@ namespace Impact {
       if (mLevel.music() != nullptr) {
         mLevel.music()->play();
         mLevel.music()->setVolume(gLocalSettings().musicVolume());
+#ifndef NO_RECORDER
+        if (recordingMixer() != nullptr)
+          recordingMixer()->playMusic(mLevel.musicFilename(), true, gLocalSettings().musicVolume(), recordingTime());
+#endif
       }
       else {
         playMusic(Game::Music(randomMusic(gRNG())));
       }
-      setState(State::Playing);
-      mLevelTimer.restart();
       mStatsClock.restart();
-      mPenaltyClock.restart();
-      mLevelScore = 0;
       mWindow.setFramerateLimit(gLocalSettings().framerateLimit());
       //MOD KeyholeEnable
     }
@@ -1379,14 +1600,64 @@ namespace Impact {
   }
 
 
+  void Game::startSimulation(void)
+  {
+    // a fresh world, so that no allocator or broad-phase state of
+    // earlier levels and screens leaks into the simulation
+    createWorld();
+    mSimClock.seed(mSession.seed);
+    resetKillingSpree();
+    mBallHasBeenLost = false;
+    mScaleGravityEnabled = false;
+    mScaleBallDensityEnabled = false;
+    mStepAccumulator = sf::Time::Zero;
+    mInput = InputState();
+    if (!mHeadless)
+      mLevel.uploadTextures();
+    buildLevel();
+    mHighscoreReached = false;
+    setState(State::Playing);
+    mLevelTimer.restart();
+    mPenaltyClock.restart();
+    mLevelScore = 0;
+  }
+
+
   void Game::gotoNextLevel(void)
   {
-    if (mPlaymode == Campaign)
-      mLevel.gotoNext();
+    if (mPlaymode == Campaign) {
+      if (mNextLevelFuture.valid())
+        mNextLevelFuture.wait();
+      // a prefetched level only lacks its textures, which startSimulation() uploads
+      if (mNextLevel.num() == mLevel.num() + 1)
+        mLevel.take(mNextLevel);
+      else
+        mLevel.gotoNext();
+    }
     gotoCurrentLevel();
   }
 
 
+  void Game::prefetchNextLevel(void)
+  {
+    if (mNextLevelFuture.valid())
+      mNextLevelFuture.wait();
+    const int nextLevel = mLevel.num() + 1;
+    if (mNextLevel.num() == nextLevel && mNextLevel.isAvailable())
+      return;
+    // read here, as the local settings must not be touched by the loader thread
+    mNextLevel.setPaths(gLocalSettings().levelsDir(), gLocalSettings().levelCacheDir());
+    std::packaged_task<bool()> task([this, nextLevel]{
+#if defined(WIN32)
+      SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+      return mNextLevel.set(nextLevel, true);
+    });
+    mNextLevelFuture = task.get_future();
+    std::thread(std::move(task)).detach();
+  }
+
+
   void Game::onPlaying(void)
   {
     sf::Event event;
@@ -1397,10 +1668,12 @@ namespace Impact {
         mWindow.close();
         break;
       case sf::Event::LostFocus:
-        gotoPausing();
+        if (!mOfflineRendering)
+          gotoPausing();
         break;
       case sf::Event::GainedFocus:
-        resume();
+        if (!mOfflineRendering)
+          resume();
         break;
       case sf::Event::MouseMoved:
         if (mScaleGravityEnabled && mScaleGravityClock.getElapsedTime() < mScaleGravityDuration) {
@@ -1410,77 +1683,38 @@ namespace Impact {
         break;
       case sf::Event::MouseButtonPressed:
         if (mBalls.empty())
-          newBall();
+          mInput.commands |= InputState::NewBall;
         break;
       case sf::Event::KeyPressed:
         if (event.key.code == mKeyMapping[PauseAction]) {
+          if (mOfflineRendering)
+            break;
           if (!mPaused)
             gotoPausing();
           else
             resume();
         }
         else if (event.key.code == sf::Keyboard::X) {
-          const b2Vec2 &racketPos = mRacket->position();
-          newBall(b2Vec2(racketPos.x, racketPos.y - 1.2f * sign(mLevel.gravity())));
+          mInput.commands |= InputState::SpawnBall;
         }
         else if (event.key.code == mKeyMapping[RecoverBallAction] || event.key.code == sf::Keyboard::Space) {
-          if (mBalls.empty()) {
-            newBall();
-          }
-          else {
-            const b2Vec2 &padPos = mRacket->position();
-            for (std::vector<Ball*>::iterator b = mBalls.begin(); b != mBalls.end(); ++b) {
-              Ball *ball = *b;
-              ball->setPosition(b2Vec2(padPos.x, padPos.y - 3.5f));
-              showScore(-DefaultForceNewBallPenalty, ball->position());
-            }
-          }
+          mInput.commands |= InputState::RecoverBall;
         }
         break;
       }
     }
 
-    if (!mBalls.empty()) { // check if ball has been kicked out of the screen
-      for (std::vector<Ball*>::iterator b = mBalls.begin(); b != mBalls.end(); ++b) {
-        Ball *ball = *b;
-        if (ball != nullptr) {
-          const float ballX = ball->position().x;
-          const float ballY = ball->position().y;
-          if (0 > ballX || ballX > float(mLevel.width()) || 0 > ballY) {
-            ball->kill();
-          }
-          else if (ballY > mLevel.height()) {
-            ball->lethalHit();
-            ball->kill();
-          }
-        }
-      }
-    }
-
-    if (mRacket != nullptr) {
-      if (sf::Mouse::isButtonPressed(sf::Mouse::Left)) {
-        mRacket->kickLeft();
-      }
-      else if (sf::Mouse::isButtonPressed(sf::Mouse::Right)) {
-        mRacket->kickRight();
-      }
-      else {
-        mRacket->stopKick();
-      }
+    // while a replay is running its inputs replace the player's
+    if (mRacket != nullptr && !mReplayReader.isOpen() && !mOfflineRendering) {
+      mInput.buttons = 0;
+      if (sf::Mouse::isButtonPressed(sf::Mouse::Left))
+        mInput.buttons |= InputState::KickLeft;
+      else if (sf::Mouse::isButtonPressed(sf::Mouse::Right))
+        mInput.buttons |= InputState::KickRight;
 
       sf::Vector2i mousePos = sf::Mouse::getPosition(mWindow);
 
       if (mFPS < 200) {
-        // check if racket has been kicked out of the screen
-        const float racketX = mRacket->position().x;
-        const float racketY = mRacket->position().y;
-        if (racketY > mLevel.height())
-          mRacket->setPosition(b2Vec2(racketX, mLevel.height() - .5f));
-        if (racketX < 0.f)
-          mRacket->setPosition(b2Vec2(1.5f, racketY));
-        else if (racketX > mLevel.width())
-          mRacket->setPosition(b2Vec2(mLevel.width() - 1.5f, racketY));
-
         const b2AABB &aabb = mRacket->aabb();
         const float32 w = aabb.upperBound.x - aabb.lowerBound.x;
         const float32 h = aabb.upperBound.y - aabb.lowerBound.y;
@@ -1493,22 +1727,10 @@ namespace Impact {
         sf::Mouse::setPosition(mousePos, mWindow);
       }
 
-      mRacket->moveTo(InvScale * b2Vec2(float32(mousePos.x), float32(mousePos.y)));
-    }
-
-    if (mScaleGravityEnabled && mScaleGravityClock.getElapsedTime() > mScaleGravityDuration) {
-      mWorld->SetGravity(b2Vec2(0.f, mLevel.gravity()));
-      mScaleGravityEnabled = false;
-    }
-
-    if (mScaleBallDensityEnabled && mScaleBallDensityClock.getElapsedTime() > mScaleBallDensityDuration) {
-      for (std::vector<Ball*>::iterator b = mBalls.begin(); b != mBalls.end(); ++b) {
-        Ball *ball = *b;
-        if (ball != nullptr && ball->isAlive()) {
-          ball->setDensity(ball->tileParam().density.get());
-        }
-      }
-      mScaleBallDensityEnabled = false;
+      // recorded in level coordinates, so that replays depend neither on the window size nor on the camera
+      const sf::Vector2f &target = mWindow.mapPixelToCoords(mousePos, mCameraView);
+      mInput.x = int32_t(target.x);
+      mInput.y = int32_t(target.y);
     }
 
     update();
@@ -1533,7 +1755,7 @@ namespace Impact {
   {
     clearWorld();
     setState(State::CreditsScreen);
-    mWindow.setView(mDefaultView);
+    mRenderTarget->setView(mDefaultView);
     mWindow.setMouseCursorVisible(true);
     mWindow.setFramerateLimit(DefaultFramerateLimit);
     playSound(mRacketHitSound);
@@ -1547,30 +1769,30 @@ namespace Impact {
     const sf::Vector2f &mousePos = getCursorPosition();
     const float t = mWallClock.getElapsedTime().asSeconds();
 
-    mWindow.clear(sf::Color(31, 31, 47));
-    mWindow.draw(mBackgroundSprite);
+    mRenderTarget->clear(sf::Color(31, 31, 47));
+    mRenderTarget->draw(mBackgroundSprite);
 
     if (gLocalSettings().useShaders()) {
       sf::RenderStates states;
       states.shader = &mTitleShader;
       mTitleShader.setParameter("uT", t);
-      mWindow.draw(mTitleSprite, states);
+      mRenderTarget->draw(mTitleSprite, states);
     }
     else {
-      mWindow.draw(mTitleText);
+      mRenderTarget->draw(mTitleText);
     }
 
     const float menuTop = std::floor(mDefaultView.getCenter().y - 10);
 
     mMenuBackText.setColor(sf::Color(255, 255, 255, mMenuBackText.getGlobalBounds().contains(mousePos) ? 255 : 192));
     mMenuBackText.setPosition(.5f * (mDefaultView.getSize().x - mMenuBackText.getLocalBounds().width), mLevelsRenderTexture.getSize().y + menuTop);
-    mWindow.draw(mMenuBackText);
+    mRenderTarget->draw(mMenuBackText);
 
     mCreditsTitleText.setPosition(.5f * (mDefaultView.getSize().x - mCreditsTitleText.getLocalBounds().width), menuTop - 40);
-    mWindow.draw(mCreditsTitleText);
+    mRenderTarget->draw(mCreditsTitleText);
 
     mCreditsText.setPosition(.5f * (mDefaultView.getSize().x - mCreditsText.getLocalBounds().width), menuTop + 10);
-    mWindow.draw(mCreditsText);
+    mRenderTarget->draw(mCreditsText);
 
     sf::Event event;
     while (mWindow.pollEvent(event)) {
@@ -1595,7 +1817,7 @@ namespace Impact {
     }
 
     if (mWelcomeLevel == 0) {
-      ExplosionDef pd(this, b2Vec2(.5f * DefaultTilesHorizontally, .4f * DefaultTilesVertically));
+      ExplosionDef pd(this, menuExplosionCenter());
       pd.ballCollisionEnabled = false;
       pd.count = gLocalSettings().particlesPerExplosion();
       pd.texture = mParticleTexture;
@@ -1604,7 +1826,7 @@ namespace Impact {
     }
 
     update();
-    drawWorld(mWindow.getDefaultView());
+    drawWorld(mDefaultView);
   }
 
 
@@ -1616,6 +1838,10 @@ namespace Impact {
     setState(State::OptionsScreen);
     mWindow.setFramerateLimit(gLocalSettings().framerateLimit());
     mMusic[0].play();
+#ifndef NO_RECORDER
+    if (recordingMixer() != nullptr)
+      recordingMixer()->playMusic(mMusicFilenames[0], mMusic[0].getLoop(), gLocalSettings().musicVolume(), recordingTime());
+#endif
   }
 
 
@@ -1624,22 +1850,22 @@ namespace Impact {
     const sf::Vector2f &mousePos = getCursorPosition();
     const float t = mWallClock.getElapsedTime().asSeconds();
 
-    mWindow.setView(mDefaultView);
-    mWindow.clear(sf::Color(31, 31, 47));
-    mWindow.draw(mBackgroundSprite);
+    mRenderTarget->setView(mDefaultView);
+    mRenderTarget->clear(sf::Color(31, 31, 47));
+    mRenderTarget->draw(mBackgroundSprite);
 
     if (gLocalSettings().useShaders()) {
       sf::RenderStates states;
       states.shader = &mTitleShader;
       mTitleShader.setParameter("uT", t);
-      mWindow.draw(mTitleSprite, states);
+      mRenderTarget->draw(mTitleSprite, states);
     }
     else {
-      mWindow.draw(mTitleText);
+      mRenderTarget->draw(mTitleText);
     }
 
     if (mWelcomeLevel == 0) {
-      ExplosionDef pd(this, b2Vec2(.5f * DefaultTilesHorizontally, .4f * DefaultTilesVertically));
+      ExplosionDef pd(this, menuExplosionCenter());
       pd.ballCollisionEnabled = false;
       pd.count = gLocalSettings().particlesPerExplosion();
       pd.texture = mParticleTexture;
@@ -1667,8 +1893,10 @@ namespace Impact {
           }
           else if (mShadersAvailable && mMenuUseShadersText.getGlobalBounds().contains(mousePos)) {
             gLocalSettings().setUseShaders(!gLocalSettings().useShaders());
-            if (gLocalSettings().useShaders())
+            if (gLocalSettings().useShaders()) {
               initShaderDependants();
+              mAssets.finish();
+            }
             createMainWindow();
             gLocalSettings().save();
           }
@@ -1734,76 +1962,76 @@ namespace Impact {
     }
 
     update();
-    drawWorld(mWindow.getDefaultView());
+    drawWorld(mDefaultView);
 
-    mWindow.draw(mOptionsTitleText);
+    mRenderTarget->draw(mOptionsTitleText);
 
     if (mShadersAvailable) {
       mMenuUseShadersText.setColor(sf::Color(255U, 255U, 255U, mMenuUseShadersText.getGlobalBounds().contains(mousePos) ? 255U : 192U));
       sf::Text useShadersText(gLocalSettings().useShaders() ? tr("on") : tr("off"), mFixedFont, 16U);
       useShadersText.setPosition(mDefaultView.getCenter().x + 160, mMenuUseShadersText.getPosition().y);
-      mWindow.draw(useShadersText);
+      mRenderTarget->draw(useShadersText);
     }
-    mWindow.draw(mMenuUseShadersText);
+    mRenderTarget->draw(mMenuUseShadersText);
 
     mMenuParticlesPerExplosionText.setColor(sf::Color(255U, 255U, 255U, mMenuParticlesPerExplosionText.getGlobalBounds().contains(mousePos) ? 255U : 192U));
-    mWindow.draw(mMenuParticlesPerExplosionText);
+    mRenderTarget->draw(mMenuParticlesPerExplosionText);
 
     mMenuMusicVolumeText.setColor(sf::Color(255U, 255U, 255U, mMenuMusicVolumeText.getGlobalBounds().contains(mousePos) ? 255U : 192U));
-    mWindow.draw(mMenuMusicVolumeText);
+    mRenderTarget->draw(mMenuMusicVolumeText);
 
     mMenuSoundFXVolumeText.setColor(sf::Color(255U, 255U, 255U, mMenuSoundFXVolumeText.getGlobalBounds().contains(mousePos) ? 255U : 192U));
-    mWindow.draw(mMenuSoundFXVolumeText);
+    mRenderTarget->draw(mMenuSoundFXVolumeText);
 
     mMenuFrameRateLimitText.setColor(sf::Color(255U, 255U, 255U, mMenuFrameRateLimitText.getGlobalBounds().contains(mousePos) ? 255U : 192U));
-    mWindow.draw(mMenuFrameRateLimitText);
+    mRenderTarget->draw(mMenuFrameRateLimitText);
 
     mMenuVelocityIterationsText.setColor(sf::Color(255U, 255U, 255U, mMenuVelocityIterationsText.getGlobalBounds().contains(mousePos) ? 255U : 192U));
-    mWindow.draw(mMenuVelocityIterationsText);
+    mRenderTarget->draw(mMenuVelocityIterationsText);
 
     mMenuPositionIterationsText.setColor(sf::Color(255U, 255U, 255U, mMenuPositionIterationsText.getGlobalBounds().contains(mousePos) ? 255U : 192U));
-    mWindow.draw(mMenuPositionIterationsText);
+    mRenderTarget->draw(mMenuPositionIterationsText);
 
     if (mShadersAvailable && gLocalSettings().useShaders()) {
       mMenuUseShadersForExplosionsText.setColor(sf::Color(255U, 255U, 255U, mMenuUseShadersForExplosionsText.getGlobalBounds().contains(mousePos) ? 255U : 192U));
       sf::Text useShadersForExplosionsText(gLocalSettings().useShadersForExplosions() ? tr("on") : tr("off"), mFixedFont, 16U);
       useShadersForExplosionsText.setPosition(mDefaultView.getCenter().x + 160, mMenuUseShadersForExplosionsText.getPosition().y);
-      mWindow.draw(mMenuUseShadersForExplosionsText);
-      mWindow.draw(useShadersForExplosionsText);
+      mRenderTarget->draw(mMenuUseShadersForExplosionsText);
+      mRenderTarget->draw(useShadersForExplosionsText);
     }
 
     sf::Text particlesPerExplosionText(std::to_string(gLocalSettings().particlesPerExplosion()), mFixedFont, 16U);
     particlesPerExplosionText.setPosition(mDefaultView.getCenter().x + 160, mMenuParticlesPerExplosionText.getPosition().y);
-    mWindow.draw(particlesPerExplosionText);
+    mRenderTarget->draw(particlesPerExplosionText);
 
     sf::Text musicVolumeText(gLocalSettings().musicVolume() == 0 ? tr("off") : std::to_string(int(gLocalSettings().musicVolume())) + "%", mFixedFont, 16U);
     musicVolumeText.setPosition(mDefaultView.getCenter().x + 160, mMenuMusicVolumeText.getPosition().y);
-    mWindow.draw(musicVolumeText);
+    mRenderTarget->draw(musicVolumeText);
 
     sf::Text soundfxVolumeText(gLocalSettings().soundFXVolume() == 0 ? tr("off") : std::to_string(int(gLocalSettings().soundFXVolume())) + "%", mFixedFont, 16U);
     soundfxVolumeText.setPosition(mDefaultView.getCenter().x + 160, mMenuSoundFXVolumeText.getPosition().y);
-    mWindow.draw(soundfxVolumeText);
+    mRenderTarget->draw(soundfxVolumeText);
 
     sf::Text frameRateLimitText(gLocalSettings().framerateLimit() == 0 ? tr("off") : std::to_string(int(gLocalSettings().framerateLimit())) + "fps", mFixedFont, 16U);
     frameRateLimitText.setPosition(mDefaultView.getCenter().x + 160, mMenuFrameRateLimitText.getPosition().y);
-    mWindow.draw(frameRateLimitText);
+    mRenderTarget->draw(frameRateLimitText);
 
     sf::Text velocityIterationsText(std::to_string(int(gLocalSettings().velocityIterations())), mFixedFont, 16U);
     velocityIterationsText.setPosition(mDefaultView.getCenter().x + 160, mMenuVelocityIterationsText.getPosition().y);
-    mWindow.draw(velocityIterationsText);
+    mRenderTarget->draw(velocityIterationsText);
 
     sf::Text positionIterationsText(std::to_string(int(gLocalSettings().positionIterations())), mFixedFont, 16U);
     positionIterationsText.setPosition(mDefaultView.getCenter().x + 160, mMenuPositionIterationsText.getPosition().y);
-    mWindow.draw(positionIterationsText);
+    mRenderTarget->draw(positionIterationsText);
 
     const float menuTop = std::floor(mDefaultView.getCenter().y - 10);
     mMenuBackText.setColor(sf::Color(255, 255, 255, mMenuBackText.getGlobalBounds().contains(mousePos) ? 255 : 192));
     mMenuBackText.setPosition(.5f * (mDefaultView.getSize().x - mMenuBackText.getLocalBounds().width), mLevelsRenderTexture.getSize().y + menuTop);
-    mWindow.draw(mMenuBackText);
+    mRenderTarget->draw(mMenuBackText);
 
     updateStats();
-    mWindow.setView(mStatsView);
-    mWindow.draw(mFPSText);
+    mRenderTarget->setView(mStatsView);
+    mRenderTarget->draw(mFPSText);
   }
 
 
@@ -1811,7 +2039,7 @@ namespace Impact {
   {
     clearWorld();
     setState(State::SelectLevelScreen);
-    mWindow.setView(mDefaultView);
+    mRenderTarget->setView(mDefaultView);
     mWindow.setMouseCursorVisible(true);
     mWindow.setFramerateLimit(DefaultFramerateLimit);
     playSound(mRacketHitSound);
@@ -1830,20 +2058,26 @@ namespace Impact {
     static const int marginBottom = 10;
     static const int lineHeight = 20;
     static const float scrollSpeed = 64.f;
+    static const float thumbnailWidth = 30.f;
+    static const float thumbnailHeight = 18.f;
+    static const float levelTextLeft = 10.f + thumbnailWidth + 8.f;
 
     const float menuTop = std::floor(mDefaultView.getCenter().y - 10);
 
-    mWindow.clear(sf::Color(31, 31, 47));
-    mWindow.draw(mBackgroundSprite);
+    // thumbnails loaded in the background become textures here
+    mAssets.processUploads(sf::milliseconds(2));
+
+    mRenderTarget->clear(sf::Color(31, 31, 47));
+    mRenderTarget->draw(mBackgroundSprite);
 
     if (gLocalSettings().useShaders()) {
       sf::RenderStates states;
       states.shader = &mTitleShader;
       mTitleShader.setParameter("uT", t);
-      mWindow.draw(mTitleSprite, states);
+      mRenderTarget->draw(mTitleSprite, states);
     }
     else {
-      mWindow.draw(mTitleText);
+      mRenderTarget->draw(mTitleText);
     }
 
     sf::Sprite levelSprite;
@@ -1859,7 +2093,8 @@ namespace Impact {
     bottomSection.width -= 10.f;
     bottomSection.top += .9f * levelSprite.getGlobalBounds().height;
 
-    const float totalHeight = float(marginTop + marginBottom + lineHeight * mLevels.size());
+    const std::size_t levelCount = mLevelSummaries.size();
+    const float totalHeight = float(marginTop + marginBottom + lineHeight * levelCount);
     const float scrollAreaHeight = mLevelsRenderView.getSize().y;
     const float dt = mElapsed.asSeconds();
     if (topSection.contains(mousePos)) {
@@ -1884,38 +2119,49 @@ namespace Impact {
     mScrollbarSprite.setScale(scrollbarWidth, scrollbarHeight);
     mScrollbarSprite.setColor(sf::Color(255, 255, 255, scrollbarRect.contains(mousePos) ? 255 : 192));
 
-    if (mEnumerateFuture.valid()) {
-      std::future_status status = mEnumerateFuture.wait_for(std::chrono::milliseconds(1));
-      if (status != std::future_status::deferred) {
-        mLevelsRenderTexture.setView(mLevelsRenderView);
-        mLevelsRenderTexture.clear(sf::Color(0, 0, 0, 40));
-        mLevelsRenderTexture.draw(mScrollbarSprite);
-        mEnumerateMutex.lock();
-        // TODO: optimize performance by drawing only visible lines
-        for (std::vector<Level>::size_type i = 0; i < mLevels.size(); ++i) {
-          const std::string &levelName = mLevels.at(i).name();
-          sf::Text levelText("Level " + std::to_string(i + 1) + ": " + (levelName.empty() ? "<unnamed>" : levelName), mFixedFont, 16U);
-          const float levelTextTop = float(marginTop + lineHeight * i);
-          levelText.setPosition(10.f, levelTextTop);
-          sf::FloatRect levelTextRect(10.f, menuTop + levelTextTop - scrollTop, levelText.getLocalBounds().width, float(lineHeight));
-          const bool mouseOver = levelTextRect.contains(mousePos);
-          levelText.setColor(sf::Color(255, 255, 255, mouseOver ? 255 : 160));
-          if (mouseOver && sf::Mouse::isButtonPressed(sf::Mouse::Button::Left)) {
-            mLevel.set(i + 1, true);
-            gotoCurrentLevel();
-          }
-          mLevelsRenderTexture.draw(levelText);
+    mLevelsRenderTexture.setView(mLevelsRenderView);
+    mLevelsRenderTexture.clear(sf::Color(0, 0, 0, 40));
+    mLevelsRenderTexture.draw(mScrollbarSprite);
+    if (levelCount > 0) {
+      // only the rows in sight are laid out and drawn, so the cost does not grow with the number of levels
+      const std::size_t firstRow = std::size_t(std::max(0.f, std::floor((scrollTop - marginTop) / lineHeight)));
+      const std::size_t lastRow = std::min(levelCount - 1, std::size_t(std::max(0.f, std::floor((scrollTop + scrollAreaHeight - marginTop) / lineHeight))));
+      for (std::size_t i = firstRow; i <= lastRow; ++i) {
+        const float levelTextTop = float(marginTop + lineHeight * i);
+        LevelRow &row = levelRow(i, levelTextLeft, levelTextTop);
+        sf::FloatRect levelTextRect(10.f, menuTop + levelTextTop - scrollTop, levelTextLeft - 10.f + row.text.getLocalBounds().width, float(lineHeight));
+        const bool mouseOver = levelTextRect.contains(mousePos);
+        if (mouseOver != row.highlighted) {
+          row.text.setColor(sf::Color(255, 255, 255, mouseOver ? 255 : 160));
+          row.highlighted = mouseOver;
+        }
+        if (mouseOver && sf::Mouse::isButtonPressed(sf::Mouse::Button::Left)) {
+          mLevel.set(int(i + 1), true);
+          gotoCurrentLevel();
         }
-        mEnumerateMutex.unlock();
+        const sf::Texture *thumbnail = mThumbnails.get(mLevelSummaries[i].hash);
+        if (thumbnail != nullptr) {
+          const sf::Vector2u &size = thumbnail->getSize();
+          const float scale = std::min(thumbnailWidth / size.x, thumbnailHeight / size.y);
+          sf::Sprite thumbnailSprite(*thumbnail);
+          thumbnailSprite.setScale(scale, scale);
+          thumbnailSprite.setPosition(10.f + .5f * (thumbnailWidth - scale * size.x), levelTextTop + .5f * (lineHeight - scale * size.y));
+          thumbnailSprite.setColor(sf::Color(255, 255, 255, row.highlighted ? 255 : 160));
+          mLevelsRenderTexture.draw(thumbnailSprite);
+        }
+        mLevelsRenderTexture.draw(row.text);
       }
+      if (firstRow > DefaultLevelRowCacheMargin)
+        mLevelRows.erase(mLevelRows.begin(), mLevelRows.lower_bound(firstRow - DefaultLevelRowCacheMargin));
+      mLevelRows.erase(mLevelRows.upper_bound(lastRow + DefaultLevelRowCacheMargin), mLevelRows.end());
     }
 
     mMenuBackText.setColor(sf::Color(255, 255, 255, mMenuBackText.getGlobalBounds().contains(mousePos) ? 255 : 192));
     mMenuBackText.setPosition(.5f * (mDefaultView.getSize().x - mMenuBackText.getLocalBounds().width), mLevelsRenderTexture.getSize().y + menuTop);
-    mWindow.draw(mMenuBackText);
+    mRenderTarget->draw(mMenuBackText);
 
     mMenuSelectLevelText.setPosition(.5f * (mDefaultView.getSize().x - mMenuSelectLevelText.getLocalBounds().width), menuTop - mMenuBackText.getLocalBounds().height - 30);
-    mWindow.draw(mMenuSelectLevelText);
+    mRenderTarget->draw(mMenuSelectLevelText);
 
     sf::Event event;
     while (mWindow.pollEvent(event)) {
@@ -1945,16 +2191,16 @@ namespace Impact {
         mMouseButtonDown = false;
       }
       else if (event.type == sf::Event::MouseWheelMoved) {
-        if ((event.mouseWheel.delta < 0 && mLevelsRenderView.getCenter().y - .5f * mLevelsRenderView.getSize().y > 0.f) || (event.mouseWheel.delta > 0 && mLevelsRenderView.getCenter().y + .5f * mLevelsRenderView.getSize().y < float(marginTop + marginBottom + lineHeight * mLevels.size())))
+        if ((event.mouseWheel.delta < 0 && mLevelsRenderView.getCenter().y - .5f * mLevelsRenderView.getSize().y > 0.f) || (event.mouseWheel.delta > 0 && mLevelsRenderView.getCenter().y + .5f * mLevelsRenderView.getSize().y < float(marginTop + marginBottom + lineHeight * mLevelSummaries.size())))
           mLevelsRenderView.move(0.f, 62.f * (event.mouseWheel.delta));
       }
     }
 
     levelSprite.setTexture(mLevelsRenderTexture.getTexture());
-    mWindow.draw(levelSprite);
+    mRenderTarget->draw(levelSprite);
 
     if (mWelcomeLevel == 0) {
-      ExplosionDef pd(this, b2Vec2(.5f * DefaultTilesHorizontally, .4f * DefaultTilesVertically));
+      ExplosionDef pd(this, menuExplosionCenter());
       pd.ballCollisionEnabled = false;
       pd.count = gLocalSettings().particlesPerExplosion();
       pd.texture = mParticleTexture;
@@ -1963,7 +2209,7 @@ namespace Impact {
     }
 
     update();
-    drawWorld(mWindow.getDefaultView());
+    drawWorld(mDefaultView);
   }
 
 
@@ -1971,7 +2217,7 @@ namespace Impact {
   {
     clearWorld();
     setState(State::CampaignScreen);
-    mWindow.setView(mDefaultView);
+    mRenderTarget->setView(mDefaultView);
     mWindow.setMouseCursorVisible(true);
     mWindow.setFramerateLimit(DefaultFramerateLimit);
     playSound(mRacketHitSound);
@@ -2019,8 +2265,8 @@ namespace Impact {
         }
       }
     }
-    mWindow.clear(sf::Color(31, 31, 47));
-    mWindow.draw(mBackgroundSprite);
+    mRenderTarget->clear(sf::Color(31, 31, 47));
+    mRenderTarget->draw(mBackgroundSprite);
 
     const float t = mWallClock.getElapsedTime().asSeconds();
 
@@ -2028,31 +2274,31 @@ namespace Impact {
       sf::RenderStates states;
       states.shader = &mTitleShader;
       mTitleShader.setParameter("uT", t);
-      mWindow.draw(mTitleSprite, states);
+      mRenderTarget->draw(mTitleSprite, states);
     }
     else {
-      mWindow.draw(mTitleText);
+      mRenderTarget->draw(mTitleText);
     }
 
     const float menuTop = std::floor(mDefaultView.getCenter().y - 45.5f);
 
     sf::Text campaignLevelText = sf::Text(tr(">>> Campaign @ Level ") + std::to_string(gLocalSettings().lastCampaignLevel()) + " <<<", mFixedFont, 32U);
     campaignLevelText.setPosition(.5f * (mDefaultView.getSize().x - campaignLevelText.getLocalBounds().width), 0 + menuTop);
-    mWindow.draw(campaignLevelText);
+    mRenderTarget->draw(campaignLevelText);
 
     mMenuResumeCampaignText.setColor(sf::Color(255, 255, 255, mMenuResumeCampaignText.getGlobalBounds().contains(mousePos) ? 255 : 192));
     mMenuResumeCampaignText.setPosition(.5f * (mDefaultView.getSize().x - mMenuResumeCampaignText.getLocalBounds().width), 64 + menuTop);
-    mWindow.draw(mMenuResumeCampaignText);
+    mRenderTarget->draw(mMenuResumeCampaignText);
 
     if (gLocalSettings().lastCampaignLevel() > 1) {
       mMenuRestartCampaignText.setColor(sf::Color(255, 255, 255, mMenuRestartCampaignText.getGlobalBounds().contains(mousePos) ? 255 : 192));
       mMenuRestartCampaignText.setPosition(.5f * (mDefaultView.getSize().x - mMenuRestartCampaignText.getLocalBounds().width), 96 + menuTop);
-      mWindow.draw(mMenuRestartCampaignText);
+      mRenderTarget->draw(mMenuRestartCampaignText);
     }
 
     mMenuBackText.setColor(sf::Color(255, 255, 255, mMenuBackText.getGlobalBounds().contains(mousePos) ? 255 : 192));
     mMenuBackText.setPosition(.5f * (mDefaultView.getSize().x - mMenuBackText.getLocalBounds().width), 224 + menuTop);
-    mWindow.draw(mMenuBackText);
+    mRenderTarget->draw(mMenuBackText);
 
     if (mWelcomeLevel == 0) {
       ExplosionDef pd(this, InvScale * b2Vec2(mousePos.x, mousePos.y));
@@ -2064,7 +2310,7 @@ namespace Impact {
     }
 
     update();
-    drawWorld(mWindow.getDefaultView());
+    drawWorld(mDefaultView);
   }
 
 
@@ -2090,7 +2336,9 @@ namespace Impact {
       sf::RenderStates states;
       sf::Sprite sprite(in.getTexture());
       states.shader = &mKeyholeShader;
-      const sf::Vector2f &pos = sf::Vector2f(center.x / DefaultTilesHorizontally, center.y / DefaultTilesVertically);
+      // relative to the part of the level the camera shows
+      const sf::Vector2f &topLeft = mCameraView.getCenter() - .5f * mCameraView.getSize();
+      const sf::Vector2f &pos = sf::Vector2f((Scale * center.x - topLeft.x) / mCameraView.getSize().x, (Scale * center.y - topLeft.y) / mCameraView.getSize().y);
       mKeyholeShader.setParameter("uCenter", pos);
       out.draw(sprite, states);
       if (copyBack)
@@ -2244,18 +2492,18 @@ namespace Impact {
 
   void Game::drawPlayground(void)
   {
-    mWindow.setView(mPlaygroundView);
+    updateCamera();
+    mRenderTarget->setView(mPlaygroundView);
     clearWindow();
 
     if (gLocalSettings().useShaders()) {
+      // the effects below work on the whole texture, so the camera only applies to the level
+      const sf::View camera(mCameraView.getCenter(), mCameraView.getSize());
+      mRenderTexture0.setView(camera);
       mRenderTexture0.clear(mLevel.backgroundColor());
       mRenderTexture0.draw(mLevel.backgroundSprite());
-
-      for (BodyList::const_iterator b = mBodies.cbegin(); b != mBodies.cend(); ++b) {
-        const Body *body = *b;
-        if (body->isAlive())
-          mRenderTexture0.draw(*body);
-      }
+      drawBodies(mRenderTexture0, camera);
+      mRenderTexture0.setView(mRenderTexture0.getDefaultView());
 
       //MOD Keyhole
       //if (mBall != nullptr && gLocalSettings().useShaders) {
@@ -2310,29 +2558,26 @@ namespace Impact {
       sf::Sprite sprite(mRenderTexture0.getTexture());
       sf::RenderStates states;
       states.shader = &mMixShader;
-      mWindow.draw(sprite, states);
+      mRenderTarget->draw(sprite, states);
     }
     else { // !gLocalSettings().useShaders
-      mWindow.clear(mLevel.backgroundColor());
-      mWindow.draw(mLevel.backgroundSprite());
-      for (BodyList::const_iterator b = mBodies.cbegin(); b != mBodies.cend(); ++b) {
-        const Body *body = *b;
-        if (body->isAlive())
-          mWindow.draw(*body);
-      }
+      mRenderTarget->setView(mCameraView);
+      mRenderTarget->clear(mLevel.backgroundColor());
+      mRenderTarget->draw(mLevel.backgroundSprite());
+      drawBodies(*mRenderTarget, mCameraView);
     }
 
     if (mOverlayDuration > sf::Time::Zero) {
       if (mOverlayClock.getElapsedTime() < mOverlayDuration) {
-        mWindow.setView(mDefaultView);
+        mRenderTarget->setView(mDefaultView);
         if (gLocalSettings().useShaders()) {
           sf::RenderStates states;
           states.shader = &mOverlayShader;
           mOverlayShader.setParameter("uT", mOverlayClock.getElapsedTime().asSeconds());
-          mWindow.draw(mOverlaySprite, states);
+          mRenderTarget->draw(mOverlaySprite, states);
         }
         else {
-          mWindow.draw(mOverlayText1);
+          mRenderTarget->draw(mOverlayText1);
         }
       }
       else {
@@ -2341,28 +2586,13 @@ namespace Impact {
     }
 
     updateStats();
+    if (mStatsDirty)
+      renderStats();
 
-    mWindow.setView(mStatsView);
-    mWindow.draw(mStatsViewRectangle);
-    mWindow.draw(mLevelMsg);
-    mWindow.draw(mFPSText);
-    mWindow.draw(mLevelNameText);
-    mWindow.draw(mLevelAuthorText);
-
-    if (mState == State::Playing) {
-      mWindow.draw(mScoreMsg);
-      mWindow.draw(mCurrentScoreMsg);
-      mWindow.draw(mHighscoreMsg);
-      for (unsigned int life = 0; life < mLives; ++life) {
-        const sf::Texture &ballTexture = mLevel.texture(Ball::Name);
-        sf::Sprite lifeSprite(ballTexture);
-        lifeSprite.setOrigin(0.f, 0.f);
-        lifeSprite.setPosition(4 + (ballTexture.getSize().x * 1.5f) * life, 26.f);
-        mWindow.draw(lifeSprite);
-      }
-    }
+    mRenderTarget->setView(mStatsView);
+    mRenderTarget->draw(mStatsSprite);
 
-    // draw special effect hints
+    // draw special effect hints; they fade out, so they are drawn over the cached stats
     std::vector<std::vector<SpecialEffect>::iterator> expiredEffects;
     sf::Vector2f pos(mStatsView.getSize().x - 4, mStatsView.getSize().y - 16);
     for (std::vector<SpecialEffect>::iterator i = mSpecialEffects.begin(); i != mSpecialEffects.end(); ++i) {
@@ -2370,7 +2600,7 @@ namespace Impact {
         const sf::Uint8 alpha = 255U - sf::Uint8(255U * i->clock->getElapsedTime().asMilliseconds() / i->duration.asMilliseconds());
         i->sprite.setPosition(pos);
         i->sprite.setColor(sf::Color(255U, 255U, 255U, alpha));
-        mWindow.draw(i->sprite);
+        mRenderTarget->draw(i->sprite);
         pos.x -= i->texture.getSize().x;
       }
       else {
@@ -2387,38 +2617,159 @@ namespace Impact {
   void Game::updateStats(void)
   {
     if (mStatsClock.getElapsedTime() > sf::milliseconds(33)) {
-      mLevelMsg.setString(tr("Level") + " " + std::to_string(mLevel.num()));
-      mFPSText.setString(std::to_string(mFPS) + " fps\nCPU: " + std::to_string(int(getCurrentCPULoadPercentage())) + "%");
-      mFPSText.setPosition(mStatsView.getSize().x - std::max<float>(mFPSText.getGlobalBounds().width - 4, 60.f), mStatsView.getSize().y - 8 - mFPSText.getGlobalBounds().height);
-      if (mState == State::Playing) {
+      // texts are only laid out again if the values they show have changed
+      if (mLevel.num() != mShownStats.levelNum) {
+        mShownStats.levelNum = mLevel.num();
+        mLevelMsg.setString(tr("Level") + " " + std::to_string(mLevel.num()));
+        mStatsDirty = true;
+      }
+      const int cpuLoad = int(getCurrentCPULoadPercentage());
+      const int soundFXKBytes = int(mSounds.residentBytes() / 1024);
+      const int drawCalls = mRenderQueue.drawCalls();
+      if (mFPS != mShownStats.fps || cpuLoad != mShownStats.cpuLoad || soundFXKBytes != mShownStats.soundFXKBytes || drawCalls != mShownStats.drawCalls) {
+        mShownStats.fps = mFPS;
+        mShownStats.cpuLoad = cpuLoad;
+        mShownStats.soundFXKBytes = soundFXKBytes;
+        mShownStats.drawCalls = drawCalls;
+        mFPSText.clear();
+        mFPSText.append(int64_t(mFPS));
+        mFPSText.append(" fps\nCPU: ");
+        mFPSText.append(int64_t(cpuLoad));
+        mFPSText.append("%\nSFX: ");
+        mFPSText.append(int64_t(soundFXKBytes));
+        mFPSText.append(" KB\nDraws: ");
+        mFPSText.append(int64_t(drawCalls));
+        mFPSText.setPosition(mStatsView.getSize().x - std::max<float>(mFPSText.getGlobalBounds().width - 4, 60.f), mStatsView.getSize().y - 8 - mFPSText.getGlobalBounds().height);
+        mStatsDirty = true;
+      }
+      const bool playing = mState == State::Playing;
+      if (playing) {
         const int64_t penalty = calcPenalty();
-        mScoreMsg.setString(std::to_string(mLevelScore) + (penalty > 0 ? " " + std::to_string(-penalty) : ""));
-        mScoreMsg.setPosition(mStatsView.getSize().x - mScoreMsg.getLocalBounds().width - 4, 4);
-        mCurrentScoreMsg.setString("total: " + std::to_string(std::max<int64_t>(0, mTotalScore + mLevelScore - penalty)));
-        mCurrentScoreMsg.setPosition(mStatsView.getSize().x - mCurrentScoreMsg.getLocalBounds().width - 4, 20);
+        if (mLevelScore != mShownStats.levelScore || penalty != mShownStats.penalty || mTotalScore != mShownStats.totalScore) {
+          mShownStats.levelScore = mLevelScore;
+          mShownStats.penalty = penalty;
+          mShownStats.totalScore = mTotalScore;
+          mScoreMsg.clear();
+          mScoreMsg.append(mLevelScore);
+          if (penalty > 0) {
+            mScoreMsg.append(" ");
+            mScoreMsg.append(-penalty);
+          }
+          mScoreMsg.setPosition(mStatsView.getSize().x - mScoreMsg.getLocalBounds().width - 4, 4);
+          mCurrentScoreMsg.clear();
+          mCurrentScoreMsg.append("total: ");
+          mCurrentScoreMsg.append(std::max<int64_t>(0, mTotalScore + mLevelScore - penalty));
+          mCurrentScoreMsg.setPosition(mStatsView.getSize().x - mCurrentScoreMsg.getLocalBounds().width - 4, 20);
+          mStatsDirty = true;
+        }
+      }
+      if (playing != mShownStats.playing || mLives != mShownStats.lives) {
+        mShownStats.playing = playing;
+        mShownStats.lives = mLives;
+        mStatsDirty = true;
       }
       mStatsClock.restart();
     }
   }
 
 
+  void Game::renderStats(void)
+  {
+    mStatsTexture.clear(sf::Color::Transparent);
+    mStatsTexture.draw(mStatsViewRectangle);
+    mStatsTexture.draw(mLevelMsg);
+    mStatsTexture.draw(mFPSText);
+    mStatsTexture.draw(mLevelNameText);
+    mStatsTexture.draw(mLevelAuthorText);
+
+    if (mState == State::Playing) {
+      mStatsTexture.draw(mScoreMsg);
+      mStatsTexture.draw(mCurrentScoreMsg);
+      mStatsTexture.draw(mHighscoreMsg);
+      const sf::Texture &ballTexture = mLevel.texture(Ball::Name);
+      sf::Sprite lifeSprite(ballTexture);
+      for (unsigned int life = 0; life < mLives; ++life) {
+        lifeSprite.setPosition(4 + (ballTexture.getSize().x * 1.5f) * life, 26.f);
+        mStatsTexture.draw(lifeSprite);
+      }
+    }
+
+    mStatsTexture.display();
+    mStatsDirty = false;
+  }
+
+
   void Game::drawStartMessage(void)
   {
     mStartMsg.setColor(sf::Color(255, 255, 255, 192 + sf::Uint8(63 * std::sin(14 * mWallClock.getElapsedTime().asSeconds()))));
     mStartMsg.setPosition(mPlaygroundView.getCenter().x - 0.5f * mStartMsg.getLocalBounds().width, mPlaygroundView.getCenter().y + mPlaygroundView.getSize().y / 4);
-    mWindow.draw(mStartMsg);
+    mRenderTarget->draw(mStartMsg);
   }
 
 
   inline void Game::drawWorld(const sf::View &view)
   {
-    mWindow.setView(view);
+    mRenderTarget->setView(view);
+    drawBodies(*mRenderTarget, view);
+  }
+
+
+  void Game::drawBodies(sf::RenderTarget &target, const sf::View &view)
+  {
+    // sprites outside the view are culled, the rest is batched by layer, shader and texture
+    mRenderQueue.begin(view);
     for (BodyList::const_iterator b = mBodies.cbegin(); b != mBodies.cend(); ++b) {
       const Body *body = *b;
-      if (body->isAlive()) {
-        mWindow.draw(*body);
+      if (body->isAlive())
+        body->enqueue(mRenderQueue);
+    }
+    mRenderQueue.draw(target);
+  }
+
+
+  sf::Vector2f Game::cameraTarget(void) const
+  {
+    // the camera follows the balls, or the racket if there are none
+    b2Vec2 target = b2Vec2_zero;
+    int n = 0;
+    for (std::vector<Ball*>::const_iterator b = mBalls.cbegin(); b != mBalls.cend(); ++b) {
+      if ((*b)->isAlive()) {
+        target += (*b)->position();
+        ++n;
       }
     }
+    if (n == 0 && mRacket != nullptr) {
+      target = mRacket->position();
+      n = 1;
+    }
+    if (n == 0)
+      return mCameraView.getCenter();
+    target *= float32(Scale) / float32(n);
+    // keep the view inside the level
+    const sf::Vector2f &halfSize = .5f * mCameraView.getSize();
+    const float32 W = float32(Scale * mLevel.width());
+    const float32 H = float32(Scale * mLevel.height());
+    return sf::Vector2f(
+      std::max(halfSize.x, std::min(target.x, W - halfSize.x)),
+      std::max(halfSize.y, std::min(target.y, H - halfSize.y)));
+  }
+
+
+  // the menus show no level, so their fireworks go off relative to the playground
+  b2Vec2 Game::menuExplosionCenter(void) const
+  {
+    const sf::Vector2f &center = mPlaygroundView.getCenter();
+    return b2Vec2(InvScale * center.x, .8f * InvScale * center.y);
+  }
+
+
+  void Game::updateCamera(void)
+  {
+    if (!mScrolling)
+      return;
+    const sf::Vector2f &center = mCameraView.getCenter();
+    const float t = std::min(1.f, DefaultCameraSpeed * mElapsed.asSeconds());
+    mCameraView.setCenter(center + t * (cameraTarget() - center));
   }
 
 
@@ -2448,8 +2799,9 @@ namespace Impact {
               showScore(block->getScore(), block->position());
               killedBodies.push_back(block);
             }
+            // a hit with the minimum impulse of 20 has the normal priority
             else if (cp.normalImpulse > 20)
-              playSound(mBlockHitSound, block->position());
+              playSound(mBlockHitSound, block->position(), .05f * cp.normalImpulse);
           }
         }
         else if (a->type() == Body::BodyType::Ground || b->type() == Body::BodyType::Ground) {
@@ -2491,7 +2843,7 @@ namespace Impact {
         }
         else if (a->type() == Body::BodyType::Racket || b->type() == Body::BodyType::Racket) {
           if (cp.normalImpulse > 20)
-            playSound(mRacketHitSound, ball->position());
+            playSound(mRacketHitSound, ball->position(), .05f * cp.normalImpulse);
         }
       }
       if (a->type() == Body::BodyType::Bumper || b->type() == Body::BodyType::Bumper) {
@@ -2514,10 +2866,76 @@ namespace Impact {
     if (mElapsed == sf::Time::Zero)
       return;
 
-    const float elapsedSeconds = 1e-6f * mElapsed.asMicroseconds();
+    // a replay covers a single level, so it is over once the level is
+    if (mState != State::Playing && mReplayReader.isOpen())
+      stopReplay();
+
+    // the simulation advances in fixed steps, so that the same inputs
+    // always lead to the same outcome regardless of the frame rate
+    mStepAccumulator += mElapsed;
+    int steps = 0;
+    while (mStepAccumulator >= DefaultTimeStep) {
+      if (++steps > DefaultMaxStepsPerFrame) {
+        // too far behind: drop the backlog instead of spiralling down
+        mStepAccumulator = sf::Time::Zero;
+        break;
+      }
+      mStepAccumulator -= DefaultTimeStep;
+      if (mState == State::Playing) {
+        InputState input = mInput;
+        if (mReplayReader.isOpen()) {
+          if (!mReplayReader.read(input)) {
+            stopReplay();
+            break;
+          }
+          // keeps the racket where the replay left it after the end
+          mInput = input;
+        }
+        else if (mReplayWriter.isOpen()) {
+          mReplayWriter.write(input);
+        }
+        applyInput(input);
+        mInput.commands = 0;
+      }
+      step();
+    }
+
+    mFPSArray[mFPSIndex++] = int(1.f / mElapsed.asSeconds());
+    if (mFPSIndex >= mFPSArray.size())
+      mFPSIndex = 0;
+    mFPS = std::accumulate(mFPSArray.begin(), mFPSArray.end(), 0) / mFPSArray.size();
+  }
+
+
+  void Game::step(void)
+  {
+    const float32 elapsedSeconds = DefaultTimeStep.asSeconds();
+
+    // tile effects expire on the simulation clock, not once per frame
+    if (mScaleGravityEnabled && mScaleGravityClock.getElapsedTime() > mScaleGravityDuration) {
+      mWorld->SetGravity(b2Vec2(0.f, mLevel.gravity()));
+      mScaleGravityEnabled = false;
+    }
+
+    if (mScaleBallDensityEnabled && mScaleBallDensityClock.getElapsedTime() > mScaleBallDensityDuration) {
+      for (std::vector<Ball*>::iterator b = mBalls.begin(); b != mBalls.end(); ++b) {
+        Ball *ball = *b;
+        if (ball != nullptr && ball->isAlive()) {
+          ball->setDensity(ball->tileParam().density.get());
+        }
+      }
+      mScaleBallDensityEnabled = false;
+    }
+
+    BodyList activators(mBalls.cbegin(), mBalls.cend());
+    if (mRacket != nullptr)
+      activators.push_back(mRacket);
+    if (mScrolling)
+      streamChunks(activators);
+    mActivationManager.update(activators, elapsedSeconds);
 
     mContactPointCount = 0;
-    mWorld->Step(elapsedSeconds, gLocalSettings().velocityIterations(), gLocalSettings().positionIterations());
+    mWorld->Step(elapsedSeconds, mSession.velocityIterations, mSession.positionIterations);
     /* Note from the Box2D manual: You should always process the
     * contact points [collected in PostSolve()] immediately after
     * the time step; otherwise some other client code might
@@ -2528,12 +2946,15 @@ namespace Impact {
     mWorld->ClearForces();
 
     BodyList remainingBodies;
+    mFallingBlocks.clear();
     for (BodyList::iterator b = mBodies.begin(); b != mBodies.end(); ++b) {
       Body *body = *b;
       if (body != nullptr) {
         if (body->isAlive()) {
           body->update(elapsedSeconds);
           remainingBodies.push_back(body);
+          if (mScrolling && body->type() == Body::BodyType::Block && body->body()->IsAwake() && body->body()->GetGravityScale() > 0.f)
+            mFallingBlocks.push_back(body->position());
         }
         else {
           if (body->type() == Body::BodyType::Ball) {
@@ -2546,12 +2967,112 @@ namespace Impact {
       }
     }
     mBodies = remainingBodies;
+    mSimClock.advance(DefaultTimeStep);
+  }
 
 
-    mFPSArray[mFPSIndex++] = int(1.f / mElapsed.asSeconds());
-    if (mFPSIndex >= mFPSArray.size())
-      mFPSIndex = 0;
-    mFPS = std::accumulate(mFPSArray.begin(), mFPSArray.end(), 0) / mFPSArray.size();
+  void Game::simulate(const InputState &input)
+  {
+    if (mState == State::Playing)
+      applyInput(input);
+    step();
+  }
+
+
+  bool Game::startHeadless(const ReplayHeader &session)
+  {
+    if (!mHeadless)
+      return false;
+    clearWorld();
+    if (!mLevel.isAvailable() || mLevel.zipFilename() != session.levelZip) {
+      mLevel.loadZip(session.levelZip);
+      if (!mLevel.isAvailable()) {
+        std::cerr << "Cannot load level " << session.levelZip << std::endl;
+        return false;
+      }
+    }
+    mSession = session;
+    mSession.levelHash = mLevel.hash();
+    mSession.levelNum = mLevel.num();
+    mSession.stepMicroseconds = uint32_t(DefaultTimeStep.asMicroseconds());
+    mLives = DefaultLives;
+    mExtraLifeIndex = 0;
+    mTotalScore = 0;
+    startSimulation();
+    return true;
+  }
+
+
+  void Game::setLevelPaths(const std::string &levelsDir, const std::string &levelCacheDir)
+  {
+    mLevel.setPaths(levelsDir, levelCacheDir);
+  }
+
+
+  void Game::applyInput(const InputState &input)
+  {
+    if (mRacket == nullptr)
+      return;
+
+    if ((input.commands & InputState::NewBall) && mBalls.empty()) {
+      newBall();
+    }
+    if (input.commands & InputState::SpawnBall) {
+      const b2Vec2 &racketPos = mRacket->position();
+      newBall(b2Vec2(racketPos.x, racketPos.y - 1.2f * sign(mLevel.gravity())));
+    }
+    if (input.commands & InputState::RecoverBall) {
+      if (mBalls.empty()) {
+        newBall();
+      }
+      else {
+        const b2Vec2 &padPos = mRacket->position();
+        for (std::vector<Ball*>::iterator b = mBalls.begin(); b != mBalls.end(); ++b) {
+          Ball *ball = *b;
+          ball->setPosition(b2Vec2(padPos.x, padPos.y - 3.5f));
+          showScore(-DefaultForceNewBallPenalty, ball->position());
+        }
+      }
+    }
+
+    if (!mBalls.empty()) { // check if ball has been kicked out of the screen
+      for (std::vector<Ball*>::iterator b = mBalls.begin(); b != mBalls.end(); ++b) {
+        Ball *ball = *b;
+        if (ball != nullptr) {
+          const float ballX = ball->position().x;
+          const float ballY = ball->position().y;
+          if (0 > ballX || ballX > float(mLevel.width()) || 0 > ballY) {
+            ball->kill();
+          }
+          else if (ballY > mLevel.height()) {
+            ball->lethalHit();
+            ball->kill();
+          }
+        }
+      }
+    }
+
+    if (input.buttons & InputState::KickLeft) {
+      mRacket->kickLeft();
+    }
+    else if (input.buttons & InputState::KickRight) {
+      mRacket->kickRight();
+    }
+    else {
+      mRacket->stopKick();
+    }
+
+    // check if racket has been kicked out of the screen
+    const float racketX = mRacket->position().x;
+    const float racketY = mRacket->position().y;
+    if (racketY > mLevel.height())
+      mRacket->setPosition(b2Vec2(racketX, mLevel.height() - .5f));
+    if (racketX < 0.f)
+      mRacket->setPosition(b2Vec2(1.5f, racketY));
+    else if (racketX > mLevel.width())
+      mRacket->setPosition(b2Vec2(mLevel.width() - 1.5f, racketY));
+
+    mRacket->moveTo(InvScale * b2Vec2(float32(input.x), float32(input.y)));
   }
 
 
@@ -2571,7 +3092,7 @@ namespace Impact {
       }
       else if (a->type() == Body::BodyType::RightBoundary || b->type() == Body::BodyType::RightBoundary) {
         Racket *racket = reinterpret_cast<Racket*>(a->type() == Body::BodyType::Racket ? a : b);
-        if (racket->position().x + racket->aabb().upperBound.x > DefaultTilesHorizontally) {
+        if (racket->position().x + racket->aabb().upperBound.x > float32(mLevel.width())) {
           contact->SetEnabled(false);
           setCursorOnRacket();
         }
@@ -2619,6 +3140,10 @@ namespace Impact {
     const float32 W = mLevel.size().x;
     const float32 H = mLevel.size().y;
 
+    // static tiles are kept in a grid instead of the broadphase tree; the polygon
+    // skin makes a tile's AABB a bit larger than the tile, so a cell spans two tiles
+    mWorld->SetStaticGrid(b2Vec2_zero, 2.f, (mLevel.width() + 1) / 2, (mLevel.height() + 1) / 2);
+
     // create level boundaries
     b2BodyDef bd;
     b2Body *boundaries = mWorld->CreateBody(&bd);
@@ -2648,7 +3173,10 @@ namespace Impact {
     addBody(mGround);
 
 
-    if (mLevel.backgroundVisible()) {
+    if (mHeadless) {
+      mStatsColor = sf::Color::Black;
+    }
+    else if (mLevel.backgroundVisible()) {
       const sf::Texture *bgTex = mLevel.backgroundSprite().getTexture();
       if (bgTex != nullptr) {
         const sf::Image &bg = bgTex->copyToImage();
@@ -2674,10 +3202,20 @@ namespace Impact {
       mStatsColor = sf::Color::Black;
     }
 
-    createStatsViewRectangle();
+    if (!mHeadless)
+      createStatsViewRectangle();
 
     // create level elements
     mBlockCount = 0;
+    mActivationManager.setup(mLevel.width(), mLevel.height());
+    mScrolling = mLevel.width() > int(DefaultTilesHorizontally) || mLevel.height() > int(DefaultTilesVertically);
+    if (mScrolling) {
+      mTiles.assign(mLevel.width() * mLevel.height(), 0);
+      mChunksHorizontally = (mLevel.width() + DefaultChunkSize - 1) / DefaultChunkSize;
+      mChunksVertically = (mLevel.height() + DefaultChunkSize - 1) / DefaultChunkSize;
+      mChunks.assign(mChunksHorizontally * mChunksVertically, Chunk());
+      mStreamingStamp = 0;
+    }
     for (int y = 0; y < mLevel.height(); ++y) {
       const uint32_t *mapRow = mLevel.mapDataScanLine(y);
       for (int x = 0; x < mLevel.width(); ++x) {
@@ -2696,32 +3234,198 @@ namespace Impact {
             // mRacket->setXAxisConstraint(mLevel.height() - .5f);
             addBody(mRacket);
           }
-          else if (tileParam.textureName == Bumper::Name) {
-            Bumper *bumper = new Bumper(tileId, this, tileParam);
-            bumper->setPosition(pos);
-            addBody(bumper);
-          }
-          else if (tileParam.fixed.get()) {
-            Wall *wall = new Wall(tileId, this, tileParam);
-            wall->setPosition(pos);
-            addBody(wall);
-          }
           else {
-            Block *block = new Block(tileId, this, tileParam);
-            block->setPosition(pos);
-            addBody(block);
-            ++mBlockCount;
+            // blocks count from the start, even if they are streamed in later
+            if (tileParam.textureName != Bumper::Name && !tileParam.fixed.get())
+              ++mBlockCount;
+            if (mScrolling)
+              mTiles[x + y * mLevel.width()] = tileId;
+            else
+              createTile(x, y, tileId);
           }
         }
       }
     }
 
+    // mergeable wall tiles collide via the outlines traced by the level
+    if (!mLevel.wallOutlines().empty())
+      addBody(new Wall(this, mLevel.wallOutlines()));
+
+    if (mScrolling) {
+      BodyList activators(mBalls.cbegin(), mBalls.cend());
+      if (mRacket != nullptr)
+        activators.push_back(mRacket);
+      streamChunks(activators);
+      mCameraView.setCenter(cameraTarget());
+    }
+    else {
+      mCameraView.setCenter(mPlaygroundView.getCenter());
+    }
+
     mLevelNameText.setString(">> " + mLevel.name() + " <<");
     mLevelNameText.setPosition(4, 52);
     mLevelAuthorText.setString(mLevel.author());
     mLevelAuthorText.setPosition(4, 62);
+    mStatsDirty = true;
 
-    setCursorOnRacket();
+    if (!mHeadless)
+      setCursorOnRacket();
+  }
+
+
+  Body *Game::createTile(int x, int y, uint32_t tileId)
+  {
+    const b2Vec2 &pos = b2Vec2(float32(x), float32(y));
+    const TileParam &tileParam = mLevel.tileParam(tileId);
+    Body *body;
+    if (tileParam.textureName == Bumper::Name) {
+      Bumper *bumper = new Bumper(tileId, this, tileParam);
+      bumper->setPosition(pos);
+      body = bumper;
+    }
+    else if (tileParam.fixed.get()) {
+      Wall *wall = new Wall(tileId, this, tileParam, !mLevel.isMergeableWall(tileId));
+      wall->setPosition(pos);
+      body = wall;
+    }
+    else {
+      Block *block = new Block(tileId, this, tileParam);
+      block->setPosition(pos);
+      mActivationManager.add(block);
+      body = block;
+    }
+    addBody(body);
+    return body;
+  }
+
+
+  inline int Game::chunkOfTile(int tile) const
+  {
+    const int x = tile % mLevel.width();
+    const int y = tile / mLevel.width();
+    return x / DefaultChunkSize + (y / DefaultChunkSize) * mChunksHorizontally;
+  }
+
+
+  void Game::streamChunks(const BodyList &activators)
+  {
+    // the balls and the racket need everything in sight, falling blocks only their surroundings
+    std::vector<b2AABB> reach;
+    for (BodyList::const_iterator b = activators.cbegin(); b != activators.cend(); ++b) {
+      const b2Vec2 halfSize(.5f * DefaultTilesHorizontally + DefaultStreamingMargin, .5f * DefaultTilesVertically + DefaultStreamingMargin);
+      b2AABB aabb;
+      aabb.lowerBound = (*b)->position() - halfSize;
+      aabb.upperBound = (*b)->position() + halfSize;
+      reach.push_back(aabb);
+    }
+    for (std::vector<b2Vec2>::const_iterator p = mFallingBlocks.cbegin(); p != mFallingBlocks.cend(); ++p) {
+      const float32 margin = float32(DefaultStreamingMargin);
+      const b2Vec2 halfSize(margin, margin);
+      b2AABB aabb;
+      aabb.lowerBound = *p - halfSize;
+      aabb.upperBound = *p + halfSize;
+      reach.push_back(aabb);
+    }
+
+    // chunks are loaded when they come within reach, but only unloaded when they are
+    // another chunk further away, so that bodies moving along a border do not make them flicker
+    ++mStreamingStamp;
+    for (std::vector<b2AABB>::const_iterator a = reach.cbegin(); a != reach.cend(); ++a) {
+      const int x0 = std::max(0, int(std::floor(a->lowerBound.x)) / DefaultChunkSize);
+      const int y0 = std::max(0, int(std::floor(a->lowerBound.y)) / DefaultChunkSize);
+      const int x1 = std::min(mChunksHorizontally - 1, int(std::floor(a->upperBound.x)) / DefaultChunkSize);
+      const int y1 = std::min(mChunksVertically - 1, int(std::floor(a->upperBound.y)) / DefaultChunkSize);
+      for (int y = std::max(0, y0 - 1); y <= std::min(mChunksVertically - 1, y1 + 1); ++y) {
+        for (int x = std::max(0, x0 - 1); x <= std::min(mChunksHorizontally - 1, x1 + 1); ++x) {
+          const int chunk = x + y * mChunksHorizontally;
+          mChunks[chunk].stamp = mStreamingStamp;
+          const bool inReach = x >= x0 && x <= x1 && y >= y0 && y <= y1;
+          if (inReach && !mChunks[chunk].loaded)
+            loadChunk(chunk);
+        }
+      }
+    }
+
+    std::vector<int> farAway;
+    for (std::vector<int>::const_iterator c = mLoadedChunks.cbegin(); c != mLoadedChunks.cend(); ++c) {
+      if (mChunks[*c].stamp != mStreamingStamp)
+        farAway.push_back(*c);
+    }
+    if (!farAway.empty())
+      unloadChunks(farAway);
+  }
+
+
+  void Game::loadChunk(int chunk)
+  {
+    const int x0 = (chunk % mChunksHorizontally) * DefaultChunkSize;
+    const int y0 = (chunk / mChunksHorizontally) * DefaultChunkSize;
+    const int x1 = std::min(x0 + DefaultChunkSize, mLevel.width());
+    const int y1 = std::min(y0 + DefaultChunkSize, mLevel.height());
+    Chunk &c = mChunks[chunk];
+    for (int y = y0; y < y1; ++y) {
+      for (int x = x0; x < x1; ++x) {
+        const int tile = x + y * mLevel.width();
+        if (mTiles[tile] == 0)
+          continue;
+        Body *body = createTile(x, y, mTiles[tile]);
+        c.bodies.push_back(body);
+        StreamedTile &streamedTile = mStreamedTiles[body];
+        streamedTile.index = tile;
+        // only blocks can be moved away from their tile, and merged walls have no body of their own
+        if (body->type() == Body::BodyType::Block)
+          streamedTile.origin = body->body()->GetPosition();
+      }
+    }
+    c.loaded = true;
+    mLoadedChunks.push_back(chunk);
+  }
+
+
+  void Game::unloadChunks(const std::vector<int> &chunks)
+  {
+    BodyList unloaded;
+    for (std::vector<int>::const_iterator c = chunks.cbegin(); c != chunks.cend(); ++c) {
+      Chunk &chunk = mChunks[*c];
+      for (BodyList::const_iterator b = chunk.bodies.cbegin(); b != chunk.bodies.cend(); ++b) {
+        Body *body = *b;
+        std::map<const Body*, StreamedTile>::iterator t = mStreamedTiles.find(body);
+        const StreamedTile streamedTile = t->second;
+        mStreamedTiles.erase(t);
+        if (body->type() == Body::BodyType::Block) {
+          // a block that has been hit or pushed away is no tile anymore;
+          // it stays in the world until it is killed
+          const b2Body *b2body = body->body();
+          if (b2body->GetGravityScale() > 0.f || b2body->GetAngle() != 0.f || b2DistanceSquared(b2body->GetPosition(), streamedTile.origin) > b2_linearSlop * b2_linearSlop) {
+            mTiles[streamedTile.index] = 0;
+            continue;
+          }
+          mActivationManager.remove(reinterpret_cast<Block*>(body));
+        }
+        unloaded.push_back(body);
+      }
+      chunk.bodies.clear();
+      chunk.loaded = false;
+      mLoadedChunks.erase(std::find(mLoadedChunks.begin(), mLoadedChunks.end(), *c));
+    }
+    std::sort(unloaded.begin(), unloaded.end());
+    mBodies.erase(std::remove_if(mBodies.begin(), mBodies.end(), [&unloaded](Body *body) {
+      return std::binary_search(unloaded.cbegin(), unloaded.cend(), body);
+    }), mBodies.end());
+    for (BodyList::iterator b = unloaded.begin(); b != unloaded.end(); ++b)
+      delete *b;
+  }
+
+
+  void Game::forgetTile(const Body *body)
+  {
+    std::map<const Body*, StreamedTile>::iterator t = mStreamedTiles.find(body);
+    if (t == mStreamedTiles.end())
+      return;
+    BodyList &bodies = mChunks[chunkOfTile(t->second.index)].bodies;
+    bodies.erase(std::find(bodies.begin(), bodies.end(), body));
+    mTiles[t->second.index] = 0;
+    mStreamedTiles.erase(t);
   }
 
 
@@ -2729,7 +3433,7 @@ namespace Impact {
   {
     mNewHighscoreMsg.setColor(sf::Color(255, 255, 255, 160 + sf::Uint8(95 * std::sin(23 * mWallClock.getElapsedTime().asSeconds()))));
     mNewHighscoreMsg.setPosition(mPlaygroundView.getCenter().x - .5f * mNewHighscoreMsg.getLocalBounds().width, mPlaygroundView.getCenter().y - 80);
-    mWindow.draw(mNewHighscoreMsg);
+    mRenderTarget->draw(mNewHighscoreMsg);
   }
 
 
@@ -2739,7 +3443,6 @@ namespace Impact {
     if (mNewHighscore) {
       gLocalSettings().setHighscore(mLevel.num(), mTotalScore);
     }
-    gLocalSettings().save();
   }
 
 
@@ -2749,7 +3452,6 @@ namespace Impact {
     if (mNewHighscore) {
       gLocalSettings().setHighscore(mTotalScore);
     }
-    gLocalSettings().save();
   }
 
 
@@ -2777,6 +3479,8 @@ namespace Impact {
       }
     }
     mLevelScore = std::max<int64_t>(0, newScore);
+    if (mHeadless)
+      return;
     const int level = mLevel.num();
     const int64_t totalScore = deductPenalty(mLevelScore);
     const int64_t highscore = gLocalSettings().highscore(level);
@@ -2801,7 +3505,7 @@ namespace Impact {
   {
     if (mRacket != nullptr) {
       const b2Vec2 &racketPos = float32(Game::Scale) * mRacket->position();
-      sf::Mouse::setPosition(sf::Vector2i(int(racketPos.x), int(racketPos.y)), mWindow);
+      sf::Mouse::setPosition(mWindow.mapCoordsToPixel(sf::Vector2f(racketPos.x, racketPos.y), mCameraView), mWindow);
     }
   }
 
@@ -2834,7 +3538,6 @@ namespace Impact {
   {
     mPaused = true;
     setState(State::Pausing);
-    mLevelTimer.pause();
     startBlurEffect();
     mWindow.setMouseCursorVisible(true);
     pauseAllMusic();
@@ -2844,7 +3547,6 @@ namespace Impact {
   void Game::resume(void)
   {
     mPaused = false;
-    mLevelTimer.resume();
     stopBlurEffect();
     setCursorOnRacket();
     if (mState == State::Pausing)
@@ -2883,8 +3585,7 @@ namespace Impact {
 
   void Game::setSoundFXVolume(float volume)
   {
-    for (std::vector<sf::Sound>::iterator sound = mSoundFX.begin(); sound != mSoundFX.end(); ++sound)
-      sound->setVolume(volume);
+    mSoundFX.setVolume(volume);
   }
 
 
@@ -2894,17 +3595,33 @@ namespace Impact {
       m->setVolume(volume);
     if (mLevel.music() != nullptr)
       mLevel.music()->setVolume(volume);
+#ifndef NO_RECORDER
+    if (recordingMixer() != nullptr)
+      recordingMixer()->setMusicVolume(volume, recordingTime());
+#endif
   }
 
 
-  void Game::playSound(const sf::SoundBuffer &buffer, const b2Vec2 &pos)
+  void Game::playSound(const SoundBank::Sound &sound, const b2Vec2 &pos, float priority)
   {
-    sf::Sound &sound = mSoundFX[mSoundIndex];
-    sound.setBuffer(buffer);
-    sound.setPosition(pos.x, 0, 0);
-    sound.play();
-    if (++mSoundIndex >= mSoundFX.size())
-      mSoundIndex = 0;
+    if (mHeadless)
+      return;
+    const SoundBank::BufferPtr &buffer = mSounds.get(sound);
+    if (!buffer) {
+      // a sound dropped from the cache is skipped this time, rather than
+      // decoded on the game thread, and is decoded again in the background
+      mAssets.decodeSound(mSounds, sound);
+      return;
+    }
+    // panned relative to the center of the playground, where
+    // sounds far off the center are less important
+    const float pan = (pos.x - DefaultCenter.x) / DefaultCenter.x;
+    mSoundFX.playSound(buffer, pan, priority * (1.f - .5f * std::min(1.f, std::abs(pan))));
+#ifndef NO_RECORDER
+    // the recording gets the sound without positioning
+    if (recordingMixer() != nullptr)
+      recordingMixer()->playSound(buffer, mSoundFX.getVolume(), recordingTime());
+#endif
   }
 
 
@@ -2913,12 +3630,24 @@ namespace Impact {
     stopAllMusic();
     mMusic[music].play();
     mMusic[music].setLoop(loop);
+#ifndef NO_RECORDER
+    if (recordingMixer() != nullptr)
+      recordingMixer()->playMusic(mMusicFilenames[music], loop, mMusic[music].getVolume(), recordingTime());
+#endif
   }
 
 
+#ifndef NO_RECORDER
+  AudioMixer *Game::recordingMixer(void)
+  {
+    return (mRecorderEnabled && mRec != nullptr) ? &mRec->mixer() : nullptr;
+  }
+#endif
+
+
   int64_t Game::calcPenalty(void) const
   {
-    return 5 * mLevelTimer.accumulatedMilliseconds() / 1000; //MOD PenaltyPerSecond
+    return 5 * mLevelTimer.getElapsedTime().asMilliseconds() / 1000; //MOD PenaltyPerSecond
   }
 
 
@@ -2931,15 +3660,18 @@ namespace Impact {
   void Game::onBodyKilled(Body *killedBody)
   {
     if (killedBody->type() == Body::BodyType::Block) {
+      mActivationManager.remove(reinterpret_cast<Block*>(killedBody));
+      if (mScrolling)
+        forgetTile(killedBody);
       playSound(mExplosionSound, killedBody->position());
       ExplosionDef pd(this, killedBody->position());
       pd.ballCollisionEnabled = mLevel.explosionParticlesCollideWithBall();
-      pd.count = gLocalSettings().particlesPerExplosion();
+      pd.count = mSession.particlesPerExplosion;
       pd.texture = mParticleTexture;
       addBody(new Explosion(pd));
       {
         // check for killing spree
-        mLastKillings[mLastKillingsIndex] = mWallClock.getElapsedTime();
+        mLastKillings[mLastKillingsIndex] = mSimClock.now();
         int i = (mLastKillingsIndex - mLastKillings.size()) % int(mLastKillings.size());
         const sf::Time &dt = mLastKillings.at(mLastKillingsIndex) - mLastKillings.at(i);
         mLastKillingsIndex = (mLastKillingsIndex + 1) % mLastKillings.size();
@@ -2950,7 +3682,7 @@ namespace Impact {
         }
       }
       const TileParam &tileParam = killedBody->tileParam();
-      if (tileParam.earthquakeDuration > sf::Time::Zero && tileParam.earthquakeIntensity > 0.f) {
+      if (!mHeadless && tileParam.earthquakeDuration > sf::Time::Zero && tileParam.earthquakeIntensity > 0.f) {
         startEarthquake(tileParam.earthquakeIntensity, tileParam.earthquakeDuration);
         addSpecialEffect(SpecialEffect(mEarthquakeDuration, &mEarthquakeClock, killedBody->texture()));
       }
@@ -2960,12 +3692,14 @@ namespace Impact {
         mScaleGravityEnabled = true;
         mScaleGravityClock.restart();
         mScaleGravityDuration = tileParam.scaleGravityDuration;
-        startAberrationEffect(tileParam.scaleGravityBy, tileParam.scaleGravityDuration);
-        OverlayDef od;
-        od.line1 = std::string("G*") + std::to_string(int(tileParam.scaleGravityBy));
-        od.line2 = std::string("for ") + std::to_string(tileParam.scaleGravityDuration.asMilliseconds() / 1000) + "s";
-        startOverlay(od);
-        addSpecialEffect(SpecialEffect(mScaleGravityDuration, &mScaleGravityClock, killedBody->texture()));
+        if (!mHeadless) {
+          startAberrationEffect(tileParam.scaleGravityBy, tileParam.scaleGravityDuration);
+          OverlayDef od;
+          od.line1 = std::string("G*") + std::to_string(int(tileParam.scaleGravityBy));
+          od.line2 = std::string("for ") + std::to_string(tileParam.scaleGravityDuration.asMilliseconds() / 1000) + "s";
+          startOverlay(od);
+          addSpecialEffect(SpecialEffect(mScaleGravityDuration, &mScaleGravityClock, killedBody->texture()));
+        }
       }
       if (tileParam.scaleBallDensityDuration > sf::Time::Zero) {
         for (std::vector<Ball*>::iterator b = mBalls.begin(); b != mBalls.end(); ++b) {
@@ -2999,19 +3733,27 @@ namespace Impact {
 
   void Game::enumerateAllLevels(void)
   {
-    std::packaged_task<bool()> task([this]{
+    // read here, as the local settings must not be touched by the enumerator thread
+    const std::string levelsDir = gLocalSettings().levelsDir();
+    const std::string levelCacheDir = gLocalSettings().levelCacheDir();
+    std::packaged_task<bool()> task([this, levelsDir, levelCacheDir]{
 #if defined(WIN32)
       const int prio = GetThreadPriority(GetCurrentThread());
       SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
 #endif
-      if (mLevels.empty()) {
+      if (mLevelSummaries.empty()) {
         for (int l = 1; !mQuitEnumeration; ++l) {
-          Level level(l);
-          if (!level.isAvailable())
+          Level level;
+          level.setPaths(levelsDir, levelCacheDir);
+          if (!level.set(l, true))
+            break;
+          // the level is loaded anyway, so its thumbnail is rendered on the way
+          mThumbnails.store(level);
+          LevelSummary summary;
+          summary.name = level.name();
+          summary.hash = level.hash();
+          if (!mLevelSummaries.push_back(summary))
             break;
-          mEnumerateMutex.lock();
-          mLevels.push_back(level);
-          mEnumerateMutex.unlock();
         }
       }
 #if defined(WIN32)
@@ -3022,4 +3764,23 @@ namespace Impact {
     mEnumerateFuture = task.get_future();
     std::thread(std::move(task)).detach();
   }
+
+
+  Game::LevelRow &Game::levelRow(std::size_t index, float left, float top)
+  {
+    std::map<std::size_t, LevelRow>::iterator r = mLevelRows.find(index);
+    if (r != mLevelRows.end())
+      return r->second;
+    LevelRow &row = mLevelRows[index];
+    const std::string &levelName = mLevelSummaries[index].name;
+    row.text.setFont(mFixedFont, 16U);
+    row.text.setColor(sf::Color(255, 255, 255, 160));
+    row.text.append("Level ");
+    row.text.append(int64_t(index + 1));
+    row.text.append(": ");
+    row.text.append(levelName.empty() ? std::string("<unnamed>") : levelName);
+    row.text.setPosition(left, top);
+    row.highlighted = false;
+    return row;
+  }
 }
@@ -32,6 +32,14 @@
 #include "Ball.h"
 #include "Racket.h"
 #include "Ground.h"
+#include "ActivationManager.h"
+#include "Replay.h"
+#include "SimulationClock.h"
+#include "AssetManager.h"
+#include "ThumbnailCache.h"
+#include "SoundEngine.h"
+#include "GlyphText.h"
+#include "AppendOnlyList.h"
 
 #ifndef NO_RECORDER
 #include "Recorder.h"
@@ -49,7 +57,7 @@ namespace Impact {
     SpecialEffect(void)
       : clock(nullptr)
     { /* ... */ }
-    SpecialEffect(const sf::Time &d, sf::Clock *clk, const sf::Texture &tex)
+    SpecialEffect(const sf::Time &d, SimulationTimer *clk, const sf::Texture &tex)
       : duration(d)
       , clock(clk)
       , texture(tex)
@@ -67,7 +75,7 @@ namespace Impact {
     sf::Time duration;
     sf::Sprite sprite;
     sf::Texture texture;
-    sf::Clock *clock;
+    SimulationTimer *clock;
   };
 
   struct ContactPoint {
@@ -150,6 +158,11 @@ namespace Impact {
 
 
   public:
+    typedef enum _Mode {
+      Interactive,
+      Headless
+    } Mode;
+
     static const int Scale = 16;
     static const float32 InvScale;
     static const unsigned int DefaultTilesHorizontally = 40U;
@@ -166,7 +179,6 @@ namespace Impact {
     static const unsigned int DefaultLives;
     static const int64_t NewLifeAfterSoManyPointsDefault;
     static const int64_t NewLifeAfterSoManyPoints[];
-    static const int MaxSoundFX = 16;
     static const int DefaultForceNewBallPenalty;
     static const int32 MaxContactPoints = 512;
     static const sf::Time DefaultFadeEffectDuration;
@@ -178,11 +190,23 @@ namespace Impact {
     static const unsigned int DefaultKillingSpreeBonus;
     static const sf::Time DefaultKillingSpreeInterval;
     static const float DefaultWallRestitution;
-
-    Game(void);
+    static const sf::Time DefaultTimeStep;
+    static const int DefaultMaxStepsPerFrame = 8;
+    static const sf::Time DefaultReplayTail;
+    static const int DefaultChunkSize = 16;
+    static const int DefaultStreamingMargin = 8;
+    static const float DefaultCameraSpeed;
+
+    explicit Game(Mode mode = Interactive);
     ~Game();
     void setLevelZip(const char *zipFilename);
     void loop(void);
+    bool playReplay(const std::string &filename);
+    bool renderReplay(const std::string &replayFilename, const std::string &videoFilename, unsigned int width, unsigned int height);
+    bool startHeadless(const ReplayHeader &session);
+    void setLevelPaths(const std::string &levelsDir, const std::string &levelCacheDir);
+    void simulate(const InputState &input);
+    bool useShaders(void) const;
     void addBody(Body *body);
     void initSounds(void);
     void initShaderDependants(void);
@@ -190,6 +214,8 @@ namespace Impact {
 
 #ifndef NO_RECORDER
     Recorder *mRec;
+    FrameGrabber mFrameGrabber;
+    sf::RenderTexture mOfflineRenderTexture;
 #endif
 
     inline b2World *world(void)
@@ -197,11 +223,78 @@ namespace Impact {
       return mWorld;
     }
 
+    inline SimulationClock &simulationClock(void)
+    {
+      return mSimClock;
+    }
+
+    inline const SimulationClock &simulationClock(void) const
+    {
+      return mSimClock;
+    }
+
+    inline bool isHeadless(void) const
+    {
+      return mHeadless;
+    }
+
+    inline bool isPlaying(void) const
+    {
+      return mState == State::Playing;
+    }
+
+    inline bool isLevelCompleted(void) const
+    {
+      return mState == State::LevelCompleted;
+    }
+
+    inline bool isGameOver(void) const
+    {
+      return mState == State::GameOver;
+    }
+
+    inline int64_t score(void) const
+    {
+      return isPlaying() ? deductPenalty(mLevelScore) : mTotalScore;
+    }
+
+    inline unsigned int lives(void) const
+    {
+      return mLives;
+    }
+
+    inline int blockCount(void) const
+    {
+      return mBlockCount;
+    }
+
+    inline const std::vector<Ball*> &balls(void) const
+    {
+      return mBalls;
+    }
+
+    inline const Racket *racket(void) const
+    {
+      return mRacket;
+    }
+
     inline const Level *level(void) const
     {
       return &mLevel;
     }
 
+    /// the texture shared by all tile bodies of a kind; empty until the first body fills it
+    inline sf::Texture &tileTexture(int index)
+    {
+      return mTileTextures[index];
+    }
+
+    /// the motion blur shared by all balls
+    inline sf::Shader &ballShader(void)
+    {
+      return mBallShader;
+    }
+
     inline const Ground *ground(void) const
     {
       return mGround;
@@ -225,12 +318,21 @@ namespace Impact {
     int mGLSLVersionMinor;
     std::string mGLShadingLanguageVersion;
     bool mShadersAvailable;
+    bool mHeadless;
+
+    SimulationClock mSimClock;
 
     // SFML
     sf::RenderWindow mWindow;
     bool mRecorderEnabled;
     sf::Clock mRecorderClock;
     sf::Clock mRecorderWallClock;
+    bool mOfflineRendering;
+    sf::Time mOfflineFrameTime;
+    /// the window, or the texture replays are rendered into offline
+    sf::RenderTarget *mRenderTarget;
+    sf::Time mSimulatedTime;
+    sf::Time recordingTime(void) const;
     sf::View mDefaultView;
     sf::View mPlaygroundView;
     sf::View mStatsView;
@@ -239,6 +341,7 @@ namespace Impact {
     sf::RenderTexture mRenderTexture0;
     sf::RenderTexture mRenderTexture1;
     sf::Shader mMixShader;
+    sf::Shader mBallShader;
     int mFadeEffectsActive;
     bool mFadeEffectsDarken;
     sf::Time mFadeEffectDuration;
@@ -282,7 +385,7 @@ namespace Impact {
     sf::Text mCreditsText;
     sf::Text mLevelNameText;
     sf::Text mLevelAuthorText;
-    sf::Text mFPSText;
+    GlyphText mFPSText;
     sf::Texture mLogoTexture;
     sf::Sprite mLogoSprite;
     sf::Text mOverlayText1;
@@ -291,16 +394,16 @@ namespace Impact {
     sf::Sprite mOverlaySprite;
     sf::Shader mOverlayShader;
     sf::Time mOverlayDuration;
-    sf::Clock mOverlayClock;
+    SimulationTimer mOverlayClock;
     std::vector<OverlayDef> mOverlayQueue;
     sf::Texture mParticleTexture;
     std::string mFadeShaderCode;
     sf::Shader mEarthquakeShader;
     float32 mEarthquakeIntensity;
-    sf::Clock mEarthquakeClock;
+    SimulationTimer mEarthquakeClock;
     sf::Time mEarthquakeDuration;
     sf::Shader mAberrationShader;
-    sf::Clock mAberrationClock;
+    SimulationTimer mAberrationClock;
     sf::Time mAberrationDuration;
     float32 mAberrationIntensity;
     sf::RenderTexture mLevelsRenderTexture;
@@ -314,11 +417,11 @@ namespace Impact {
     sf::Clock mWallClock;
     sf::Clock mScoreClock;
     sf::Clock mBlurClock;
-    sf::Clock mFadeEffectTimer;
-    sf::Clock mScaleGravityClock;
+    SimulationTimer mFadeEffectTimer;
+    SimulationTimer mScaleGravityClock;
     sf::Time mScaleGravityDuration;
     bool mScaleGravityEnabled;
-    sf::Clock mScaleBallDensityClock;
+    SimulationTimer mScaleBallDensityClock;
     sf::Time mScaleBallDensityDuration;
     bool mScaleBallDensityEnabled;
     bool mNewHighscore;
@@ -326,8 +429,8 @@ namespace Impact {
     sf::Text mLevelCompletedMsg;
     sf::Text mGameOverMsg;
     sf::Text mPlayerWonMsg;
-    sf::Text mScoreMsg;
-    sf::Text mCurrentScoreMsg;
+    GlyphText mScoreMsg;
+    GlyphText mCurrentScoreMsg;
     sf::Text mHighscoreMsg;
     sf::Text mYourScoreMsg;
     sf::Text mTotalScoreMsg;
@@ -335,22 +438,25 @@ namespace Impact {
     sf::Text mStartMsg;
     sf::Text mProgramInfoMsg;
     sf::Text mLevelMsg;
-    sf::SoundBuffer mStartupSound;
-    sf::SoundBuffer mNewBallSound;
-    sf::SoundBuffer mBallOutSound;
-    sf::SoundBuffer mBlockHitSound;
-    sf::SoundBuffer mPenaltySound;
-    sf::SoundBuffer mRacketHitSound;
-    sf::SoundBuffer mRacketHitBlockSound;
-    sf::SoundBuffer mExplosionSound;
-    sf::SoundBuffer mNewLifeSound;
-    sf::SoundBuffer mLevelCompleteSound;
-    sf::SoundBuffer mKillingSpreeSound;
-    sf::SoundBuffer mMultiballSound;
-    sf::SoundBuffer mHighscoreSound;
-    sf::SoundBuffer mBumperSound;
+    SoundBank mSounds;
+    SoundBank::Sound mStartupSound;
+    SoundBank::Sound mNewBallSound;
+    SoundBank::Sound mBallOutSound;
+    SoundBank::Sound mBlockHitSound;
+    SoundBank::Sound mPenaltySound;
+    SoundBank::Sound mRacketHitSound;
+    SoundBank::Sound mRacketHitBlockSound;
+    SoundBank::Sound mExplosionSound;
+    SoundBank::Sound mNewLifeSound;
+    SoundBank::Sound mLevelCompleteSound;
+    SoundBank::Sound mKillingSpreeSound;
+    SoundBank::Sound mMultiballSound;
+    SoundBank::Sound mHighscoreSound;
+    SoundBank::Sound mBumperSound;
 
     std::vector<sf::Music> mMusic;
+    std::vector<std::string> mMusicFilenames;
+    AssetManager mAssets;
     std::vector<int> mFPSArray;
     std::vector<int>::size_type mFPSIndex;
     int mFPS;
@@ -360,6 +466,47 @@ namespace Impact {
     Ground *mGround;
     ContactPoint mPoints[MaxContactPoints];
     int32 mContactPointCount;
+    ActivationManager mActivationManager;
+
+    // levels larger than the playground scroll; their tiles are streamed in
+    // square chunks, which are loaded near the balls, the racket and falling
+    // blocks and unloaded again when all of them are far away
+    struct Chunk {
+      Chunk(void)
+        : loaded(false)
+        , stamp(0)
+      { /* ... */ }
+      BodyList bodies;
+      bool loaded;
+      unsigned int stamp;
+    };
+    bool mScrolling;
+    int mChunksHorizontally;
+    int mChunksVertically;
+    std::vector<Chunk> mChunks;
+    std::vector<int> mLoadedChunks;
+    unsigned int mStreamingStamp;
+    // tile ids of the level that have not been killed or moved away yet
+    std::vector<uint32_t> mTiles;
+    struct StreamedTile {
+      int index;
+      b2Vec2 origin;
+    };
+    std::map<const Body*, StreamedTile> mStreamedTiles;
+    std::vector<b2Vec2> mFallingBlocks;
+    sf::View mCameraView;
+    std::map<int, sf::Texture> mTileTextures;
+    RenderQueue mRenderQueue;
+    Body *createTile(int x, int y, uint32_t tileId);
+    int chunkOfTile(int tile) const;
+    void streamChunks(const BodyList &activators);
+    void loadChunk(int chunk);
+    void unloadChunks(const std::vector<int> &chunks);
+    void forgetTile(const Body *body);
+    sf::Vector2f cameraTarget(void) const;
+    void updateCamera(void);
+    b2Vec2 menuExplosionCenter(void) const;
+    void drawBodies(sf::RenderTarget &target, const sf::View &view);
 
     // b2ContactListener interface
     virtual void PreSolve(b2Contact* contact, const b2Manifold* oldManifold);
@@ -382,30 +529,92 @@ namespace Impact {
     std::vector<Ball*> mBalls;
     Racket *mRacket;
     Level mLevel;
+    // the next campaign level, loaded in the background while the current one is played
+    Level mNextLevel;
+    std::future<bool> mNextLevelFuture;
+    void prefetchNextLevel(void);
     TileParam mBallTileParam;
-    Timer mLevelTimer;
+    SimulationTimer mLevelTimer;
     sf::Clock mStatsClock;
-    sf::Clock mPenaltyClock;
+    // the stats view is rendered into a texture, and only rendered again if what it shows has changed
+    struct StatsValues {
+      StatsValues(void)
+        : levelNum(-1)
+        , fps(-1)
+        , cpuLoad(-1)
+        , soundFXKBytes(-1)
+        , drawCalls(-1)
+        , levelScore(-1)
+        , penalty(-1)
+        , totalScore(-1)
+        , lives(0)
+        , playing(false)
+      { /* ... */ }
+      int levelNum;
+      int fps;
+      int cpuLoad;
+      int soundFXKBytes;
+      int drawCalls;
+      int64_t levelScore;
+      int64_t penalty;
+      int64_t totalScore;
+      unsigned int lives;
+      bool playing;
+    };
+    StatsValues mShownStats;
+    sf::RenderTexture mStatsTexture;
+    sf::Sprite mStatsSprite;
+    bool mStatsDirty;
+    void renderStats(void);
+    SimulationTimer mPenaltyClock;
     std::vector<sf::Time> mLastKillings;
     int mLastKillingsIndex;
     std::vector<SpecialEffect> mSpecialEffects;
     bool mHighscoreReached;
 
+    // fixed steps and replays
+    InputState mInput;
+    sf::Time mStepAccumulator;
+    ReplayHeader mSession;
+    ReplayWriter mReplayWriter;
+    ReplayReader mReplayReader;
+    sf::Time mReplayEndTime;
+    void applyInput(const InputState &input);
+    void step(void);
+    void startSimulation(void);
+    void startReplayCapture(void);
+    void stopReplay(void);
+
     std::string mLevelZipFilename;
     int mDisplayCount;
 
-    std::vector<Level> mLevels;
-    std::mutex mEnumerateMutex;
-    bool mQuitEnumeration;
+    struct LevelSummary {
+      std::string name;
+      std::string hash;
+    };
+    /// all levels, appended to by the enumerator while the level-select screen reads them
+    AppendOnlyList<LevelSummary> mLevelSummaries;
+    ThumbnailCache mThumbnails;
+    std::atomic<bool> mQuitEnumeration;
+    struct LevelRow {
+      GlyphText text;
+      bool highlighted;
+    };
+    /// laid out lines of the level-select screen, kept only for the rows in and around sight
+    std::map<std::size_t, LevelRow> mLevelRows;
+    static const std::size_t DefaultLevelRowCacheMargin = 20;
+    LevelRow &levelRow(std::size_t index, float left, float top);
     void enumerateAllLevels(void);
     std::packaged_task<bool()> mEnumerateTask;
     std::future<bool> mEnumerateFuture;
-    std::vector<sf::Sound> mSoundFX;
-    std::vector<sf::Sound>::size_type mSoundIndex;
+    SoundEngine mSoundFX;
     void setSoundFXVolume(float volume);
-    void playSound(const sf::SoundBuffer &buffer, const b2Vec2 &pos = DefaultCenter);
+    void playSound(const SoundBank::Sound &sound, const b2Vec2 &pos = DefaultCenter, float priority = 1.f);
     void setMusicVolume(float volume);
     void playMusic(Music music, bool loop = true);
+#ifndef NO_RECORDER
+    AudioMixer *recordingMixer(void);
+#endif
     int64_t calcPenalty(void) const;
     int64_t deductPenalty(int64_t score) const;
     void createStatsViewRectangle(void);
@@ -422,6 +631,7 @@ namespace Impact {
     void extraBall(void);
     void setState(State state);
     void clearWorld(void);
+    void createWorld(void);
     void clearWindow(void);
     void updateStats(void);
     void drawWorld(const sf::View &view);
@@ -460,6 +670,9 @@ namespace Impact {
     void gotoNextLevel(void);
     void onPlaying(void);
 
+    void finishInitialization(void);
+    void onInitialization(void);
+
     void gotoLevelCompleted(void);
     void onLevelCompleted(void);
 
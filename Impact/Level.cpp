@@ -20,8 +20,6 @@
 
 #include "stdafx.h"
 
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/xml_parser.hpp>
 #include <boost/algorithm/string.hpp>
 
 #include <zlib.h>
@@ -37,6 +35,8 @@ extern "C" {
 #endif
 
 #include "sha1.h"
+#include "XmlReader.h"
+#include "LevelCache.h"
 
 #if defined(WIN32)
 #include <Shlwapi.h>
@@ -50,6 +50,9 @@ namespace Impact {
   const float32 Level::DefaultGravity = 9.81f;
   const float32 Level::DefaultWallRestitution = 1.f;
 
+  std::mutex Level::sExtractMutex;
+  std::map<std::string, std::shared_ptr<std::mutex> > Level::sExtractDirMutexes;
+
   Level::Level(void)
     : mBackgroundColor(sf::Color::Black)
     , mBackgroundVisible(true)
@@ -67,6 +70,7 @@ namespace Impact {
     , mKillingSpreeInterval(Game::DefaultKillingSpreeInterval)
     , mSuccessfullyLoaded(false)
     , mMusic(nullptr)
+    , mMusicEnabled(true)
   {
     // ...
   }
@@ -100,6 +104,12 @@ namespace Impact {
     , mAuthor(other.mAuthor)
     , mCopyright(other.mCopyright)
     , mMusic(other.mMusic)
+    , mMusicEnabled(other.mMusicEnabled)
+    , mLevelsDir(other.mLevelsDir)
+    , mLevelCacheDir(other.mLevelCacheDir)
+    , mMusicFilename(other.mMusicFilename)
+    , mZipFilename(other.mZipFilename)
+    , mWallOutlines(other.mWallOutlines)
   {
     // ...
   }
@@ -127,42 +137,188 @@ namespace Impact {
   }
 
 
+  // moves a level loaded in the background into this one, leaving the other one empty;
+  // strings and vectors are swapped, so that neither tiles nor map data are copied
+  void Level::take(Level &other)
+  {
+    safeDelete(mMusic);
+    mMusic = other.mMusic;
+    other.mMusic = nullptr;
+    mSuccessfullyLoaded = other.mSuccessfullyLoaded;
+    other.mSuccessfullyLoaded = false;
+    mSHA1.swap(other.mSHA1);
+    mBackgroundImageOpacity = other.mBackgroundImageOpacity;
+    mBackgroundVisible = other.mBackgroundVisible;
+    mBackgroundColor = other.mBackgroundColor;
+    mBackgroundImage = other.mBackgroundImage;
+    other.mBackgroundImage = sf::Image();
+    mBackgroundTexture = other.mBackgroundTexture;
+    other.mBackgroundTexture = sf::Texture();
+    other.mBackgroundSprite = sf::Sprite();
+    setBackgroundSprite();
+    mLevelNum = other.mLevelNum;
+    other.mLevelNum = 0;
+    mMapData.swap(other.mMapData);
+    mNumTilesX = other.mNumTilesX;
+    mNumTilesY = other.mNumTilesY;
+    mTileWidth = other.mTileWidth;
+    mTileHeight = other.mTileHeight;
+    mFirstGID = other.mFirstGID;
+    mBoundary = other.mBoundary;
+    mGravity = other.mGravity;
+    mWallRestitution = other.mWallRestitution;
+    mExplosionParticlesCollideWithBall = other.mExplosionParticlesCollideWithBall;
+    mKillingsPerKillingSpree = other.mKillingsPerKillingSpree;
+    mKillingSpreeBonus = other.mKillingSpreeBonus;
+    mKillingSpreeInterval = other.mKillingSpreeInterval;
+    mBase62Name.swap(other.mBase62Name);
+    mName.swap(other.mName);
+    mInfo.swap(other.mInfo);
+    mCredits.swap(other.mCredits);
+    mAuthor.swap(other.mAuthor);
+    mCopyright.swap(other.mCopyright);
+    mMusicFilename.swap(other.mMusicFilename);
+    mZipFilename.swap(other.mZipFilename);
+    mTiles.swap(other.mTiles);
+    other.mTiles.clear();
+    mTileImages.swap(other.mTileImages);
+    other.mTileImages.clear();
+    mWallOutlines.swap(other.mWallOutlines);
+  }
+
+
+  // needs the OpenGL context, unlike loading the level
+  bool Level::uploadTextures(void)
+  {
+    bool ok = true;
+    for (std::vector<sf::Image>::size_type i = 0; i < mTileImages.size() && i < mTiles.size(); ++i) {
+      if (mTileImages.at(i).getSize().x > 0)
+        ok = mTiles.at(i).texture.loadFromImage(mTileImages.at(i)) && ok;
+    }
+    std::vector<sf::Image>().swap(mTileImages);
+    if (mBackgroundImage.getSize().x > 0) {
+      ok = mBackgroundTexture.loadFromImage(mBackgroundImage) && ok;
+      mBackgroundImage = sf::Image();
+      setBackgroundSprite();
+    }
+    return ok;
+  }
+
+
+  void Level::setBackgroundSprite(void)
+  {
+    mBackgroundSprite = sf::Sprite();
+    if (mBackgroundTexture.getSize().x > 0) {
+      mBackgroundSprite.setTexture(mBackgroundTexture, true);
+      mBackgroundSprite.setColor(sf::Color(255, 255, 255, sf::Uint8(mBackgroundImageOpacity * 0xff)));
+    }
+  }
+
+
   bool Level::calcSHA1(const std::string &filename)
   {
     std::ifstream is;
     is.open(filename, std::ios::binary);
     if (is.is_open()) {
-      is.seekg(0, std::ios::end);
-      int nBytes = int(is.tellg());
-      is.seekg(0, std::ios::beg);
-      char *buf = new char[nBytes];
-      is.read(buf, nBytes);
+      // the zip is hashed piece by piece while it's read, so it never has to fit in memory
+      static const std::size_t ChunkSize = 64 * 1024;
+      std::vector<char> buf(ChunkSize);
+      sha1::Hasher hasher;
+      while (is.read(buf.data(), ChunkSize) || is.gcount() > 0)
+        hasher.update(buf.data(), std::size_t(is.gcount()));
       is.close();
       unsigned char hash[20];
-      sha1::calc(buf, nBytes, hash);
-      std::stringstream strBuf;
-      for (int i = 0; i < 20; ++i)
-        strBuf << std::hex << std::setw(2) << std::setfill('0') << short(hash[i]);
-      mSHA1 = strBuf.str();
-      delete[] buf;
-      mBase62Name = base62_encode<boost::multiprecision::uint256_t>(reinterpret_cast<uint8_t*>(hash), sizeof(hash));
+      hasher.finish(hash);
+      char hexHash[41];
+      sha1::toHexString(hash, hexHash);
+      mSHA1 = hexHash;
+      mBase62Name = base62_encode(hash, sizeof(hash));
       return true;
     }
     return false;
   }
 
 
+  void Level::setPaths(const std::string &levelsDir, const std::string &levelCacheDir)
+  {
+    mLevelsDir = levelsDir;
+    mLevelCacheDir = levelCacheDir;
+  }
+
+
+  std::string Level::levelsDir(void) const
+  {
+    return mLevelsDir.empty() ? gLocalSettings().levelsDir() : mLevelsDir;
+  }
+
+
+  std::string Level::levelCacheDir(void) const
+  {
+    return mLevelCacheDir.empty() ? gLocalSettings().levelCacheDir() : mLevelCacheDir;
+  }
+
+
+  void Level::openMusic(const std::string &filename)
+  {
+    if (!mMusicEnabled)
+      return;
+    mMusic = new sf::Music;
+    if (mMusic != nullptr) {
+      mMusicFilename = filename;
+      bool musicLoaded = mMusic->openFromFile(mMusicFilename);
+      // the volume is set when the music starts to play, as levels
+      // may be loaded on threads that must not read the local settings
+      if (musicLoaded)
+        mMusic->setLoop(true);
+    }
+  }
+
+
   void Level::load(void)
   {
     std::string levelFilename;
     std::ostringstream levelStrBuf;
     levelStrBuf << std::setw(4) << std::setfill('0') << mLevelNum;
     const std::string levelStr = levelStrBuf.str();
-    levelFilename = gLocalSettings().levelsDir() + "/" + levelStr + ".zip";
+    levelFilename = levelsDir() + "/" + levelStr + ".zip";
     loadZip(levelFilename);
   }
 
 
+#if defined(LINUX_AMD64)
+  // extracts by path rather than after a chdir(), which would pull the
+  // working directory from under the other threads, e.g. while the next
+  // level is loaded in the background
+  static bool extractCurrentFile(unzFile hz, const std::string &filename)
+  {
+    if (boost::algorithm::ends_with(filename, "/"))
+      return true;
+    if (unzOpenCurrentFile(hz) != UNZ_OK)
+      return false;
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    bool ok = out.is_open();
+    char buf[16 * 1024];
+    int n = 0;
+    while (ok && (n = unzReadCurrentFile(hz, buf, sizeof(buf))) > 0) {
+      out.write(buf, n);
+      ok = out.good();
+    }
+    unzCloseCurrentFile(hz);
+    return ok && n == 0;
+  }
+#endif
+
+
+  std::shared_ptr<std::mutex> Level::extractMutex(const std::string &levelPath)
+  {
+    std::lock_guard<std::mutex> lock(sExtractMutex);
+    std::shared_ptr<std::mutex> &dirMutex = sExtractDirMutexes[levelPath];
+    if (!dirMutex)
+      dirMutex.reset(new std::mutex);
+    return dirMutex;
+  }
+
+
 #pragma warning(disable : 4503)
   void Level::loadZip(const std::string &zipFilename)
   {
@@ -173,6 +329,8 @@ namespace Impact {
     std::string levelFilename;
 
     safeDelete(mMusic);
+    mMusicFilename.clear();
+    mZipFilename = zipFilename;
 
 #if defined(WIN32)
     char szPath[MAX_PATH];
@@ -195,10 +353,32 @@ namespace Impact {
     std::cout << "LEVEL NAME: " << mName << std::endl;
 #endif
 
+    // a level compiled before is loaded straight from the cache
+    mSHA1.clear();
+    mBase62Name.clear();
+    calcSHA1(zipFilename);
+    const std::string &compiledFilename = levelCacheDir() + "/" + mSHA1 + ".lvl";
+    if (!mSHA1.empty() && readCompiled(compiledFilename)) {
+      mSuccessfullyLoaded = true;
+#ifndef NDEBUG
+      std::cout << "Level loaded from " << compiledFilename << std::endl;
+#endif
+      return;
+    }
+
+    // only loads of the same level have to wait for each other, and
+    // when they're done waiting the level is usually in the cache
+    levelPath = levelsDir() + "/" + mName;
+    std::shared_ptr<std::mutex> dirMutex = extractMutex(levelPath);
+    std::lock_guard<std::mutex> lock(*dirMutex);
+    if (!mSHA1.empty() && readCompiled(compiledFilename)) {
+      mSuccessfullyLoaded = true;
+      return;
+    }
+
 #if defined(WIN32)
     HZIP hz = OpenZip(zipFilename.c_str(), nullptr);
     if (hz) {
-      levelPath = gLocalSettings().levelsDir() + "/" + mName;
       SetUnzipBaseDir(hz, levelPath.c_str());
       ZIPENTRY ze;
       GetZipItem(hz, -1, &ze);
@@ -211,59 +391,34 @@ namespace Impact {
           levelFilename = levelPath + "/" + currentItemName;
         }
         else if (boost::algorithm::ends_with(currentItemName, ".ogg")) {
-          mMusic = new sf::Music;
-          if (mMusic != nullptr) {
-            bool musicLoaded = mMusic->openFromFile(levelPath + "/" + currentItemName);
-            if (musicLoaded) {
-              mMusic->setLoop(true);
-              mMusic->setVolume(gLocalSettings().musicVolume());
-            }
-          }
+          openMusic(levelPath + "/" + currentItemName);
         }
       }
       CloseZip(hz);
-      calcSHA1(zipFilename);
     }
 #elif defined(LINUX_AMD64)
     unzFile hz = unzOpen(zipFilename.c_str());
     if (hz) {
-      int rc;
-      levelPath = gLocalSettings().levelsDir() + "/" + mName;
-      char curwd[MAX_PATH];
-      const char *path = getcwd(curwd, MAX_PATH);
       mkdir(levelPath.c_str(), 0775);
-      rc = chdir(levelPath.c_str());
-      if (rc != 0)
-        return;
       unz_global_info gInfo;
       unzGetGlobalInfo(hz, &gInfo);
       int nItems = gInfo.number_entry;
-      int extractWithoutPath = 0;
-      int extractOverwrite = 1;
       for (int i = 0; i < nItems; ++i) {
         char zeName[MAX_PATH];
         unz_file_info fi;
         unzGetCurrentFileInfo(hz, &fi, zeName, MAX_PATH, NULL, 0, NULL, 0);
-        do_extract_currentfile(hz, &extractWithoutPath, &extractOverwrite, NULL);
         std::string currentItemName = zeName;
+        extractCurrentFile(hz, levelPath + "/" + currentItemName);
         if (boost::algorithm::ends_with(currentItemName, ".tmx")) {
           levelFilename = levelPath + "/" + currentItemName;
         }
         else if (boost::algorithm::ends_with(currentItemName, ".ogg")) {
-          mMusic = new sf::Music;
-          if (mMusic != nullptr) {
-            bool musicLoaded = mMusic->openFromFile(levelPath + "/" + currentItemName);
-            if (musicLoaded) {
-              mMusic->setLoop(true);
-              mMusic->setVolume(gLocalSettings().musicVolume());
-            }
-          }
+          openMusic(levelPath + "/" + currentItemName);
         }
         if ((i+1)<nItems) {
           unzGoToNextFile(hz);
         }
       }
-      rc = chdir(curwd);
       unzClose(hz);
   }
 #endif
@@ -272,264 +427,743 @@ namespace Impact {
     if (!ok)
       return;
 
-    mBackgroundImageOpacity = 1.f;
-    boost::property_tree::ptree pt;
-    try {
-      boost::property_tree::xml_parser::read_xml(levelFilename, pt);
+    ok = readTmx(levelFilename, levelPath);
+    if (ok) {
+      traceWalls();
+      if (!mSHA1.empty())
+        writeCompiled(compiledFilename);
     }
-    catch (const boost::property_tree::xml_parser::xml_parser_error &ex) {
-      std::cerr << "XML parser error: " << ex.what() << " (line " << ex.line() << ")" << std::endl;
-      ok = false;
+
+    mSuccessfullyLoaded = ok;
+#ifndef NDEBUG
+    std::cout << "Level " << (mSuccessfullyLoaded ? "loaded." : "NOT loaded.") << std::endl;
+    if (mSuccessfullyLoaded)
+      std::cout <<
+      "            _\n"
+      "           /(|\n"
+      "          (  :\n"
+      "         __\\  \\  _____\n"
+      "       (____)  `|\n"
+      "      (____)|   |\n"
+      "       (____).__|\n"
+      "        (___)__.|_____\n"
+      << std::endl;
+#endif
+  }
+
+
+  static bool readCsvMapData(const XmlReader::Range &csv, std::vector<uint32_t> &mapData)
+  {
+    std::vector<uint32_t>::size_type i = 0;
+    const char *p = csv.begin;
+    while (p < csv.end) {
+      while (p < csv.end && (*p == ',' || *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+        ++p;
+      if (p == csv.end)
+        break;
+      if (*p < '0' || *p > '9' || i == mapData.size())
+        return false;
+      uint32_t gid = 0;
+      while (p < csv.end && *p >= '0' && *p <= '9')
+        gid = 10 * gid + uint32_t(*p++ - '0');
+      mapData[i++] = gid;
     }
+    return i == mapData.size();
+  }
 
-    if (!ok)
-      return;
 
-    try { // evaluate level properties
-      mMapData.clear();
-      mGravity = DefaultGravity;
-      mWallRestitution = DefaultWallRestitution;
-      mCredits = std::string();
-      mAuthor = std::string();
-      mCopyright = std::string();
-      mInfo = std::string();
-      mBackgroundColor = sf::Color::Black;
-      mKillingsPerKillingSpree = Game::DefaultKillingsPerKillingSpree;
-      mKillingSpreeBonus = Game::DefaultKillingSpreeBonus;
-      mKillingSpreeInterval = Game::DefaultKillingSpreeInterval;
-      mExplosionParticlesCollideWithBall = false;
-      const boost::property_tree::ptree &layerProperties = pt.get_child("map.properties");
-      boost::property_tree::ptree::const_iterator pi;
-      for (pi = layerProperties.begin(); pi != layerProperties.end(); ++pi) {
-        boost::property_tree::ptree property = pi->second;
-        if (pi->first == "property") {
-          std::string propName = property.get<std::string>("<xmlattr>.name");
-          boost::algorithm::to_lower(propName);
-          if (propName == "credits") {
-            mCredits = property.get<std::string>("<xmlattr>.value", std::string());
-          }
-          else if (propName == "author") {
-            mAuthor = property.get<std::string>("<xmlattr>.value", std::string());
-          }
-          else if (propName == "copyright") {
-            mCopyright = property.get<std::string>("<xmlattr>.value", std::string());
-          }
-          else if (propName == "name") {
-            mName = property.get<std::string>("<xmlattr>.value", std::string());
-          }
-          else if (propName == "gravity") {
-            mGravity = property.get<float32>("<xmlattr>.value", 9.81f);
-          }
-          else if (propName == "wallrestitution") {
-            mWallRestitution = property.get<float32>("<xmlattr>.value", 1.f);
-          } 
-          else if (propName == "explosionparticlescollidewithball") {
-            mExplosionParticlesCollideWithBall = property.get<bool>("<xmlattr>.value", false);
-          }
-          else if (propName == "killingspreebonus") {
-            mKillingSpreeBonus = property.get<int>("<xmlattr>.value", Game::DefaultKillingSpreeBonus);
-          }
-          else if (propName == "killingspreeinterval") {
-            mKillingSpreeInterval = sf::milliseconds(property.get<int>("<xmlattr>.value", Game::DefaultKillingSpreeInterval.asMilliseconds()));
-          }
-          else if (propName == "killingsperkillingspree") {
-            mKillingsPerKillingSpree = property.get<int>("<xmlattr>.value", Game::DefaultKillingsPerKillingSpree);
+  static bool decodeMapData(const XmlReader::Range &base64, std::vector<uint32_t> &mapData)
+  {
+    const char *in = base64.begin;
+    Base64Decoder decoder;
+    const std::size_t size = mapData.size() * sizeof(uint32_t);
+    const std::size_t decodedSize = decoder.decode(in, base64.end, reinterpret_cast<uint8_t*>(mapData.data()), size);
+    uint8_t excess;
+    if (decoder.failed() || decodedSize != size || decoder.decode(in, base64.end, &excess, 1) != 0) {
+      std::cerr << "Error parsing TMX file: map data has the wrong size" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+
+  static bool inflateMapData(const XmlReader::Range &base64, std::vector<uint32_t> &mapData)
+  {
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+    // 15 + 32: maximum window size, detect zlib or gzip header automatically
+    int rc = inflateInit2(&stream, 15 + 32);
+    if (rc == Z_OK) {
+      stream.next_out = reinterpret_cast<Bytef*>(mapData.data());
+      stream.avail_out = uInt(mapData.size() * sizeof(uint32_t));
+      // decode the base64 text a chunk at a time and inflate straight into the map
+      const char *in = base64.begin;
+      Base64Decoder decoder;
+      uint8_t chunk[16 * 1024];
+      while (rc == Z_OK) {
+        if (stream.avail_in == 0) {
+          stream.next_in = chunk;
+          stream.avail_in = uInt(decoder.decode(in, base64.end, chunk, sizeof(chunk)));
+          if (stream.avail_in == 0) {
+            rc = Z_BUF_ERROR;
+            break;
           }
         }
+        rc = inflate(&stream, Z_NO_FLUSH);
       }
-    } catch (boost::property_tree::ptree_error &e) { UNUSED(e); }
-
-    try {
-      const std::string &mapDataB64 = pt.get<std::string>("map.layer.data");
-      mTileWidth = pt.get<int>("map.<xmlattr>.tilewidth");
-      mTileHeight = pt.get<int>("map.<xmlattr>.tileheight");
-      mNumTilesX = pt.get<int>("map.<xmlattr>.width");
-      mNumTilesY = pt.get<int>("map.<xmlattr>.height");
-      try {
-        std::string bgColor = pt.get<std::string>("map.<xmlattr>.backgroundcolor");
-        int r = 0, g = 0, b = 0;
-        if (bgColor.size() == 7 && bgColor[0] == '#') {
-          bgColor.erase(0, 1);
-          const uint32_t rgb = std::stoul(bgColor, 0, 16);
-          r = (rgb >> 16) & 0xff;
-          g = (rgb >> 8) & 0xff;
-          b = rgb & 0xff;
-          mBackgroundColor = sf::Color(r, g, b, 255);
+      inflateEnd(&stream);
+      if (decoder.failed())
+        rc = Z_DATA_ERROR;
+    }
+    if (rc == Z_STREAM_END) {
+      if (stream.avail_out == 0)
+        return true;
+      std::cerr << "Inflating map data failed: map data too short" << std::endl;
+    }
+    else if (rc == Z_DATA_ERROR)
+      std::cerr << "Inflating map data failed: Z_DATA_ERROR" << std::endl;
+    else if (rc == Z_MEM_ERROR)
+      std::cerr << "Inflating map data failed: Z_MEM_ERROR" << std::endl;
+    else if (rc == Z_BUF_ERROR)
+      std::cerr << "Inflating map data failed: Z_BUF_ERROR " << std::endl;
+    else
+      std::cerr << "Inflating map data failed with error code " << rc << std::endl;
+    return false;
+  }
+
+
+  static void readTileProperty(const XmlReader &xml, TileParam &tileParam)
+  {
+    std::string propName;
+    if (!xml.attribute("name", propName))
+      return;
+    boost::algorithm::to_lower(propName);
+    if (propName == "name") {
+      xml.attribute("value", tileParam.textureName);
+    }
+    //MOD Property1
+    else if (propName == "points") {
+      tileParam.score = xml.attribute<int64_t>("value", 0);
+    }
+    else if (propName == "fixed") {
+      tileParam.fixed = xml.attribute<bool>("value", false);
+    }
+    //MOD Property2
+    else if (propName == "friction") {
+      tileParam.friction = xml.attribute<float32>("value", .5f);
+    }
+    else if (propName == "lineardamping") {
+      tileParam.linearDamping = xml.attribute<float32>("value", 5.f);
+    }
+    else if (propName == "angulardamping") {
+      tileParam.angularDamping = xml.attribute<float32>("value", .4f);
+    }
+    else if (propName == "restitution") {
+      tileParam.restitution = xml.attribute<float32>("value", 1.f);
+    }
+    else if (propName == "density") {
+      tileParam.density = xml.attribute<float32>("value", 20.f);
+    }
+    else if (propName == "gravityscale") {
+      tileParam.gravityScale = xml.attribute<float32>("value", 1.f);
+    }
+    else if (propName == "scalegravityby") {
+      tileParam.scaleGravityBy = xml.attribute<float32>("value", 0.f);
+    }
+    else if (propName == "scalegravityseconds") {
+      tileParam.scaleGravityDuration = sf::seconds(xml.attribute<float32>("value", 0.f));
+    }
+    else if (propName == "scaleballdensityby") {
+      tileParam.scaleBallDensityBy = xml.attribute<float32>("value", 0.f);
+    }
+    else if (propName == "scaleballdensityseconds") {
+      tileParam.scaleBallDensityDuration = sf::seconds(xml.attribute<float32>("value", 0.f));
+    }
+    else if (propName == "minimumhitimpulse") {
+      tileParam.minimumHitImpulse = xml.attribute<int>("value", 5);
+    }
+    else if (propName == "minimumkillimpulse") {
+      tileParam.minimumKillImpulse = xml.attribute<int>("value", 50);
+    }
+    else if (propName == "smooth") {
+      tileParam.smooth = xml.attribute<bool>("value", true);
+    }
+    else if (propName == "earthquakeseconds") {
+      tileParam.earthquakeDuration = sf::seconds(xml.attribute<float32>("value", 0.f));
+    }
+    else if (propName == "earthquakeintensity") {
+      tileParam.earthquakeIntensity = .05f * xml.attribute<float32>("value", 0.f);
+    }
+    else if (propName == "impulse") {
+      tileParam.bumperImpulse = xml.attribute<float32>("value", 20.f);
+    }
+    else if (propName == "multiball") {
+      tileParam.multiball = xml.attribute<bool>("value", false);
+    }
+    else if (propName == "shape") {
+      tileParam.shapeType = xml.attribute<BodyShapeType>("value", BodyShapeType::CircleShape);
+    }
+  }
+
+
+  bool Level::readTmx(const std::string &tmxFilename, const std::string &levelPath)
+  {
+    XmlReader xml;
+    if (!xml.open(tmxFilename)) {
+      std::cerr << "XML parser error: " << xml.errorString() << std::endl;
+      return false;
+    }
+
+    mBackgroundImageOpacity = 1.f;
+    mBackgroundVisible = true;
+    mBackgroundImage = sf::Image();
+    mBackgroundTexture = sf::Texture();
+    mBackgroundSprite = sf::Sprite();
+    mMapData.clear();
+    mWallOutlines.clear();
+    mTiles.clear();
+    mTileImages.clear();
+    mBoundary = Boundary();
+    mGravity = DefaultGravity;
+    mWallRestitution = DefaultWallRestitution;
+    mCredits = std::string();
+    mAuthor = std::string();
+    mCopyright = std::string();
+    mInfo = std::string();
+    mBackgroundColor = sf::Color::Black;
+    mKillingsPerKillingSpree = Game::DefaultKillingsPerKillingSpree;
+    mKillingSpreeBonus = Game::DefaultKillingSpreeBonus;
+    mKillingSpreeInterval = Game::DefaultKillingSpreeInterval;
+    mExplosionParticlesCollideWithBall = false;
+
+    if (!xml.readNextChild(0) || xml.name() != "map") {
+      std::cerr << "Error parsing TMX file: <map> expected (line " << xml.line() << ")" << std::endl;
+      return false;
+    }
+    mTileWidth = xml.attribute<int>("tilewidth", 0);
+    mTileHeight = xml.attribute<int>("tileheight", 0);
+    mNumTilesX = xml.attribute<int>("width", 0);
+    mNumTilesY = xml.attribute<int>("height", 0);
+    if (mTileWidth <= 0 || mTileHeight <= 0 || mNumTilesX <= 0 || mNumTilesY <= 0) {
+      std::cerr << "Error parsing TMX file: invalid map size (line " << xml.line() << ")" << std::endl;
+      return false;
+    }
+    std::string bgColor;
+    if (xml.attribute("backgroundcolor", bgColor) && bgColor.size() == 7 && bgColor[0] == '#') {
+      const uint32_t rgb = std::strtoul(bgColor.c_str() + 1, nullptr, 16);
+      mBackgroundColor = sf::Color((rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff, 255);
+    }
+
+    bool haveTileset = false;
+    bool haveLayer = false;
+    bool haveImageLayer = false;
+    bool haveObjectGroup = false;
+    const int mapDepth = xml.depth();
+    while (xml.readNextChild(mapDepth)) {
+      const XmlReader::Range &name = xml.name();
+      if (name == "properties") {
+        const int depth = xml.depth();
+        while (xml.readNextChild(depth)) {
+          if (xml.name() == "property")
+            readMapProperty(xml);
         }
-      } catch (boost::property_tree::ptree_error &e) { UNUSED(e); }
-
-      uint8_t *compressed = nullptr;
-      uLong compressedSize = 0UL;
-      base64_decode(mapDataB64, compressed, compressedSize);
-      if (compressed != nullptr && compressedSize > 0) {
-        static const size_t CHUNKSIZE = 128 * 1024; // sizeof(uint32_t) * Game::DefaultPlaygroundWidth * Game::DefaultPlaygroundHeight;
-        uint32_t *mapData = new uint32_t[CHUNKSIZE / sizeof(uint32_t)];
-        if (mapData != nullptr) {
-          uLongf mapDataSize = CHUNKSIZE;
-          int rc = uncompress(reinterpret_cast<Bytef*>(mapData), &mapDataSize, reinterpret_cast<Bytef*>(compressed), compressedSize);
-          if (rc == Z_OK) {
-            for (uLongf i = 0; i < mapDataSize; ++i) {
-              mMapData.push_back(*(mapData + i));
-            }
-            delete [] mapData;
-          }
-          else {
-            ok = false;
-            if (rc == Z_DATA_ERROR)
-              std::cerr << "Inflating map data failed: Z_DATA_ERROR" << std::endl;
-            else if (rc == Z_MEM_ERROR)
-              std::cerr << "Inflating map data failed: Z_MEM_ERROR" << std::endl;
-            else if (rc == Z_BUF_ERROR)
-              std::cerr << "Inflating map data failed: Z_BUF_ERROR " << std::endl;
-            else
-              std::cerr << "Inflating map data failed with error code " << rc << std::endl;
+      }
+      else if (name == "tileset" && !haveTileset) {
+        haveTileset = true;
+        if (!readTileset(xml, levelPath))
+          return false;
+      }
+      else if (name == "layer" && !haveLayer) {
+        haveLayer = true;
+        if (!readLayer(xml))
+          return false;
+      }
+      else if (name == "imagelayer" && !haveImageLayer) {
+        haveImageLayer = true;
+        readImageLayer(xml, levelPath);
+      }
+      else if (name == "objectgroup" && !haveObjectGroup) {
+        haveObjectGroup = true;
+        readObjectGroup(xml);
+      }
+    }
+
+    if (xml.hasError()) {
+      std::cerr << "XML parser error: " << xml.errorString() << " (line " << xml.line() << ")" << std::endl;
+      return false;
+    }
+    if (!haveTileset || !haveLayer) {
+      std::cerr << "Error parsing TMX file: map without tileset or layer" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+
+  void Level::readMapProperty(const XmlReader &xml)
+  {
+    std::string propName;
+    if (!xml.attribute("name", propName))
+      return;
+    boost::algorithm::to_lower(propName);
+    if (propName == "credits") {
+      mCredits = xml.attribute<std::string>("value", std::string());
+    }
+    else if (propName == "author") {
+      mAuthor = xml.attribute<std::string>("value", std::string());
+    }
+    else if (propName == "copyright") {
+      mCopyright = xml.attribute<std::string>("value", std::string());
+    }
+    else if (propName == "name") {
+      mName = xml.attribute<std::string>("value", std::string());
+    }
+    else if (propName == "gravity") {
+      mGravity = xml.attribute<float32>("value", 9.81f);
+    }
+    else if (propName == "wallrestitution") {
+      mWallRestitution = xml.attribute<float32>("value", 1.f);
+    }
+    else if (propName == "explosionparticlescollidewithball") {
+      mExplosionParticlesCollideWithBall = xml.attribute<bool>("value", false);
+    }
+    else if (propName == "killingspreebonus") {
+      mKillingSpreeBonus = xml.attribute<int>("value", Game::DefaultKillingSpreeBonus);
+    }
+    else if (propName == "killingspreeinterval") {
+      mKillingSpreeInterval = sf::milliseconds(xml.attribute<int>("value", Game::DefaultKillingSpreeInterval.asMilliseconds()));
+    }
+    else if (propName == "killingsperkillingspree") {
+      mKillingsPerKillingSpree = xml.attribute<int>("value", Game::DefaultKillingsPerKillingSpree);
+    }
+  }
+
+
+  bool Level::readTileset(XmlReader &xml, const std::string &levelPath)
+  {
+    if (xml.attribute("firstgid") == nullptr) {
+      std::cerr << "Error parsing TMX file: tileset without firstgid (line " << xml.line() << ")" << std::endl;
+      return false;
+    }
+    mFirstGID = xml.attribute<uint32_t>("firstgid", 0);
+    mTiles.resize(mFirstGID);
+    mTileImages.resize(mFirstGID);
+    const int tilesetDepth = xml.depth();
+    while (xml.readNextChild(tilesetDepth)) {
+      if (xml.name() != "tile")
+        continue;
+      if (xml.attribute("id") == nullptr) {
+        std::cerr << "Error parsing TMX file: tile without id (line " << xml.line() << ")" << std::endl;
+        return false;
+      }
+      const int id = int(mFirstGID) + xml.attribute<int>("id", 0);
+      TileParam tileParam;
+      sf::Image image;
+      std::string imageSource;
+      const int tileDepth = xml.depth();
+      while (xml.readNextChild(tileDepth)) {
+        if (xml.name() == "image") {
+          xml.attribute("source", imageSource);
+        }
+        else if (xml.name() == "properties") {
+          const int depth = xml.depth();
+          while (xml.readNextChild(depth)) {
+            if (xml.name() == "property")
+              readTileProperty(xml, tileParam);
           }
         }
-        delete[] compressed;
       }
+      if (xml.hasError())
+        break;
+      if (imageSource.empty() || !image.loadFromFile(levelPath + "/" + imageSource))
+        return false;
+      if (!tileParam.fixed.isValid())
+        tileParam.fixed = (tileParam.textureName == Wall::Name) || (tileParam.textureName == Bumper::Name);
+      if (id >= int(mTiles.size())) {
+        mTiles.resize(id + 1);
+        mTileImages.resize(id + 1);
+      }
+      mTiles[id] = tileParam;
+      mTileImages[id] = image;
+    }
+    return !xml.hasError();
+  }
 
-      if (!ok)
-        return;
-
-      try {
-        mBackgroundVisible = pt.get<bool>("map.layer.imagelayer.<xmlattr>.visible", true);
-        if (mBackgroundVisible) {
-          const std::string &backgroundTextureFilename = levelPath + "/" + pt.get<std::string>("map.imagelayer.image.<xmlattr>.source");
-          mBackgroundTexture.loadFromFile(backgroundTextureFilename);
-          mBackgroundSprite.setTexture(mBackgroundTexture);
-          mBackgroundImageOpacity = pt.get<float>("map.imagelayer.<xmlattr>.opacity", 1.f);
-          mBackgroundSprite.setColor(sf::Color(255, 255, 255, sf::Uint8(mBackgroundImageOpacity * 0xff)));
-        }
+
+  bool Level::readLayer(XmlReader &xml)
+  {
+    const int layerDepth = xml.depth();
+    while (xml.readNextChild(layerDepth)) {
+      if (xml.name() != "data")
+        continue;
+      std::string encoding;
+      std::string compression;
+      xml.attribute("encoding", encoding);
+      xml.attribute("compression", compression);
+      if (xml.next() != XmlReader::Text) {
+        std::cerr << "Error parsing TMX file: empty map data (line " << xml.line() << ")" << std::endl;
+        return false;
       }
-      catch (boost::property_tree::ptree_error &e) { UNUSED(e); }
-
-      mBoundary = Boundary();
-      try {
-        const boost::property_tree::ptree &object = pt.get_child("map.objectgroup.object");
-        mBoundary.left = object.get<int>("<xmlattr>.x");
-        mBoundary.top = object.get<int>("<xmlattr>.y");
-        mBoundary.right = mBoundary.left + object.get<int>("<xmlattr>.width");
-        mBoundary.bottom = mBoundary.top + object.get<int>("<xmlattr>.height");
-        mBoundary.valid = true;
-      } catch (boost::property_tree::ptree_error &e) { UNUSED(e); }
-
-      const boost::property_tree::ptree &tileset = pt.get_child("map.tileset");
-      mFirstGID = tileset.get<uint32_t>("<xmlattr>.firstgid");
-      mTiles.resize(tileset.count("tile") + mFirstGID);
-      boost::property_tree::ptree::const_iterator ti;
-      for (ti = tileset.begin(); ti != tileset.end(); ++ti) {
-        boost::property_tree::ptree tile = ti->second;
-        if (ti->first == "tile") {
-          const int id = mFirstGID + tile.get<int>("<xmlattr>.id");
-          mTiles.resize(id + 1);
-          TileParam tileParam;
-          const std::string &filename = levelPath + "/" + tile.get<std::string>("image.<xmlattr>.source");
-          ok = tileParam.texture.loadFromFile(filename);
-          if (!ok)
-            return;
-          const boost::property_tree::ptree &tileProperties = tile.get_child("properties");
-          boost::property_tree::ptree::const_iterator pi;
-          for (pi = tileProperties.begin(); pi != tileProperties.end(); ++pi) {
-            boost::property_tree::ptree property = pi->second;
-            if (pi->first == "property") {
-              try {
-                std::string propName = property.get<std::string>("<xmlattr>.name");
-                boost::algorithm::to_lower(propName);
-                if (propName == "name") {
-                  tileParam.textureName = property.get<std::string>("<xmlattr>.value");
-                }
-                //MOD Property1
-                else if (propName == "points") {
-                  tileParam.score = property.get<int64_t>("<xmlattr>.value", 0);
-                }
-                else if (propName == "fixed") {
-                  tileParam.fixed = property.get<bool>("<xmlattr>.value", false);
-                }
-                //MOD Property2
-                else if (propName == "friction") {
-                  tileParam.friction = property.get<float32>("<xmlattr>.value", .5f);
-                }
-                else if (propName == "lineardamping") {
-                  tileParam.linearDamping = property.get<float32>("<xmlattr>.value", 5.f);
-                }
-                else if (propName == "angulardamping") {
-                  tileParam.angularDamping = property.get<float32>("<xmlattr>.value", .4f);
-                }
-                else if (propName == "restitution") {
-                  tileParam.restitution = property.get<float32>("<xmlattr>.value", 1.f);
-                }
-                else if (propName == "density") {
-                  tileParam.density = property.get<float32>("<xmlattr>.value", 20.f);
-                }
-                else if (propName == "gravityscale") {
-                  tileParam.gravityScale = property.get<float32>("<xmlattr>.value", 1.f);
-                }
-                else if (propName == "scalegravityby") {
-                  tileParam.scaleGravityBy = property.get<float32>("<xmlattr>.value", 0.f);
-                }
-                else if (propName == "scalegravityseconds") {
-                  tileParam.scaleGravityDuration = sf::seconds(property.get<float32>("<xmlattr>.value", 0.f));
-                }
-                else if (propName == "scaleballdensityby") {
-                  tileParam.scaleBallDensityBy = property.get<float32>("<xmlattr>.value", 0.f);
-                }
-                else if (propName == "scaleballdensityseconds") {
-                  tileParam.scaleBallDensityDuration = sf::seconds(property.get<float32>("<xmlattr>.value", 0.f));
-                }
-                else if (propName == "minimumhitimpulse") {
-                  tileParam.minimumHitImpulse = property.get<int>("<xmlattr>.value", 5);
-                }
-                else if (propName == "minimumkillimpulse") {
-                  tileParam.minimumKillImpulse = property.get<int>("<xmlattr>.value", 50);
-                }
-                else if (propName == "smooth") {
-                  tileParam.smooth = property.get<bool>("<xmlattr>.value", true);
-                }
-                else if (propName == "earthquakeseconds") {
-                  tileParam.earthquakeDuration = sf::seconds(property.get<float32>("<xmlattr>.value", 0));
-                }
-                else if (propName == "earthquakeintensity") {
-                  tileParam.earthquakeIntensity = .05f * property.get<float32>("<xmlattr>.value", 0.f) ;
-                }
-                else if (propName == "impulse") {
-                  tileParam.bumperImpulse = property.get<float32>("<xmlattr>.value", 20.f);
-                }
-                else if (propName == "multiball") {
-                  tileParam.multiball = property.get<bool>("<xmlattr>.value", false);
-                }
-                else if (propName == "shape") {
-                  tileParam.shapeType = property.get<BodyShapeType>("<xmlattr>.value", BodyShapeType::CircleShape);
-                }
-              }
-              catch (boost::property_tree::ptree_error &e) { UNUSED(e); }
-            }
-          }
-          if (!tileParam.fixed.isValid())
-            tileParam.fixed = (tileParam.textureName == Wall::Name) || (tileParam.textureName == Bumper::Name);
-          mTiles[id] = tileParam;
+      mMapData.assign(std::size_t(mNumTilesX) * std::size_t(mNumTilesY), 0);
+      if (encoding == "csv") {
+        if (!readCsvMapData(xml.text(), mMapData)) {
+          std::cerr << "Error parsing TMX file: malformed CSV map data" << std::endl;
+          return false;
         }
+        return true;
+      }
+      if (encoding != "base64") {
+        std::cerr << "Error parsing TMX file: unsupported map encoding '" << encoding << "'" << std::endl;
+        return false;
       }
+      if (compression == "zlib" || compression == "gzip")
+        return inflateMapData(xml.text(), mMapData);
+      if (compression.empty())
+        return decodeMapData(xml.text(), mMapData);
+      std::cerr << "Error parsing TMX file: unsupported map compression '" << compression << "'" << std::endl;
+      return false;
+    }
+    std::cerr << "Error parsing TMX file: layer without data" << std::endl;
+    return false;
+  }
+
+
+  void Level::readImageLayer(XmlReader &xml, const std::string &levelPath)
+  {
+    mBackgroundVisible = xml.attribute<bool>("visible", true);
+    const float opacity = xml.attribute<float>("opacity", 1.f);
+    std::string imageSource;
+    const int depth = xml.depth();
+    while (xml.readNextChild(depth)) {
+      if (xml.name() == "image")
+        xml.attribute("source", imageSource);
     }
-    catch (boost::property_tree::ptree_error &e) {
-      std::cerr << "Error parsing TMX file: " << e.what() << std::endl;
-      ok = false;
+    if (mBackgroundVisible && !imageSource.empty()) {
+      mBackgroundImage.loadFromFile(levelPath + "/" + imageSource);
+      mBackgroundImageOpacity = opacity;
     }
+  }
 
-    mSuccessfullyLoaded = ok;
-#ifndef NDEBUG
-    std::cout << "Level " << (mSuccessfullyLoaded ? "loaded." : "NOT loaded.") << std::endl;
-    if (mSuccessfullyLoaded)
-      std::cout <<
-      "            _\n"
-      "           /(|\n"
-      "          (  :\n"
-      "         __\\  \\  _____\n"
-      "       (____)  `|\n"
-      "      (____)|   |\n"
-      "       (____).__|\n"
-      "        (___)__.|_____\n"
-      << std::endl;
+
+  void Level::readObjectGroup(XmlReader &xml)
+  {
+    if (!xml.readNextChild(xml.depth()) || xml.name() != "object")
+      return;
+    const XmlReader::Range *x = xml.attribute("x");
+    const XmlReader::Range *y = xml.attribute("y");
+    const XmlReader::Range *width = xml.attribute("width");
+    const XmlReader::Range *height = xml.attribute("height");
+    if (x == nullptr || y == nullptr || width == nullptr || height == nullptr)
+      return;
+    mBoundary.left = XmlReader::convert<int>(x->str(), 0);
+    mBoundary.top = XmlReader::convert<int>(y->str(), 0);
+    mBoundary.right = mBoundary.left + XmlReader::convert<int>(width->str(), 0);
+    mBoundary.bottom = mBoundary.top + XmlReader::convert<int>(height->str(), 0);
+    mBoundary.valid = true;
+  }
+
+
+  template <typename T>
+  static void putDynamicValue(LevelCacheWriter &out, const DynamicValue<T> &value)
+  {
+    out.put(uint8_t(value.isValid() ? 1 : 0));
+    if (value.isValid())
+      out.put(value.get());
+  }
+
+
+  template <typename T>
+  static bool getDynamicValue(LevelCacheReader &in, DynamicValue<T> &value)
+  {
+    uint8_t valid = 0;
+    if (!in.get(valid))
+      return false;
+    if (valid) {
+      T v;
+      if (!in.get(v))
+        return false;
+      value = v;
+    }
+    return true;
+  }
+
+
+  static void putTime(LevelCacheWriter &out, const sf::Time &t)
+  {
+    out.put(int64_t(t.asMicroseconds()));
+  }
+
+
+  static bool getTime(LevelCacheReader &in, sf::Time &t)
+  {
+    int64_t us = 0;
+    if (!in.get(us))
+      return false;
+    t = sf::microseconds(us);
+    return true;
+  }
+
+
+  static void putImage(LevelCacheWriter &out, const sf::Image &image)
+  {
+    const sf::Vector2u &size = image.getSize();
+    out.put(uint32_t(size.x));
+    out.put(uint32_t(size.y));
+    out.putBytes(image.getPixelsPtr(), std::size_t(4) * size.x * size.y);
+  }
+
+
+  static bool getImage(LevelCacheReader &in, sf::Image &image)
+  {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    if (!in.get(width) || !in.get(height))
+      return false;
+    const uint8_t *pixels = in.take(std::size_t(4) * width * height);
+    if (pixels == nullptr)
+      return false;
+    if (width == 0 || height == 0)
+      return true;
+    image.create(width, height, pixels);
+    return true;
+  }
+
+
+  bool Level::writeCompiled(const std::string &filename) const
+  {
+    LevelCacheWriter out;
+    out.putString(mSHA1);
+    out.putString(mName);
+    out.putString(mCredits);
+    out.putString(mAuthor);
+    out.putString(mCopyright);
+    out.putString(mInfo);
+    out.putString(mMusicFilename);
+    out.put(mGravity);
+    out.put(mWallRestitution);
+    out.put(uint8_t(mExplosionParticlesCollideWithBall ? 1 : 0));
+    out.put(int32_t(mKillingsPerKillingSpree));
+    out.put(int32_t(mKillingSpreeBonus));
+    putTime(out, mKillingSpreeInterval);
+    out.put(mBackgroundColor.r);
+    out.put(mBackgroundColor.g);
+    out.put(mBackgroundColor.b);
+    out.put(mBackgroundColor.a);
+    out.put(uint8_t(mBackgroundVisible ? 1 : 0));
+    out.put(mBackgroundImageOpacity);
+    putImage(out, mBackgroundImage);
+    out.put(int32_t(mTileWidth));
+    out.put(int32_t(mTileHeight));
+    out.put(int32_t(mNumTilesX));
+    out.put(int32_t(mNumTilesY));
+    out.put(mFirstGID);
+    out.put(uint8_t(mBoundary.valid ? 1 : 0));
+    out.put(int32_t(mBoundary.left));
+    out.put(int32_t(mBoundary.top));
+    out.put(int32_t(mBoundary.right));
+    out.put(int32_t(mBoundary.bottom));
+    out.put(uint32_t(mMapData.size()));
+    out.putBytes(mMapData.data(), mMapData.size() * sizeof(uint32_t));
+
+    out.put(uint32_t(mTiles.size()));
+    for (std::vector<TileParam>::const_iterator t = mTiles.cbegin(); t != mTiles.cend(); ++t) {
+      out.putString(t->textureName);
+      putImage(out, mTileImages.at(t - mTiles.cbegin()));
+      out.put(t->score);
+      putDynamicValue(out, t->fixed);
+      putDynamicValue(out, t->friction);
+      putDynamicValue(out, t->linearDamping);
+      putDynamicValue(out, t->angularDamping);
+      putDynamicValue(out, t->restitution);
+      putDynamicValue(out, t->density);
+      out.put(int32_t(t->shapeType));
+      out.put(t->gravityScale);
+      out.put(uint8_t(t->smooth ? 1 : 0));
+      out.put(int32_t(t->minimumHitImpulse));
+      out.put(int32_t(t->minimumKillImpulse));
+      putTime(out, t->scaleGravityDuration);
+      out.put(t->scaleGravityBy);
+      putTime(out, t->scaleBallDensityDuration);
+      out.put(t->scaleBallDensityBy);
+      putTime(out, t->earthquakeDuration);
+      out.put(t->earthquakeIntensity);
+      out.put(t->bumperImpulse);
+      out.put(uint8_t(t->multiball ? 1 : 0));
+    }
+
+    out.put(uint32_t(mWallOutlines.size()));
+    for (std::vector<WallOutline>::const_iterator w = mWallOutlines.cbegin(); w != mWallOutlines.cend(); ++w) {
+      out.put(w->tileId);
+      out.put(uint32_t(w->vertices.size()));
+      out.putBytes(w->vertices.data(), w->vertices.size() * sizeof(b2Vec2));
+    }
+
+    const std::string &dir = levelCacheDir();
+#if defined(WIN32)
+    CreateDirectory(dir.c_str(), NULL);
+#elif defined(LINUX_AMD64)
+    mkdir(dir.c_str(), 0775);
 #endif
+    return out.save(filename);
+  }
+
+
+  bool Level::readCompiled(const std::string &filename)
+  {
+    LevelCacheReader in;
+    if (!in.open(filename))
+      return false;
+
+    std::string sha1;
+    std::string name;
+    std::string musicFilename;
+    if (!in.getString(sha1) || sha1 != mSHA1 || !in.getString(name))
+      return false;
+    bool ok = in.getString(mCredits)
+      && in.getString(mAuthor)
+      && in.getString(mCopyright)
+      && in.getString(mInfo)
+      && in.getString(musicFilename);
+    // the music is streamed from the directory the zip was extracted to
+    if (!ok || (!musicFilename.empty() && !fileExists(musicFilename)))
+      return false;
+
+    uint8_t explosionParticlesCollideWithBall = 0;
+    int32_t killingsPerKillingSpree = 0;
+    int32_t killingSpreeBonus = 0;
+    uint8_t backgroundVisible = 0;
+    mBackgroundImage = sf::Image();
+    mBackgroundTexture = sf::Texture();
+    mBackgroundSprite = sf::Sprite();
+    ok = in.get(mGravity)
+      && in.get(mWallRestitution)
+      && in.get(explosionParticlesCollideWithBall)
+      && in.get(killingsPerKillingSpree)
+      && in.get(killingSpreeBonus)
+      && getTime(in, mKillingSpreeInterval)
+      && in.get(mBackgroundColor.r)
+      && in.get(mBackgroundColor.g)
+      && in.get(mBackgroundColor.b)
+      && in.get(mBackgroundColor.a)
+      && in.get(backgroundVisible)
+      && in.get(mBackgroundImageOpacity)
+      && getImage(in, mBackgroundImage);
+    if (!ok)
+      return false;
+    mExplosionParticlesCollideWithBall = explosionParticlesCollideWithBall != 0;
+    mKillingsPerKillingSpree = killingsPerKillingSpree;
+    mKillingSpreeBonus = killingSpreeBonus;
+    mBackgroundVisible = backgroundVisible != 0;
+
+    int32_t tileWidth = 0;
+    int32_t tileHeight = 0;
+    int32_t numTilesX = 0;
+    int32_t numTilesY = 0;
+    uint8_t boundaryValid = 0;
+    int32_t boundary[4];
+    uint32_t mapSize = 0;
+    ok = in.get(tileWidth)
+      && in.get(tileHeight)
+      && in.get(numTilesX)
+      && in.get(numTilesY)
+      && in.get(mFirstGID)
+      && in.get(boundaryValid)
+      && in.get(boundary)
+      && in.get(mapSize)
+      && tileWidth > 0 && tileHeight > 0
+      && numTilesX > 0 && numTilesY > 0
+      && uint64_t(mapSize) == uint64_t(numTilesX) * uint64_t(numTilesY);
+    // a damaged or stale cache file is no reason to fail, the zip is read instead
+    const uint8_t *mapData = ok ? in.take(std::size_t(mapSize) * sizeof(uint32_t)) : nullptr;
+    if (mapData == nullptr)
+      return false;
+    mTileWidth = tileWidth;
+    mTileHeight = tileHeight;
+    mNumTilesX = numTilesX;
+    mNumTilesY = numTilesY;
+    mBoundary = Boundary();
+    mBoundary.valid = boundaryValid != 0;
+    mBoundary.left = boundary[0];
+    mBoundary.top = boundary[1];
+    mBoundary.right = boundary[2];
+    mBoundary.bottom = boundary[3];
+    mMapData.resize(mapSize);
+    std::memcpy(mMapData.data(), mapData, std::size_t(mapSize) * sizeof(uint32_t));
+
+    uint32_t numTiles = 0;
+    if (!in.get(numTiles) || numTiles < mFirstGID)
+      return false;
+    // each tile of the map must have its parameters and image
+    for (std::vector<uint32_t>::const_iterator id = mMapData.cbegin(); id != mMapData.cend(); ++id)
+      if (*id >= numTiles)
+        return false;
+    mTiles.clear();
+    mTiles.resize(numTiles);
+    mTileImages.clear();
+    mTileImages.resize(numTiles);
+    for (std::vector<TileParam>::iterator t = mTiles.begin(); t != mTiles.end(); ++t) {
+      int32_t shapeType = 0;
+      uint8_t smooth = 0;
+      int32_t minimumHitImpulse = 0;
+      int32_t minimumKillImpulse = 0;
+      uint8_t multiball = 0;
+      ok = in.getString(t->textureName)
+        && getImage(in, mTileImages.at(t - mTiles.begin()))
+        && in.get(t->score)
+        && getDynamicValue(in, t->fixed)
+        && getDynamicValue(in, t->friction)
+        && getDynamicValue(in, t->linearDamping)
+        && getDynamicValue(in, t->angularDamping)
+        && getDynamicValue(in, t->restitution)
+        && getDynamicValue(in, t->density)
+        && in.get(shapeType)
+        && in.get(t->gravityScale)
+        && in.get(smooth)
+        && in.get(minimumHitImpulse)
+        && in.get(minimumKillImpulse)
+        && getTime(in, t->scaleGravityDuration)
+        && in.get(t->scaleGravityBy)
+        && getTime(in, t->scaleBallDensityDuration)
+        && in.get(t->scaleBallDensityBy)
+        && getTime(in, t->earthquakeDuration)
+        && in.get(t->earthquakeIntensity)
+        && in.get(t->bumperImpulse)
+        && in.get(multiball);
+      if (!ok)
+        return false;
+      t->shapeType = BodyShapeType(shapeType);
+      t->smooth = smooth != 0;
+      t->minimumHitImpulse = minimumHitImpulse;
+      t->minimumKillImpulse = minimumKillImpulse;
+      t->multiball = multiball != 0;
+    }
+
+    uint32_t numOutlines = 0;
+    if (!in.get(numOutlines))
+      return false;
+    mWallOutlines.clear();
+    mWallOutlines.resize(numOutlines);
+    for (std::vector<WallOutline>::iterator w = mWallOutlines.begin(); w != mWallOutlines.end(); ++w) {
+      uint32_t numVertices = 0;
+      if (!in.get(w->tileId) || w->tileId >= numTiles || !in.get(numVertices))
+        return false;
+      const uint8_t *vertices = in.take(std::size_t(numVertices) * sizeof(b2Vec2));
+      if (vertices == nullptr)
+        return false;
+      w->vertices.resize(numVertices);
+      std::memcpy(w->vertices.data(), vertices, std::size_t(numVertices) * sizeof(b2Vec2));
+    }
+    if (!in.atEnd() || mTileImages.size() != mTiles.size())
+      return false;
+
+    mName = name;
+    if (!musicFilename.empty())
+      openMusic(musicFilename);
+    return true;
   }
 
 
@@ -558,6 +1192,15 @@ namespace Impact {
   }
 
 
+  sf::Vector2u Level::textureSize(const std::string &name) const
+  {
+    const int index = bodyIndexByTextureName(name);
+    if (index < 0)
+      throw "Bad texture name: '" + name + "'";
+    return tileSize(uint32_t(index));
+  }
+
+
   uint32_t *const Level::mapDataScanLine(int y)
   {
     return mMapData.data() + y * mNumTilesX;
@@ -569,4 +1212,232 @@ namespace Impact {
     return mTiles.at(index);
   }
 
+
+  bool Level::isMergeableWall(uint32_t tileId) const
+  {
+    if (tileId < mFirstGID || tileId >= mTiles.size())
+      return false;
+    const TileParam &tileParam = mTiles.at(tileId);
+    if (!tileParam.fixed.isValid() || !tileParam.fixed.get())
+      return false;
+    if (tileParam.textureName == Ball::Name || tileParam.textureName == Racket::Name || tileParam.textureName == Bumper::Name)
+      return false;
+    // only tiles filling exactly one cell of the map can be merged
+    return tileSize(tileId) == sf::Vector2u(Game::Scale, Game::Scale);
+  }
+
+
+  // the walls are traced before the textures are uploaded,
+  // and headless games never upload them at all
+  sf::Vector2u Level::tileSize(uint32_t tileId) const
+  {
+    if (tileId < mTileImages.size())
+      return mTileImages.at(tileId).getSize();
+    return mTiles.at(tileId).texture.getSize();
+  }
+
+
+  bool Level::sameWallMaterial(uint32_t tileId1, uint32_t tileId2) const
+  {
+    if (tileId1 == tileId2)
+      return true;
+    const TileParam &a = mTiles.at(tileId1);
+    const TileParam &b = mTiles.at(tileId2);
+    return (a.density.isValid() ? a.density.get() : Wall::DefaultDensity) == (b.density.isValid() ? b.density.get() : Wall::DefaultDensity)
+      && (a.friction.isValid() ? a.friction.get() : Wall::DefaultFriction) == (b.friction.isValid() ? b.friction.get() : Wall::DefaultFriction)
+      && (a.restitution.isValid() ? a.restitution.get() : Wall::DefaultRestitution) == (b.restitution.isValid() ? b.restitution.get() : Wall::DefaultRestitution);
+  }
+
+
+  /* Trace the outlines of connected wall tiles so that a single static body
+   * with a few chain shapes can replace a body per tile. The boundary edges
+   * of every material group are directed so that the wall lies to their
+   * right (the map's y axis points down). Following them with a preference
+   * for right turns separates regions touching only at a corner.
+   */
+  void Level::traceWalls(void)
+  {
+    mWallOutlines.clear();
+
+    const int W = mNumTilesX;
+    const int H = mNumTilesY;
+    if (W <= 0 || H <= 0 || mMapData.size() < size_t(W * H))
+      return;
+
+    std::vector<int> group(W * H, -1);
+    std::vector<uint32_t> groupTileIds;
+    for (int i = 0; i < W * H; ++i) {
+      const uint32_t tileId = mMapData[i];
+      if (!isMergeableWall(tileId))
+        continue;
+      int g = 0;
+      while (g < int(groupTileIds.size()) && !sameWallMaterial(groupTileIds[g], tileId))
+        ++g;
+      if (g == int(groupTileIds.size()))
+        groupTileIds.push_back(tileId);
+      group[i] = g;
+    }
+
+    struct Edge {
+      int from;
+      int to;
+      int dir;
+    };
+    const int VW = W + 1;
+    std::vector<Edge> edges;
+    std::vector<int> outgoing(2 * VW * (H + 1));
+    std::vector<bool> visited;
+    std::vector<int> dirs;
+    for (int g = 0; g < int(groupTileIds.size()); ++g) {
+      auto inGroup = [&group, W, H, g](int x, int y) {
+        return x >= 0 && y >= 0 && x < W && y < H && group[x + y * W] == g;
+      };
+      edges.clear();
+      std::fill(outgoing.begin(), outgoing.end(), -1);
+      auto addEdge = [&edges, &outgoing, VW](int x0, int y0, int x1, int y1, int dir) {
+        const int from = x0 + y0 * VW;
+        outgoing[2 * from + (outgoing[2 * from] < 0 ? 0 : 1)] = int(edges.size());
+        Edge e = { from, x1 + y1 * VW, dir };
+        edges.push_back(e);
+      };
+      for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+          if (!inGroup(x, y))
+            continue;
+          if (!inGroup(x, y - 1))
+            addEdge(x, y, x + 1, y, 0);
+          if (!inGroup(x + 1, y))
+            addEdge(x + 1, y, x + 1, y + 1, 1);
+          if (!inGroup(x, y + 1))
+            addEdge(x + 1, y + 1, x, y + 1, 2);
+          if (!inGroup(x - 1, y))
+            addEdge(x, y + 1, x, y, 3);
+        }
+      }
+
+      visited.assign(edges.size(), false);
+      for (int first = 0; first < int(edges.size()); ++first) {
+        if (visited[first])
+          continue;
+        WallOutline outline;
+        outline.tileId = groupTileIds[g];
+        dirs.clear();
+        int e = first;
+        do {
+          visited[e] = true;
+          const Edge &edge = edges[e];
+          outline.vertices.push_back(b2Vec2(float32(edge.from % VW), float32(edge.from / VW)));
+          dirs.push_back(edge.dir);
+          const int *out = &outgoing[2 * edge.to];
+          int next = out[0];
+          if (out[1] >= 0 && edges[out[1]].dir == (edge.dir + 1) % 4)
+            next = out[1];
+          e = next;
+        } while (e != first && e >= 0 && !visited[e]);
+
+        // drop the vertices between colinear edges
+        const int N = int(outline.vertices.size());
+        std::vector<b2Vec2> corners;
+        corners.reserve(N);
+        for (int i = 0; i < N; ++i)
+          if (dirs[i] != dirs[(i + N - 1) % N])
+            corners.push_back(outline.vertices[i]);
+        outline.vertices.swap(corners);
+        mWallOutlines.push_back(outline);
+      }
+    }
+#ifndef NDEBUG
+    std::cout << "Traced " << mWallOutlines.size() << " wall outline(s)." << std::endl;
+#endif
+  }
+
+
+  // box filter weighted by alpha, so that transparent pixels do not darken the edges
+  static sf::Image downsampled(const sf::Image &src, unsigned int w, unsigned int h, float opacity = 1.f)
+  {
+    sf::Image dst;
+    dst.create(w, h, sf::Color::Transparent);
+    const sf::Vector2u &size = src.getSize();
+    if (size.x == 0 || size.y == 0)
+      return dst;
+    const sf::Uint8 *pixels = src.getPixelsPtr();
+    for (unsigned int y = 0; y < h; ++y) {
+      const unsigned int y0 = y * size.y / h;
+      const unsigned int y1 = std::max(y0 + 1, (y + 1) * size.y / h);
+      for (unsigned int x = 0; x < w; ++x) {
+        const unsigned int x0 = x * size.x / w;
+        const unsigned int x1 = std::max(x0 + 1, (x + 1) * size.x / w);
+        unsigned int r = 0, g = 0, b = 0, a = 0;
+        for (unsigned int sy = y0; sy < y1; ++sy) {
+          const sf::Uint8 *p = pixels + 4 * (sy * size.x + x0);
+          for (unsigned int sx = x0; sx < x1; ++sx, p += 4) {
+            r += p[0] * p[3];
+            g += p[1] * p[3];
+            b += p[2] * p[3];
+            a += p[3];
+          }
+        }
+        if (a > 0)
+          dst.setPixel(x, y, sf::Color(sf::Uint8(r / a), sf::Uint8(g / a), sf::Uint8(b / a), sf::Uint8(opacity * a / ((x1 - x0) * (y1 - y0)))));
+      }
+    }
+    return dst;
+  }
+
+
+  /* Draw the map on the CPU from the decoded tile images, so that no
+   * OpenGL context and no physics are needed. Every tile is downsampled
+   * once and then copied to all cells it occupies.
+   */
+  bool Level::renderThumbnail(sf::Image &thumbnail, unsigned int pixelsPerTile) const
+  {
+    const int W = mNumTilesX;
+    const int H = mNumTilesY;
+    if (W <= 0 || H <= 0 || pixelsPerTile == 0 || mMapData.size() < size_t(W * H) || mTileImages.empty())
+      return false;
+
+    const float32 f = float32(pixelsPerTile) / Game::Scale;
+    thumbnail.create(W * pixelsPerTile, H * pixelsPerTile, mBackgroundColor);
+    if (mBackgroundVisible && mBackgroundImage.getSize().x > 0) {
+      const sf::Vector2u &size = mBackgroundImage.getSize();
+      const sf::Image &background = downsampled(mBackgroundImage, std::max(1U, unsigned(f * size.x)), std::max(1U, unsigned(f * size.y)), mBackgroundImageOpacity);
+      thumbnail.copy(background, 0, 0, sf::IntRect(0, 0, 0, 0), true);
+    }
+
+    std::map<uint32_t, sf::Image> patches;
+    for (int y = 0; y < H; ++y) {
+      for (int x = 0; x < W; ++x) {
+        const uint32_t tileId = mMapData[y * W + x];
+        if (tileId < mFirstGID || tileId >= mTileImages.size())
+          continue;
+        const sf::Image &image = mTileImages.at(tileId);
+        if (image.getSize().x == 0)
+          continue;
+        std::map<uint32_t, sf::Image>::const_iterator patch = patches.find(tileId);
+        if (patch == patches.cend()) {
+          const unsigned int w = std::max(1U, unsigned(f * image.getSize().x + .5f));
+          const unsigned int h = std::max(1U, unsigned(f * image.getSize().y + .5f));
+          patch = patches.insert(std::make_pair(tileId, downsampled(image, w, h))).first;
+        }
+        const sf::Vector2u &patchSize = patch->second.getSize();
+        sf::IntRect source(0, 0, int(patchSize.x), int(patchSize.y));
+        int left = int((x + .5f) * pixelsPerTile - .5f * patchSize.x);
+        int top = int((y + .5f) * pixelsPerTile - .5f * patchSize.y);
+        if (left < 0) {
+          source.left = -left;
+          source.width += left;
+          left = 0;
+        }
+        if (top < 0) {
+          source.top = -top;
+          source.height += top;
+          top = 0;
+        }
+        if (source.width > 0 && source.height > 0)
+          thumbnail.copy(patch->second, unsigned(left), unsigned(top), source, true);
+      }
+    }
+    return true;
+  }
+
 }
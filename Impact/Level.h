@@ -23,6 +23,9 @@
 #include <SFML/System.hpp>
 #include <vector>
 #include <string>
+#include <mutex>
+#include <map>
+#include <memory>
 #include "Body.h"
 #include "globals.h"
 #include "TileParam.h"
@@ -55,6 +58,18 @@ namespace Impact {
     bool valid;
   };
 
+  /// closed outline of connected wall tiles with the same material, in tile units
+  struct WallOutline {
+    WallOutline(void)
+      : tileId(0)
+    { /* ... */ }
+    /// id of a tile supplying the material of the outline
+    uint32_t tileId;
+    std::vector<b2Vec2> vertices;
+  };
+
+  class XmlReader;
+
   class Level {
   public:
     Level(void);
@@ -69,9 +84,22 @@ namespace Impact {
     void clear(void);
     bool set(int level, bool doLoad);
     bool gotoNext(void);
+    void take(Level &other);
+    bool uploadTextures(void);
+    /// levels loaded on threads other than the main one must not read the
+    /// local settings, so they are told where levels go; headless games
+    /// disable music, too
+    void setPaths(const std::string &levelsDir, const std::string &levelCacheDir);
+    inline void setMusicEnabled(bool enabled)
+    {
+      mMusicEnabled = enabled;
+    }
 
     const sf::Texture &texture(const std::string &name) const;
     int bodyIndexByTextureName(const std::string &name) const;
+    /// sizes of the tile images, also known before or without uploadTextures()
+    sf::Vector2u tileSize(uint32_t tileId) const;
+    sf::Vector2u textureSize(const std::string &name) const;
     uint32_t *const mapDataScanLine(int y);
     const TileParam &tileParam(int index) const;
     inline bool isAvailable(void) const
@@ -176,14 +204,31 @@ namespace Impact {
     {
       return mSHA1;
     }
+    inline const std::string &zipFilename(void) const
+    {
+      return mZipFilename;
+    }
     inline sf::Music *music(void)
     {
       return mMusic;
     }
+    inline const std::string &musicFilename(void) const
+    {
+      return mMusicFilename;
+    }
     inline float32 wallRestitution(void) const
     {
       return mWallRestitution;
     }
+    /// outlines of the merged wall tiles, traced when the level is loaded
+    inline const std::vector<WallOutline> &wallOutlines(void) const
+    {
+      return mWallOutlines;
+    }
+    bool isMergeableWall(uint32_t tileId) const;
+    /// draws the map scaled down to the given number of pixels per tile;
+    /// needs the decoded tile images, so it must be called before uploadTextures()
+    bool renderThumbnail(sf::Image &thumbnail, unsigned int pixelsPerTile) const;
 
     void load(void);
     void loadZip(const std::string &zipFilename);
@@ -194,6 +239,7 @@ namespace Impact {
     float32 mBackgroundImageOpacity;
     bool mBackgroundVisible;
     sf::Color mBackgroundColor;
+    sf::Image mBackgroundImage;
     sf::Texture mBackgroundTexture;
     sf::Sprite mBackgroundSprite;
     int mLevelNum;
@@ -217,10 +263,39 @@ namespace Impact {
     std::string mAuthor;
     std::string mCopyright;
     sf::Music *mMusic;
+    bool mMusicEnabled;
+    std::string mLevelsDir;
+    std::string mLevelCacheDir;
+    std::string mMusicFilename;
+    std::string mZipFilename;
 
     std::vector<TileParam> mTiles;
+    // loading decodes the images only, so that levels can be loaded
+    // without an OpenGL context; uploadTextures() turns them into textures
+    std::vector<sf::Image> mTileImages;
+    std::vector<WallOutline> mWallOutlines;
+
+    // each level is extracted into a directory of its own, which
+    // only one thread at a time may write to and read from
+    static std::mutex sExtractMutex;
+    static std::map<std::string, std::shared_ptr<std::mutex> > sExtractDirMutexes;
+    static std::shared_ptr<std::mutex> extractMutex(const std::string &levelPath);
 
     bool calcSHA1(const std::string &filename);
+    void openMusic(const std::string &filename);
+    std::string levelsDir(void) const;
+    std::string levelCacheDir(void) const;
+    bool readCompiled(const std::string &filename);
+    bool writeCompiled(const std::string &filename) const;
+    bool readTmx(const std::string &tmxFilename, const std::string &levelPath);
+    void readMapProperty(const XmlReader &xml);
+    bool readTileset(XmlReader &xml, const std::string &levelPath);
+    bool readLayer(XmlReader &xml);
+    void readImageLayer(XmlReader &xml, const std::string &levelPath);
+    void readObjectGroup(XmlReader &xml);
+    void setBackgroundSprite(void);
+    bool sameWallMaterial(uint32_t tileId1, uint32_t tileId2) const;
+    void traceWalls(void);
   };
 
 }
@@ -0,0 +1,194 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "stdafx.h"
+#include "LevelCache.h"
+
+#if defined(LINUX_AMD64)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Impact {
+
+  const uint32_t LevelCacheWriter::Magic = 0x4c43504d; // "MPCL"
+  const uint32_t LevelCacheWriter::Version = 1;
+
+
+  LevelCacheWriter::LevelCacheWriter(void)
+  {
+    put(Magic);
+    put(Version);
+  }
+
+
+  void LevelCacheWriter::putBytes(const void *data, std::size_t size)
+  {
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(data);
+    mData.insert(mData.end(), p, p + size);
+  }
+
+
+  void LevelCacheWriter::putString(const std::string &str)
+  {
+    put(uint32_t(str.size()));
+    putBytes(str.data(), str.size());
+  }
+
+
+  bool LevelCacheWriter::save(const std::string &filename) const
+  {
+    const std::string tmpFile = filename + ".tmp";
+    {
+      std::ofstream ofs(tmpFile, std::ios::binary);
+      if (!ofs.is_open()) {
+        std::cerr << "Cannot write " << tmpFile << std::endl;
+        return false;
+      }
+      ofs.write(reinterpret_cast<const char*>(mData.data()), std::streamsize(mData.size()));
+      if (!ofs) {
+        std::cerr << "Cannot write " << tmpFile << std::endl;
+        return false;
+      }
+    }
+#if defined(WIN32)
+    const bool ok = MoveFileExA(tmpFile.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else
+    const bool ok = std::rename(tmpFile.c_str(), filename.c_str()) == 0;
+#endif
+    if (!ok)
+      std::cerr << "Cannot replace " << filename << std::endl;
+    return ok;
+  }
+
+
+  LevelCacheReader::LevelCacheReader(void)
+#if defined(WIN32)
+    : mFile(INVALID_HANDLE_VALUE)
+    , mMapping(NULL)
+#elif defined(LINUX_AMD64)
+    : mFile(-1)
+#endif
+    , mData(nullptr)
+    , mSize(0)
+    , mPos(0)
+  { /* ... */ }
+
+
+  LevelCacheReader::~LevelCacheReader()
+  {
+    close();
+  }
+
+
+  bool LevelCacheReader::open(const std::string &filename)
+  {
+    close();
+#if defined(WIN32)
+    mFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+      return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0) {
+      close();
+      return false;
+    }
+    mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping == NULL) {
+      close();
+      return false;
+    }
+    mData = reinterpret_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    mSize = std::size_t(size.QuadPart);
+#elif defined(LINUX_AMD64)
+    mFile = ::open(filename.c_str(), O_RDONLY);
+    if (mFile < 0)
+      return false;
+    struct stat st;
+    if (fstat(mFile, &st) != 0 || st.st_size == 0) {
+      close();
+      return false;
+    }
+    void *data = mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, mFile, 0);
+    mData = data != MAP_FAILED ? reinterpret_cast<const uint8_t*>(data) : nullptr;
+    mSize = std::size_t(st.st_size);
+#endif
+    if (mData == nullptr) {
+      close();
+      return false;
+    }
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (!get(magic) || magic != LevelCacheWriter::Magic || !get(version) || version != LevelCacheWriter::Version) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+
+  void LevelCacheReader::close(void)
+  {
+#if defined(WIN32)
+    if (mData != nullptr)
+      UnmapViewOfFile(mData);
+    if (mMapping != NULL)
+      CloseHandle(mMapping);
+    if (mFile != INVALID_HANDLE_VALUE)
+      CloseHandle(mFile);
+    mMapping = NULL;
+    mFile = INVALID_HANDLE_VALUE;
+#elif defined(LINUX_AMD64)
+    if (mData != nullptr)
+      munmap(const_cast<uint8_t*>(mData), mSize);
+    if (mFile >= 0)
+      ::close(mFile);
+    mFile = -1;
+#endif
+    mData = nullptr;
+    mSize = 0;
+    mPos = 0;
+  }
+
+
+  const uint8_t *LevelCacheReader::take(std::size_t size)
+  {
+    if (mData == nullptr || size > mSize - mPos)
+      return nullptr;
+    const uint8_t *p = mData + mPos;
+    mPos += size;
+    return p;
+  }
+
+
+  bool LevelCacheReader::getString(std::string &str)
+  {
+    uint32_t size = 0;
+    if (!get(size))
+      return false;
+    const uint8_t *p = take(size);
+    if (p == nullptr)
+      return false;
+    str.assign(reinterpret_cast<const char*>(p), size);
+    return true;
+  }
+
+}
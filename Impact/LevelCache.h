@@ -0,0 +1,110 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __LEVELCACHE_H_
+#define __LEVELCACHE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(WIN32)
+#include <Windows.h>
+#endif
+
+namespace Impact {
+
+  /* A compiled level holds everything Level::loadZip() gets out of a level
+   * zip in one flat blob: level properties, map grid, tile parameters, wall
+   * outlines and the decoded RGBA pixels of all images. Values are stored
+   * in native byte order, strings and arrays are prefixed with their size.
+   * Blobs are named after the SHA-1 of their zip, so they never go stale;
+   * a blob with another version is simply ignored and written anew.
+   */
+  class LevelCacheWriter {
+  public:
+    static const uint32_t Magic;
+    static const uint32_t Version;
+
+    LevelCacheWriter(void);
+
+    template <typename T>
+    void put(const T &value)
+    {
+      putBytes(&value, sizeof(T));
+    }
+    void putBytes(const void *data, std::size_t size);
+    void putString(const std::string &str);
+    /// writes the blob to a temporary file first, then renames it
+    bool save(const std::string &filename) const;
+
+  private:
+    std::vector<uint8_t> mData;
+  };
+
+
+  /// reads a compiled level from a memory mapping of its file
+  class LevelCacheReader {
+  public:
+    LevelCacheReader(void);
+    ~LevelCacheReader();
+
+    /// maps the file and checks magic and version
+    bool open(const std::string &filename);
+    void close(void);
+
+    template <typename T>
+    bool get(T &value)
+    {
+      const uint8_t *p = take(sizeof(T));
+      if (p == nullptr)
+        return false;
+      std::memcpy(&value, p, sizeof(T));
+      return true;
+    }
+    bool getString(std::string &str);
+    /// the next size bytes right in the mapping, nullptr if the blob is too short
+    const uint8_t *take(std::size_t size);
+
+    inline bool isOpen(void) const
+    {
+      return mData != nullptr;
+    }
+    inline bool atEnd(void) const
+    {
+      return mPos == mSize;
+    }
+
+  private:
+#if defined(WIN32)
+    HANDLE mFile;
+    HANDLE mMapping;
+#elif defined(LINUX_AMD64)
+    int mFile;
+#endif
+    const uint8_t *mData;
+    std::size_t mSize;
+    std::size_t mPos;
+  };
+
+}
+
+#endif // __LEVELCACHE_H_
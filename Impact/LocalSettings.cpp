@@ -25,6 +25,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <boost/serialization/version.hpp>
 #include <boost/serialization/map.hpp>
 
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+
 #if defined(WIN32)
 #include <ShlObj.h>
 #endif
@@ -46,9 +52,11 @@ namespace Impact {
       , campaignHighscore(0LL)
       , musicVolume(50)
       , soundfxVolume(100)
+      , soundfxCacheSize(512U)
       , framerateLimit(0)
       , velocityIterations(32)
       , positionIterations(64)
+      , recordReplays(false)
     { /* ... */ }
     bool useShaders;
     bool useShadersForExplosions;
@@ -58,19 +66,162 @@ namespace Impact {
     int64_t campaignHighscore;
     float musicVolume;
     float soundfxVolume;
+    unsigned int soundfxCacheSize;
     unsigned int framerateLimit;
     int velocityIterations;
     int positionIterations;
+    bool recordReplays;
 
     std::string appData;
     std::string settingsFile;
     std::string levelsDir;
     std::string soundFXDir;
     std::string musicDir;
+    std::string replaysDir;
+    std::string levelCacheDir;
+    std::string highscoreLog;
 
     std::map<int, int64_t> highscores;
   };
 
+
+  /* Writes settings and highscores on a thread of its own, so that neither
+   * a change in the options nor a new highscore ever stalls a frame.
+   * Settings are written as a whole after they have not changed for a
+   * while. Highscores are appended to a log in batches instead, which is
+   * folded into the settings file by LocalSettings::flush().
+   */
+  class LocalSettingsWriter {
+  public:
+    static const std::chrono::milliseconds DefaultSaveDelay;
+    static const std::chrono::milliseconds DefaultLogInterval;
+    // key of the campaign highscore in the log, as there is no level -1
+    static const int CampaignKey = -1;
+
+    LocalSettingsWriter(void)
+      : mQuit(false)
+    { /* ... */ }
+    ~LocalSettingsWriter()
+    {
+      stop();
+    }
+
+    void schedule(const LocalSettingsPrivate &settings);
+    void logHighscore(int key, int64_t score);
+    void stop(void);
+
+    std::string logFile;
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mWakeup;
+    std::thread mThread;
+    bool mQuit;
+    std::shared_ptr<LocalSettingsPrivate> mSnapshot;
+    std::chrono::steady_clock::time_point mLastRequest;
+    std::map<int, int64_t> mPendingHighscores;
+
+    void start(void);
+    void run(void);
+    void writePending(std::unique_lock<std::mutex> &lock, bool force);
+    bool appendHighscores(const std::map<int, int64_t> &highscores);
+  };
+
+  const std::chrono::milliseconds LocalSettingsWriter::DefaultSaveDelay(500);
+  const std::chrono::milliseconds LocalSettingsWriter::DefaultLogInterval(2000);
+
+
+  void LocalSettingsWriter::schedule(const LocalSettingsPrivate &settings)
+  {
+    std::shared_ptr<LocalSettingsPrivate> snapshot(new LocalSettingsPrivate(settings));
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mSnapshot = snapshot;
+      mLastRequest = std::chrono::steady_clock::now();
+      start();
+    }
+    mWakeup.notify_one();
+  }
+
+
+  void LocalSettingsWriter::logHighscore(int key, int64_t score)
+  {
+    // no notification: the writer picks the scores up on its next round
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPendingHighscores[key] = score;
+    start();
+  }
+
+
+  void LocalSettingsWriter::start(void)
+  {
+    if (!mThread.joinable()) {
+      mQuit = false;
+      mThread = std::thread(&LocalSettingsWriter::run, this);
+    }
+  }
+
+
+  void LocalSettingsWriter::stop(void)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mQuit = true;
+    }
+    mWakeup.notify_one();
+    if (mThread.joinable())
+      mThread.join();
+    std::unique_lock<std::mutex> lock(mMutex);
+    writePending(lock, true);
+  }
+
+
+  void LocalSettingsWriter::run(void)
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mQuit) {
+      if (mSnapshot)
+        mWakeup.wait_until(lock, mLastRequest + DefaultSaveDelay);
+      else
+        mWakeup.wait_for(lock, DefaultLogInterval);
+      writePending(lock, mQuit);
+    }
+  }
+
+
+  void LocalSettingsWriter::writePending(std::unique_lock<std::mutex> &lock, bool force)
+  {
+    if (!mPendingHighscores.empty()) {
+      std::map<int, int64_t> highscores;
+      highscores.swap(mPendingHighscores);
+      lock.unlock();
+      appendHighscores(highscores);
+      lock.lock();
+    }
+    if (mSnapshot && (force || std::chrono::steady_clock::now() >= mLastRequest + DefaultSaveDelay)) {
+      std::shared_ptr<LocalSettingsPrivate> snapshot;
+      snapshot.swap(mSnapshot);
+      lock.unlock();
+      LocalSettings::write(snapshot);
+      lock.lock();
+    }
+  }
+
+
+  bool LocalSettingsWriter::appendHighscores(const std::map<int, int64_t> &highscores)
+  {
+    std::ofstream log(logFile, std::ios::app);
+    if (!log.is_open()) {
+      std::cerr << "Cannot open " << logFile << std::endl;
+      return false;
+    }
+    for (std::map<int, int64_t>::const_iterator h = highscores.cbegin(); h != highscores.cend(); ++h)
+      log << h->first << " " << h->second << "\n";
+    log.flush();
+    return log.good();
+  }
+
+
   LocalSettings& gLocalSettings() {
      static LocalSettings* localSettings = new LocalSettings();
      return *localSettings;
@@ -78,6 +229,7 @@ namespace Impact {
 
   LocalSettings::LocalSettings(void)
     : d(new LocalSettingsPrivate)
+    , mWriter(new LocalSettingsWriter)
   {
 #if defined(WIN32)
     TCHAR szPath[MAX_PATH];
@@ -88,6 +240,10 @@ namespace Impact {
       d->levelsDir = d->appData + "\\levels";
       d->soundFXDir = d->appData + "\\soundfx";
       d->musicDir = d->appData + "\\music";
+      d->replaysDir = d->appData + "\\replays";
+      d->levelCacheDir = d->appData + "\\levelcache";
+      d->highscoreLog = d->appData + "\\highscores.log";
+      mWriter->logFile = d->highscoreLog;
       load();
     }
 #elif defined(LINUX_AMD64)
@@ -102,6 +258,10 @@ namespace Impact {
     d->levelsDir = d->appData + "/levels";
     d->soundFXDir = d->appData + "/soundfx";
     d->musicDir = d->appData + "/music";
+    d->replaysDir = d->appData + "/replays";
+    d->levelCacheDir = d->appData + "/levelcache";
+    d->highscoreLog = d->appData + "/highscores.log";
+    mWriter->logFile = d->highscoreLog;
 #ifndef NDEBUG
     std::cout << "settingsFile = '" << d->settingsFile << "'" << std::endl;
 #endif
@@ -110,23 +270,81 @@ namespace Impact {
   }
 
 
+  LocalSettings::LocalSettings(const std::shared_ptr<LocalSettingsPrivate> &data)
+    : d(data)
+  { /* ... */ }
+
+
   bool LocalSettings::save(void)
   {
-    bool ok = true;
-    std::ofstream ofs(d->settingsFile);
-    unsigned int flags = boost::archive::no_header | boost::archive::no_tracking | boost::archive::no_xml_tag_checking;
-    boost::archive::xml_oarchive xml(ofs, flags);
-    xml << boost::serialization::make_nvp("impact", *this);
+    mWriter->schedule(*d);
+    return true;
+  }
+
+
+  bool LocalSettings::flush(void)
+  {
+    mWriter->stop();
+    bool ok = write(d);
+    // the highscores are in the settings file now
+    if (ok && fileExists(d->highscoreLog))
+      ok = std::remove(d->highscoreLog.c_str()) == 0;
+    return ok;
+  }
+
+
+  bool LocalSettings::write(const std::shared_ptr<LocalSettingsPrivate> &data)
+  {
+    // written to a temporary file first, so that a crash never leaves a truncated file behind
+    const std::string tmpFile = data->settingsFile + ".tmp";
+    {
+      std::ofstream ofs(tmpFile);
+      if (!ofs.is_open()) {
+        std::cerr << "Cannot write " << tmpFile << std::endl;
+        return false;
+      }
+      LocalSettings settings(data);
+      unsigned int flags = boost::archive::no_header | boost::archive::no_tracking | boost::archive::no_xml_tag_checking;
+      boost::archive::xml_oarchive xml(ofs, flags);
+      xml << boost::serialization::make_nvp("impact", settings);
+    }
+#if defined(WIN32)
+    const bool ok = MoveFileExA(tmpFile.c_str(), data->settingsFile.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else
+    const bool ok = std::rename(tmpFile.c_str(), data->settingsFile.c_str()) == 0;
+#endif
+    if (!ok)
+      std::cerr << "Cannot replace " << data->settingsFile << std::endl;
     return ok;
   }
 
 
+  bool LocalSettings::loadHighscoreLog(void)
+  {
+    std::ifstream log(d->highscoreLog);
+    if (!log.is_open())
+      return true;
+    // the log is in chronological order and every setHighscore() is
+    // recorded, so the last record wins, even if it resets a score
+    int key;
+    int64_t score;
+    while (log >> key >> score) {
+      if (key == LocalSettingsWriter::CampaignKey)
+        d->campaignHighscore = score;
+      else
+        d->highscores[key] = score;
+    }
+    // a torn last line after a crash costs at most that one score
+    return log.eof();
+  }
+
+
 #pragma warning(disable : 4503)
   bool LocalSettings::load(void)
   {
     bool ok = fileExists(d->settingsFile);
     if (!ok)
-      return true;
+      return loadHighscoreLog();
     boost::property_tree::ptree pt;
     try {
       boost::property_tree::xml_parser::read_xml(d->settingsFile, pt);
@@ -151,7 +369,9 @@ namespace Impact {
         d->lastCampaignLevel = 1;
       d->campaignHighscore = pt.get<int64_t>("impact.campaign-highscore", 0ULL);
       d->soundfxVolume = b2Clamp(pt.get<float>("impact.soundfx-volume", 100.f), 0.f, 100.f);
+      d->soundfxCacheSize = pt.get<unsigned int>("impact.soundfx-cache-size", 512U);
       d->musicVolume = b2Clamp(pt.get<float>("impact.music-volume", 50.f), 0.f, 100.f);
+      d->recordReplays = pt.get<bool>("impact.record-replays", false);
     }
     catch (const boost::property_tree::xml_parser::xml_parser_error &ex) {
       std::cerr << "XML parser error: " << ex.what() << " (line " << ex.line() << ")" << std::endl;
@@ -183,7 +403,7 @@ namespace Impact {
 
     d->useShaders &= sf::Shader::isAvailable();
     d->useShadersForExplosions &= d->useShaders;
-    return ok;
+    return loadHighscoreLog() && ok;
   }
 
 
@@ -202,6 +422,8 @@ namespace Impact {
     ar & boost::serialization::make_nvp("campaign-highscore", d->campaignHighscore);
     ar & boost::serialization::make_nvp("music-volume", d->musicVolume);
     ar & boost::serialization::make_nvp("soundfx-volume", d->soundfxVolume);
+    ar & boost::serialization::make_nvp("soundfx-cache-size", d->soundfxCacheSize);
+    ar & boost::serialization::make_nvp("record-replays", d->recordReplays);
   }
 
 
@@ -259,6 +481,18 @@ namespace Impact {
   }
 
 
+  const std::string &LocalSettings::replaysDir(void) const
+  {
+    return d->replaysDir;
+  }
+
+
+  const std::string &LocalSettings::levelCacheDir(void) const
+  {
+    return d->levelCacheDir;
+  }
+
+
   void LocalSettings::setMusicVolume(float volume)
   {
     d->musicVolume = volume;
@@ -283,6 +517,18 @@ namespace Impact {
   }
 
 
+  void LocalSettings::setSoundFXCacheSize(unsigned int kbytes)
+  {
+    d->soundfxCacheSize = kbytes;
+  }
+
+
+  unsigned int LocalSettings::soundFXCacheSize(void) const
+  {
+    return d->soundfxCacheSize;
+  }
+
+
   void LocalSettings::setParticlesPerExplosion(unsigned int n)
   {
     d->particlesPerExplosion = n;
@@ -343,21 +589,36 @@ namespace Impact {
   }
 
 
+  void LocalSettings::setRecordReplays(bool enabled)
+  {
+    d->recordReplays = enabled;
+  }
+
+
+  bool LocalSettings::recordReplays(void) const
+  {
+    return d->recordReplays;
+  }
+
+
   void LocalSettings::setHighscore(int level, int64_t score)
   {
     d->highscores[level] = score;
+    mWriter->logHighscore(level, score);
   }
 
 
   int64_t LocalSettings::highscore(int level) const
   {
-    return d->highscores[level];
+    std::map<int, int64_t>::const_iterator h = d->highscores.find(level);
+    return h != d->highscores.end() ? h->second : 0;
   }
 
 
   void LocalSettings::setHighscore(int64_t score)
   {
     d->campaignHighscore = score;
+    mWriter->logHighscore(LocalSettingsWriter::CampaignKey, score);
   }
 
 
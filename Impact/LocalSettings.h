@@ -28,12 +28,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 namespace Impact {
 
   class LocalSettingsPrivate;
+  class LocalSettingsWriter;
 
   class LocalSettings {
   public:
     LocalSettings(void);
 
+    /// hands a copy of the settings to a background writer and returns at once;
+    /// saves in quick succession are coalesced into one write
     bool save(void);
+    /// writes the settings right away and compacts the highscore log, for shutdown
+    bool flush(void);
     bool load(void);
 
     void setUseShaders(bool);
@@ -45,10 +50,16 @@ namespace Impact {
     const std::string &levelsDir(void) const;
     const std::string &musicDir(void) const;
     const std::string &soundFXDir(void) const;
+    const std::string &replaysDir(void) const;
+    /// compiled levels, see Level::writeCompiled()
+    const std::string &levelCacheDir(void) const;
     void setMusicVolume(float);
     float musicVolume(void) const;
     void setSoundFXVolume(float);
     float soundFXVolume(void) const;
+    /// memory budget for decoded sound effects in KB, see SoundBank
+    void setSoundFXCacheSize(unsigned int);
+    unsigned int soundFXCacheSize(void) const;
     void setParticlesPerExplosion(unsigned int);
     unsigned int particlesPerExplosion(void) const;
     void setLastCampaignLevel(int) const;
@@ -59,6 +70,8 @@ namespace Impact {
     int positionIterations(void) const;
     void setVelocityIterations(int);
     int velocityIterations(void) const;
+    void setRecordReplays(bool);
+    bool recordReplays(void) const;
 
     void setHighscore(int level, int64_t score);
     int64_t highscore(int level) const;
@@ -69,7 +82,13 @@ namespace Impact {
 
   private:
     std::shared_ptr<LocalSettingsPrivate> d;
+    std::shared_ptr<LocalSettingsWriter> mWriter;
 
+    explicit LocalSettings(const std::shared_ptr<LocalSettingsPrivate> &data);
+    static bool write(const std::shared_ptr<LocalSettingsPrivate> &data);
+    bool loadHighscoreLog(void);
+
+    friend class LocalSettingsWriter;
     friend class boost::serialization::access;
     template<class archive>void serialize(archive& ar, const unsigned int version);
   };
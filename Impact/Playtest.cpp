@@ -0,0 +1,308 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "stdafx.h"
+#include "Playtest.h"
+
+namespace Impact {
+
+  const float TrackingPolicy::DefaultKickDistance = 2.5f;
+
+
+  /* Time until a body at y moving with vy under gravity g reaches lineY,
+   * or a negative value if it never does. Damping is neglected.
+   */
+  static float32 timeToReach(float32 y, float32 vy, float32 g, float32 lineY)
+  {
+    const float32 dy = lineY - y;
+    if (std::abs(g) < b2_epsilon)
+      return (vy != 0.f && sign(vy) == sign(dy)) ? dy / vy : -1.f;
+    const float32 d = vy * vy + 2.f * g * dy;
+    if (d < 0.f)
+      return -1.f;
+    const float32 r = std::sqrt(d);
+    const float32 t1 = (-vy - r) / g;
+    const float32 t2 = (-vy + r) / g;
+    if (t1 > 0.f && t2 > 0.f)
+      return std::min(t1, t2);
+    return std::max(t1, t2);
+  }
+
+
+  // a ball leaving the playground sideways bounces back off the boundaries
+  static float32 reflect(float32 x, float32 width)
+  {
+    const float32 period = 2.f * width;
+    x = std::fmod(x, period);
+    if (x < 0.f)
+      x += period;
+    return x > width ? period - x : x;
+  }
+
+
+  RacketPolicy *RacketPolicy::create(const std::string &name)
+  {
+    if (name == "track")
+      return new TrackingPolicy;
+    if (name == "sweep")
+      return new SweepPolicy;
+    return nullptr;
+  }
+
+
+  TrackingPolicy::TrackingPolicy(void)
+    : mHomeY(-1.f)
+    , mAimOffset(0.f)
+  { /* ... */ }
+
+
+  void TrackingPolicy::reset(uint32_t seed)
+  {
+    // every run hits the balls at a slightly different spot of the racket
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> aimOffset(-.4f, .4f);
+    mAimOffset = aimOffset(rng);
+    mHomeY = -1.f;
+  }
+
+
+  void TrackingPolicy::control(const Game &game, InputState &input)
+  {
+    const Racket *racket = game.racket();
+    if (racket == nullptr)
+      return;
+    const b2Vec2 &racketPos = racket->position();
+    if (mHomeY < 0.f)
+      mHomeY = racketPos.y;
+    const float32 width = float32(game.level()->width());
+    const float32 g = game.level()->gravity();
+
+    Ball *target = nullptr;
+    float32 targetX = racketPos.x;
+    float32 minTime = std::numeric_limits<float32>::max();
+    const std::vector<Ball*> &balls = game.balls();
+    for (std::vector<Ball*>::const_iterator b = balls.cbegin(); b != balls.cend(); ++b) {
+      Ball *ball = *b;
+      const b2Vec2 &pos = ball->position();
+      const b2Vec2 &v = ball->body()->GetLinearVelocity();
+      const float32 t = timeToReach(pos.y, v.y, g, mHomeY);
+      // balls that do not come down are followed, but only if no other one does
+      const float32 urgency = t >= 0.f ? t : 1e3f + std::abs(mHomeY - pos.y);
+      if (urgency < minTime) {
+        minTime = urgency;
+        target = ball;
+        targetX = t >= 0.f ? reflect(pos.x + v.x * t, width) : pos.x;
+      }
+    }
+
+    input.x = int32_t(Game::Scale * (targetX + mAimOffset));
+    input.y = int32_t(Game::Scale * mHomeY);
+    if (target != nullptr && b2Distance(target->position(), racketPos) < DefaultKickDistance)
+      input.buttons = target->position().x < racketPos.x ? InputState::KickLeft : InputState::KickRight;
+  }
+
+
+  SweepPolicy::SweepPolicy(void)
+    : mHomeY(-1.f)
+    , mStep(0)
+    , mPhase(0)
+  { /* ... */ }
+
+
+  void SweepPolicy::reset(uint32_t seed)
+  {
+    // runs start at different points of the sweep
+    mStep = int(seed % DefaultStepsPerSweep);
+    mPhase = 0;
+    mHomeY = -1.f;
+  }
+
+
+  void SweepPolicy::control(const Game &game, InputState &input)
+  {
+    static const int KickSteps = 12;
+    static const float32 Margin = 2.f;
+    const Racket *racket = game.racket();
+    if (racket == nullptr)
+      return;
+    if (mHomeY < 0.f)
+      mHomeY = racket->position().y;
+    const float32 width = float32(game.level()->width());
+    float32 u = float32(mStep) / DefaultStepsPerSweep;
+    if (mPhase & 1)
+      u = 1.f - u;
+    input.x = int32_t(Game::Scale * (Margin + u * (width - 2.f * Margin)));
+    input.y = int32_t(Game::Scale * mHomeY);
+    if (mStep < KickSteps)
+      input.buttons = (mPhase & 1) ? InputState::KickLeft : InputState::KickRight;
+    if (++mStep >= DefaultStepsPerSweep) {
+      mStep = 0;
+      ++mPhase;
+    }
+  }
+
+
+  PlaytestConfig::PlaytestConfig(void)
+    : runs(8)
+    , threads(std::max(1, int(std::thread::hardware_concurrency())))
+    , timeLimit(sf::seconds(300))
+    , policy("track")
+    , seed(1)
+    , velocityIterations(gLocalSettings().velocityIterations())
+    , positionIterations(gLocalSettings().positionIterations())
+    , particlesPerExplosion(gLocalSettings().particlesPerExplosion())
+    , levelsDir(gLocalSettings().levelsDir())
+    , levelCacheDir(gLocalSettings().levelCacheDir())
+  { /* ... */ }
+
+
+  Playtest::Playtest(const PlaytestConfig &config)
+    : mConfig(config)
+    , mNextTask(0)
+  { /* ... */ }
+
+
+  bool Playtest::run(void)
+  {
+    std::unique_ptr<RacketPolicy> policy(RacketPolicy::create(mConfig.policy));
+    if (!policy) {
+      std::cerr << "Unknown racket policy " << mConfig.policy << std::endl;
+      return false;
+    }
+    if (mConfig.levels.empty()) {
+      // the numbered levels, just like a campaign
+      for (int l = 1; ; ++l) {
+        std::ostringstream levelStrBuf;
+        levelStrBuf << mConfig.levelsDir << "/" << std::setw(4) << std::setfill('0') << l << ".zip";
+        if (!fileExists(levelStrBuf.str()))
+          break;
+        mConfig.levels.push_back(levelStrBuf.str());
+      }
+    }
+    if (mConfig.levels.empty() || mConfig.runs < 1) {
+      std::cerr << "Nothing to playtest." << std::endl;
+      return false;
+    }
+
+    mResults = std::vector<PlaytestResult>(mConfig.levels.size());
+    for (std::vector<PlaytestResult>::size_type i = 0; i < mResults.size(); ++i)
+      mResults[i].zipFilename = mConfig.levels[i];
+
+    mNextTask = 0;
+    const int nTasks = int(mConfig.levels.size()) * mConfig.runs;
+    const int nThreads = std::max(1, std::min(mConfig.threads, nTasks));
+    std::vector<std::thread> workers;
+    for (int i = 0; i < nThreads; ++i)
+      workers.push_back(std::thread(&Playtest::work, this));
+    for (std::vector<std::thread>::iterator w = workers.begin(); w != workers.end(); ++w)
+      w->join();
+    return true;
+  }
+
+
+  void Playtest::work(void)
+  {
+    std::unique_ptr<Game> game(new Game(Game::Headless));
+    game->setLevelPaths(mConfig.levelsDir, mConfig.levelCacheDir);
+    std::unique_ptr<RacketPolicy> policy(RacketPolicy::create(mConfig.policy));
+    const int nTasks = int(mConfig.levels.size()) * mConfig.runs;
+    // tasks are ordered by level, so a worker rarely has to load another one
+    for (int task = mNextTask++; task < nTasks; task = mNextTask++)
+      simulate(*game, *policy, task / mConfig.runs, task % mConfig.runs);
+  }
+
+
+  void Playtest::simulate(Game &game, RacketPolicy &policy, int level, int run)
+  {
+    ReplayHeader session;
+    session.levelZip = mConfig.levels.at(level);
+    session.seed = mConfig.seed + uint32_t(run);
+    session.velocityIterations = mConfig.velocityIterations;
+    session.positionIterations = mConfig.positionIterations;
+    session.particlesPerExplosion = mConfig.particlesPerExplosion;
+    if (!game.startHeadless(session))
+      return;
+    policy.reset(session.seed);
+
+    const int64_t maxSteps = mConfig.timeLimit.asMicroseconds() / Game::DefaultTimeStep.asMicroseconds();
+    int64_t steps = 0;
+    sf::Clock stepClock;
+    while (game.isPlaying() && steps < maxSteps) {
+      InputState input;
+      policy.control(game, input);
+      if (game.balls().empty())
+        input.commands |= InputState::NewBall;
+      game.simulate(input);
+      ++steps;
+    }
+    const sf::Time &stepTime = stepClock.getElapsedTime();
+    const sf::Time &playTime = sf::microseconds(steps * Game::DefaultTimeStep.asMicroseconds());
+
+    std::lock_guard<std::mutex> lock(mResultsMutex);
+    PlaytestResult &result = mResults[level];
+    result.hash = game.level()->hash();
+    ++result.runs;
+    if (game.isLevelCompleted()) {
+      if (result.completed == 0 || playTime < result.fastestCompletion)
+        result.fastestCompletion = playTime;
+      result.completionTime += playTime;
+      ++result.completed;
+    }
+    result.score += game.score();
+    result.blocksRemaining += game.blockCount();
+    result.steps += steps;
+    result.stepTime += stepTime;
+#ifndef NDEBUG
+    std::cout << session.levelZip << " run " << run << ": "
+      << (game.isLevelCompleted() ? "completed" : (game.isGameOver() ? "game over" : "timed out"))
+      << " after " << playTime.asSeconds() << "s, score " << game.score() << std::endl;
+#endif
+  }
+
+
+  bool Playtest::save(const std::string &csvFilename) const
+  {
+    std::ofstream out(csvFilename);
+    if (!out.is_open()) {
+      std::cerr << "Cannot write " << csvFilename << std::endl;
+      return false;
+    }
+    out << "level,hash,runs,completed,fastest_s,mean_completion_s,mean_score,mean_blocks_remaining,mean_step_us" << std::endl;
+    for (std::vector<PlaytestResult>::const_iterator r = mResults.cbegin(); r != mResults.cend(); ++r) {
+      out << r->zipFilename << "," << r->hash << "," << r->runs << "," << r->completed << ",";
+      if (r->completed > 0)
+        out << r->fastestCompletion.asSeconds() << "," << r->completionTime.asSeconds() / r->completed;
+      else
+        out << ",";
+      out << ",";
+      if (r->runs > 0)
+        out << double(r->score) / r->runs << "," << double(r->blocksRemaining) / r->runs;
+      else
+        out << ",";
+      out << ",";
+      if (r->steps > 0)
+        out << double(r->stepTime.asMicroseconds()) / r->steps;
+      out << std::endl;
+    }
+    return true;
+  }
+
+}
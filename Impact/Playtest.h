@@ -0,0 +1,154 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef __PLAYTEST_H_
+#define __PLAYTEST_H_
+
+#include <SFML/System.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include "Replay.h"
+
+namespace Impact {
+
+  class Game;
+
+
+  /// steers the racket of a headless game in place of a player
+  class RacketPolicy {
+  public:
+    virtual ~RacketPolicy() { /* ... */ }
+    /// called before every run with the seed of that run
+    virtual void reset(uint32_t seed) = 0;
+    /// fills in the racket target and buttons for the next step
+    virtual void control(const Game &game, InputState &input) = 0;
+
+    static RacketPolicy *create(const std::string &name);
+  };
+
+
+  /// moves the racket to where the most urgent ball will cross its line
+  /// and kicks once the ball is close
+  class TrackingPolicy : public RacketPolicy {
+  public:
+    static const float DefaultKickDistance;
+
+    TrackingPolicy(void);
+    virtual void reset(uint32_t seed);
+    virtual void control(const Game &game, InputState &input);
+
+  private:
+    float mHomeY;
+    float mAimOffset;
+  };
+
+
+  /// sweeps the racket from wall to wall, kicking at every turn
+  class SweepPolicy : public RacketPolicy {
+  public:
+    static const int DefaultStepsPerSweep = 240;
+
+    SweepPolicy(void);
+    virtual void reset(uint32_t seed);
+    virtual void control(const Game &game, InputState &input);
+
+  private:
+    float mHomeY;
+    int mStep;
+    int mPhase;
+  };
+
+
+  struct PlaytestConfig {
+    PlaytestConfig(void);
+    std::vector<std::string> levels;
+    int runs;
+    int threads;
+    sf::Time timeLimit;
+    std::string policy;
+    uint32_t seed;
+    int32_t velocityIterations;
+    int32_t positionIterations;
+    uint32_t particlesPerExplosion;
+    /// read from the local settings up front, because the workers must not touch them
+    std::string levelsDir;
+    std::string levelCacheDir;
+  };
+
+
+  /// the outcome of all runs on one level
+  struct PlaytestResult {
+    PlaytestResult(void)
+      : runs(0)
+      , completed(0)
+      , score(0)
+      , blocksRemaining(0)
+      , steps(0)
+    { /* ... */ }
+    std::string zipFilename;
+    std::string hash;
+    int runs;
+    int completed;
+    sf::Time fastestCompletion;
+    sf::Time completionTime;
+    int64_t score;
+    int64_t blocksRemaining;
+    int64_t steps;
+    sf::Time stepTime;
+  };
+
+
+  /* Plays every level a number of times with a racket policy instead of a
+   * player. Each worker thread owns a headless game with a world of its own
+   * and takes (level, run) pairs off a shared counter. Runs are seeded from
+   * the base seed and the run index, so the results only depend on the
+   * configuration, not on the number of threads.
+   */
+  class Playtest {
+  public:
+    Playtest(const PlaytestConfig &config);
+
+    bool run(void);
+    bool save(const std::string &csvFilename) const;
+
+    inline const std::vector<PlaytestResult> &results(void) const
+    {
+      return mResults;
+    }
+
+  private:
+    PlaytestConfig mConfig;
+    std::vector<PlaytestResult> mResults;
+    std::mutex mResultsMutex;
+    std::atomic<int> mNextTask;
+
+    void work(void);
+    void simulate(Game &game, RacketPolicy &policy, int level, int run);
+  };
+
+}
+
+#endif // __PLAYTEST_H_
@@ -31,12 +31,17 @@ namespace Impact {
     : Body(Body::BodyType::Racket, game, tileParam)
   {
     mName = Name;
-    mTexture = mGame->level()->texture(mName);
-    setSmooth(mTileParam.smooth);
-    mSprite.setTexture(mTexture);
-    mSprite.setOrigin(sf::Vector2f(.5f * mTexture.getSize().x, .5f * mTexture.getSize().y));
-
-    setHalfTextureSize(mTexture);
+    mZIndex = PlayerLayer;
+    mSize = mGame->level()->textureSize(mName);
+    setHalfTextureSize(mSize);
+
+    // headless games never draw, so they need no textures of their own
+    if (!mGame->isHeadless()) {
+      mTexture = mGame->level()->texture(mName);
+      setSmooth(mTileParam.smooth);
+      mSprite.setTexture(mTexture);
+      mSprite.setOrigin(sf::Vector2f(.5f * mTexture.getSize().x, .5f * mTexture.getSize().y));
+    }
 
     b2BodyDef bd;
     bd.type = b2_dynamicBody;
@@ -45,8 +50,8 @@ namespace Impact {
 
     b2PolygonShape polygon;
     const float32 hs = .5f * Game::InvScale;
-    const float32 hh = hs * mTexture.getSize().y;
-    const float32 xoff = hs * (mTexture.getSize().x - mTexture.getSize().y);
+    const float32 hh = hs * mSize.y;
+    const float32 xoff = hs * (mSize.x - mSize.y);
     polygon.SetAsBox(xoff, hh);
 
     const float32 density = tileParam.density.isValid() ? tileParam.density.get() : DefaultDensity;
@@ -127,8 +132,8 @@ namespace Impact {
 
   void Racket::setXAxisConstraint(float32 y)
   {
-    const float32 W = float32(mTexture.getSize().x);
-    const float32 H = float32(mTexture.getSize().y);
+    const float32 W = float32(mSize.x);
+    const float32 H = float32(mSize.y);
     b2BodyDef bd;
     bd.position.y = y;
     b2Body *xAxis = mGame->world()->CreateBody(&bd);
@@ -60,6 +60,8 @@ namespace Impact {
     b2Body *mTiltingBody;
     b2MouseJoint *mMouseJoint;
     mutable b2AABB mAABB;
+    // of the texture, which headless games don't have
+    sf::Vector2u mSize;
   };
 
 }
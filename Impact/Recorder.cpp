@@ -37,6 +37,65 @@ extern "C" {
 
 namespace Impact {
 
+  static inline int64_t toMicroseconds(const PipelineClock::duration &d)
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+  }
+
+
+  static inline void updateMaximum(std::atomic<int64_t> &maximum, int64_t value)
+  {
+    int64_t current = maximum.load(std::memory_order_relaxed);
+    while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed))
+      /**/;
+  }
+
+
+  LatencyCounter::LatencyCounter(void)
+    : mFrames(0)
+    , mDropped(0)
+    , mTotalWait(0)
+    , mMaxWait(0)
+    , mTotalBusy(0)
+    , mMaxBusy(0)
+  {
+    // ...
+  }
+
+
+  void LatencyCounter::record(const PipelineClock::duration &wait, const PipelineClock::duration &busy)
+  {
+    const int64_t waitUs = toMicroseconds(wait);
+    const int64_t busyUs = toMicroseconds(busy);
+    mTotalWait.fetch_add(waitUs, std::memory_order_relaxed);
+    mTotalBusy.fetch_add(busyUs, std::memory_order_relaxed);
+    updateMaximum(mMaxWait, waitUs);
+    updateMaximum(mMaxBusy, busyUs);
+    mFrames.fetch_add(1, std::memory_order_relaxed);
+  }
+
+
+  void LatencyCounter::drop(void)
+  {
+    mDropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+
+  StageStats LatencyCounter::stats(void) const
+  {
+    StageStats s;
+    s.frames = mFrames.load(std::memory_order_relaxed);
+    s.dropped = mDropped.load(std::memory_order_relaxed);
+    if (s.frames > 0) {
+      s.avgWaitMicroseconds = mTotalWait.load(std::memory_order_relaxed) / s.frames;
+      s.avgBusyMicroseconds = mTotalBusy.load(std::memory_order_relaxed) / s.frames;
+    }
+    s.maxWaitMicroseconds = mMaxWait.load(std::memory_order_relaxed);
+    s.maxBusyMicroseconds = mMaxBusy.load(std::memory_order_relaxed);
+    return s;
+  }
+
+
   static int write_frame(AVFormatContext *fmt_ctx, const AVRational *time_base, AVStream *st, AVPacket *pkt)
   {
     /* rescale output packet timestamp values from codec to stream timebase */
@@ -46,92 +105,106 @@ namespace Impact {
   }
 
 
-  Recorder::Recorder(Game *game)
+  static AVSampleFormat chooseSampleFormat(const AVCodec *codec)
+  {
+    static const AVSampleFormat Preferred[] = { AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_S16P };
+    if (codec->sample_fmts == nullptr)
+      return AV_SAMPLE_FMT_S16;
+    for (size_t i = 0; i < sizeof(Preferred) / sizeof(Preferred[0]); ++i) {
+      for (const AVSampleFormat *fmt = codec->sample_fmts; *fmt != AV_SAMPLE_FMT_NONE; ++fmt) {
+        if (*fmt == Preferred[i])
+          return *fmt;
+      }
+    }
+    return AV_SAMPLE_FMT_NONE;
+  }
+
+
+  static inline float clampSample(float sample)
+  {
+    return std::max(-1.f, std::min(1.f, sample));
+  }
+
+
+  /// convert the mixer's interleaved stereo samples into the encoder's sample format
+  static void storeSamples(const float *src, AVFrame *frame)
+  {
+    const int n = frame->nb_samples;
+    switch (frame->format) {
+    case AV_SAMPLE_FMT_FLT:
+    {
+      float *dst = reinterpret_cast<float*>(frame->data[0]);
+      for (int i = 0; i < 2 * n; ++i)
+        dst[i] = clampSample(src[i]);
+      break;
+    }
+    case AV_SAMPLE_FMT_FLTP:
+    {
+      float *left = reinterpret_cast<float*>(frame->data[0]);
+      float *right = reinterpret_cast<float*>(frame->data[1]);
+      for (int i = 0; i < n; ++i) {
+        left[i] = clampSample(src[2 * i]);
+        right[i] = clampSample(src[2 * i + 1]);
+      }
+      break;
+    }
+    case AV_SAMPLE_FMT_S16:
+    {
+      int16_t *dst = reinterpret_cast<int16_t*>(frame->data[0]);
+      for (int i = 0; i < 2 * n; ++i)
+        dst[i] = int16_t(32767.f * clampSample(src[i]));
+      break;
+    }
+    case AV_SAMPLE_FMT_S16P:
+    {
+      int16_t *left = reinterpret_cast<int16_t*>(frame->data[0]);
+      int16_t *right = reinterpret_cast<int16_t*>(frame->data[1]);
+      for (int i = 0; i < n; ++i) {
+        left[i] = int16_t(32767.f * clampSample(src[2 * i]));
+        right[i] = int16_t(32767.f * clampSample(src[2 * i + 1]));
+      }
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+
+  const std::string Recorder::DefaultFilename = "recordings/blah.avi";
+
+
+  Recorder::Recorder(Game *game, const std::string &filename, int width, int height)
     : mGame(game)
+    , mFilename(filename)
+    , mWidth(width & ~1) // YUV 4:2:0 needs even dimensions
+    , mHeight(height & ~1)
     , mDoQuit(false)
-    , mAudioClient(nullptr)
-    , mCaptureClient(nullptr)
-    , mRecThread(nullptr)
     , mAudioCtx(nullptr)
     , mAudioCodec(nullptr)
-    , mAudioFile(nullptr)
+    , mAudioOutStream(nullptr)
+    , mAudioFrame(nullptr)
     , mVideoCtx(nullptr)
     , mVideoCodec(nullptr)
     , mVideoOutContainer(nullptr)
     , mVideoOutStream(nullptr)
-    , mSamples(nullptr)
-    , mSamplesEnd(nullptr)
-    , mCurrentFrame(nullptr)
-    , mAudioFrame(nullptr)
-    , mBufferSize(0)
-    , mNewVideoFrameAvailable(false)
+    , mSwsCtx(nullptr)
+    , mBackPressurePolicy(DropFrame)
+    , mVideoFrames(DefaultVideoQueueSize)
+    , mConvertedFrames(DefaultVideoQueueSize)
+    , mFreeYUVFrames(DefaultVideoQueueSize)
+    , mEncodedPackets(DefaultPacketQueueSize)
+    , mConversionThread(nullptr)
+    , mEncoderThread(nullptr)
+    , mMuxerThread(nullptr)
+    , mConversionDone(false)
+    , mEncodingDone(false)
   {
     avcodec_register_all();
     av_register_all();
 
-    HRESULT hr;
-    const CLSID CLSID_MMDeviceEnumerator = __uuidof(MMDeviceEnumerator);
-    const IID IID_IMMDeviceEnumerator = __uuidof(IMMDeviceEnumerator);
-    const IID IID_IAudioClient = __uuidof(IAudioClient);
-    const IID IID_IAudioCaptureClient = __uuidof(IAudioCaptureClient);
-
-    mActualDuration = 0;
-    UINT32 bufferFrameCount;
-    IMMDeviceEnumerator *pEnumerator = nullptr;
-    IMMDevice *pDevice = nullptr;
-
-    hr = CoCreateInstance(CLSID_MMDeviceEnumerator, NULL, CLSCTX_ALL, IID_IMMDeviceEnumerator, (void**)&pEnumerator);
-    if (FAILED(hr)) {
-      std::cerr << "CoCreateInstance() failed in line " << __LINE__ << std::endl;
-      return;
-    }
-
-    hr = pEnumerator->GetDefaultAudioEndpoint(eRender, eConsole, &pDevice);
-    if (FAILED(hr)) {
-      std::cerr << "pEnumerator->GetDefaultAudioEndpoint() failed in line " << __LINE__ << std::endl;
-      return;
-    }
-
-    hr = pDevice->Activate(IID_IAudioClient, CLSCTX_ALL, NULL, (void**)&mAudioClient);
-    if (FAILED(hr)) {
-      std::cerr << "pDevice->Activate() failed in line " << __LINE__ << std::endl;
-      return;
-    }
-
-    hr = mAudioClient->GetMixFormat(&mWFX);
-    if (FAILED(hr)) {
-      std::cerr << "pAudioClient->GetMixFormat() failed in line " << __LINE__ << std::endl;
-      return;
-    }
-
-    hr = mAudioClient->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_LOOPBACK, mActualDuration, 0, mWFX, NULL);
-    if (FAILED(hr)) {
-      std::cerr << "mAudioClient->Initialize() failed in line " << __LINE__ << std::endl;
-      return;
-    }
-
-    hr = mAudioClient->GetBufferSize(&bufferFrameCount);
-    if (FAILED(hr)) {
-      std::cerr << "pAudioClient->GetBufferSize() failed in line " << __LINE__ << std::endl;
-      return;
-    }
-
-    hr = mAudioClient->GetService(IID_IAudioCaptureClient, (void**)&mCaptureClient);
-    if (FAILED(hr)) {
-      std::cerr << "pAudioClient->GetService() failed in line " << __LINE__ << std::endl;
-      return;
-    }
-
-    mActualDuration = 1000 * bufferFrameCount / mWFX->nSamplesPerSec;
-
-    hr = this->start();
-    if (FAILED(hr)) {
+    if (!this->start())
       std::cerr << "this->start() failed in line " << __LINE__ << std::endl;
-      return;
-    }
-
-    safeRelease(pEnumerator);
-    safeRelease(pDevice);
   }
 
 
@@ -141,12 +214,6 @@ namespace Impact {
     std::cout << "Recorder::~Recorder()" << std::endl;
 #endif
     this->stop();
-    safeDelete(mRecThread);
-#if defined(WIN32)
-    CoTaskMemFree(mWFX);
-    safeRelease(mAudioClient);
-    safeRelease(mCaptureClient);
-#endif
   }
 
 
@@ -156,129 +223,31 @@ namespace Impact {
   }
 
 
-  void Recorder::capture(void)
-  {
-    HRESULT hr = S_OK;
-    UINT32 packetLength = 0;
-    while (!mDoQuit) {
-      hr = mCaptureClient->GetNextPacketSize(&packetLength);
-      if (FAILED(hr))
-        mDoQuit = true;
-      BYTE *pData;
-      UINT32 numAudioFramesAvailable;
-      DWORD flags;
-      while (packetLength != 0 && !mDoQuit) {
-        hr = mCaptureClient->GetBuffer(&pData, &numAudioFramesAvailable, &flags, NULL, NULL);
-        if (FAILED(hr))
-          std::cerr << "mCaptureClient->GetBuffer() failed on line " << __LINE__ << std::endl;
-        if (flags & AUDCLNT_BUFFERFLAGS_SILENT)
-          pData = nullptr;
-        hr = copyAudioData(reinterpret_cast<float32*>(pData), numAudioFramesAvailable);
-        if (FAILED(hr))
-          std::cerr << "copyAudioData() failed on line " << __LINE__ << std::endl;
-        hr = mCaptureClient->ReleaseBuffer(numAudioFramesAvailable);
-        if (FAILED(hr))
-          std::cerr << "mCaptureClient->ReleaseBuffer() failed on line " << __LINE__ << std::endl;
-        hr = mCaptureClient->GetNextPacketSize(&packetLength);
-        if (FAILED(hr))
-          std::cerr << "mCaptureClient->GetNextPacketSize() failed on line " << __LINE__ << std::endl;
-      }
-      // Sleep(mActualDuration / 2);
-      // Sleep(1000 / 100);
-    }
-    hr = mAudioClient->Stop();
-    if (FAILED(hr))
-      std::cerr << "mAudioClient->Stop() failed on line " << __LINE__ << std::endl;
-  }
-
-
-  HRESULT Recorder::start(void)
+  bool Recorder::start(void)
   {
     int ret;
 
-    if (mRecThread != nullptr)
-      return S_FALSE;
+    if (mEncoderThread != nullptr)
+      return false;
 
     mDoQuit = false;
-    mRecThread = new std::thread(&Recorder::capture, this);
-
-    mAudioCodec = avcodec_find_encoder(AV_CODEC_ID_AAC);
-    if (mAudioCodec == nullptr) {
-      std::cerr << "avcodec_find_encoder() failed in line " << __LINE__ << std::endl;
-      return S_FALSE;
-    }
-
-    mAudioCtx = avcodec_alloc_context3(mAudioCodec);
-    if (!mAudioCtx) {
-      std::cerr << "avcodec_alloc_context3() failed in line " << __LINE__ << std::endl;
-      return S_FALSE;
-    }
 
-    mAudioCtx->bit_rate = 160 * 1000;
-    mAudioCtx->sample_fmt = AV_SAMPLE_FMT_S16;
-    mAudioCtx->sample_rate = mWFX->nSamplesPerSec;
-    mAudioCtx->profile = FF_PROFILE_AAC_MAIN;
-    mAudioCtx->channel_layout = AV_CH_LAYOUT_STEREO;
-    mAudioCtx->channels = av_get_channel_layout_nb_channels(mAudioCtx->channel_layout);
-
-    ret = avcodec_open2(mAudioCtx, mAudioCodec, NULL);
+    ret = avformat_alloc_output_context2(&mVideoOutContainer, NULL, NULL, mFilename.c_str());
     if (ret < 0) {
-      std::cerr << "avcodec_open2() failed in line " << __LINE__ << std::endl;
-      return S_FALSE;
-    }
-
-    mAudioFile = fopen("recordings/blah.aac", "wb+");
-    if (!mAudioFile) {
-      std::cerr << "fopen() failed in line " << __LINE__ << std::endl;
-      return S_FALSE;
-    }
-
-    mAudioFrame = av_frame_alloc();
-    if (!mAudioFrame) {
-      std::cerr << "Could not allocate audio frame in line " << __LINE__ << std::endl;
-      return S_FALSE;
-    }
-    mAudioFrame->nb_samples = mAudioCtx->frame_size;
-    mAudioFrame->format = mAudioCtx->sample_fmt;
-    mAudioFrame->channel_layout = mAudioCtx->channel_layout;
-
-    mBufferSize = av_samples_get_buffer_size(NULL, mAudioCtx->channels, mAudioCtx->frame_size, mAudioCtx->sample_fmt, 0);
-    if (mBufferSize < 0) {
-      std::cerr << "Could not get sample buffer size in line " << __LINE__ << std::endl;
-      return S_FALSE;
-    }
-
-    mSamples = (uint8_t*)av_malloc(2 * mBufferSize);
-    if (!mSamples) {
-      std::cerr << "Could not allocate " << mBufferSize << " bytes for samples buffer in line " << __LINE__ << std::endl;
-      return S_FALSE;
-    }
-    mSamplesEnd = mSamples + mBufferSize;
-    mCurrentFrame = mSamples;
-
-    ret = avcodec_fill_audio_frame(mAudioFrame, mAudioCtx->channels, mAudioCtx->sample_fmt, (const uint8_t*)mSamples, mBufferSize, 0);
-    if (ret < 0) {
-      std::cerr << "Could not setup audio frame in line " << __LINE__ << std::endl;
-      return S_FALSE;
+      std::cerr << "avformat_alloc_output_context2() failed in line " << __LINE__ << std::endl;
+      return false;
     }
 
     mVideoCodec = avcodec_find_encoder(AV_CODEC_ID_H264);
     if (mVideoCodec == nullptr) {
       std::cerr << "avcodec_find_encoder(AV_CODEC_ID_H264) failed in line " << __LINE__ << std::endl;
-      return S_FALSE;
-    }
-
-    static const char *VideoOutFilename = "recordings/blah.avi";
-    ret = avformat_alloc_output_context2(&mVideoOutContainer, NULL, NULL, VideoOutFilename);
-    if (ret < 0) {
-      std::cerr << "avformat_alloc_output_context2() failed in line " << __LINE__ << std::endl;
-      return S_FALSE;
+      return false;
     }
 
     mVideoOutStream = avformat_new_stream(mVideoOutContainer, mVideoCodec);
     if (!mVideoOutStream) {
       std::cerr << "avformat_new_stream() failed in line " << __LINE__ << std::endl;
-      return S_FALSE;
+      return false;
     }
 
     mVideoCtx = mVideoOutStream->codec;
@@ -290,12 +259,13 @@ namespace Impact {
       mVideoOutStream->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
     mVideoOutStream->time_base = timeBase();
 
+    mVideoOutStream->codec->time_base = timeBase();
     mVideoOutStream->codec->coder_type = AVMEDIA_TYPE_VIDEO;
     mVideoOutStream->codec->pix_fmt = AV_PIX_FMT_YUV420P;
-    mVideoOutStream->codec->width = 640;
-    mVideoOutStream->codec->height = 480;
+    mVideoOutStream->codec->width = mWidth;
+    mVideoOutStream->codec->height = mHeight;
     mVideoOutStream->codec->codec_id = mVideoCodec->id;
-    mVideoOutStream->codec->bit_rate = 400000;
+    mVideoOutStream->codec->bit_rate = int(400000LL * mWidth * mHeight / (DefaultVideoWidth * DefaultVideoHeight));
     mVideoOutStream->codec->gop_size = 250;
     mVideoOutStream->codec->keyint_min = 25;
     mVideoOutStream->codec->max_b_frames = 3;
@@ -321,219 +291,399 @@ namespace Impact {
 
     if (avcodec_open2(mVideoOutStream->codec, mVideoCodec, NULL) < 0) {
       std::cerr << "avcodec_open2() failed in line " << __LINE__ << std::endl;
-      return S_FALSE;
+      return false;
     }
 
-    if (avio_open2(&mVideoOutContainer->pb, VideoOutFilename, AVIO_FLAG_WRITE, nullptr, nullptr) < 0) {
-      std::cerr << "avio_open2() failed in line " << __LINE__ << std::endl;
-      return S_FALSE;
+    mAudioCodec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+    if (mAudioCodec == nullptr) {
+      std::cerr << "avcodec_find_encoder() failed in line " << __LINE__ << std::endl;
+      return false;
     }
-    avformat_write_header(mVideoOutContainer, NULL);
 
-    mVideoFrame = av_frame_alloc();
-    if (!mVideoFrame) {
-      std::cerr << "Could not allocate video frame in line " << __LINE__ << std::endl;
-      return S_FALSE;
+    mAudioOutStream = avformat_new_stream(mVideoOutContainer, mAudioCodec);
+    if (!mAudioOutStream) {
+      std::cerr << "avformat_new_stream() failed in line " << __LINE__ << std::endl;
+      return false;
+    }
+
+    mAudioCtx = mAudioOutStream->codec;
+    avcodec_get_context_defaults3(mAudioCtx, mAudioCodec);
+    if (mVideoOutContainer->oformat->flags & AVFMT_GLOBALHEADER)
+      mAudioCtx->flags |= CODEC_FLAG_GLOBAL_HEADER;
+
+    mAudioCtx->bit_rate = 160 * 1000;
+    mAudioCtx->sample_fmt = chooseSampleFormat(mAudioCodec);
+    if (mAudioCtx->sample_fmt == AV_SAMPLE_FMT_NONE) {
+      std::cerr << "No suitable sample format for " << mAudioCodec->name << " in line " << __LINE__ << std::endl;
+      return false;
     }
-    mVideoFrame->format = mVideoCtx->pix_fmt;
-    mVideoFrame->width = mVideoCtx->width;
-    mVideoFrame->height = mVideoCtx->height;
-
-    mRGBFrame = av_frame_alloc();
-    if (!mRGBFrame) {
-      std::cerr << "Could not allocate video frame in line " << __LINE__ << std::endl;
-      return S_FALSE;
+    mAudioCtx->sample_rate = mMixer.sampleRate();
+    mAudioCtx->channel_layout = AV_CH_LAYOUT_STEREO;
+    mAudioCtx->channels = av_get_channel_layout_nb_channels(mAudioCtx->channel_layout);
+    mAudioCtx->time_base = av_make_q(1, mAudioCtx->sample_rate);
+    mAudioOutStream->time_base = mAudioCtx->time_base;
+    // ffmpeg's own AAC encoder is still marked experimental
+    mAudioCtx->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+
+    ret = avcodec_open2(mAudioCtx, mAudioCodec, NULL);
+    if (ret < 0) {
+      std::cerr << "avcodec_open2() failed in line " << __LINE__ << std::endl;
+      return false;
     }
 
-    mSwsCtx = sws_getCachedContext(nullptr,
-      mVideoCtx->width, mVideoCtx->height, PIX_FMT_RGBA,
-      mVideoCtx->width, mVideoCtx->height, PIX_FMT_YUV420P,
-      SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+    mAudioFrame = av_frame_alloc();
+    if (!mAudioFrame) {
+      std::cerr << "Could not allocate audio frame in line " << __LINE__ << std::endl;
+      return false;
+    }
+    mAudioFrame->nb_samples = mAudioCtx->frame_size > 0 ? mAudioCtx->frame_size : DefaultAudioFrameSize;
+    mAudioFrame->format = mAudioCtx->sample_fmt;
+    mAudioFrame->channel_layout = mAudioCtx->channel_layout;
+    mAudioFrame->channels = mAudioCtx->channels;
+    mAudioFrame->sample_rate = mAudioCtx->sample_rate;
 
-    ret = av_image_alloc(mVideoFrame->data, mVideoFrame->linesize, mVideoCtx->width, mVideoCtx->height, mVideoCtx->pix_fmt, 32);
+    ret = av_frame_get_buffer(mAudioFrame, 0);
     if (ret < 0) {
-      std::cerr << "Could not allocate raw picture buffer in line " << __LINE__ << std::endl;
-      return S_FALSE;
+      std::cerr << "Could not allocate audio samples in line " << __LINE__ << std::endl;
+      return false;
     }
-#endif
+    mMixBuffer.resize(mAudioFrame->nb_samples * AudioMixer::ChannelCount);
 
-    mVideoFrameNumber = 0;
+    if (avio_open2(&mVideoOutContainer->pb, mFilename.c_str(), AVIO_FLAG_WRITE, nullptr, nullptr) < 0) {
+      std::cerr << "avio_open2() failed in line " << __LINE__ << std::endl;
+      return false;
+    }
+    avformat_write_header(mVideoOutContainer, NULL);
 
-    HRESULT hr;
-    hr = mAudioClient->Start();
-    if (FAILED(hr)) {
-      std::cerr << "mAudioClient->Start() failed on line " << __LINE__ << std::endl;
-      return S_FALSE;
+    // as many YUV frames as fit into the queue to the encoder, so that pushing to it never fails
+    for (int i = 0; i < DefaultVideoQueueSize; ++i) {
+      AVFrame *frame = av_frame_alloc();
+      if (!frame) {
+        std::cerr << "Could not allocate video frame in line " << __LINE__ << std::endl;
+        return false;
+      }
+      mYUVFrames.push_back(frame);
+      frame->format = mVideoCtx->pix_fmt;
+      frame->width = mVideoCtx->width;
+      frame->height = mVideoCtx->height;
+      ret = av_image_alloc(frame->data, frame->linesize, mVideoCtx->width, mVideoCtx->height, mVideoCtx->pix_fmt, 32);
+      if (ret < 0) {
+        std::cerr << "Could not allocate raw picture buffer in line " << __LINE__ << std::endl;
+        return false;
+      }
+      mFreeYUVFrames.push(frame);
     }
+#endif
+
+    mVideoFrameNumber = 0;
+    mPTS = sf::Time::Zero;
 
 #ifndef NDEBUG
-    std::cout << "AUDIO INPUT:" << std::endl
-      << "mActualDuration: " << mActualDuration << std::endl
-      << "wFormatTag:      " << std::showbase << std::internal << std::hex << std::setw(4) << mWFX->wFormatTag << std::endl << std::dec
-      << "nChannels:       " << mWFX->nChannels << std::endl
-      << "nSamplesPerSec:  " << mWFX->nSamplesPerSec << std::endl
-      << "nAvgBytesPerSec: " << mWFX->nAvgBytesPerSec << std::endl
-      << "nBlockAlign:     " << mWFX->nBlockAlign << std::endl
-      << "wBitsPerSample:  " << mWFX->wBitsPerSample << std::endl
-      << "cbSize:          " << mWFX->cbSize << std::endl;
     std::cout << "AUDIO OUTPUT:" << std::endl
       << "mAudioCtx->frame_size:       " << mAudioCtx->frame_size << std::endl
+      << "mAudioCtx->sample_fmt:       " << av_get_sample_fmt_name(mAudioCtx->sample_fmt) << std::endl
+      << "mAudioCtx->sample_rate:      " << mAudioCtx->sample_rate << std::endl
       << "mAudioCtx->channels:         " << mAudioCtx->channels << std::endl
-      << "mAudioCtx->channel_layout:   " << mAudioCtx->channel_layout << std::endl
-      << "mBufferSize:     " << mBufferSize << std::endl;
+      << "mAudioCtx->channel_layout:   " << mAudioCtx->channel_layout << std::endl;
 #endif
 
 
     av_dump_format(mVideoOutContainer, 0, 0, 1);
 
-    return S_OK;
+    mConversionDone = false;
+    mEncodingDone = false;
+    mConversionThread = new std::thread(&Recorder::convertFrames, this);
+    mEncoderThread = new std::thread(&Recorder::encodeFrames, this);
+    mMuxerThread = new std::thread(&Recorder::muxPackets, this);
+
+    return true;
   }
 
 
-  HRESULT Recorder::stop(void)
+  bool Recorder::stop(void)
   {
-    if (mRecThread != nullptr) {
+    if (mEncoderThread != nullptr) {
 #ifndef NDEBUG
       std::cout << "Recorder::stop() ..." << std::endl;
 #endif
       mDoQuit = true;
-      mRecThread->join();
+      mVideoFramePushed.notify();
+      mVideoFramePopped.notify();
+      // the video threads drain their queues before they return
+      mConversionThread->join();
+      safeDelete(mConversionThread);
+      mEncoderThread->join();
+      safeDelete(mEncoderThread);
+      mMuxerThread->join();
+      safeDelete(mMuxerThread);
 #ifndef NDEBUG
-      std::cout << "mRecThread returned." << std::endl;
+      static const char *StageNames[StageCount] = { "capture", "conversion", "encoding", "muxing" };
+      for (int i = 0; i < StageCount; ++i) {
+        const StageStats &s = mLatency[i].stats();
+        std::cout << "Recorder " << StageNames[i] << ": " << s.frames << " frames, " << s.dropped << " dropped"
+          << ", wait avg " << s.avgWaitMicroseconds << " us max " << s.maxWaitMicroseconds << " us"
+          << ", busy avg " << s.avgBusyMicroseconds << " us max " << s.maxBusyMicroseconds << " us" << std::endl;
+      }
 #endif
-      safeDelete(mRecThread);
 
-      fclose(mAudioFile);
+      av_write_trailer(mVideoOutContainer);
+      avio_close(mVideoOutContainer->pb);
 
-      av_free(mSamples);
       av_frame_free(&mAudioFrame);
       avcodec_close(mAudioCtx);
-      av_free(mAudioCtx);
-
-      av_write_trailer(mVideoOutContainer);
-      avio_close(mVideoOutContainer->pb);
 
-      av_frame_free(&mVideoFrame);
-      av_frame_free(&mRGBFrame);
+      AVFrame *frame;
+      while (mFreeYUVFrames.pop(frame))
+        /**/;
+      for (std::vector<AVFrame*>::iterator f = mYUVFrames.begin(); f != mYUVFrames.end(); ++f) {
+        av_freep(&(*f)->data[0]);
+        av_frame_free(&(*f));
+      }
+      mYUVFrames.clear();
+      sws_freeContext(mSwsCtx);
+      mSwsCtx = nullptr;
       
       // av_free(mVideoCtx);
       // avformat_free_context(mVideoOutContainer);
     }
-    return S_OK;
+    return true;
   }
 
 
+  void Recorder::convertFrames(void)
+  {
+    PendingFrame pending;
+    for (;;) {
+      if (!mVideoFrames.pop(pending)) {
+        // the render thread has stopped pushing before mDoQuit is set, so one more look suffices
+        if (!mDoQuit) {
+          mVideoFramePushed.wait();
+          continue;
+        }
+        if (!mVideoFrames.pop(pending))
+          break;
+      }
+      mVideoFramePopped.notify();
+      const PipelineClock::time_point t0 = PipelineClock::now();
+      AVFrame *yuv = nullptr;
+      while (!mFreeYUVFrames.pop(yuv)) {
+        // all YUV frames are queued for or held by the encoder
+        if (mBackPressurePolicy == DropFrame)
+          break;
+        mYUVFrameFreed.wait();
+      }
+      if (yuv == nullptr) {
+        mLatency[ConversionStage].drop();
+        continue;
+      }
+
+      const VideoFrame &frame = *pending.frame;
+      mSwsCtx = sws_getCachedContext(mSwsCtx,
+        frame.width, frame.height, PIX_FMT_RGBA,
+        mVideoCtx->width, mVideoCtx->height, PIX_FMT_YUV420P,
+        SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+      // the rows come bottom-up from the frame buffer, so start at the top row and walk backwards
+      const uint8_t *src[4] = { frame.topRow(), nullptr, nullptr, nullptr };
+      const int srcStride[4] = { -frame.stride(), 0, 0, 0 };
+      sws_scale(mSwsCtx, src, srcStride, 0, frame.height, yuv->data, yuv->linesize);
+
+      ConvertedFrame converted;
+      converted.frame = yuv;
+      converted.timestamp = frame.timestamp;
+      pending.frame.reset(); // back to the grabber's pool
+      converted.queued = PipelineClock::now();
+      mConvertedFrames.push(converted);
+      mFrameConverted.notify();
+      mLatency[ConversionStage].record(t0 - pending.queued, converted.queued - t0);
+    }
+    mConversionDone = true;
+    mFrameConverted.notify();
+  }
+
 
-  HRESULT Recorder::copyAudioData(float32 *pData, UINT32 nFrames)
+  void Recorder::encodeFrames(void)
   {
-    // pData contains nFrames frames of float32 samples
-    const int nBytesPerOutputFrame = sizeof(sample_t) * mWFX->nChannels;
-    const int nOutputBufSize = nFrames * nBytesPerOutputFrame;
-    sample_t *dst = reinterpret_cast<sample_t*>(mCurrentFrame);
-    if (pData != nullptr) {
-      const float32 *src = reinterpret_cast<float32*>(pData);
-      for (UINT32 i = 0; i < nFrames; ++i) {
-        for (WORD j = 0; j < mWFX->nChannels; ++j) {
-          const sample_t sample = int(std::numeric_limits<sample_t>::max() * (*src++));
-          *dst++ = sample;
+    ConvertedFrame converted;
+    for (;;) {
+      if (!mConvertedFrames.pop(converted)) {
+        if (!mConversionDone) {
+          mFrameConverted.wait();
+          continue;
         }
+        if (!mConvertedFrames.pop(converted))
+          break;
       }
+      const PipelineClock::time_point t0 = PipelineClock::now();
+      encodeVideoFrame(converted.frame, converted.timestamp);
+      mFreeYUVFrames.push(converted.frame);
+      mYUVFrameFreed.notify();
+      mLatency[EncodingStage].record(t0 - converted.queued, PipelineClock::now() - t0);
+      // the audio follows the video's time stamps, so both end up on the same time line
+      encodeAudio(converted.timestamp);
     }
-    else { // pData == 0, write silence
-      memset(dst, 0, nOutputBufSize);
+
+    // flush the frames delayed by the encoders
+    int gotOutput;
+    do {
+      AVPacket pkt;
+      av_init_packet(&pkt);
+      pkt.data = nullptr;
+      pkt.size = 0;
+      gotOutput = 0;
+      if (avcodec_encode_video2(mVideoCtx, &pkt, nullptr, &gotOutput) < 0) {
+        std::cerr << "Error flushing encoder in line " << __LINE__ << std::endl;
+        break;
+      }
+      if (gotOutput)
+        queuePacket(&pkt, mVideoOutStream, mVideoCtx->time_base);
+    } while (gotOutput);
+
+    do {
+      AVPacket pkt;
+      av_init_packet(&pkt);
+      pkt.data = nullptr;
+      pkt.size = 0;
+      gotOutput = 0;
+      if (avcodec_encode_audio2(mAudioCtx, &pkt, nullptr, &gotOutput) < 0) {
+        std::cerr << "Error flushing encoder in line " << __LINE__ << std::endl;
+        break;
+      }
+      if (gotOutput)
+        queuePacket(&pkt, mAudioOutStream, mAudioCtx->time_base);
+    } while (gotOutput);
+
+    mEncodingDone = true;
+    mPacketEncoded.notify();
+  }
+
+
+  void Recorder::muxPackets(void)
+  {
+    EncodedPacket encoded;
+    for (;;) {
+      if (!mEncodedPackets.pop(encoded)) {
+        // the encoder thread has queued its last packet before mEncodingDone is set
+        if (!mEncodingDone) {
+          mPacketEncoded.wait();
+          continue;
+        }
+        if (!mEncodedPackets.pop(encoded))
+          break;
+      }
+      mPacketMuxed.notify();
+      const PipelineClock::time_point t0 = PipelineClock::now();
+      int ret = write_frame(mVideoOutContainer, &encoded.timeBase, encoded.stream, &encoded.packet);
+      av_free_packet(&encoded.packet);
+      mLatency[MuxingStage].record(t0 - encoded.queued, PipelineClock::now() - t0);
+      if (ret < 0)
+        std::cerr << "Error writing frame in line " << __LINE__ << std::endl;
     }
+  }
 
-    mCurrentFrame += nOutputBufSize;
 
-    const int overhead = mCurrentFrame - mSamplesEnd;
-    if (overhead < 0)
-      return S_OK;
+  void Recorder::queuePacket(AVPacket *pkt, AVStream *stream, const AVRational &timeBase)
+  {
+    EncodedPacket encoded;
+    encoded.packet = *pkt;
+    encoded.stream = stream;
+    encoded.timeBase = timeBase;
+    encoded.queued = PipelineClock::now();
+    // packets cannot be dropped without breaking the stream, so wait for the muxer
+    while (!mEncodedPackets.push(encoded))
+      mPacketMuxed.wait();
+    mPacketEncoded.notify();
+  }
+
+
+  bool Recorder::encodeVideoFrame(AVFrame *frame, const sf::Time &timestamp)
+  {
+    mPTS = timestamp;
+
+    // dropped frames leave a gap in the pts instead of shifting the video against the audio
+    int64_t pts = av_rescale_q(timestamp.asMicroseconds(), av_make_q(1, 1000000), mVideoCtx->time_base);
+    if (pts < mVideoFrameNumber)
+      pts = mVideoFrameNumber;
+    frame->pts = pts;
+    mVideoFrameNumber = pts + 1;
 
     AVPacket pkt;
     av_init_packet(&pkt);
     pkt.data = nullptr;
     pkt.size = 0;
+
     int gotOutput = 0;
-    int ret = avcodec_encode_audio2(mAudioCtx, &pkt, mAudioFrame, &gotOutput);
+    int ret = avcodec_encode_video2(mVideoCtx, &pkt, frame, &gotOutput);
     if (ret < 0) {
       std::cerr << "Error encoding frame in line " << __LINE__ << std::endl;
-      return S_FALSE;
-    }
-    if (gotOutput) {
-      fwrite(pkt.data, pkt.size, 1, mAudioFile);
-      av_free_packet(&pkt);
+      return false;
     }
 
-    memcpy(mSamples, mSamplesEnd, overhead);
-    mCurrentFrame = mSamples + overhead;
+    if (gotOutput)
+      queuePacket(&pkt, mVideoOutStream, mVideoCtx->time_base);
 
-    do {
-      ret = avcodec_encode_audio2(mAudioCtx, &pkt, NULL, &gotOutput);
+    return true;
+  }
+
+
+  bool Recorder::encodeAudio(const sf::Time &until)
+  {
+    const int64_t end = until.asMicroseconds() * mAudioCtx->sample_rate / 1000000;
+    const int n = mAudioFrame->nb_samples;
+    while (mMixer.framesMixed() + n <= end) {
+      if (av_frame_make_writable(mAudioFrame) < 0) {
+        std::cerr << "Could not make audio frame writable in line " << __LINE__ << std::endl;
+        return false;
+      }
+      mAudioFrame->pts = mMixer.framesMixed();
+      mMixer.mix(mMixBuffer.data(), n);
+      storeSamples(mMixBuffer.data(), mAudioFrame);
+
+      AVPacket pkt;
+      av_init_packet(&pkt);
+      pkt.data = nullptr;
+      pkt.size = 0;
+      int gotOutput = 0;
+      int ret = avcodec_encode_audio2(mAudioCtx, &pkt, mAudioFrame, &gotOutput);
       if (ret < 0) {
         std::cerr << "Error encoding frame in line " << __LINE__ << std::endl;
-        return S_FALSE;
-      }
-      if (gotOutput) {
-        fwrite(pkt.data, pkt.size, 1, mAudioFile);
-        av_free_packet(&pkt);
+        return false;
       }
+      if (gotOutput)
+        queuePacket(&pkt, mAudioOutStream, mAudioCtx->time_base);
+    }
+    return true;
+  }
 
-    } while (gotOutput);
-
-
-    if (mNewVideoFrameAvailable) {
-      mNewVideoFrameAvailable = false;
-      const sf::Image &image = mCurrentVideoFrame;
-      if (image.getSize().x > 0 && image.getSize().y > 0) {
-
-        av_init_packet(&pkt);
-        pkt.data = nullptr;
-        pkt.size = 0;
-
-        ret = avpicture_fill((AVPicture *)mRGBFrame, image.getPixelsPtr(), PIX_FMT_RGBA, mVideoCtx->width, mVideoCtx->height);
-        if (ret < 0) {
-          std::cerr << "avpicture_fill() failed in line " << __LINE__ << std::endl;
-          return S_FALSE;
-        }
-        ret = sws_scale(mSwsCtx, mRGBFrame->data, mRGBFrame->linesize, 0, mVideoCtx->height, mVideoFrame->data, mVideoFrame->linesize);
-
-        mVideoFrame->pts = mVideoFrameNumber++;
-        pkt.pts = mVideoFrame->pts;
-        pkt.dts = pkt.pts;
-        pkt.duration = int(mFrameTime.asSeconds() * mVideoOutStream->time_base.den / mVideoOutStream->time_base.num);
-
-        std::cout << mVideoFrameNumber << " " << mVideoFrame->pts
-          << " " << pkt.duration << " " << " lasted " << mFrameTime.asMilliseconds() << " ms."
-          << std::endl;
-
-        ret = avcodec_encode_video2(mVideoOutStream->codec, &pkt, mVideoFrame, &gotOutput);
-        if (ret < 0) {
-          std::cerr << "Error encoding frame in line " << __LINE__ << std::endl;
-          return S_FALSE;
-        }
-
-        if (gotOutput) {
-          ret = av_interleaved_write_frame(mVideoOutContainer, &pkt);
-          if (ret < 0) {
-            std::cerr << "Error writing frame in line " << __LINE__ << std::endl;
-            return S_FALSE;
-          }
-          av_free_packet(&pkt);
-        }
 
+  bool Recorder::pushFrame(const VideoFramePtr &frame)
+  {
+    const PipelineClock::time_point t0 = PipelineClock::now();
+    PendingFrame pending;
+    pending.frame = frame;
+    pending.queued = t0;
+    while (!mVideoFrames.push(pending)) {
+      if (mBackPressurePolicy == DropFrame || mDoQuit) {
+        mLatency[CaptureStage].drop();
+        return false;
       }
-
+      // Block: stall the render thread until the conversion thread catches up
+      mVideoFramePopped.wait();
+      pending.queued = PipelineClock::now();
     }
+    mVideoFramePushed.notify();
+    mLatency[CaptureStage].record(PipelineClock::duration::zero(), pending.queued - t0);
+    return true;
+  }
+
 
-    return S_OK;
+  void Recorder::setBackPressurePolicy(BackPressurePolicy policy)
+  {
+    mBackPressurePolicy = policy;
   }
 
 
-  void Recorder::setFrame(const sf::Image &image, const sf::Time &pts)
+  StageStats Recorder::stats(Stage stage) const
   {
-    mCurrentVideoFrame = image;
-    mNewVideoFrameAvailable = true;
-    mFrameTime = pts - mPTS;
-    mPTS = pts;
+    return mLatency[stage].stats();
   }
 }
@@ -26,69 +26,189 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
-#if defined(WIN32)
-#include <Mmdeviceapi.h>
-#include <MMSystem.h>
-#include <Audioclient.h>
-#endif
-
-#include <SFML/Graphics/Image.hpp>
 #include <SFML/System/Time.hpp>
 
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "AudioMixer.h"
+#include "FrameGrabber.h"
+#include "SPSCQueue.h"
 
 namespace Impact {
 
+  typedef std::chrono::steady_clock PipelineClock;
+
+  /// latency figures of one stage of the recording pipeline
+  struct StageStats {
+    StageStats(void)
+      : frames(0)
+      , dropped(0)
+      , avgWaitMicroseconds(0)
+      , maxWaitMicroseconds(0)
+      , avgBusyMicroseconds(0)
+      , maxBusyMicroseconds(0)
+    { /* ... */ }
+    /// frames passed on to the next stage
+    int64_t frames;
+    /// frames dropped because the next stage lagged behind
+    int64_t dropped;
+    /// time spent queued in front of the stage
+    int64_t avgWaitMicroseconds;
+    int64_t maxWaitMicroseconds;
+    /// time spent in the stage itself
+    int64_t avgBusyMicroseconds;
+    int64_t maxBusyMicroseconds;
+  };
+
+
+  /// written by the thread running a stage, read by any thread
+  class LatencyCounter {
+  public:
+    LatencyCounter(void);
+    void record(const PipelineClock::duration &wait, const PipelineClock::duration &busy);
+    void drop(void);
+    StageStats stats(void) const;
+
+  private:
+    std::atomic<int64_t> mFrames;
+    std::atomic<int64_t> mDropped;
+    std::atomic<int64_t> mTotalWait;
+    std::atomic<int64_t> mMaxWait;
+    std::atomic<int64_t> mTotalBusy;
+    std::atomic<int64_t> mMaxBusy;
+  };
+
+
+  /* Video frames travel through the pipeline
+   *   render thread -> conversion thread (sws_scale) -> encoder thread (H.264)
+   *   -> muxer thread
+   * connected by lock-free queues. The encoder thread returns the YUV frames
+   * to the conversion thread, so the number of YUV frames bounds the number
+   * of frames in flight. What happens if a stage lags behind depends on the
+   * back-pressure policy; encoded packets are never dropped, though, so the
+   * encoder waits for the muxer if need be.
+   * The encoder thread also pulls the audio from the mixer up to the time stamp
+   * of each video frame and hands its packets to the same muxer.
+   */
   class Recorder {
   public:
-    Recorder(Game *game);
+    typedef enum _BackPressurePolicy {
+      DropFrame,
+      Block
+    } BackPressurePolicy;
+
+    typedef enum _Stage {
+      CaptureStage,
+      ConversionStage,
+      EncodingStage,
+      MuxingStage,
+      StageCount
+    } Stage;
+
+    Recorder(Game *game, const std::string &filename = DefaultFilename, int width = DefaultVideoWidth, int height = DefaultVideoHeight);
     ~Recorder();
 
-    HRESULT start(void);
-    HRESULT stop(void);
+    bool start(void);
+    bool stop(void);
 
-    void setFrame(const sf::Image &frame, const sf::Time &wallClock);
+    /// hand a grabbed frame over to the encoder; returns false if the frame had to be dropped
+    bool pushFrame(const VideoFramePtr &frame);
 
     AVRational timeBase(void) const;
 
+    void setBackPressurePolicy(BackPressurePolicy policy);
+    inline BackPressurePolicy backPressurePolicy(void) const
+    {
+      return mBackPressurePolicy;
+    }
+    StageStats stats(Stage stage) const;
+
+    /// the game feeds its sounds and music into the recording through the mixer
+    inline AudioMixer &mixer(void)
+    {
+      return mMixer;
+    }
+
+    static const std::string DefaultFilename;
+    static const int DefaultVideoWidth = 640;
+    static const int DefaultVideoHeight = 480;
+    static const int DefaultVideoQueueSize = 8;
+    static const int DefaultPacketQueueSize = 64;
+    static const int DefaultAudioFrameSize = 1024;
+
   private:
-    HRESULT copyAudioData(float32 *pData, UINT32 nFrames);
-    void capture(void);
+    struct PendingFrame {
+      VideoFramePtr frame;
+      PipelineClock::time_point queued;
+    };
+
+    struct ConvertedFrame {
+      ConvertedFrame(void)
+        : frame(nullptr)
+      { /* ... */ }
+      AVFrame *frame;
+      sf::Time timestamp;
+      PipelineClock::time_point queued;
+    };
+
+    /// owns the packet's data until the muxer has written it
+    struct EncodedPacket {
+      AVPacket packet;
+      AVStream *stream;
+      AVRational timeBase;
+      PipelineClock::time_point queued;
+    };
+
+    void convertFrames(void);
+    void encodeFrames(void);
+    void muxPackets(void);
+    bool encodeVideoFrame(AVFrame *frame, const sf::Time &timestamp);
+    bool encodeAudio(const sf::Time &until);
+    void queuePacket(AVPacket *pkt, AVStream *stream, const AVRational &timeBase);
 
   private:
     Game *mGame;
+    std::string mFilename;
+    int mWidth;
+    int mHeight;
 
-    typedef int16_t sample_t;
-
-    FILE *mAudioFile;
+    AudioMixer mMixer;
+    std::vector<float> mMixBuffer;
     AVCodecContext *mAudioCtx;
     AVCodec *mAudioCodec;
-    uint8_t *mSamples;
-    uint8_t *mSamplesEnd;
-    uint8_t *mCurrentFrame;
+    AVStream *mAudioOutStream;
     AVFrame *mAudioFrame;
-    int mBufferSize;
 
     AVStream *mVideoOutStream;
     AVFormatContext* mVideoOutContainer;
     AVCodecContext *mVideoCtx;
     AVCodec *mVideoCodec;
-    AVFrame *mVideoFrame;
-    AVFrame *mRGBFrame;
     SwsContext *mSwsCtx;
     int64_t mVideoFrameNumber;
-    sf::Image mCurrentVideoFrame;
-    sf::Time mFrameTime;
     sf::Time mPTS;
-    bool mNewVideoFrameAvailable;
-
-    IAudioClient *mAudioClient;
-    IAudioCaptureClient *mCaptureClient;
-    WAVEFORMATEX *mWFX;
-    DWORD mActualDuration;
 
-    std::thread *mRecThread;
-    bool mDoQuit;
+    std::atomic<BackPressurePolicy> mBackPressurePolicy;
+    SPSCQueue<PendingFrame> mVideoFrames;
+    SPSCQueue<ConvertedFrame> mConvertedFrames;
+    SPSCQueue<AVFrame*> mFreeYUVFrames;
+    SPSCQueue<EncodedPacket> mEncodedPackets;
+    QueueEvent mVideoFramePushed;
+    QueueEvent mVideoFramePopped;
+    QueueEvent mFrameConverted;
+    QueueEvent mYUVFrameFreed;
+    QueueEvent mPacketEncoded;
+    QueueEvent mPacketMuxed;
+    std::vector<AVFrame*> mYUVFrames;
+    LatencyCounter mLatency[StageCount];
+    std::thread *mConversionThread;
+    std::thread *mEncoderThread;
+    std::thread *mMuxerThread;
+    std::atomic<bool> mConversionDone;
+    std::atomic<bool> mEncodingDone;
+    std::atomic<bool> mDoQuit;
   };
 
 }
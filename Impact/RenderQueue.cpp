@@ -0,0 +1,140 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "stdafx.h"
+#include "RenderQueue.h"
+
+namespace Impact {
+
+  RenderQueue::RenderQueue(void)
+    : mBatch(sf::Quads)
+    , mDrawCalls(0)
+    , mCulledCount(0)
+  {
+    // ...
+  }
+
+
+  // within a layer, items are drawn in the order they were added, as
+  // overlapping sprites would otherwise cover each other at random
+  bool RenderQueue::Item::operator<(const Item &other) const
+  {
+    if (layer != other.layer)
+      return layer < other.layer;
+    return order < other.order;
+  }
+
+
+  void RenderQueue::begin(const sf::View &view)
+  {
+    mItems.clear();
+    mVisible = sf::FloatRect(view.getCenter() - .5f * view.getSize(), view.getSize());
+    mDrawCalls = 0;
+    mCulledCount = 0;
+  }
+
+
+  void RenderQueue::add(const sf::Sprite &sprite, int layer, const sf::Shader *shader)
+  {
+    if (!mVisible.intersects(sprite.getGlobalBounds())) {
+      ++mCulledCount;
+      return;
+    }
+    Item item;
+    item.layer = layer;
+    item.shader = shader;
+    item.texture = sprite.getTexture();
+    item.sprite = &sprite;
+    item.drawable = nullptr;
+    item.order = mItems.size();
+    mItems.push_back(item);
+  }
+
+
+  void RenderQueue::add(const sf::Drawable &drawable, int layer)
+  {
+    Item item;
+    item.layer = layer;
+    item.shader = nullptr;
+    item.texture = nullptr;
+    item.sprite = nullptr;
+    item.drawable = &drawable;
+    item.order = mItems.size();
+    mItems.push_back(item);
+  }
+
+
+  void RenderQueue::draw(sf::RenderTarget &target)
+  {
+    std::sort(mItems.begin(), mItems.end());
+    const Item *batch = nullptr;
+    for (std::vector<Item>::const_iterator i = mItems.cbegin(); i != mItems.cend(); ++i) {
+      if (i->drawable != nullptr) {
+        flush(target, batch);
+        batch = nullptr;
+        target.draw(*i->drawable);
+        ++mDrawCalls;
+        continue;
+      }
+      if (batch != nullptr && (batch->shader != i->shader || batch->texture != i->texture)) {
+        flush(target, batch);
+        batch = nullptr;
+      }
+      if (batch == nullptr)
+        batch = &*i;
+      appendQuad(mBatch, *i->sprite);
+    }
+    flush(target, batch);
+    mItems.clear();
+  }
+
+
+  void RenderQueue::flush(sf::RenderTarget &target, const Item *batch)
+  {
+    if (batch == nullptr || mBatch.getVertexCount() == 0)
+      return;
+    sf::RenderStates states;
+    states.texture = batch->texture;
+    states.shader = batch->shader;
+    target.draw(mBatch, states);
+    ++mDrawCalls;
+    mBatch.clear();
+  }
+
+
+  void RenderQueue::appendQuad(sf::VertexArray &vertices, const sf::Sprite &sprite)
+  {
+    // the same corners and texture coordinates an sf::Sprite draws itself with
+    const sf::IntRect &rect = sprite.getTextureRect();
+    const float w = float(std::abs(rect.width));
+    const float h = float(std::abs(rect.height));
+    const float u0 = float(rect.left);
+    const float v0 = float(rect.top);
+    const float u1 = u0 + float(rect.width);
+    const float v1 = v0 + float(rect.height);
+    const sf::Transform &transform = sprite.getTransform();
+    const sf::Color &color = sprite.getColor();
+    vertices.append(sf::Vertex(transform.transformPoint(0.f, 0.f), color, sf::Vector2f(u0, v0)));
+    vertices.append(sf::Vertex(transform.transformPoint(0.f, h), color, sf::Vector2f(u0, v1)));
+    vertices.append(sf::Vertex(transform.transformPoint(w, h), color, sf::Vector2f(u1, v1)));
+    vertices.append(sf::Vertex(transform.transformPoint(w, 0.f), color, sf::Vector2f(u1, v0)));
+  }
+
+}
@@ -0,0 +1,74 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __RENDERQUEUE_H_
+#define __RENDERQUEUE_H_
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+namespace Impact {
+
+  /// collects what is to be drawn in a frame, culls sprites outside the view and draws
+  /// everything sorted by layer, and in the order it was added within a layer;
+  /// consecutive sprites sharing the same shader and texture go out in a single draw call
+  class RenderQueue {
+  public:
+    RenderQueue(void);
+    /// start collecting a frame drawn with the given view
+    void begin(const sf::View &view);
+    /// queue a sprite; sprites outside the view are dropped
+    void add(const sf::Sprite &sprite, int layer, const sf::Shader *shader = nullptr);
+    /// queue a drawable that cannot be batched; it is never culled
+    void add(const sf::Drawable &drawable, int layer);
+    /// draw everything queued since begin() and empty the queue
+    void draw(sf::RenderTarget &target);
+    inline int drawCalls(void) const
+    {
+      return mDrawCalls;
+    }
+    inline int culledCount(void) const
+    {
+      return mCulledCount;
+    }
+    /// append the four corners of a sprite to a vertex array of quads
+    static void appendQuad(sf::VertexArray &vertices, const sf::Sprite &sprite);
+
+  private:
+    struct Item {
+      int layer;
+      const sf::Shader *shader;
+      const sf::Texture *texture;
+      const sf::Sprite *sprite;
+      const sf::Drawable *drawable;
+      std::size_t order;
+      bool operator<(const Item &other) const;
+    };
+    std::vector<Item> mItems;
+    sf::FloatRect mVisible;
+    sf::VertexArray mBatch;
+    int mDrawCalls;
+    int mCulledCount;
+    void flush(sf::RenderTarget &target, const Item *batch);
+  };
+
+}
+
+#endif // __RENDERQUEUE_H_
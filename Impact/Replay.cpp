@@ -0,0 +1,298 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "stdafx.h"
+#include "Replay.h"
+
+namespace Impact {
+
+  static const char ReplayMagic[4] = { 'I', 'M', 'P', 'R' };
+  static const uint8_t ReplayVersion = 1;
+
+  typedef enum _RecordFlags {
+    XChanged = 1 << 0,
+    YChanged = 1 << 1,
+    ButtonsChanged = 1 << 2,
+    CommandsSet = 1 << 3,
+    EndOfReplay = 1 << 7
+  } RecordFlags;
+
+
+  static void putVarint(std::vector<uint8_t> &buf, uint64_t value)
+  {
+    while (value >= 0x80) {
+      buf.push_back(uint8_t(value | 0x80));
+      value >>= 7;
+    }
+    buf.push_back(uint8_t(value));
+  }
+
+
+  static inline uint64_t zigzag(int64_t value)
+  {
+    return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+  }
+
+
+  static inline int64_t unzigzag(uint64_t value)
+  {
+    return int64_t(value >> 1) ^ -int64_t(value & 1);
+  }
+
+
+  static void putString(std::vector<uint8_t> &buf, const std::string &str)
+  {
+    putVarint(buf, str.size());
+    buf.insert(buf.end(), str.begin(), str.end());
+  }
+
+
+  ReplayWriter::ReplayWriter(void)
+    : mFile(nullptr)
+    , mUnchanged(0)
+    , mSteps(0)
+  {
+    // ...
+  }
+
+
+  ReplayWriter::~ReplayWriter()
+  {
+    close();
+  }
+
+
+  bool ReplayWriter::open(const std::string &filename, const ReplayHeader &header)
+  {
+    close();
+    mFile = gzopen(filename.c_str(), "wb9");
+    if (mFile == nullptr) {
+      std::cerr << "Cannot open replay file " << filename << " for writing." << std::endl;
+      return false;
+    }
+    mBuffer.clear();
+    mBuffer.insert(mBuffer.end(), ReplayMagic, ReplayMagic + sizeof(ReplayMagic));
+    mBuffer.push_back(ReplayVersion);
+    putString(mBuffer, header.levelHash);
+    putString(mBuffer, header.levelZip);
+    putVarint(mBuffer, zigzag(header.levelNum));
+    putVarint(mBuffer, header.seed);
+    putVarint(mBuffer, header.stepMicroseconds);
+    putVarint(mBuffer, zigzag(header.velocityIterations));
+    putVarint(mBuffer, zigzag(header.positionIterations));
+    putVarint(mBuffer, header.particlesPerExplosion);
+    flush();
+    mLast = InputState();
+    mUnchanged = 0;
+    mSteps = 0;
+    return true;
+  }
+
+
+  void ReplayWriter::write(const InputState &input)
+  {
+    if (mFile == nullptr)
+      return;
+    ++mSteps;
+    uint8_t flags = 0;
+    if (input.x != mLast.x)
+      flags |= XChanged;
+    if (input.y != mLast.y)
+      flags |= YChanged;
+    if (input.buttons != mLast.buttons)
+      flags |= ButtonsChanged;
+    if (input.commands != 0)
+      flags |= CommandsSet;
+    if (flags == 0) {
+      ++mUnchanged;
+      return;
+    }
+    putVarint(mBuffer, mUnchanged);
+    mBuffer.push_back(flags);
+    if (flags & XChanged)
+      putVarint(mBuffer, zigzag(int64_t(input.x) - mLast.x));
+    if (flags & YChanged)
+      putVarint(mBuffer, zigzag(int64_t(input.y) - mLast.y));
+    if (flags & ButtonsChanged)
+      mBuffer.push_back(input.buttons);
+    if (flags & CommandsSet)
+      mBuffer.push_back(input.commands);
+    mLast = input;
+    mUnchanged = 0;
+    if (mBuffer.size() >= 4096)
+      flush();
+  }
+
+
+  void ReplayWriter::flush(void)
+  {
+    if (!mBuffer.empty()) {
+      gzwrite(mFile, mBuffer.data(), unsigned(mBuffer.size()));
+      mBuffer.clear();
+    }
+  }
+
+
+  void ReplayWriter::close(void)
+  {
+    if (mFile == nullptr)
+      return;
+    putVarint(mBuffer, mUnchanged);
+    mBuffer.push_back(EndOfReplay);
+    flush();
+    gzclose(mFile);
+    mFile = nullptr;
+  }
+
+
+  ReplayReader::ReplayReader(void)
+    : mFile(nullptr)
+    , mUnchanged(0)
+    , mAtEnd(true)
+  {
+    // ...
+  }
+
+
+  ReplayReader::~ReplayReader()
+  {
+    close();
+  }
+
+
+  bool ReplayReader::readVarint(uint64_t &value)
+  {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      const int c = gzgetc(mFile);
+      if (c < 0)
+        return false;
+      value |= uint64_t(c & 0x7f) << shift;
+      if ((c & 0x80) == 0)
+        return true;
+    }
+    return false;
+  }
+
+
+  bool ReplayReader::readString(std::string &str)
+  {
+    uint64_t size;
+    if (!readVarint(size) || size > 4096)
+      return false;
+    str.resize(size_t(size));
+    return size == 0 || gzread(mFile, &str[0], unsigned(size)) == int(size);
+  }
+
+
+  bool ReplayReader::open(const std::string &filename)
+  {
+    close();
+    mFile = gzopen(filename.c_str(), "rb");
+    if (mFile == nullptr) {
+      std::cerr << "Cannot open replay file " << filename << "." << std::endl;
+      return false;
+    }
+    char magic[sizeof(ReplayMagic)];
+    bool ok = gzread(mFile, magic, sizeof(magic)) == sizeof(magic)
+      && std::equal(magic, magic + sizeof(magic), ReplayMagic)
+      && gzgetc(mFile) == ReplayVersion;
+    uint64_t levelNum = 0, seed = 0, stepMicroseconds = 0, velocityIterations = 0, positionIterations = 0, particlesPerExplosion = 0;
+    ok = ok
+      && readString(mHeader.levelHash)
+      && readString(mHeader.levelZip)
+      && readVarint(levelNum)
+      && readVarint(seed)
+      && readVarint(stepMicroseconds)
+      && readVarint(velocityIterations)
+      && readVarint(positionIterations)
+      && readVarint(particlesPerExplosion);
+    if (!ok) {
+      std::cerr << filename << " is not a valid replay file." << std::endl;
+      close();
+      return false;
+    }
+    mHeader.levelNum = int32_t(unzigzag(levelNum));
+    mHeader.seed = uint32_t(seed);
+    mHeader.stepMicroseconds = uint32_t(stepMicroseconds);
+    mHeader.velocityIterations = int32_t(unzigzag(velocityIterations));
+    mHeader.positionIterations = int32_t(unzigzag(positionIterations));
+    mHeader.particlesPerExplosion = uint32_t(particlesPerExplosion);
+    mLast = InputState();
+    mAtEnd = false;
+    return readRecord();
+  }
+
+
+  bool ReplayReader::readRecord(void)
+  {
+    int flags = -1;
+    if (!readVarint(mUnchanged) || (flags = gzgetc(mFile)) < 0) {
+      std::cerr << "Replay is truncated." << std::endl;
+      flags = EndOfReplay;
+    }
+    if (flags & EndOfReplay) {
+      mAtEnd = true;
+      return true;
+    }
+    mNext = mLast;
+    mNext.commands = 0;
+    uint64_t value;
+    if ((flags & XChanged) && readVarint(value))
+      mNext.x = int32_t(mLast.x + unzigzag(value));
+    if ((flags & YChanged) && readVarint(value))
+      mNext.y = int32_t(mLast.y + unzigzag(value));
+    if (flags & ButtonsChanged)
+      mNext.buttons = uint8_t(gzgetc(mFile));
+    if (flags & CommandsSet)
+      mNext.commands = uint8_t(gzgetc(mFile));
+    return true;
+  }
+
+
+  bool ReplayReader::read(InputState &input)
+  {
+    if (mFile == nullptr)
+      return false;
+    if (mUnchanged > 0) {
+      --mUnchanged;
+      input = mLast;
+      input.commands = 0;
+      return true;
+    }
+    if (mAtEnd)
+      return false;
+    mLast = mNext;
+    input = mLast;
+    return readRecord();
+  }
+
+
+  void ReplayReader::close(void)
+  {
+    if (mFile != nullptr) {
+      gzclose(mFile);
+      mFile = nullptr;
+    }
+    mAtEnd = true;
+  }
+
+}
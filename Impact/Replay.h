@@ -0,0 +1,152 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef __REPLAY_H_
+#define __REPLAY_H_
+
+#include <zlib.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Impact {
+
+  /// what the player did during one physics step
+  struct InputState {
+    InputState(void)
+      : x(0)
+      , y(0)
+      , buttons(0)
+      , commands(0)
+    { /* ... */ }
+
+    typedef enum _Buttons {
+      KickLeft = 1 << 0,
+      KickRight = 1 << 1
+    } Buttons;
+
+    typedef enum _Commands {
+      NewBall = 1 << 0,
+      SpawnBall = 1 << 1,
+      RecoverBall = 1 << 2
+    } Commands;
+
+    /// racket target in pixels of the default view
+    int32_t x;
+    int32_t y;
+    /// held down for as long as the button is pressed
+    uint8_t buttons;
+    /// fired once, only on the step following the key press
+    uint8_t commands;
+  };
+
+
+  /// everything besides the inputs needed to re-simulate a session
+  struct ReplayHeader {
+    ReplayHeader(void)
+      : levelNum(0)
+      , seed(0)
+      , stepMicroseconds(0)
+      , velocityIterations(0)
+      , positionIterations(0)
+      , particlesPerExplosion(0)
+    { /* ... */ }
+    std::string levelHash;
+    std::string levelZip;
+    int32_t levelNum;
+    uint32_t seed;
+    uint32_t stepMicroseconds;
+    int32_t velocityIterations;
+    int32_t positionIterations;
+    uint32_t particlesPerExplosion;
+  };
+
+
+  /* A replay is a gzip'ed stream of the header followed by one record per
+   * step whose input differs from the step before. A record starts with the
+   * number of unchanged steps preceding it, followed by a flags byte and the
+   * changed fields. Mouse positions are stored as zig-zag encoded deltas, so
+   * a typical record takes three or four bytes before compression.
+   */
+  class ReplayWriter {
+  public:
+    ReplayWriter(void);
+    ~ReplayWriter();
+
+    bool open(const std::string &filename, const ReplayHeader &header);
+    void write(const InputState &input);
+    void close(void);
+
+    inline bool isOpen(void) const
+    {
+      return mFile != nullptr;
+    }
+    inline int64_t steps(void) const
+    {
+      return mSteps;
+    }
+
+  private:
+    gzFile mFile;
+    std::vector<uint8_t> mBuffer;
+    InputState mLast;
+    uint64_t mUnchanged;
+    int64_t mSteps;
+
+    void flush(void);
+  };
+
+
+  class ReplayReader {
+  public:
+    ReplayReader(void);
+    ~ReplayReader();
+
+    bool open(const std::string &filename);
+    /// the input for the next step; false at the end of the replay
+    bool read(InputState &input);
+    void close(void);
+
+    inline bool isOpen(void) const
+    {
+      return mFile != nullptr;
+    }
+    inline const ReplayHeader &header(void) const
+    {
+      return mHeader;
+    }
+
+  private:
+    gzFile mFile;
+    ReplayHeader mHeader;
+    InputState mLast;
+    InputState mNext;
+    uint64_t mUnchanged;
+    bool mAtEnd;
+
+    bool readRecord(void);
+    bool readVarint(uint64_t &value);
+    bool readString(std::string &str);
+  };
+
+}
+
+#endif // __REPLAY_H_
@@ -0,0 +1,140 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef __SPSCQUEUE_H_
+#define __SPSCQUEUE_H_
+
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <mutex>
+#include <condition_variable>
+
+namespace Impact {
+
+  /// bounded lock-free queue for exactly one producer thread and one consumer thread
+  template <typename T>
+  class SPSCQueue {
+  public:
+    /// the capacity is rounded up to the next power of two
+    explicit SPSCQueue(std::size_t capacity)
+      : mHead(0)
+      , mTail(0)
+    {
+      std::size_t n = 2;
+      while (n < capacity)
+        n <<= 1;
+      mBuffer.resize(n);
+      mMask = n - 1;
+    }
+
+    /// producer only; returns false if the queue is full
+    bool push(const T &item)
+    {
+      const std::size_t tail = mTail.load(std::memory_order_relaxed);
+      if (tail - mHead.load(std::memory_order_acquire) > mMask)
+        return false;
+      mBuffer[tail & mMask] = item;
+      mTail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// consumer only; returns false if the queue is empty
+    bool pop(T &item)
+    {
+      const std::size_t head = mHead.load(std::memory_order_relaxed);
+      if (head == mTail.load(std::memory_order_acquire))
+        return false;
+      item = std::move(mBuffer[head & mMask]);
+      mBuffer[head & mMask] = T();
+      mHead.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// a snapshot which may be outdated as soon as it is returned
+    inline std::size_t size(void) const
+    {
+      return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+    }
+    inline bool empty(void) const
+    {
+      return size() == 0;
+    }
+    inline std::size_t capacity(void) const
+    {
+      return mMask + 1;
+    }
+
+  private:
+    SPSCQueue(const SPSCQueue &);
+    SPSCQueue &operator=(const SPSCQueue &);
+
+    static const std::size_t CacheLineSize = 64;
+
+    std::vector<T> mBuffer;
+    std::size_t mMask;
+    // keep the indexes written by different threads on different cache lines
+    char mPad0[CacheLineSize];
+    std::atomic<std::size_t> mHead;
+    char mPad1[CacheLineSize - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> mTail;
+    char mPad2[CacheLineSize - sizeof(std::atomic<std::size_t>)];
+  };
+
+
+  /// lets the thread at one end of an SPSCQueue sleep until the other end has
+  /// pushed or popped; a notification is kept until the waiter takes it, so
+  /// none is lost between a failed push() or pop() and the call to wait()
+  class QueueEvent {
+  public:
+    QueueEvent(void)
+      : mSignaled(false)
+    { /* ... */ }
+
+    void notify(void)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSignaled = true;
+      }
+      mCondition.notify_one();
+    }
+
+    void wait(void)
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCondition.wait(lock, [this]{ return mSignaled; });
+      mSignaled = false;
+    }
+
+  private:
+    QueueEvent(const QueueEvent &);
+    QueueEvent &operator=(const QueueEvent &);
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mSignaled;
+  };
+
+}
+
+#endif // __SPSCQUEUE_H_
@@ -0,0 +1,104 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef __SIMULATIONCLOCK_H_
+#define __SIMULATIONCLOCK_H_
+
+#include <SFML/System.hpp>
+
+#include <cstdint>
+#include <random>
+
+namespace Impact {
+
+  /* The time and the random numbers of the simulation. Unlike sf::Clock it
+   * only advances with physics steps, so that running the same inputs with
+   * the same seed yields the same results at any frame rate, while pausing,
+   * and when rendering offline. The time never goes backwards, so timers
+   * started before a reseed stay valid; only time differences are used.
+   */
+  class SimulationClock {
+  public:
+    SimulationClock(void)
+      : mSteps(0)
+    { /* ... */ }
+    inline void seed(uint32_t seed)
+    {
+      mRNG.seed(seed);
+    }
+    inline void advance(const sf::Time &dt)
+    {
+      mNow += dt;
+      ++mSteps;
+    }
+    inline const sf::Time &now(void) const
+    {
+      return mNow;
+    }
+    inline uint64_t steps(void) const
+    {
+      return mSteps;
+    }
+    /// the generator for every random draw affecting the game state
+    inline std::mt19937 &rng(void)
+    {
+      return mRNG;
+    }
+
+  private:
+    sf::Time mNow;
+    uint64_t mSteps;
+    std::mt19937 mRNG;
+  };
+
+
+  /// a stop watch like sf::Clock, but reading the simulation time
+  class SimulationTimer {
+  public:
+    SimulationTimer(const SimulationClock *clock = nullptr)
+      : mClock(clock)
+    {
+      restart();
+    }
+    inline void setClock(const SimulationClock *clock)
+    {
+      mClock = clock;
+      restart();
+    }
+    inline sf::Time getElapsedTime(void) const
+    {
+      return (mClock != nullptr) ? mClock->now() - mStart : sf::Time::Zero;
+    }
+    inline sf::Time restart(void)
+    {
+      const sf::Time &elapsed = getElapsedTime();
+      mStart = (mClock != nullptr) ? mClock->now() : sf::Time::Zero;
+      return elapsed;
+    }
+
+  private:
+    const SimulationClock *mClock;
+    sf::Time mStart;
+  };
+
+}
+
+#endif // __SIMULATIONCLOCK_H_
@@ -0,0 +1,155 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "stdafx.h"
+#include "SoundBank.h"
+
+namespace Impact {
+
+  SoundBank::SoundBank(std::size_t budget)
+    : mBudget(budget)
+    , mCompressedBytes(0)
+    , mDecodedBytes(0)
+  { /* ... */ }
+
+
+  SoundBank::Sound SoundBank::add(const std::string &filename)
+  {
+    Sound sound(new Entry);
+    sound->filename = filename;
+    sound->decodedSize = 0;
+    sound->decoding = false;
+    std::lock_guard<std::mutex> lock(mMutex);
+    sound->lruPos = mLru.end();
+    mSounds.push_back(sound);
+    return sound;
+  }
+
+
+  bool SoundBank::load(const Sound &sound)
+  {
+    std::ifstream in(sound->filename, std::ios::binary);
+    if (!in.is_open())
+      return false;
+    std::shared_ptr<std::vector<char> > data(new std::vector<char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>()));
+    if (data->empty())
+      return false;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCompressedBytes += data->size();
+    if (sound->data)
+      mCompressedBytes -= sound->data->size();
+    sound->data = data;
+    return true;
+  }
+
+
+  SoundBank::BufferPtr SoundBank::get(const Sound &sound)
+  {
+    if (!sound)
+      return BufferPtr();
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (sound->buffer)
+      mLru.splice(mLru.begin(), mLru, sound->lruPos);
+    return sound->buffer;
+  }
+
+
+  bool SoundBank::startDecoding(const Sound &sound)
+  {
+    if (!sound)
+      return false;
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (sound->buffer || sound->decoding || !sound->data)
+      return false;
+    sound->decoding = true;
+    return true;
+  }
+
+
+  bool SoundBank::decode(const Sound &sound)
+  {
+    std::shared_ptr<const std::vector<char> > data;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      data = sound->data;
+    }
+    if (!data)
+      return false;
+    // the bank stays unlocked while decoding, so that sounds can be played meanwhile
+    std::shared_ptr<sf::SoundBuffer> buffer(new sf::SoundBuffer);
+    const bool ok = buffer->loadFromMemory(data->data(), data->size());
+    std::lock_guard<std::mutex> lock(mMutex);
+    sound->decoding = false;
+    if (!ok) {
+      std::cerr << sound->filename << " failed to decode." << std::endl;
+      // don't try again on every trigger
+      if (sound->data == data) {
+        mCompressedBytes -= data->size();
+        sound->data.reset();
+      }
+      return false;
+    }
+    if (sound->buffer)
+      return true;
+    sound->buffer = buffer;
+    sound->decodedSize = buffer->getSampleCount() * sizeof(sf::Int16);
+    sound->lruPos = mLru.insert(mLru.begin(), sound.get());
+    mDecodedBytes += sound->decodedSize;
+    evict();
+    return true;
+  }
+
+
+  void SoundBank::setBudget(std::size_t budget)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBudget = budget;
+    evict();
+  }
+
+
+  // the sound played last is never dropped, even if it exceeds the budget alone
+  void SoundBank::evict(void)
+  {
+    while (mDecodedBytes > mBudget && mLru.size() > 1) {
+      Entry *entry = mLru.back();
+      mLru.pop_back();
+      entry->buffer.reset();
+      entry->lruPos = mLru.end();
+      mDecodedBytes -= entry->decodedSize;
+      entry->decodedSize = 0;
+    }
+  }
+
+
+  std::size_t SoundBank::residentBytes(void) const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCompressedBytes + mDecodedBytes;
+  }
+
+
+  std::size_t SoundBank::decodedBytes(void) const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mDecodedBytes;
+  }
+
+}
@@ -0,0 +1,97 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SOUNDBANK_H_
+#define __SOUNDBANK_H_
+
+#include <SFML/Audio/SoundBuffer.hpp>
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+
+namespace Impact {
+
+  /* Keeps sound effects in memory as they are stored on disk, i.e. as
+   * compressed OGG data, along with their decoded samples. The decoded
+   * samples are cached within a memory budget; if it's exceeded, the
+   * least recently played sounds are dropped and have to be decoded again
+   * before they can be played next time. Decoding is left to the caller's
+   * worker threads, so that playing a sound never waits for it. Sounds
+   * still playing keep their samples alive, because the mixers share the
+   * buffers.
+   */
+  class SoundBank {
+  public:
+    struct Entry {
+      std::string filename;
+      std::shared_ptr<const std::vector<char> > data;
+      std::shared_ptr<const sf::SoundBuffer> buffer;
+      std::size_t decodedSize;
+      bool decoding;
+      std::list<Entry*>::iterator lruPos;
+    };
+    typedef std::shared_ptr<Entry> Sound;
+    typedef std::shared_ptr<const sf::SoundBuffer> BufferPtr;
+
+    SoundBank(std::size_t budget = DefaultBudget);
+
+    /// registers a sound; its data is read by load()
+    Sound add(const std::string &filename);
+    /// reads the compressed data of a sound; may be called from any thread
+    bool load(const Sound &sound);
+    /// the decoded sound; null if it's not in the cache
+    BufferPtr get(const Sound &sound);
+    /// true if the sound is neither cached nor being decoded, in which case
+    /// the caller is expected to run decode(); marks the sound as being decoded
+    bool startDecoding(const Sound &sound);
+    /// decodes a loaded sound into the cache; may be called from any thread
+    bool decode(const Sound &sound);
+
+    void setBudget(std::size_t budget);
+    inline std::size_t budget(void) const
+    {
+      return mBudget;
+    }
+    /// compressed and decoded bytes held by the bank
+    std::size_t residentBytes(void) const;
+    std::size_t decodedBytes(void) const;
+
+    static const std::size_t DefaultBudget = 512 * 1024;
+
+  private:
+    typedef std::list<Entry*> LruList;
+
+    std::vector<Sound> mSounds;
+    /// decoded sounds, the most recently played first
+    LruList mLru;
+    std::size_t mBudget;
+    std::size_t mCompressedBytes;
+    std::size_t mDecodedBytes;
+    mutable std::mutex mMutex;
+
+    void evict(void);
+  };
+
+}
+
+#endif // __SOUNDBANK_H_
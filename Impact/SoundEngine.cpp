@@ -0,0 +1,189 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "stdafx.h"
+#include "SoundEngine.h"
+
+namespace Impact {
+
+  const sf::Time SoundEngine::DefaultCoalesceWindow = sf::milliseconds(30);
+
+
+  SoundEngine::SoundEngine(void)
+    : mQueueHead(0)
+    , mQueueTail(0)
+    , mDroppedCount(0)
+    , mFramesMixed(0)
+    , mCoalesceFrames(DefaultCoalesceWindow.asMicroseconds() * int64_t(DefaultSampleRate) / 1000000)
+    , mMix(FramesPerChunk * ChannelCount)
+    , mSamples(FramesPerChunk * ChannelCount)
+  {
+    // ...
+  }
+
+
+  SoundEngine::~SoundEngine()
+  {
+    // the streaming thread calls onGetData(), so it must end before this object does
+    stop();
+  }
+
+
+  void SoundEngine::start(void)
+  {
+    initialize(ChannelCount, DefaultSampleRate);
+    play();
+  }
+
+
+  void SoundEngine::playSound(const BufferPtr &buffer, float pan, float priority)
+  {
+    const unsigned int head = mQueueHead.load(std::memory_order_relaxed);
+    const unsigned int next = (head + 1) % QueueSize;
+    if (next == mQueueTail.load(std::memory_order_acquire)) {
+      ++mDroppedCount;
+      return;
+    }
+    Command &cmd = mQueue[head];
+    cmd.buffer = buffer;
+    cmd.pan = pan;
+    cmd.priority = priority;
+    mQueueHead.store(next, std::memory_order_release);
+  }
+
+
+  bool SoundEngine::onGetData(Chunk &data)
+  {
+    unsigned int tail = mQueueTail.load(std::memory_order_relaxed);
+    const unsigned int head = mQueueHead.load(std::memory_order_acquire);
+    while (tail != head) {
+      apply(mQueue[tail]);
+      // the voice holds the buffer now
+      mQueue[tail].buffer.reset();
+      tail = (tail + 1) % QueueSize;
+    }
+    mQueueTail.store(tail, std::memory_order_release);
+
+    render(FramesPerChunk);
+    mFramesMixed += FramesPerChunk;
+    data.samples = mSamples.data();
+    data.sampleCount = mSamples.size();
+    // the stream never ends, it plays silence if there's nothing to mix
+    return true;
+  }
+
+
+  void SoundEngine::onSeek(sf::Time)
+  {
+    // the stream cannot be sought
+  }
+
+
+  void SoundEngine::apply(const Command &cmd)
+  {
+    if (cmd.buffer->getChannelCount() == 0 || cmd.buffer->getSampleCount() == 0)
+      return;
+    // explosion storms trigger the same sound dozens of times per frame,
+    // which is merged into the voice that has just started playing it
+    for (unsigned int i = 0; i < MaxVoices; ++i) {
+      Voice &v = mVoices[i];
+      if (v.buffer == cmd.buffer && mFramesMixed - v.startFrame < mCoalesceFrames) {
+        if (cmd.priority > v.priority) {
+          v.priority = cmd.priority;
+          pan(v, cmd.pan);
+        }
+        return;
+      }
+    }
+    Voice *target = nullptr;
+    for (unsigned int i = 0; i < MaxVoices; ++i) {
+      Voice &v = mVoices[i];
+      if (v.buffer == nullptr) {
+        target = &v;
+        break;
+      }
+      if (target == nullptr || audibility(v) < audibility(*target))
+        target = &v;
+    }
+    if (target->buffer != nullptr && audibility(*target) >= cmd.priority)
+      return;
+    target->buffer = cmd.buffer;
+    target->position = 0.0;
+    target->step = double(cmd.buffer->getSampleRate()) / DefaultSampleRate;
+    target->priority = cmd.priority;
+    target->startFrame = mFramesMixed;
+    pan(*target, cmd.pan);
+  }
+
+
+  // balance rather than constant power panning, so that centered sounds keep their full volume
+  void SoundEngine::pan(Voice &voice, float pan)
+  {
+    pan = std::max(-1.f, std::min(1.f, pan));
+    voice.left = std::min(1.f, 1.f - pan);
+    voice.right = std::min(1.f, 1.f + pan);
+  }
+
+
+  // a voice fades from its priority to zero while it plays
+  float SoundEngine::audibility(const Voice &voice) const
+  {
+    const double frames = double(voice.buffer->getSampleCount() / voice.buffer->getChannelCount());
+    return voice.priority * float(1.0 - voice.position / frames);
+  }
+
+
+  void SoundEngine::render(unsigned int frameCount)
+  {
+    static const float Scale = 1.f / 32768.f;
+    std::fill(mMix.begin(), mMix.end(), 0.f);
+    for (unsigned int i = 0; i < MaxVoices; ++i) {
+      Voice &v = mVoices[i];
+      if (v.buffer == nullptr)
+        continue;
+      const sf::Int16 *samples = v.buffer->getSamples();
+      const unsigned int channels = v.buffer->getChannelCount();
+      const size_t sourceFrames = size_t(v.buffer->getSampleCount() / channels);
+      const float left = v.left * Scale;
+      const float right = v.right * Scale;
+      float *dst = mMix.data();
+      for (unsigned int f = 0; f < frameCount; ++f) {
+        const size_t idx = size_t(v.position);
+        if (idx >= sourceFrames) {
+          v.buffer.reset();
+          break;
+        }
+        // linear interpolation between neighbouring source frames
+        const size_t next = idx + 1 < sourceFrames ? idx + 1 : idx;
+        const float t = float(v.position - double(idx));
+        const sf::Int16 *a = samples + idx * channels;
+        const sf::Int16 *b = samples + next * channels;
+        const float l = a[0] + t * (b[0] - a[0]);
+        const float r = channels > 1 ? a[1] + t * (b[1] - a[1]) : l;
+        *dst++ += left * l;
+        *dst++ += right * r;
+        v.position += v.step;
+      }
+    }
+    for (std::vector<float>::size_type i = 0; i < mMix.size(); ++i)
+      mSamples[i] = sf::Int16(32767.f * std::max(-1.f, std::min(1.f, mMix[i])));
+  }
+
+}
@@ -0,0 +1,120 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SOUNDENGINE_H_
+#define __SOUNDENGINE_H_
+
+#include <SFML/Audio.hpp>
+#include <SFML/System/Time.hpp>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Impact {
+
+  /* Mixes the game's sound effects in software and plays them through a
+   * single stereo stream, whose streaming thread runs the mixer. The game
+   * thread only puts trigger commands into a lock-free queue, so that
+   * playing a sound costs the same no matter how many blocks explode at
+   * once. Triggers of a sound that has started within the last few
+   * milliseconds are coalesced into the voice already playing it, and
+   * if all voices are busy, a new sound only replaces the least audible
+   * one if it has a higher priority.
+   */
+  class SoundEngine : public sf::SoundStream {
+  public:
+    typedef std::shared_ptr<const sf::SoundBuffer> BufferPtr;
+
+    SoundEngine(void);
+    ~SoundEngine();
+
+    /// starts the mixer
+    void start(void);
+
+    /// called by the game thread only
+    /// @param pan stereo position from -1 (left) to 1 (right)
+    /// @param priority relative importance of the sound, 1 being normal
+    void playSound(const BufferPtr &buffer, float pan = 0.f, float priority = 1.f);
+
+    /// number of triggers dropped because the queue was full
+    inline unsigned int droppedCount(void) const
+    {
+      return mDroppedCount;
+    }
+
+    static const unsigned int ChannelCount = 2;
+    static const unsigned int DefaultSampleRate = 44100;
+    static const unsigned int MaxVoices = 16;
+    static const unsigned int FramesPerChunk = 512;
+    static const unsigned int QueueSize = 256;
+    static const sf::Time DefaultCoalesceWindow;
+
+  private:
+    struct Command {
+      BufferPtr buffer;
+      float pan;
+      float priority;
+    };
+
+    struct Voice {
+      Voice(void)
+        : buffer(nullptr)
+        , position(0.0)
+        , step(0.0)
+        , left(0.f)
+        , right(0.f)
+        , priority(0.f)
+        , startFrame(0)
+      { /* ... */ }
+      BufferPtr buffer;
+      double position;
+      double step;
+      float left;
+      float right;
+      float priority;
+      int64_t startFrame;
+    };
+
+    virtual bool onGetData(Chunk &data);
+    virtual void onSeek(sf::Time timeOffset);
+
+    void apply(const Command &cmd);
+    void pan(Voice &voice, float pan);
+    float audibility(const Voice &voice) const;
+    void render(unsigned int frameCount);
+
+    /// single producer (the game thread), single consumer (the streaming thread)
+    Command mQueue[QueueSize];
+    std::atomic<unsigned int> mQueueHead;
+    std::atomic<unsigned int> mQueueTail;
+    unsigned int mDroppedCount;
+
+    /// the following are only touched by the streaming thread
+    Voice mVoices[MaxVoices];
+    int64_t mFramesMixed;
+    int64_t mCoalesceFrames;
+    std::vector<float> mMix;
+    std::vector<sf::Int16> mSamples;
+  };
+
+}
+
+#endif // __SOUNDENGINE_H_
@@ -26,6 +26,7 @@ namespace Impact {
     : Body(Body::BodyType::Text, def.game)
   {
     setLifetime(def.maxAge);
+    mZIndex = TextLayer;
     mText.setCharacterSize(def.size);
     mText.setFont(def.font);
     mText.setString(sf::String(def.text));
@@ -0,0 +1,104 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "stdafx.h"
+#include "ThumbnailCache.h"
+
+
+namespace Impact {
+
+  ThumbnailCache::ThumbnailCache(AssetManager &assets, const std::string &cacheDir, std::size_t budget)
+    : mAssets(assets)
+    , mCacheDir(cacheDir)
+    , mBudget(budget)
+    , mResidentBytes(0)
+  { /* ... */ }
+
+
+  std::string ThumbnailCache::filename(const std::string &hash) const
+  {
+    return mCacheDir + "/" + hash + ".png";
+  }
+
+
+  bool ThumbnailCache::store(const Level &level) const
+  {
+    if (level.hash().empty())
+      return false;
+    const std::string &thumbnailFilename = filename(level.hash());
+    if (fileExists(thumbnailFilename))
+      return true;
+    sf::Image thumbnail;
+    if (!level.renderThumbnail(thumbnail, DefaultPixelsPerTile))
+      return false;
+#if defined(WIN32)
+    CreateDirectory(mCacheDir.c_str(), NULL);
+#elif defined(LINUX_AMD64)
+    mkdir(mCacheDir.c_str(), 0775);
+#endif
+    return thumbnail.saveToFile(thumbnailFilename);
+  }
+
+
+  const sf::Texture *ThumbnailCache::get(const std::string &hash)
+  {
+    std::map<std::string, EntryPtr>::const_iterator e = mEntries.find(hash);
+    if (e == mEntries.cend()) {
+      // a thumbnail which cannot be loaded keeps its entry, so it isn't tried again
+      EntryPtr entry = std::make_shared<Entry>();
+      entry->hash = hash;
+      entry->loaded = false;
+      mEntries[hash] = entry;
+      const std::string &thumbnailFilename = filename(hash);
+      mAssets.load(thumbnailFilename, [entry, thumbnailFilename](void) {
+        return fileExists(thumbnailFilename) && entry->image.loadFromFile(thumbnailFilename);
+      }, [this, entry](void) {
+        const bool ok = entry->texture.loadFromImage(entry->image);
+        entry->image = sf::Image();
+        if (ok) {
+          entry->loaded = true;
+          mLru.push_front(entry.get());
+          entry->lruPos = mLru.begin();
+          mResidentBytes += 4 * entry->texture.getSize().x * entry->texture.getSize().y;
+          evict();
+        }
+        return ok;
+      });
+      return nullptr;
+    }
+    Entry *entry = e->second.get();
+    if (!entry->loaded)
+      return nullptr;
+    mLru.splice(mLru.begin(), mLru, entry->lruPos);
+    return &entry->texture;
+  }
+
+
+  void ThumbnailCache::evict(void)
+  {
+    while (mResidentBytes > mBudget && mLru.size() > 1) {
+      Entry *entry = mLru.back();
+      mLru.pop_back();
+      mResidentBytes -= 4 * entry->texture.getSize().x * entry->texture.getSize().y;
+      mEntries.erase(entry->hash);
+    }
+  }
+
+}
@@ -0,0 +1,90 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __THUMBNAILCACHE_H_
+#define __THUMBNAILCACHE_H_
+
+#include <SFML/Graphics.hpp>
+
+#include <string>
+#include <map>
+#include <list>
+#include <memory>
+
+#include "AssetManager.h"
+
+namespace Impact {
+
+  class Level;
+
+  /* Keeps thumbnails of the levels on disk, in the level cache directory
+   * and named after the level's hash, so they are rendered only once per
+   * level. The select screen gets them as textures, which are loaded by
+   * the asset manager in the background. If the textures exceed the
+   * budget, the least recently shown thumbnails are dropped and loaded
+   * again when they're needed next time.
+   */
+  class ThumbnailCache {
+  public:
+    ThumbnailCache(AssetManager &assets, const std::string &cacheDir, std::size_t budget = DefaultBudget);
+
+    /// renders the thumbnail of a level which has just been loaded, unless it's on disk already;
+    /// may be called from any thread
+    bool store(const Level &level) const;
+    std::string filename(const std::string &hash) const;
+
+    /// the thumbnail of the level with the given hash; null while it's being loaded
+    const sf::Texture *get(const std::string &hash);
+
+    /// bytes of the textures held by the cache
+    inline std::size_t residentBytes(void) const
+    {
+      return mResidentBytes;
+    }
+
+    static const unsigned int DefaultPixelsPerTile = 4;
+    static const std::size_t DefaultBudget = 4 * 1024 * 1024;
+
+  private:
+    struct Entry {
+      std::string hash;
+      sf::Image image;
+      sf::Texture texture;
+      bool loaded;
+      std::list<Entry*>::iterator lruPos;
+    };
+    typedef std::shared_ptr<Entry> EntryPtr;
+    typedef std::list<Entry*> LruList;
+
+    AssetManager &mAssets;
+    /// taken from the local settings on construction, so that store() needn't read them
+    const std::string mCacheDir;
+    std::map<std::string, EntryPtr> mEntries;
+    /// loaded thumbnails, the most recently shown first
+    LruList mLru;
+    std::size_t mBudget;
+    std::size_t mResidentBytes;
+
+    void evict(void);
+  };
+
+}
+
+#endif // __THUMBNAILCACHE_H_
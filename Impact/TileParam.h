@@ -46,6 +46,8 @@ namespace Impact {
     { /* ... */ }
     TileParam(const TileParam &other)
       : score(other.score)
+      , textureName(other.textureName)
+      , texture(other.texture)
       , fixed(other.fixed)
       , density(other.density)
       , friction(other.friction)
@@ -28,19 +28,29 @@ namespace Impact {
   const float32 Wall::DefaultRestitution = .5f;
 
 
-  Wall::Wall(int index, Game *game, const TileParam &tileParam)
+  Wall::Wall(int index, Game *game, const TileParam &tileParam, bool solid)
     : Body(Body::BodyType::Wall, game, tileParam)
   {
     mName = Name;
-    mTexture = mGame->level()->tileParam(index).texture;
-
-    setHalfTextureSize(mTexture);
-
-    const float halfW = .5f * mTexture.getSize().x;
-    const float halfH = .5f * mTexture.getSize().y;
-
-    mSprite.setTexture(mTexture);
-    mSprite.setOrigin(halfW, halfH);
+    const sf::Vector2u &size = mGame->level()->tileSize(index);
+    setHalfTextureSize(size);
+
+    const float halfW = .5f * size.x;
+    const float halfH = .5f * size.y;
+
+    // headless games never draw, so they need no textures of their own
+    if (!mGame->isHeadless()) {
+      // all walls of a kind share one texture, so that they can be drawn in one go
+      sf::Texture &texture = mGame->tileTexture(index);
+      if (texture.getSize().x == 0)
+        texture = mGame->level()->tileParam(index).texture;
+      mSprite.setTexture(texture);
+      mSprite.setOrigin(halfW, halfH);
+    }
+
+    // the collision shape of a merged wall tile belongs to the outline wall
+    if (!solid)
+      return;
 
     b2BodyDef bd;
     bd.type = b2_staticBody;
@@ -60,6 +70,32 @@ namespace Impact {
   }
 
 
+  Wall::Wall(Game *game, const std::vector<WallOutline> &outlines)
+    : Body(Body::BodyType::Wall, game)
+  {
+    mName = Name;
+
+    b2BodyDef bd;
+    bd.type = b2_staticBody;
+    bd.userData = this;
+    mBody = game->world()->CreateBody(&bd);
+
+    for (std::vector<WallOutline>::const_iterator outline = outlines.cbegin(); outline != outlines.cend(); ++outline) {
+      const TileParam &tileParam = mGame->level()->tileParam(outline->tileId);
+      b2ChainShape chain;
+      chain.CreateLoop(outline->vertices.data(), int32(outline->vertices.size()));
+
+      b2FixtureDef fd;
+      fd.density = tileParam.density.isValid() ? tileParam.density.get() : DefaultDensity;
+      fd.restitution = tileParam.restitution.isValid() ? tileParam.restitution.get() : DefaultRestitution;
+      fd.friction = tileParam.friction.isValid() ? tileParam.friction.get() : DefaultFriction;
+      fd.shape = &chain;
+      fd.userData = this;
+      mBody->CreateFixture(&fd);
+    }
+  }
+
+
   void Wall::setPosition(int x, int y)
   {
     setPosition(b2Vec2(float32(x), float32(y)));
@@ -68,6 +104,11 @@ namespace Impact {
 
   void Wall::setPosition(const b2Vec2 &pos)
   {
+    if (mBody == nullptr) {
+      const b2Vec2 &p = pos + b2Vec2(mHalfTextureSize.x, 1 - mHalfTextureSize.y);
+      mSprite.setPosition(Game::Scale * p.x, Game::Scale * p.y);
+      return;
+    }
     Body::setPosition(pos);
     const b2Vec2 &p = mBody->GetPosition();
     mSprite.setPosition(Game::Scale * p.x, Game::Scale * p.y);
@@ -80,9 +121,17 @@ namespace Impact {
   }
 
 
+  void Wall::enqueue(RenderQueue &queue) const
+  {
+    if (mSprite.getTexture() != nullptr)
+      queue.add(mSprite, mZIndex);
+  }
+
+
   void Wall::onDraw(sf::RenderTarget &target, sf::RenderStates states) const
   {
-    target.draw(mSprite, states);
+    if (mSprite.getTexture() != nullptr)
+      target.draw(mSprite, states);
   }
 
 
@@ -32,11 +32,13 @@ namespace Impact {
   class Wall : public Body
   {
   public:
-    Wall(int index, Game *game, const TileParam &tileParam);
+    Wall(int index, Game *game, const TileParam &tileParam, bool solid = true);
+    Wall(Game *game, const std::vector<WallOutline> &outlines);
 
     // Body implementation
     virtual void onUpdate(float elapsedSeconds);
     virtual void onDraw(sf::RenderTarget &target, sf::RenderStates states) const;
+    virtual void enqueue(RenderQueue &queue) const;
     virtual BodyType type(void) const { return Body::BodyType::Wall; }
 
     virtual void setPosition(int x, int y);
@@ -0,0 +1,346 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "stdafx.h"
+#include "XmlReader.h"
+
+namespace Impact {
+
+  static inline bool isWhitespace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+
+  static inline bool isNameChar(char c)
+  {
+    return !isWhitespace(c) && c != '=' && c != '>' && c != '/' && c != '<' && c != '"' && c != '\'' && c != '\0';
+  }
+
+
+  static void appendUtf8(std::string &out, unsigned long cp)
+  {
+    if (cp < 0x80) {
+      out += char(cp);
+    }
+    else if (cp < 0x800) {
+      out += char(0xc0 | (cp >> 6));
+      out += char(0x80 | (cp & 0x3f));
+    }
+    else if (cp < 0x10000) {
+      out += char(0xe0 | (cp >> 12));
+      out += char(0x80 | ((cp >> 6) & 0x3f));
+      out += char(0x80 | (cp & 0x3f));
+    }
+    else {
+      out += char(0xf0 | (cp >> 18));
+      out += char(0x80 | ((cp >> 12) & 0x3f));
+      out += char(0x80 | ((cp >> 6) & 0x3f));
+      out += char(0x80 | (cp & 0x3f));
+    }
+  }
+
+
+  std::string XmlReader::Range::str(void) const
+  {
+    const char *amp = static_cast<const char*>(std::memchr(begin, '&', size()));
+    if (amp == nullptr)
+      return std::string(begin, end);
+    std::string result(begin, amp);
+    const char *p = amp;
+    while (p < end) {
+      if (*p != '&') {
+        result += *p++;
+        continue;
+      }
+      const char *semicolon = static_cast<const char*>(std::memchr(p, ';', end - p));
+      if (semicolon == nullptr) {
+        result.append(p, end);
+        break;
+      }
+      const std::string entity(p + 1, semicolon);
+      if (entity == "amp")
+        result += '&';
+      else if (entity == "lt")
+        result += '<';
+      else if (entity == "gt")
+        result += '>';
+      else if (entity == "quot")
+        result += '"';
+      else if (entity == "apos")
+        result += '\'';
+      else if (entity.size() > 1 && entity[0] == '#')
+        appendUtf8(result, entity[1] == 'x' ? std::strtoul(entity.c_str() + 2, nullptr, 16) : std::strtoul(entity.c_str() + 1, nullptr, 10));
+      else
+        result.append(p, semicolon + 1);
+      p = semicolon + 1;
+    }
+    return result;
+  }
+
+
+  XmlReader::XmlReader(void)
+    : mData(nullptr)
+    , mEnd(nullptr)
+    , mPos(nullptr)
+    , mDepth(0)
+    , mPendingEnd(false)
+  { /* ... */ }
+
+
+  bool XmlReader::open(const std::string &filename)
+  {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.is_open()) {
+      mErrorString = "cannot open " + filename;
+      return false;
+    }
+    in.seekg(0, std::ios::end);
+    const std::streamoff size = in.tellg();
+    in.seekg(0, std::ios::beg);
+    mBuffer.resize(std::size_t(size));
+    if (size > 0)
+      in.read(&mBuffer[0], size);
+    if (!in) {
+      mErrorString = "cannot read " + filename;
+      return false;
+    }
+    setData(mBuffer.empty() ? nullptr : &mBuffer[0], mBuffer.size());
+    return true;
+  }
+
+
+  void XmlReader::setData(const char *data, std::size_t size)
+  {
+    mData = data;
+    mEnd = data + size;
+    mPos = data;
+    mDepth = 0;
+    mPendingEnd = false;
+    mErrorString.clear();
+  }
+
+
+  int XmlReader::line(void) const
+  {
+    return 1 + int(std::count(mData, mPos, '\n'));
+  }
+
+
+  XmlReader::Token XmlReader::fail(const char *message)
+  {
+    mErrorString = message;
+    return Error;
+  }
+
+
+  void XmlReader::skipWhitespace(void)
+  {
+    while (mPos < mEnd && isWhitespace(*mPos))
+      ++mPos;
+  }
+
+
+  bool XmlReader::skipPast(const char *terminator)
+  {
+    const std::size_t n = std::strlen(terminator);
+    const char *found = std::search(mPos, mEnd, terminator, terminator + n);
+    if (found == mEnd)
+      return false;
+    mPos = found + n;
+    return true;
+  }
+
+
+  XmlReader::Range XmlReader::readName(void)
+  {
+    Range name;
+    name.begin = mPos;
+    while (mPos < mEnd && isNameChar(*mPos))
+      ++mPos;
+    name.end = mPos;
+    return name;
+  }
+
+
+  XmlReader::Token XmlReader::next(void)
+  {
+    if (mPendingEnd) {
+      // the end of an empty element like <image/>
+      mPendingEnd = false;
+      --mDepth;
+      return EndElement;
+    }
+    for (;;) {
+      const char *textBegin = mPos;
+      while (mPos < mEnd && *mPos != '<')
+        ++mPos;
+      if (mPos > textBegin && mDepth > 0) {
+        const char *p = textBegin;
+        while (p < mPos && isWhitespace(*p))
+          ++p;
+        if (p < mPos) {
+          mText.begin = textBegin;
+          mText.end = mPos;
+          return Text;
+        }
+      }
+      if (mPos >= mEnd)
+        return mDepth == 0 ? EndOfDocument : fail("unexpected end of document");
+
+      const std::size_t left = std::size_t(mEnd - mPos);
+      if (left >= 2 && mPos[1] == '?') {
+        if (!skipPast("?>"))
+          return fail("unterminated processing instruction");
+      }
+      else if (left >= 4 && std::memcmp(mPos, "<!--", 4) == 0) {
+        if (!skipPast("-->"))
+          return fail("unterminated comment");
+      }
+      else if (left >= 9 && std::memcmp(mPos, "<![CDATA[", 9) == 0) {
+        mText.begin = mPos + 9;
+        if (!skipPast("]]>"))
+          return fail("unterminated CDATA section");
+        mText.end = mPos - 3;
+        return Text;
+      }
+      else if (left >= 2 && mPos[1] == '!') {
+        if (!skipPast(">"))
+          return fail("unterminated declaration");
+      }
+      else if (left >= 2 && mPos[1] == '/') {
+        return readEndElement();
+      }
+      else {
+        return readStartElement();
+      }
+    }
+  }
+
+
+  XmlReader::Token XmlReader::readStartElement(void)
+  {
+    ++mPos;
+    mName = readName();
+    if (mName.empty())
+      return fail("element name expected");
+    mAttributes.clear();
+    for (;;) {
+      skipWhitespace();
+      if (mPos >= mEnd)
+        return fail("unterminated start tag");
+      if (*mPos == '>') {
+        ++mPos;
+        ++mDepth;
+        return StartElement;
+      }
+      if (*mPos == '/') {
+        if (mPos + 1 >= mEnd || mPos[1] != '>')
+          return fail("'>' expected");
+        mPos += 2;
+        ++mDepth;
+        mPendingEnd = true;
+        return StartElement;
+      }
+      const Range &attrName = readName();
+      if (attrName.empty())
+        return fail("attribute name expected");
+      skipWhitespace();
+      if (mPos >= mEnd || *mPos != '=')
+        return fail("'=' expected");
+      ++mPos;
+      skipWhitespace();
+      if (mPos >= mEnd || (*mPos != '"' && *mPos != '\''))
+        return fail("quoted attribute value expected");
+      const char quote = *mPos++;
+      Range value;
+      value.begin = mPos;
+      while (mPos < mEnd && *mPos != quote)
+        ++mPos;
+      if (mPos >= mEnd)
+        return fail("unterminated attribute value");
+      value.end = mPos++;
+      mAttributes.push_back(std::make_pair(attrName, value));
+    }
+  }
+
+
+  XmlReader::Token XmlReader::readEndElement(void)
+  {
+    mPos += 2;
+    mName = readName();
+    skipWhitespace();
+    if (mPos >= mEnd || *mPos != '>')
+      return fail("unterminated end tag");
+    ++mPos;
+    if (--mDepth < 0)
+      return fail("unbalanced end tag");
+    return EndElement;
+  }
+
+
+  bool XmlReader::skipElement(void)
+  {
+    const int depth = mDepth;
+    for (;;) {
+      const Token token = next();
+      if (token == Error || token == EndOfDocument)
+        return false;
+      if (token == EndElement && mDepth < depth)
+        return true;
+    }
+  }
+
+
+  bool XmlReader::readNextChild(int parentDepth)
+  {
+    while (mDepth > parentDepth) {
+      if (!skipElement())
+        return false;
+    }
+    for (;;) {
+      const Token token = next();
+      if (token == StartElement)
+        return true;
+      if (token != Text)
+        return false;
+    }
+  }
+
+
+  const XmlReader::Range *XmlReader::attribute(const char *name) const
+  {
+    for (std::vector<std::pair<Range, Range> >::const_iterator a = mAttributes.cbegin(); a != mAttributes.cend(); ++a)
+      if (a->first == name)
+        return &a->second;
+    return nullptr;
+  }
+
+
+  bool XmlReader::attribute(const char *name, std::string &value) const
+  {
+    const Range *range = attribute(name);
+    if (range == nullptr)
+      return false;
+    value = range->str();
+    return true;
+  }
+
+}
@@ -0,0 +1,178 @@
+/*  
+
+    Copyright (c) 2015 Oliver Lau <ola@ct.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __XMLREADER_H_
+#define __XMLREADER_H_
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <locale>
+#include <cstring>
+
+#include "util.h"
+
+namespace Impact {
+
+  /* A pull parser for the XML written by map editors like Tiled: elements,
+   * attributes, character data, CDATA sections, comments and processing
+   * instructions, but no DTDs. It works in place on a buffer holding the
+   * whole document, so names, attribute values and text are handed out as
+   * ranges of that buffer instead of being copied into a tree first.
+   */
+  class XmlReader {
+  public:
+    typedef enum _Token {
+      StartElement,
+      EndElement,
+      Text,
+      EndOfDocument,
+      Error
+    } Token;
+
+    struct Range {
+      Range(void)
+        : begin(nullptr)
+        , end(nullptr)
+      { /* ... */ }
+      inline std::size_t size(void) const
+      {
+        return std::size_t(end - begin);
+      }
+      inline bool empty(void) const
+      {
+        return begin == end;
+      }
+      inline bool operator==(const char *s) const
+      {
+        const std::size_t n = std::strlen(s);
+        return n == size() && std::memcmp(begin, s, n) == 0;
+      }
+      inline bool operator!=(const char *s) const
+      {
+        return !(*this == s);
+      }
+      /// a copy with character and entity references resolved
+      std::string str(void) const;
+      const char *begin;
+      const char *end;
+    };
+
+    XmlReader(void);
+
+    bool open(const std::string &filename);
+    void setData(const char *data, std::size_t size);
+
+    Token next(void);
+    /// skips everything up to and including the end tag of the current element
+    bool skipElement(void);
+    /// advances to the next child of the element opened at parentDepth,
+    /// skipping whatever is left of the previous child; false once the
+    /// parent element ends or the document is malformed
+    bool readNextChild(int parentDepth);
+
+    inline const Range &name(void) const
+    {
+      return mName;
+    }
+    inline const Range &text(void) const
+    {
+      return mText;
+    }
+    inline int depth(void) const
+    {
+      return mDepth;
+    }
+    inline bool hasError(void) const
+    {
+      return !mErrorString.empty();
+    }
+    inline const std::string &errorString(void) const
+    {
+      return mErrorString;
+    }
+    int line(void) const;
+
+    const Range *attribute(const char *name) const;
+    bool attribute(const char *name, std::string &value) const;
+    template <typename T>
+    T attribute(const char *name, const T &defaultValue) const
+    {
+      const Range *value = attribute(name);
+      return value != nullptr ? convert(value->str(), defaultValue) : defaultValue;
+    }
+
+    /// converts like boost::property_tree, i.e. in the classic locale
+    template <typename T>
+    static T convert(const std::string &value, const T &defaultValue)
+    {
+      std::istringstream in(value);
+      in.imbue(std::locale::classic());
+      T result;
+      in >> result;
+      if (in.fail() || !(in >> std::ws).eof())
+        return defaultValue;
+      return result;
+    }
+
+  private:
+    std::vector<char> mBuffer;
+    const char *mData;
+    const char *mEnd;
+    const char *mPos;
+    int mDepth;
+    bool mPendingEnd;
+    Range mName;
+    Range mText;
+    std::vector<std::pair<Range, Range> > mAttributes;
+    std::string mErrorString;
+
+    Token fail(const char *message);
+    Token readStartElement(void);
+    Token readEndElement(void);
+    bool skipPast(const char *terminator);
+    Range readName(void);
+    void skipWhitespace(void);
+  };
+
+
+  template <>
+  inline std::string XmlReader::convert<std::string>(const std::string &value, const std::string &)
+  {
+    return value;
+  }
+
+  template <>
+  inline bool XmlReader::convert<bool>(const std::string &value, const bool &defaultValue)
+  {
+    const boost::optional<bool> &result = BoolTranslator().get_value(value);
+    return result ? result.get() : defaultValue;
+  }
+
+  template <>
+  inline BodyShapeType XmlReader::convert<BodyShapeType>(const std::string &value, const BodyShapeType &defaultValue)
+  {
+    const boost::optional<BodyShapeType> &result = BodyShapeTypeTranslator().get_value(value);
+    return result ? result.get() : defaultValue;
+  }
+
+}
+
+#endif // __XMLREADER_H_
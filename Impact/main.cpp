@@ -19,6 +19,7 @@
 
 
 #include "stdafx.h"
+#include "Playtest.h"
 #if defined(WIN32)
 #include <Windows.h>
 #endif
@@ -26,7 +27,38 @@
 #include <gtk/gtk.h>
 #endif
 
-Impact::Game breakout;
+
+static int playtest(int argc, char *argv[])
+{
+  Impact::PlaytestConfig config;
+  for (int i = 3; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--runs" && i + 1 < argc) {
+      std::istringstream(argv[++i]) >> config.runs;
+    }
+    else if (arg == "--threads" && i + 1 < argc) {
+      std::istringstream(argv[++i]) >> config.threads;
+    }
+    else if (arg == "--limit" && i + 1 < argc) {
+      float seconds = 0.f;
+      std::istringstream(argv[++i]) >> seconds;
+      config.timeLimit = sf::seconds(seconds);
+    }
+    else if (arg == "--policy" && i + 1 < argc) {
+      config.policy = argv[++i];
+    }
+    else if (arg == "--seed" && i + 1 < argc) {
+      std::istringstream(argv[++i]) >> config.seed;
+    }
+    else {
+      config.levels.push_back(arg);
+    }
+  }
+  Impact::Playtest playtest(config);
+  if (!playtest.run() || !playtest.save(argv[2]))
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
 
 
 int main(int argc, char *argv[])
@@ -34,7 +66,31 @@ int main(int argc, char *argv[])
 #if defined(LINUX_AMD64)   
   gtk_init(&argc, &argv);
 #endif
-  if (argc == 2) {
+  // playtests are headless, so they must not open the game's window
+  if (argc >= 3 && std::string(argv[1]) == "--playtest")
+    return playtest(argc, argv);
+
+  Impact::Game breakout;
+  if (argc >= 3 && std::string(argv[1]) == "--replay") {
+    if (!breakout.playReplay(argv[2]))
+      return EXIT_FAILURE;
+  }
+  else if (argc >= 4 && std::string(argv[1]) == "--render") {
+    unsigned int width = 1280;
+    unsigned int height = 720;
+    if (argc >= 5) {
+      std::istringstream size(argv[4]);
+      char x = 0;
+      size >> width >> x >> height;
+      if (size.fail() || x != 'x') {
+        std::cerr << "Invalid video size " << argv[4] << ", expected WIDTHxHEIGHT" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    if (!breakout.renderReplay(argv[2], argv[3], width, height))
+      return EXIT_FAILURE;
+  }
+  else if (argc == 2) {
 #if defined(WIN32) && defined(CT_VERSION_INTERNAL)
     char szPath[MAX_PATH];
     char *res = _fullpath(szPath, argv[1], MAX_PATH);
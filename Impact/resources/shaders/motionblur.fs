@@ -21,15 +21,14 @@
 
 uniform sampler2D uTexture;
 uniform float uBlur;
-uniform float uRot;
-uniform vec2 uV;
 uniform vec2 uResolution;
 
 varying mat2 vRot;
 varying vec2 vTexCoord;
+varying vec2 vV;
 
 void main(void) {
-  vec2 v = 0.65 * uV / uResolution.x;
+  vec2 v = 0.65 * vV / uResolution.x;
   float blur = uBlur / uResolution.x;
   const float N = 5.0;
   vec4 sum = texture2D(uTexture, vTexCoord);
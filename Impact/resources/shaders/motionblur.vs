@@ -19,16 +19,21 @@
 
 */
 
-uniform float uRot;
+// all balls share this shader and are drawn in one go, so each one passes
+// its velocity in red and green and its angle in blue and alpha, see Ball.cpp
+const float MaxSpeed = 64.0;
 
 varying vec2 vTexCoord;
 varying mat2 vRot;
+varying vec2 vV;
 
 void main() {
   const vec2 center = vec2(0.5);
   gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
   vec4 texCoord = gl_TextureMatrix[0] * gl_MultiTexCoord0;
-  vRot = mat2(cos(uRot), sin(uRot), -sin(uRot), cos(uRot));
+  float rot = 6.2831853 * (gl_Color.b * 255.0 * 256.0 + gl_Color.a * 255.0) / 65535.0;
+  vRot = mat2(cos(rot), sin(rot), -sin(rot), cos(rot));
   vTexCoord = (texCoord.st - center) * vRot + center;
-  gl_FrontColor = gl_Color;
+  vV = 2.0 * MaxSpeed * (gl_Color.rg - 0.5);
+  gl_FrontColor = vec4(1.0);
 }
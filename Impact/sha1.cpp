@@ -35,6 +35,20 @@
 #include "stdafx.h"
 #include "sha1.h"
 
+#include <cstring>
+
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))) || (defined(_MSC_VER) && _MSC_VER >= 1900 && (defined(_M_X64) || defined(_M_IX86)))
+#define SHA1_X86_SHA 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SHA1_TARGET
+#else
+#include <cpuid.h>
+#define SHA1_TARGET __attribute__((target("sha,ssse3,sse4.1")))
+#endif
+#endif
+
 namespace sha1
 {
     namespace // local
@@ -46,16 +60,6 @@ namespace sha1
             return ((value << steps) | (value >> (32 - steps)));
         }
 
-        // Sets the first 16 integers in the buffert to zero.
-        // Used for clearing the W buffert.
-        inline void clearWBuffert(unsigned int* buffert)
-        {
-            for (int pos = 16; --pos >= 0;)
-            {
-                buffert[pos] = 0;
-            }
-        }
-
         void innerHash(unsigned int* result, unsigned int* w)
         {
             unsigned int a = result[0];
@@ -114,62 +118,228 @@ namespace sha1
             result[3] += d;
             result[4] += e;
         }
+
+        // Hash complete 64 byte blocks with the portable code.
+        void hashBlocksPortable(unsigned int* result, const unsigned char* sarray, std::size_t blocks)
+        {
+            // The reusable round buffer
+            unsigned int w[80];
+
+            for (; blocks > 0; --blocks, sarray += 64)
+            {
+                // Init the round buffer with the 64 byte block data.
+                for (int roundPos = 0; roundPos < 16; ++roundPos)
+                {
+                    // This line will swap endian on big endian and keep endian on little endian.
+                    w[roundPos] = (unsigned int) sarray[4 * roundPos + 3]
+                            | (((unsigned int) sarray[4 * roundPos + 2]) << 8)
+                            | (((unsigned int) sarray[4 * roundPos + 1]) << 16)
+                            | (((unsigned int) sarray[4 * roundPos]) << 24);
+                }
+                innerHash(result, w);
+            }
+        }
+
+#ifdef SHA1_X86_SHA
+        // Hash complete 64 byte blocks with the SHA extensions. Every
+        // sha1rnds4 does four rounds; the message words are expanded four
+        // at a time in a ring of four registers.
+        SHA1_TARGET void hashBlocksSHA(unsigned int* result, const unsigned char* sarray, std::size_t blocks)
+        {
+            const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+            __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) result), 0x1b);
+            __m128i e0 = _mm_set_epi32((int) result[4], 0, 0, 0);
+
+            for (; blocks > 0; --blocks, sarray += 64)
+            {
+                const __m128i abcdSave = abcd;
+                const __m128i e0Save = e0;
+                __m128i msg0, msg1, msg2, msg3;
+                __m128i previous;
+
+                #define sha1load(w, pos) \
+                w = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (sarray + 16 * pos)), byteSwap);
+
+                #define sha1rounds(w, func) \
+                { \
+                    const __m128i e = _mm_sha1nexte_epu32(previous, w); \
+                    previous = abcd; \
+                    abcd = _mm_sha1rnds4_epu32(abcd, e, func); \
+                }
+
+                #define sha1step(w, w1, w2, w3, func) \
+                w = _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(w, w1), w2), w3); \
+                sha1rounds(w, func)
+
+                sha1load(msg0, 0)
+                previous = abcd;
+                abcd = _mm_sha1rnds4_epu32(abcd, _mm_add_epi32(e0, msg0), 0);
+                sha1load(msg1, 1)
+                sha1rounds(msg1, 0)
+                sha1load(msg2, 2)
+                sha1rounds(msg2, 0)
+                sha1load(msg3, 3)
+                sha1rounds(msg3, 0)
+                sha1step(msg0, msg1, msg2, msg3, 0)
+                sha1step(msg1, msg2, msg3, msg0, 1)
+                sha1step(msg2, msg3, msg0, msg1, 1)
+                sha1step(msg3, msg0, msg1, msg2, 1)
+                sha1step(msg0, msg1, msg2, msg3, 1)
+                sha1step(msg1, msg2, msg3, msg0, 1)
+                sha1step(msg2, msg3, msg0, msg1, 2)
+                sha1step(msg3, msg0, msg1, msg2, 2)
+                sha1step(msg0, msg1, msg2, msg3, 2)
+                sha1step(msg1, msg2, msg3, msg0, 2)
+                sha1step(msg2, msg3, msg0, msg1, 2)
+                sha1step(msg3, msg0, msg1, msg2, 3)
+                sha1step(msg0, msg1, msg2, msg3, 3)
+                sha1step(msg1, msg2, msg3, msg0, 3)
+                sha1step(msg2, msg3, msg0, msg1, 3)
+                sha1step(msg3, msg0, msg1, msg2, 3)
+
+                #undef sha1step
+                #undef sha1rounds
+                #undef sha1load
+
+                e0 = _mm_sha1nexte_epu32(previous, e0Save);
+                abcd = _mm_add_epi32(abcd, abcdSave);
+            }
+
+            _mm_storeu_si128((__m128i*) result, _mm_shuffle_epi32(abcd, 0x1b));
+            result[4] = (unsigned int) _mm_extract_epi32(e0, 3);
+        }
+
+        bool cpuHasSHA()
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+            __cpuid(info, 1);
+            const bool sse = (info[2] & (1 << 9)) != 0 && (info[2] & (1 << 19)) != 0;
+            __cpuidex(info, 7, 0);
+            return sse && (info[1] & (1 << 29)) != 0;
+#else
+            unsigned int eax, ebx, ecx, edx;
+            if (__get_cpuid_max(0, 0) < 7 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            {
+                return false;
+            }
+            // SSSE3 and SSE4.1 are needed for the byte swap and to extract E.
+            const bool sse = (ecx & bit_SSSE3) != 0 && (ecx & bit_SSE4_1) != 0;
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            return sse && (ebx & (1 << 29)) != 0;
+#endif
+        }
+
+        const bool useSHA = cpuHasSHA();
+#else
+        const bool useSHA = false;
+#endif
+
+        inline void hashBlocks(unsigned int* result, const unsigned char* sarray, std::size_t blocks)
+        {
+#ifdef SHA1_X86_SHA
+            if (useSHA)
+            {
+                hashBlocksSHA(result, sarray, blocks);
+                return;
+            }
+#endif
+            hashBlocksPortable(result, sarray, blocks);
+        }
     } // namespace
 
-    void calc(const void* src, const int bytelength, unsigned char* hash)
+    Hasher::Hasher()
     {
-        // Init the result array.
-        unsigned int result[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+        reset();
+    }
 
+    void Hasher::reset()
+    {
+        state[0] = 0x67452301;
+        state[1] = 0xefcdab89;
+        state[2] = 0x98badcfe;
+        state[3] = 0x10325476;
+        state[4] = 0xc3d2e1f0;
+        blockFill = 0;
+        length = 0;
+    }
+
+    void Hasher::update(const void* src, std::size_t bytelength)
+    {
         // Cast the void src pointer to be the byte array we can work with.
         const unsigned char* sarray = (const unsigned char*) src;
+        length += bytelength;
 
-        // The reusable round buffer
-        unsigned int w[80];
-
-        // Loop through all complete 64byte blocks.
-        const int endOfFullBlocks = bytelength - 64;
-        int endCurrentBlock;
-        int currentBlock = 0;
-
-        while (currentBlock <= endOfFullBlocks)
+        // Complete the block left over from the last piece first.
+        if (blockFill > 0)
         {
-            endCurrentBlock = currentBlock + 64;
-
-            // Init the round buffer with the 64 byte block data.
-            for (int roundPos = 0; currentBlock < endCurrentBlock; currentBlock += 4)
+            const std::size_t n = (64 - blockFill < bytelength) ? 64 - blockFill : bytelength;
+            memcpy(block + blockFill, sarray, n);
+            blockFill += n;
+            sarray += n;
+            bytelength -= n;
+            if (blockFill < 64)
             {
-                // This line will swap endian on big endian and keep endian on little endian.
-                w[roundPos++] = (unsigned int) sarray[currentBlock + 3]
-                        | (((unsigned int) sarray[currentBlock + 2]) << 8)
-                        | (((unsigned int) sarray[currentBlock + 1]) << 16)
-                        | (((unsigned int) sarray[currentBlock]) << 24);
+                return;
             }
-            innerHash(result, w);
+            hashBlocks(state, block, 1);
+            blockFill = 0;
+        }
+
+        // Hash all complete 64 byte blocks in place and keep the rest.
+        const std::size_t blocks = bytelength / 64;
+        if (blocks > 0)
+        {
+            hashBlocks(state, sarray, blocks);
+            sarray += 64 * blocks;
+            bytelength -= 64 * blocks;
         }
+        memcpy(block, sarray, bytelength);
+        blockFill = bytelength;
+    }
+
+    void Hasher::finish(unsigned char* hash)
+    {
+        const unsigned long long bitlength = length << 3;
 
-        // Handle the last and not full 64 byte block if existing.
-        endCurrentBlock = bytelength - currentBlock;
-        clearWBuffert(w);
-        int lastBlockBytes = 0;
-        for (;lastBlockBytes < endCurrentBlock; ++lastBlockBytes)
+        // Pad with a one bit and zeros, and append the length in bits.
+        block[blockFill++] = 0x80;
+        if (blockFill > 56)
         {
-            w[lastBlockBytes >> 2] |= (unsigned int) sarray[lastBlockBytes + currentBlock] << ((3 - (lastBlockBytes & 3)) << 3);
+            memset(block + blockFill, 0, 64 - blockFill);
+            hashBlocks(state, block, 1);
+            blockFill = 0;
         }
-        w[lastBlockBytes >> 2] |= 0x80 << ((3 - (lastBlockBytes & 3)) << 3);
-        if (endCurrentBlock >= 56)
+        memset(block + blockFill, 0, 56 - blockFill);
+        for (int i = 0; i < 8; ++i)
         {
-            innerHash(result, w);
-            clearWBuffert(w);
+            block[56 + i] = (unsigned char) (bitlength >> ((7 - i) << 3));
         }
-        w[15] = bytelength << 3;
-        innerHash(result, w);
+        hashBlocks(state, block, 1);
 
         // Store hash in result pointer, and make sure we get in in the correct order on both endian models.
         for (int hashByte = 20; --hashByte >= 0;)
         {
-            hash[hashByte] = (result[hashByte >> 2] >> (((3 - hashByte) & 0x3) << 3)) & 0xff;
+            hash[hashByte] = (state[hashByte >> 2] >> (((3 - hashByte) & 0x3) << 3)) & 0xff;
         }
+        reset();
+    }
+
+    bool hardwareAccelerated()
+    {
+        return useSHA;
+    }
+
+    void calc(const void* src, const int bytelength, unsigned char* hash)
+    {
+        Hasher hasher;
+        hasher.update(src, bytelength);
+        hasher.finish(hash);
     }
 
     void toHexString(const unsigned char* hash, char* hexstring)
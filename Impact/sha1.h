@@ -28,9 +28,47 @@
 #ifndef SHA1_DEFINED
 #define SHA1_DEFINED
 
+#include <cstddef>
+
 namespace sha1
 {
 
+    /**
+     Hashes data which arrives in pieces, e.g. while a file is read, so it never
+     has to be held in memory as a whole. Full blocks are hashed with the SHA
+     extensions of the CPU if it has them.
+     */
+    class Hasher
+    {
+    public:
+        Hasher();
+
+        void reset();
+
+        /**
+         @param src points to the next piece of the data to be hashed.
+         @param bytelength the number of bytes to hash from the src pointer.
+         */
+        void update(const void* src, std::size_t bytelength);
+
+        /**
+         Hashes the remaining data and resets the hasher.
+         @param hash should point to a buffer of at least 20 bytes of size for storing the sha1 result in.
+         */
+        void finish(unsigned char* hash);
+
+    private:
+        unsigned int state[5];
+        unsigned char block[64];
+        std::size_t blockFill;
+        unsigned long long length;
+    };
+
+    /**
+     @return true if the SHA extensions of the CPU are used.
+     */
+    bool hardwareAccelerated();
+
     /**
      @param src points to any kind of data to be hashed.
      @param bytelength the number of bytes to hash from the src pointer.
@@ -69,7 +69,7 @@
 #include "LocalSettings.h"
 #include "globals.h"
 #include "Easings.h"
-#include "Timer.h"
+#include "SimulationClock.h"
 #include "TileParam.h"
 #include "Level.h"
 #include "Destructible.h"
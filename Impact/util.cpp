@@ -23,25 +23,6 @@
 
 namespace Impact {
 
-  // from http://www.adp-gmbh.ch/cpp/common/base64.html
-
-  static const std::string base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-  static inline bool is_base64(unsigned char c) {
-    bool yes = (isalnum(c) || (c == '+') || (c == '/'));
-    return yes;
-  }
-
-  // trim from end
-  static inline std::string &rtrim(std::string &s) {
-    s.erase(std::remove(s.begin(), s.end(), '\n'), s.end() );
-    s.erase(std::remove(s.begin(), s.end(), '\r'), s.end() );
-    s.erase(std::remove(s.begin(), s.end(), ' '), s.end() );
-    return s;
-  }
-
-
-
   bool fileExists(const std::string &filename)
   {
     struct stat buffer;
@@ -49,48 +30,76 @@ namespace Impact {
   }
 
 
-  bool base64_decode(std::string base64, uint8_t *&buf, unsigned long &sz) {
-    std::string encodedString = rtrim(base64);
-    std::size_t inLen = encodedString.size();
-    int i = 0;
-    int j = 0;
-    int idx = 0;
-    unsigned char char_array_4[4];
-    unsigned char char_array_3[3];
-    std::vector<uint8> ret;
-    while (inLen-- && (encodedString[idx] != '=') && is_base64(encodedString[idx])) {
-      char_array_4[i++] = encodedString[idx++];
-      if (i == 4) {
-        for (i = 0; i < 4; ++i)
-          char_array_4[i] = base64_chars.find(char_array_4[i]);
-        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-        for (i = 0; (i < 3); ++i)
-          ret.push_back(char_array_3[i]);
-        i = 0;
+  static const uint8_t Base64Skip = 0xfe;
+  static const uint8_t Base64Pad = 0xfd;
+
+  // values of the base64 digits; whitespace is skipped, '=' ends the data
+  // and everything else (0xff) is invalid
+  static const uint8_t Base64Table[256] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe, 0xfe, 0xff, 0xff, 0xfe, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xfd, 0xff, 0xff,
+    0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+  };
+
+
+  std::size_t Base64Decoder::decode(const char *&in, const char *end, uint8_t *out, std::size_t outSize)
+  {
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(in);
+    const uint8_t *const pEnd = reinterpret_cast<const uint8_t*>(end);
+    uint8_t *o = out;
+    uint8_t *const oEnd = out + outSize;
+    for (;;) {
+      if (mNumBits == 0) {
+        // fast path: four digits in a row make three bytes
+        while (pEnd - p >= 4 && oEnd - o >= 3) {
+          const uint32_t a = Base64Table[p[0]];
+          const uint32_t b = Base64Table[p[1]];
+          const uint32_t c = Base64Table[p[2]];
+          const uint32_t d = Base64Table[p[3]];
+          if (((a | b | c | d) & 0xc0) != 0)
+            break;
+          const uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+          o[0] = uint8_t(v >> 16);
+          o[1] = uint8_t(v >> 8);
+          o[2] = uint8_t(v);
+          o += 3;
+          p += 4;
+        }
+      }
+      if (p == pEnd || o == oEnd)
+        break;
+      const uint8_t v = Base64Table[*p++];
+      if (v == Base64Skip)
+        continue;
+      if (v > 63) {
+        if (v != Base64Pad)
+          mFailed = true;
+        p = pEnd;
+        break;
+      }
+      mBits = (mBits << 6) | v;
+      mNumBits += 6;
+      if (mNumBits >= 8) {
+        mNumBits -= 8;
+        *o++ = uint8_t(mBits >> mNumBits);
+        mBits &= (1U << mNumBits) - 1;
       }
     }
-    if (i) {
-      for (j = i; j < 4; ++j)
-        char_array_4[j] = 0;
-      for (j = 0; j  <4; ++j)
-        char_array_4[j] = base64_chars.find(char_array_4[j]);
-      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-      for (j = 0; (j < i - 1); ++j)
-        ret.push_back(char_array_3[j]);
-    }
-    sz = ret.size();
-    if (sz == 0) {
-      buf = nullptr;
-      return false;
-    }
-    buf = new uint8_t[sz];
-    for (std::size_t i = 0; i < sz; ++i)
-      buf[i] = ret.at(i);
-    return true;
+    in = reinterpret_cast<const char*>(p);
+    return std::size_t(o - out);
   }
 
 
@@ -22,6 +22,7 @@
 #define __UTIL_H_
 
 #include <string>
+#include <vector>
 #include <cstdint>
 #include <cassert>
 
@@ -32,7 +33,6 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
-#include <boost/multiprecision/cpp_int.hpp>
 
 namespace Impact {
   typedef enum _BodyShapeType {
@@ -227,23 +227,59 @@ namespace Impact {
   };
 
 
-  template <typename T>
-  std::string base62_encode(const uint8_t *const buf, int n) {
-    T x = 0;
-    for (int i = 0; i < n; ++i) {
-      x += buf[i];
-      x *= 256;
-    }
+  /// encodes the bytes, followed by a zero byte, as a number in base 62, least significant
+  /// digit first; the number is held in 32 bit words, most significant first, and divided
+  /// word by word, so no big integer arithmetic is needed
+  inline std::string base62_encode(const uint8_t *const buf, int n) {
+    const int nBytes = n + 1;
+    const int nWords = (nBytes + 3) / 4;
+    const int pad = 4 * nWords - nBytes;
+    std::vector<uint32_t> x(nWords, 0);
+    for (int i = 0; i < n; ++i)
+      x[(i + pad) / 4] |= uint32_t(buf[i]) << (8 * (3 - (i + pad) % 4));
     static const char a[62+1] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-    std::stringstream base62;
-    while (x != 0) {
-      base62 << a[int(x % 62)];
-      x /= 62;
+    std::string base62;
+    int first = 0;
+    for (;;) {
+      while (first < nWords && x[first] == 0)
+        ++first;
+      if (first == nWords)
+        break;
+      uint64_t remainder = 0;
+      for (int i = first; i < nWords; ++i) {
+        const uint64_t dividend = (remainder << 32) | x[i];
+        x[i] = uint32_t(dividend / 62);
+        remainder = dividend % 62;
+      }
+      base62 += a[remainder];
+    }
+    return base62;
+  }
+
+  /// decodes base64 text piece by piece, skipping whitespace, so that the
+  /// bytes can be written to their final destination (or fed to zlib)
+  /// without buffering the whole decoded data first
+  class Base64Decoder {
+  public:
+    Base64Decoder(void)
+      : mBits(0)
+      , mNumBits(0)
+      , mFailed(false)
+    { /* ... */ }
+    /// decodes characters from in up to end until outSize bytes have been
+    /// written to out; advances in and returns the number of bytes written
+    std::size_t decode(const char *&in, const char *end, uint8_t *out, std::size_t outSize);
+    /// true if the text contained a character outside the base64 alphabet
+    inline bool failed(void) const
+    {
+      return mFailed;
     }
-    return base62.str();
+  private:
+    uint32_t mBits;
+    int mNumBits;
+    bool mFailed;
   };
 
-  extern bool base64_decode(std::string, uint8_t *&, unsigned long &);
   extern bool fileExists(const std::string &);
 
 }